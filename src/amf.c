@@ -22,6 +22,9 @@
 #include <string.h>
 
 #include "amf.h"
+#include "probes.h"
+#include "stats.h"
+#include "util.h"
 
 /* function common to all array types */
 static void amf_list_init(amf_list * list) {
@@ -34,6 +37,7 @@ static void amf_list_init(amf_list * list) {
 
 static amf_data * amf_list_push(amf_list * list, amf_data * data) {
     amf_node * node = (amf_node*)malloc(sizeof(amf_node));
+    stats_count_amf_allocation(sizeof(amf_node));
     if (node != NULL) {
         node->data = data;
         node->next = NULL;
@@ -56,6 +60,7 @@ static amf_data * amf_list_push(amf_list * list, amf_data * data) {
 static amf_data * amf_list_insert_before(amf_list * list, amf_node * node, amf_data * data) {
     if (node != NULL) {
         amf_node * new_node = (amf_node*)malloc(sizeof(amf_node));
+        stats_count_amf_allocation(sizeof(amf_node));
         if (new_node != NULL) {
             new_node->next = node;
             new_node->prev = node->prev;
@@ -78,6 +83,7 @@ static amf_data * amf_list_insert_before(amf_list * list, amf_node * node, amf_d
 static amf_data * amf_list_insert_after(amf_list * list, amf_node * node, amf_data * data) {
     if (node != NULL) {
         amf_node * new_node = (amf_node*)malloc(sizeof(amf_node));
+        stats_count_amf_allocation(sizeof(amf_node));
         if (new_node != NULL) {
             new_node->next = node->next;
             new_node->prev = node;
@@ -205,6 +211,7 @@ static size_t buffer_write(const void * in_buffer, size_t size, void * user_data
 /* allocate an AMF data object */
 amf_data * amf_data_new(byte type) {
     amf_data * data = (amf_data*)malloc(sizeof(amf_data));
+    stats_count_amf_allocation(sizeof(amf_data));
     if (data != NULL) {
         data->type = type;
         data->error_code = AMF_ERROR_OK;
@@ -230,12 +237,12 @@ size_t amf_data_buffer_write(amf_data * data, byte * buffer, size_t maxbytes) {
 
 /* callback function to read data from a file stream */
 static size_t file_read(void * out_buffer, size_t size, void * user_data) {
-    return fread(out_buffer, sizeof(byte), size, (FILE *)user_data);
+    return stats_fread(out_buffer, sizeof(byte), size, (FILE *)user_data);
 }
 
 /* callback function to write data to a file stream */
 static size_t file_write(const void * in_buffer, size_t size, void * user_data) {
-    return fwrite(in_buffer, sizeof(byte), size, (FILE *)user_data);
+    return stats_fwrite(in_buffer, sizeof(byte), size, (FILE *)user_data);
 }
 
 /* load AMF data from a file stream */
@@ -285,6 +292,7 @@ static amf_data * amf_string_read(amf_read_proc read_proc, void * user_data) {
     }
 
     buffer = (byte*)calloc(strsize, sizeof(byte));
+    stats_count_amf_allocation(strsize);
     if (buffer == NULL) {
         return NULL;
     }
@@ -463,7 +471,7 @@ static amf_data * amf_date_read(amf_read_proc read_proc, void * user_data) {
 }
 
 /* load AMF data from stream */
-amf_data * amf_data_read(amf_read_proc read_proc, void * user_data) {
+static amf_data * amf_data_read_value(amf_read_proc read_proc, void * user_data) {
     byte type;
     if (read_proc(&type, sizeof(byte), user_data) < sizeof(byte)) {
         return amf_data_error(AMF_ERROR_EOF);
@@ -500,6 +508,15 @@ amf_data * amf_data_read(amf_read_proc read_proc, void * user_data) {
     }
 }
 
+amf_data * amf_data_read(amf_read_proc read_proc, void * user_data) {
+    amf_data * data;
+
+    FLVMETA_PROBE0(amf_read_start);
+    data = amf_data_read_value(read_proc, user_data);
+    FLVMETA_PROBE1(amf_read_done, amf_data_get_type(data));
+    return data;
+}
+
 /* determines the size of the given AMF data */
 size_t amf_data_size(const amf_data * data) {
     size_t s = 0;
@@ -727,7 +744,7 @@ amf_data * amf_data_clone(const amf_data * data) {
             case AMF_TYPE_BOOLEAN: return amf_boolean_new(amf_boolean_get_value(data));
             case AMF_TYPE_STRING:
                 if (data->string_data.mbstr != NULL) {
-                    return amf_string_new((byte *)strdup((char *)amf_string_get_bytes(data)), amf_string_get_size(data));
+                    return amf_string_new(amf_string_get_bytes(data), amf_string_get_size(data));
                 }
                 else {
                     return amf_str(NULL);
@@ -781,73 +798,77 @@ void amf_data_free(amf_data * data) {
     }
 }
 
-/* dump AMF data into a stream as text */
-void amf_data_dump(FILE * stream, const amf_data * data, int indent_level) {
+/* dump AMF data into a sink as text */
+void amf_data_dump(output_sink * out, const amf_data * data, int indent_level) {
     if (data != NULL) {
         amf_node * node;
         time_t time;
-        struct tm * t;
+        struct tm t;
         char datestr[128];
         switch (data->type) {
             case AMF_TYPE_NUMBER:
-                fprintf(stream, "%.12g", data->number_data);
+                sink_printf(out, "%.12g", data->number_data);
                 break;
             case AMF_TYPE_BOOLEAN:
-                fprintf(stream, "%s", (data->boolean_data) ? "true" : "false");
+                sink_write_z(out, (data->boolean_data) ? "true" : "false");
                 break;
             case AMF_TYPE_STRING:
-                fprintf(stream, "\'%.*s\'", data->string_data.size, data->string_data.mbstr);
+                sink_write_char(out, '\'');
+                sink_write(out, data->string_data.mbstr, data->string_data.size);
+                sink_write_char(out, '\'');
                 break;
             case AMF_TYPE_OBJECT:
                 node = amf_object_first(data);
-                fprintf(stream, "{\n");
+                sink_write_z(out, "{\n");
                 while (node != NULL) {
-                    fprintf(stream, "%*s", (indent_level+1)*4, "");
-                    amf_data_dump(stream, amf_object_get_name(node), indent_level+1);
-                    fprintf(stream, ": ");
-                    amf_data_dump(stream, amf_object_get_data(node), indent_level+1);
+                    sink_write_chars(out, ' ', (indent_level+1)*4);
+                    amf_data_dump(out, amf_object_get_name(node), indent_level+1);
+                    sink_write_z(out, ": ");
+                    amf_data_dump(out, amf_object_get_data(node), indent_level+1);
                     node = amf_object_next(node);
-                    fprintf(stream, "\n");
+                    sink_write_char(out, '\n');
                 }
-                fprintf(stream, "%*s", indent_level*4 + 1, "}");
+                sink_write_chars(out, ' ', indent_level*4);
+                sink_write_char(out, '}');
                 break;
             case AMF_TYPE_NULL:
-                fprintf(stream, "null");
+                sink_write_z(out, "null");
                 break;
             case AMF_TYPE_UNDEFINED:
-                fprintf(stream, "undefined");
+                sink_write_z(out, "undefined");
                 break;
             /*case AMF_TYPE_REFERENCE:*/
             case AMF_TYPE_ASSOCIATIVE_ARRAY:
                 node = amf_associative_array_first(data);
-                fprintf(stream, "{\n");
+                sink_write_z(out, "{\n");
                 while (node != NULL) {
-                    fprintf(stream, "%*s", (indent_level+1)*4, "");
-                    amf_data_dump(stream, amf_associative_array_get_name(node), indent_level+1);
-                    fprintf(stream, " => ");
-                    amf_data_dump(stream, amf_associative_array_get_data(node), indent_level+1);
+                    sink_write_chars(out, ' ', (indent_level+1)*4);
+                    amf_data_dump(out, amf_associative_array_get_name(node), indent_level+1);
+                    sink_write_z(out, " => ");
+                    amf_data_dump(out, amf_associative_array_get_data(node), indent_level+1);
                     node = amf_associative_array_next(node);
-                    fprintf(stream, "\n");
+                    sink_write_char(out, '\n');
                 }
-                fprintf(stream, "%*s", indent_level*4 + 1, "}");
+                sink_write_chars(out, ' ', indent_level*4);
+                sink_write_char(out, '}');
                 break;
             case AMF_TYPE_ARRAY:
                 node = amf_array_first(data);
-                fprintf(stream, "[\n");
+                sink_write_z(out, "[\n");
                 while (node != NULL) {
-                    fprintf(stream, "%*s", (indent_level+1)*4, "");
-                    amf_data_dump(stream, node->data, indent_level+1);
+                    sink_write_chars(out, ' ', (indent_level+1)*4);
+                    amf_data_dump(out, node->data, indent_level+1);
                     node = amf_array_next(node);
-                    fprintf(stream, "\n");
+                    sink_write_char(out, '\n');
                 }
-                fprintf(stream, "%*s", indent_level*4 + 1, "]");
+                sink_write_chars(out, ' ', indent_level*4);
+                sink_write_char(out, ']');
                 break;
             case AMF_TYPE_DATE:
                 time = amf_date_to_time_t(data);
-                tzset();
-                t = localtime(&time);
-                strftime(datestr, sizeof(datestr), "%a, %d %b %Y %H:%M:%S %z", t);
-                fprintf(stream, "%s", datestr);
+                flvmeta_localtime(&time, &t);
+                strftime(datestr, sizeof(datestr), "%a, %d %b %Y %H:%M:%S %z", &t);
+                sink_write_z(out, datestr);
                 break;
             /*case AMF_TYPE_SIMPLEOBJECT:*/
             case AMF_TYPE_XML: break;
@@ -915,6 +936,7 @@ amf_data * amf_string_new(byte * str, uint16 size) {
             data->string_data.size = size;
         }
         data->string_data.mbstr = (byte*)calloc(size+1, sizeof(byte));
+        stats_count_amf_allocation((size_t)size + 1);
         if (data->string_data.mbstr != NULL) {
             if (data->string_data.size > 0) {
                 memcpy(data->string_data.mbstr, str, data->string_data.size);
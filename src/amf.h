@@ -26,6 +26,7 @@
 #include <stdio.h>
 #include <time.h>
 
+#include "sink.h"
 #include "types.h"
 
 /* AMF data types */
@@ -144,8 +145,8 @@ byte       amf_data_get_error_code(const amf_data * data);
 amf_data * amf_data_clone(const amf_data * data);
 /* release the memory of AMF data */
 void       amf_data_free(amf_data * data);
-/* dump AMF data into a stream as text */
-void       amf_data_dump(FILE * stream, const amf_data * data, int indent_level);
+/* dump AMF data into a sink as text */
+void       amf_data_dump(output_sink * out, const amf_data * data, int indent_level);
 
 /* return a null AMF object with the specified error code attached to it */
 amf_data * amf_data_error(byte error_code);
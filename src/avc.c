@@ -294,3 +294,25 @@ int read_avc_resolution(flv_stream * f, uint32 body_length, uint32 * width, uint
     free(sps_buffer);
     return FLV_OK;
 }
+
+/**
+    Reads the resolution from the first SPS of an AVCDecoderConfigurationRecord
+    already read into memory, such as an avcC box payload.
+*/
+int parse_avc_resolution(const byte * record, size_t size, uint32 * width, uint32 * height) {
+    size_t sps_size;
+
+    /* configuration record, then the size of the first SPS */
+    if (size < sizeof(AVCDecoderConfigurationRecord) + sizeof(uint16)
+    || (record[5] & 0x1F) == 0) {
+        return FLV_OK;
+    }
+
+    sps_size = ((size_t)record[6] << 8) | record[7];
+    if (sps_size == 0 || sps_size > size - 8) {
+        return FLV_ERROR_EOF;
+    }
+
+    parse_sps((byte *)record + 8, sps_size, width, height);
+    return FLV_OK;
+}
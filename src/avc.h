@@ -33,6 +33,8 @@ extern "C" {
 
 int read_avc_resolution(flv_stream * f, uint32 body_length, uint32 * width, uint32 * height);
 
+int parse_avc_resolution(const byte * record, size_t size, uint32 * width, uint32 * height);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
@@ -0,0 +1,157 @@
+/*
+    FLVMeta - FLV Metadata Editor
+
+    Copyright (C) 2007-2014 Marc Noirot <marc.noirot AT gmail.com>
+
+    This file is part of FLVMeta.
+
+    FLVMeta is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    FLVMeta is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FLVMeta; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#include "cbor.h"
+
+#include <string.h>
+
+/* major types */
+#define CBOR_MAJOR_UNSIGNED     0
+#define CBOR_MAJOR_NEGATIVE     1
+#define CBOR_MAJOR_TEXT         3
+#define CBOR_MAJOR_ARRAY        4
+#define CBOR_MAJOR_MAP          5
+#define CBOR_MAJOR_TAG          6
+#define CBOR_MAJOR_SIMPLE       7
+
+/* additional information values */
+#define CBOR_INFO_UINT8         24
+#define CBOR_INFO_UINT16        25
+#define CBOR_INFO_UINT32        26
+#define CBOR_INFO_UINT64        27
+#define CBOR_INFO_INDEFINITE    31
+
+/* simple values */
+#define CBOR_SIMPLE_FALSE       20
+#define CBOR_SIMPLE_TRUE        21
+#define CBOR_SIMPLE_NULL        22
+#define CBOR_SIMPLE_UNDEFINED   23
+
+/* write a data item head, using the shortest argument encoding */
+static void cbor_write_head(output_sink * out, int major, uint64 value) {
+    byte head[9];
+    size_t size;
+
+    if (value < CBOR_INFO_UINT8) {
+        head[0] = (byte)((major << 5) | (int)value);
+        size = 1;
+    }
+    else if (value <= 0xFFU) {
+        head[0] = (byte)((major << 5) | CBOR_INFO_UINT8);
+        head[1] = (byte)value;
+        size = 2;
+    }
+    else if (value <= 0xFFFFU) {
+        head[0] = (byte)((major << 5) | CBOR_INFO_UINT16);
+        head[1] = (byte)(value >> 8);
+        head[2] = (byte)value;
+        size = 3;
+    }
+    else if (value <= 0xFFFFFFFFU) {
+        head[0] = (byte)((major << 5) | CBOR_INFO_UINT32);
+        head[1] = (byte)(value >> 24);
+        head[2] = (byte)(value >> 16);
+        head[3] = (byte)(value >> 8);
+        head[4] = (byte)value;
+        size = 5;
+    }
+    else {
+        int i;
+        head[0] = (byte)((major << 5) | CBOR_INFO_UINT64);
+        for (i = 0; i < 8; ++i) {
+            head[1 + i] = (byte)(value >> (56 - 8 * i));
+        }
+        size = 9;
+    }
+
+    sink_write(out, head, size);
+}
+
+static void cbor_write_byte(output_sink * out, int major, int info) {
+    sink_write_char(out, (char)((major << 5) | info));
+}
+
+void cbor_emit_unsigned(output_sink * out, uint64 value) {
+    cbor_write_head(out, CBOR_MAJOR_UNSIGNED, value);
+}
+
+void cbor_emit_integer(output_sink * out, sint64 value) {
+    if (value < 0) {
+        /* negative integers are encoded as -1 - n */
+        cbor_write_head(out, CBOR_MAJOR_NEGATIVE, (uint64)(-1 - value));
+    }
+    else {
+        cbor_write_head(out, CBOR_MAJOR_UNSIGNED, (uint64)value);
+    }
+}
+
+void cbor_emit_text(output_sink * out, const char * str, size_t bytes) {
+    cbor_write_head(out, CBOR_MAJOR_TEXT, bytes);
+    sink_write(out, str, bytes);
+}
+
+void cbor_emit_text_z(output_sink * out, const char * str) {
+    cbor_emit_text(out, str, strlen(str));
+}
+
+void cbor_emit_array_start(output_sink * out, uint64 size) {
+    cbor_write_head(out, CBOR_MAJOR_ARRAY, size);
+}
+
+void cbor_emit_array_start_indefinite(output_sink * out) {
+    cbor_write_byte(out, CBOR_MAJOR_ARRAY, CBOR_INFO_INDEFINITE);
+}
+
+void cbor_emit_map_start(output_sink * out, uint64 size) {
+    cbor_write_head(out, CBOR_MAJOR_MAP, size);
+}
+
+void cbor_emit_map_start_indefinite(output_sink * out) {
+    cbor_write_byte(out, CBOR_MAJOR_MAP, CBOR_INFO_INDEFINITE);
+}
+
+void cbor_emit_break(output_sink * out) {
+    cbor_write_byte(out, CBOR_MAJOR_SIMPLE, CBOR_INFO_INDEFINITE);
+}
+
+void cbor_emit_tag(output_sink * out, uint64 tag) {
+    cbor_write_head(out, CBOR_MAJOR_TAG, tag);
+}
+
+void cbor_emit_boolean(output_sink * out, byte value) {
+    cbor_write_byte(out, CBOR_MAJOR_SIMPLE, value != 0 ? CBOR_SIMPLE_TRUE : CBOR_SIMPLE_FALSE);
+}
+
+void cbor_emit_null(output_sink * out) {
+    cbor_write_byte(out, CBOR_MAJOR_SIMPLE, CBOR_SIMPLE_NULL);
+}
+
+void cbor_emit_undefined(output_sink * out) {
+    cbor_write_byte(out, CBOR_MAJOR_SIMPLE, CBOR_SIMPLE_UNDEFINED);
+}
+
+void cbor_emit_number(output_sink * out, number64 value) {
+    /* always a double-precision float, like AMF numbers */
+    number64_be be = swap_number64(value);
+    cbor_write_byte(out, CBOR_MAJOR_SIMPLE, CBOR_INFO_UINT64);
+    sink_write(out, &be, sizeof(number64_be));
+}
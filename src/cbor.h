@@ -0,0 +1,71 @@
+/*
+    FLVMeta - FLV Metadata Editor
+
+    Copyright (C) 2007-2014 Marc Noirot <marc.noirot AT gmail.com>
+
+    This file is part of FLVMeta.
+
+    FLVMeta is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    FLVMeta is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FLVMeta; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#ifndef __CBOR_H__
+#define __CBOR_H__
+
+#include "types.h"
+#include "sink.h"
+
+/**
+    This is a basic CBOR (RFC 7049) emitter.
+    It writes CBOR-encoded data items to an output sink without creating
+    an in-memory tree.
+*/
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+void cbor_emit_unsigned(output_sink * out, uint64 value);
+
+void cbor_emit_integer(output_sink * out, sint64 value);
+
+void cbor_emit_text(output_sink * out, const char * str, size_t bytes);
+
+void cbor_emit_text_z(output_sink * out, const char * str);
+
+void cbor_emit_array_start(output_sink * out, uint64 size);
+
+void cbor_emit_array_start_indefinite(output_sink * out);
+
+void cbor_emit_map_start(output_sink * out, uint64 size);
+
+void cbor_emit_map_start_indefinite(output_sink * out);
+
+void cbor_emit_break(output_sink * out);
+
+void cbor_emit_tag(output_sink * out, uint64 tag);
+
+void cbor_emit_boolean(output_sink * out, byte value);
+
+void cbor_emit_null(output_sink * out);
+
+void cbor_emit_undefined(output_sink * out);
+
+void cbor_emit_number(output_sink * out, number64 value);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __CBOR_H__ */
@@ -19,11 +19,19 @@
     along with FLVMeta; if not, write to the Free Software
     Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
 */
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
 #include "check.h"
 #include "dump.h"
 #include "info.h"
+#include "input.h"
 #include "json.h"
+#include "probes.h"
+#include "trace.h"
 #include "util.h"
+#include "xml.h"
 
 #include <math.h>
 #include <stdlib.h>
@@ -35,36 +43,47 @@
 
 #define MAX_ACCEPTABLE_TAG_BODY_LENGTH 1000000
 
+/* number of tags read from the start of the file when looking for onMetaData */
+#define MAX_METADATA_SEARCH_TAGS 16
+
 typedef struct {
+    output_sink * out;
     json_emitter je;
+    xml_writer xw;
 } check_context;
 
 /* start the report */
 static void report_start(const flvmeta_opts * opts, check_context * ctxt) {
     time_t now;
-    struct tm * t;
+    struct tm t;
     char datestr[128];
 
     if (opts->quiet)
         return;
 
     now = time(NULL);
-    tzset();
-    t = localtime(&now);
-    strftime(datestr, sizeof(datestr), "%Y-%m-%dT%H:%M:%S", t);
+    flvmeta_localtime(&now, &t);
+    strftime(datestr, sizeof(datestr), "%Y-%m-%dT%H:%M:%S", &t);
 
     if (opts->check_report_format == FLVMETA_FORMAT_XML) {
-        puts("<?xml version=\"1.0\" encoding=\"utf-8\"?>");
-        puts("<report xmlns=\"http://schemas.flvmeta.org/report/1.0/\">");
-        puts("  <metadata>");
-        printf("    <filename>%s</filename>\n", opts->input_file);
-        printf("    <creation-date>%s</creation-date>\n", datestr);
-        printf("    <generator>%s</generator>\n", PACKAGE_STRING);
-        puts("  </metadata>");
-        puts("  <messages>");
+        xml_writer_init(&ctxt->xw, ctxt->out);
+        xml_write_z(&ctxt->xw, "<?xml version=\"1.0\" encoding=\"utf-8\"?>\n");
+        xml_write_z(&ctxt->xw, "<report xmlns=\"http://schemas.flvmeta.org/report/1.0/\">\n");
+        xml_write_z(&ctxt->xw, "  <metadata>\n");
+        xml_write_z(&ctxt->xw, "    <filename>");
+        xml_write_escaped_z(&ctxt->xw, opts->input_file);
+        xml_write_z(&ctxt->xw, "</filename>\n");
+        xml_write_z(&ctxt->xw, "    <creation-date>");
+        xml_write_z(&ctxt->xw, datestr);
+        xml_write_z(&ctxt->xw, "</creation-date>\n");
+        xml_write_z(&ctxt->xw, "    <generator>");
+        xml_write_escaped_z(&ctxt->xw, PACKAGE_STRING);
+        xml_write_z(&ctxt->xw, "</generator>\n");
+        xml_write_z(&ctxt->xw, "  </metadata>\n");
+        xml_write_z(&ctxt->xw, "  <messages>\n");
     }
     else if (opts->check_report_format == FLVMETA_FORMAT_JSON) {
-        json_emit_init(&ctxt->je);
+        json_emit_init(&ctxt->je, ctxt->out);
         json_emit_object_start(&ctxt->je);
 
         json_emit_object_key_z(&ctxt->je, "filename");
@@ -87,8 +106,8 @@ static void report_end(const flvmeta_opts * opts, check_context * ctxt, uint32 e
         return;
 
     if (opts->check_report_format == FLVMETA_FORMAT_XML) {
-        puts("  </messages>");
-        puts("</report>");
+        xml_write_z(&ctxt->xw, "  </messages>\n");
+        xml_write_z(&ctxt->xw, "</report>\n");
     }
     else if (opts->check_report_format == FLVMETA_FORMAT_JSON) {
         json_emit_array_end(&ctxt->je);
@@ -101,14 +120,14 @@ static void report_end(const flvmeta_opts * opts, check_context * ctxt, uint32 e
 
         json_emit_object_end(&ctxt->je);
 
-        printf("\n");
+        sink_write_char(ctxt->out, '\n');
     }
     else {
-        printf("%u error(s), %u warning(s)\n", errors, warnings);
+        sink_printf(ctxt->out, "%u error(s), %u warning(s)\n", errors, warnings);
     }
 }
 
-/* report an error to stdout according to the current format */
+/* report an error to the report sink according to the current format */
 static void report_print_message(
     int level,
     const char * code,
@@ -117,6 +136,8 @@ static void report_print_message(
     const flvmeta_opts * opts,
     check_context * ctxt
 ) {
+    FLVMETA_PROBE4(check_message, level, code, offset, message);
+
     if (opts->quiet)
         return;
 
@@ -133,9 +154,15 @@ static void report_print_message(
 
         if (opts->check_report_format == FLVMETA_FORMAT_XML) {
             /* XML report entry */
-            printf("    <message level=\"%s\" code=\"%s\"", levelstr, code);
-            printf(" offset=\"%" FILE_OFFSET_PRINTF_FORMAT  "u\">", offset);
-            printf("%s</message>\n", message);
+            xml_write_z(&ctxt->xw, "    <message level=\"");
+            xml_write_z(&ctxt->xw, levelstr);
+            xml_write_z(&ctxt->xw, "\" code=\"");
+            xml_write_z(&ctxt->xw, code);
+            xml_write_z(&ctxt->xw, "\" offset=\"");
+            xml_write_unsigned(&ctxt->xw, (uint64)offset);
+            xml_write_z(&ctxt->xw, "\">");
+            xml_write_escaped_z(&ctxt->xw, message);
+            xml_write_z(&ctxt->xw, "</message>\n");
         }
         else if (opts->check_report_format == FLVMETA_FORMAT_JSON) {
             /* JSON report entry */
@@ -158,24 +185,37 @@ static void report_print_message(
         else {
             /* raw report entry */
             /*printf("%s:", opts->input_file);*/
-            printf("0x%.8" FILE_OFFSET_PRINTF_FORMAT "x: ", offset);
-            printf("%s %s: %s\n", levelstr, code, message);
+            sink_printf(ctxt->out, "0x%.8" FILE_OFFSET_PRINTF_FORMAT "x: ", offset);
+            sink_printf(ctxt->out, "%s %s: %s\n", levelstr, code, message);
         }
     }
 }
 
 /* convenience macros */
+#define error_budget_exhausted() \
+    (opts->check_max_errors > 0 && errors >= (uint32)opts->check_max_errors)
 #define print_info(code, offset, message) \
     report_print_message(FLVMETA_CHECK_LEVEL_INFO, code, offset, message, opts, &ctxt)
 #define print_warning(code, offset, message) \
-    if (opts->check_level <= FLVMETA_CHECK_LEVEL_WARNING) ++warnings; \
-    report_print_message(FLVMETA_CHECK_LEVEL_WARNING, code, offset, message, opts, &ctxt)
+    do { \
+        if (opts->check_level <= FLVMETA_CHECK_LEVEL_WARNING) ++warnings; \
+        report_print_message(FLVMETA_CHECK_LEVEL_WARNING, code, offset, message, opts, &ctxt); \
+    } while (0)
+/* errors beyond the error budget are neither counted nor reported */
 #define print_error(code, offset, message) \
-    if (opts->check_level <= FLVMETA_CHECK_LEVEL_ERROR) ++errors; \
-    report_print_message(FLVMETA_CHECK_LEVEL_ERROR, code, offset, message, opts, &ctxt)
+    do { \
+        if (!error_budget_exhausted()) { \
+            if (opts->check_level <= FLVMETA_CHECK_LEVEL_ERROR) ++errors; \
+            report_print_message(FLVMETA_CHECK_LEVEL_ERROR, code, offset, message, opts, &ctxt); \
+        } \
+    } while (0)
 #define print_fatal(code, offset, message) \
-    if (opts->check_level <= FLVMETA_CHECK_LEVEL_FATAL) ++errors; \
-    report_print_message(FLVMETA_CHECK_LEVEL_FATAL, code, offset, message, opts, &ctxt)
+    do { \
+        if (!error_budget_exhausted()) { \
+            if (opts->check_level <= FLVMETA_CHECK_LEVEL_FATAL) ++errors; \
+            report_print_message(FLVMETA_CHECK_LEVEL_FATAL, code, offset, message, opts, &ctxt); \
+        } \
+    } while (0)
 
 /* get string representing given AMF type */
 static const char * get_amf_type_string(byte type) {
@@ -198,7 +238,7 @@ static const char * get_amf_type_string(byte type) {
 }
 
 /* check FLV file validity */
-int check_flv_file(const flvmeta_opts * opts) {
+int check_flv_file(const flvmeta_opts * opts, output_sink * out) {
     flv_stream * flv_in;
     flv_header header;
     check_context ctxt;
@@ -227,6 +267,9 @@ int check_flv_file(const flvmeta_opts * opts) {
 
     int video_frames_number, keyframes_number;
 
+    int sampled;
+    int trace_level;
+
     prev_audio_tag = 0;
     prev_video_tag = 0;
 
@@ -242,6 +285,7 @@ int check_flv_file(const flvmeta_opts * opts) {
     have_on_last_second = 0;
     on_last_second_timestamp = 0;
     consecutive_unknown_tags = 0;
+    sampled = 0;
 
     /* file stats */
     if (flvmeta_filesize(opts->input_file, &filesize) == 0) {
@@ -249,19 +293,32 @@ int check_flv_file(const flvmeta_opts * opts) {
     }
 
     /* open file for reading */
-    flv_in = flv_open(opts->input_file);
+    flv_in = input_open(opts, opts->input_file);
     if (flv_in == NULL) {
         return ERROR_OPEN_READ;
     }
 
     errors = warnings = 0;
+    trace_level = trace_depth();
 
+    /* file information is gathered along the checks, with a sensible set of unobstrusive options */
+    opts_loc.verbose = 0;
+    opts_loc.reset_timestamps = 0;
+    opts_loc.preserve_metadata = 0;
+    opts_loc.all_keyframes = 0;
+    opts_loc.error_handling = FLVMETA_IGNORE_ERRORS;
+    opts_loc.insert_onlastsecond = 0;
+
+    flv_info_reset(&info);
+
+    ctxt.out = out;
     report_start(opts, &ctxt);
 
     /** check header **/
+    trace_begin("check header", NULL);
 
     /* check signature */
-    result = flv_read_header(flv_in, &header);
+    result = input_read_header(opts, flv_in, &header);
     if (result == FLV_ERROR_EOF) {
         print_fatal(FATAL_HEADER_EOF, 0, "unexpected end of file in header");
         goto end;
@@ -270,6 +327,7 @@ int check_flv_file(const flvmeta_opts * opts) {
         print_fatal(FATAL_HEADER_NO_SIGNATURE, 0, "FLV signature not found in header");
         goto end;
     }
+    info.header = header;
 
     /* version */
     if (header.version != FLV_VERSION) {
@@ -316,27 +374,211 @@ int check_flv_file(const flvmeta_opts * opts) {
         print_fatal(FATAL_GENERAL_NO_TAG, 13, "file does not contain tags");
         goto end;
     }
+    trace_end();
+
+    /** seek index mode: only check the onMetaData keyframes index **/
+    if (opts->check_seek_index) {
+        amf_data * keyframes, * file_times, * file_filepositions;
+        amf_node * t_node, * f_node;
+        number64 last_position;
+        uint32 keyframes_checked;
+        flv_tag tag;
+        int i;
+
+        trace_begin("check seek index", NULL);
+
+        /* look for onMetaData at the start of the file */
+        for (i = 0; on_metadata == NULL && i < MAX_METADATA_SEARCH_TAGS; ++i) {
+            if (flv_read_tag(flv_in, &tag) != FLV_OK) {
+                break;
+            }
+            if (tag.type == FLV_TAG_TYPE_META && flv_tag_get_body_length(tag) > 0) {
+                amf_data * name, * data;
+
+                name = data = NULL;
+                if (flv_read_metadata(flv_in, &name, &data) == FLV_OK
+                    && amf_data_get_type(name) == AMF_TYPE_STRING
+                    && !strcmp((char*)amf_string_get_bytes(name), "onMetaData")
+                ) {
+                    on_metadata_offset = flv_get_current_tag_offset(flv_in);
+                    on_metadata = data;
+                    data = NULL;
+                }
+                amf_data_free(name);
+                amf_data_free(data);
+            }
+        }
+
+        if (on_metadata == NULL) {
+            print_warning(WARNING_METADATA_NOT_PRESENT, flv_get_offset(flv_in), "onMetaData event not found, file might not be playable");
+            goto end;
+        }
+
+        keyframes = NULL;
+        if (amf_data_get_type(on_metadata) == AMF_TYPE_ASSOCIATIVE_ARRAY) {
+            keyframes = amf_associative_array_get(on_metadata, "keyframes");
+        }
+        if (amf_data_get_type(keyframes) != AMF_TYPE_OBJECT) {
+            print_warning(WARNING_KEYFRAMES_MISSING, on_metadata_offset, "keyframes index not found in onMetaData");
+            goto end;
+        }
+
+        file_times = amf_object_get(keyframes, "times");
+        file_filepositions = amf_object_get(keyframes, "filepositions");
+        if (amf_data_get_type(file_times) != AMF_TYPE_ARRAY) {
+            print_warning(WARNING_KEYFRAMES_TIMES_MISSING, on_metadata_offset, "Missing times metadata");
+            goto end;
+        }
+        if (amf_data_get_type(file_filepositions) != AMF_TYPE_ARRAY) {
+            print_warning(WARNING_KEYFRAMES_FILEPOS_MISSING, on_metadata_offset, "Missing filepositions metadata");
+            goto end;
+        }
+        if (amf_array_size(file_times) != amf_array_size(file_filepositions)) {
+            print_warning(WARNING_KEYFRAMES_ARRAY_LENGTH_BAD, on_metadata_offset, "invalid keyframes arrays length");
+        }
+
+        /* one random read per keyframe */
+        keyframes_checked = 0;
+        last_position = 0;
+        t_node = amf_array_first(file_times);
+        f_node = amf_array_first(file_filepositions);
+        while (t_node != NULL && f_node != NULL) {
+            amf_data * f_time, * f_position;
+            number64 time, position;
+            flv_video_tag vt;
+
+            if (error_budget_exhausted()) {
+                sprintf(message, "error limit of %d reached, aborting", opts->check_max_errors);
+                print_info(INFO_GENERAL_ERROR_LIMIT, on_metadata_offset, message);
+                goto end;
+            }
+
+            f_time = amf_array_get(t_node);
+            f_position = amf_array_get(f_node);
+            t_node = amf_array_next(t_node);
+            f_node = amf_array_next(f_node);
+
+            if (amf_data_get_type(f_time) != AMF_TYPE_NUMBER) {
+                sprintf(message, "invalid type for time: expected %s, got %s",
+                    get_amf_type_string(AMF_TYPE_NUMBER),
+                    get_amf_type_string(amf_data_get_type(f_time)));
+                print_warning(WARNING_KEYFRAMES_TIME_TYPE_BAD, on_metadata_offset, message);
+                continue;
+            }
+            if (amf_data_get_type(f_position) != AMF_TYPE_NUMBER) {
+                sprintf(message, "invalid type for file position: expected %s, got %s",
+                    get_amf_type_string(AMF_TYPE_NUMBER),
+                    get_amf_type_string(amf_data_get_type(f_position)));
+                print_warning(WARNING_KEYFRAMES_POS_TYPE_BAD, on_metadata_offset, message);
+                continue;
+            }
+
+            time = amf_number_get_value(f_time);
+            position = amf_number_get_value(f_position);
+            ++keyframes_checked;
+
+            /* positions must be sorted for players to look them up */
+            if (keyframes_checked > 1 && position <= last_position) {
+                sprintf(message, "keyframe file positions are not increasing from %.12g to %.12g", last_position, position);
+                print_warning(WARNING_KEYFRAMES_POS_ORDER, on_metadata_offset, message);
+            }
+            last_position = position;
+
+            /* a video tag must start at the given position */
+            if (position < FLV_HEADER_SIZE + sizeof(uint32_be)
+                || position + FLV_TAG_SIZE > (number64)filesize
+                || position != (number64)(file_offset_t)position
+                || flv_seek_tag(flv_in, (file_offset_t)position) != FLV_OK
+                || flv_read_tag(flv_in, &tag) != FLV_OK
+                || tag.type != FLV_TAG_TYPE_VIDEO
+                || position + FLV_TAG_SIZE + flv_tag_get_body_length(tag) > (number64)filesize
+                || flv_read_video_tag(flv_in, &vt) != FLV_OK
+            ) {
+                sprintf(message, "keyframe file position %.12g does not point to a video tag", position);
+                print_error(ERROR_KEYFRAMES_POS_NO_TAG, on_metadata_offset, message);
+                continue;
+            }
+
+            if (flv_video_tag_frame_type(vt) != FLV_VIDEO_TAG_FRAME_TYPE_KEYFRAME) {
+                sprintf(message, "keyframe file position %.12g points to a video tag which is not a keyframe", position);
+                print_error(ERROR_KEYFRAMES_POS_NO_KEYFRAME, (file_offset_t)position, message);
+            }
+
+            /* the indexed time must match the tag timestamp to the millisecond */
+            if (fabs(flv_tag_get_timestamp(tag) - time * 1000.0) >= 1.0) {
+                sprintf(message, "keyframe time %.12g does not match the tag timestamp %.12g",
+                    time, flv_tag_get_timestamp(tag) / 1000.0);
+                print_error(ERROR_KEYFRAMES_POS_TIME_BAD, (file_offset_t)position, message);
+            }
+        }
+
+        sprintf(message, "%u keyframe positions verified, the rest of the file has not been checked", keyframes_checked);
+        print_info(INFO_KEYFRAMES_VERIFIED, on_metadata_offset, message);
+        goto end;
+    }
+
+    /** tail mode: only check the end of the file **/
+    if (opts->check_tail) {
+        flv_tail_info tail;
+
+        trace_begin("check tail", NULL);
+        get_flv_tail_info(flv_in, filesize, &tail);
+
+        if (tail.truncated) {
+            sprintf(message, "file is truncated, last complete tag ends at offset %" FILE_OFFSET_PRINTF_FORMAT "u", tail.valid_size);
+            print_error(ERROR_GENERAL_TRUNCATED, tail.valid_size, message);
+        }
+        else if (tail.forward_scan) {
+            print_warning(WARNING_PREV_TAG_SIZE_NO_BACKWARD, filesize, "previous tag sizes cannot be followed backwards from the end of file");
+        }
+
+        sprintf(message, "only the header and the last tags have been checked, duration is %.12g s", tail.duration);
+        print_info(INFO_GENERAL_TAIL, filesize, message);
+        goto end;
+    }
 
     /** read tags **/
+    trace_begin("check tags", NULL);
     while (flv_get_offset(flv_in) < filesize) {
         flv_tag tag;
         file_offset_t offset;
         uint32 body_length, timestamp, stream_id;
         int decr_timestamp_signaled;
 
+        /* stop as soon as the error budget is exhausted */
+        if (error_budget_exhausted()) {
+            sprintf(message, "error limit of %d reached, aborting", opts->check_max_errors);
+            print_info(INFO_GENERAL_ERROR_LIMIT, flv_get_offset(flv_in), message);
+            goto end;
+        }
+
         result = flv_read_tag(flv_in, &tag);
         if (result != FLV_OK) {
             print_fatal(FATAL_TAG_EOF, flv_get_offset(flv_in), "unexpected end of file in tag");
             goto end;
         }
-
-        ++tag_number;
+        input_tag(opts, flv_in, &tag);
 
         offset = flv_get_current_tag_offset(flv_in);
         body_length = flv_tag_get_body_length(tag);
         timestamp = flv_tag_get_timestamp(tag);
         stream_id = flv_tag_get_stream_id(tag);
 
+        /* in sample mode, the forward scan ends after the requested duration */
+        if (opts->check_sample > 0
+            && tag.type != FLV_TAG_TYPE_META
+            && info.have_first_timestamp
+            && timestamp >= info.first_timestamp
+            && timestamp - info.first_timestamp >= (uint32)opts->check_sample * 1000
+        ) {
+            sampled = 1;
+            break;
+        }
+
+        ++tag_number;
+
+        flv_info_add_tag(&info, &tag, offset, &opts_loc);
+
         /* check tag type */
         if (tag.type != FLV_TAG_TYPE_AUDIO
             && tag.type != FLV_TAG_TYPE_VIDEO
@@ -451,6 +693,8 @@ int check_flv_file(const flvmeta_opts * opts) {
                     goto end;
                 }
 
+                flv_info_add_audio_tag(&info, &at, &opts_loc);
+
                 /* check whether the format varies between tags */
                 if (have_prev_audio_tag && prev_audio_tag != at) {
                     print_warning(WARNING_AUDIO_FORMAT_CHANGED, offset + 11, "audio format changed since last tag");
@@ -513,6 +757,12 @@ int check_flv_file(const flvmeta_opts * opts) {
                     goto end;
                 }
 
+                /* this might read the rest of the frame to compute video resolution */
+                if (flv_info_add_video_tag(&info, flv_in, &vt, &opts_loc) != FLV_OK) {
+                    print_fatal(FATAL_INFO_COMPUTATION_ERROR, offset + 11, "unable to compute file information");
+                    goto end;
+                }
+
                 /* check whether the format varies between tags */
                 if (have_prev_video_tag && flv_video_tag_codec_id(prev_video_tag) != flv_video_tag_codec_id(vt)) {
                     print_warning(WARNING_VIDEO_FORMAT_CHANGED, offset + 11, "video format changed since last tag");
@@ -576,7 +826,10 @@ int check_flv_file(const flvmeta_opts * opts) {
                     amf_data_free(data);
                     goto end;
                 }
-                else if (result == FLV_ERROR_EMPTY_TAG) {
+
+                flv_info_add_metadata(&info, name, &data, &opts_loc);
+
+                if (result == FLV_ERROR_EMPTY_TAG) {
                     print_warning(WARNING_METADATA_EMPTY, offset + 11, "empty metadata tag");
                 }
                 else if (result == FLV_ERROR_INVALID_METADATA_NAME) {
@@ -657,6 +910,18 @@ int check_flv_file(const flvmeta_opts * opts) {
                 amf_data_free(data);
             }
         }
+        else {
+            /* empty tags still count in the file information */
+            if (tag.type == FLV_TAG_TYPE_AUDIO) {
+                flv_info_add_audio_tag(&info, NULL, &opts_loc);
+            }
+            else if (tag.type == FLV_TAG_TYPE_VIDEO) {
+                flv_info_add_video_tag(&info, flv_in, NULL, &opts_loc);
+            }
+            else if (tag.type == FLV_TAG_TYPE_META) {
+                flv_info_add_metadata(&info, NULL, NULL, &opts_loc);
+            }
+        }
 
         /* check body length against previous tag size */
         result = flv_read_prev_tag_size(flv_in, &prev_tag_size);
@@ -671,7 +936,50 @@ int check_flv_file(const flvmeta_opts * opts) {
         }
     }
 
+    /* the last tag may have exhausted the error budget too */
+    if (error_budget_exhausted()) {
+        sprintf(message, "error limit of %d reached, aborting", opts->check_max_errors);
+        print_info(INFO_GENERAL_ERROR_LIMIT, flv_get_offset(flv_in), message);
+        goto end;
+    }
+
+    /** sample mode: check the last tag, skip the final checks */
+    if (sampled) {
+        flv_tag tag;
+        file_offset_t offset;
+
+        offset = filesize - sizeof(uint32_be);
+        if (flv_seek_prev_tag_size(flv_in, offset) != FLV_OK
+            || flv_read_prev_tag_size(flv_in, &prev_tag_size) != FLV_OK
+        ) {
+            print_fatal(FATAL_PREV_TAG_SIZE_EOF, offset, "unexpected end of file in previous tag size");
+            goto end;
+        }
+
+        /* the last previous tag size must point to a valid tag */
+        if (prev_tag_size < FLV_TAG_SIZE
+            || prev_tag_size > offset - FLV_HEADER_SIZE - sizeof(uint32_be)
+            || flv_seek_tag(flv_in, offset - prev_tag_size) != FLV_OK
+            || flv_read_tag(flv_in, &tag) != FLV_OK
+            || (tag.type != FLV_TAG_TYPE_AUDIO && tag.type != FLV_TAG_TYPE_VIDEO && tag.type != FLV_TAG_TYPE_META)
+            || flv_tag_get_body_length(tag) + FLV_TAG_SIZE != prev_tag_size
+        ) {
+            sprintf(message, "last previous tag size (%u) does not match a valid tag, file is probably truncated", prev_tag_size);
+            print_error(ERROR_PREV_TAG_SIZE_BAD_LAST, offset, message);
+        }
+        else if (flv_tag_get_timestamp(tag) < last_timestamp) {
+            sprintf(message, "timestamps are decreasing from %u to %u", last_timestamp, flv_tag_get_timestamp(tag));
+            print_error(ERROR_TIMESTAMP_DECREASE, offset - prev_tag_size + 4, message);
+        }
+
+        sprintf(message, "only the first %d seconds and the last tag have been checked", opts->check_sample);
+        print_info(INFO_GENERAL_SAMPLE, filesize, message);
+        goto end;
+    }
+
     /** final checks */
+    trace_end();
+    trace_begin("final checks", NULL);
 
     /* check consistency with global header */
     if (!have_video && flv_header_has_video(header)) {
@@ -723,23 +1031,6 @@ int check_flv_file(const flvmeta_opts * opts) {
         have_width = 0;
         have_height = 0;
 
-        /* compute metadata, with a sensible set of unobstrusive options */
-        opts_loc.verbose = 0;
-        opts_loc.reset_timestamps = 0;
-        opts_loc.preserve_metadata = 0;
-        opts_loc.all_keyframes = 0;
-        opts_loc.error_handling = FLVMETA_IGNORE_ERRORS;
-        opts_loc.insert_onlastsecond = 0;
-
-        flv_reset(flv_in);
-        if (get_flv_info(flv_in, &info, &opts_loc) != OK) {
-            print_fatal(FATAL_INFO_COMPUTATION_ERROR, 0, "unable to compute file information");
-            goto end;
-        }
-
-        /* delete useless info data */
-        amf_data_free(info.original_on_metadata);
-
         /* more metadata checks */
         for (n = amf_associative_array_first(on_metadata); n != NULL; n = amf_associative_array_next(n)) {
             byte * name;
@@ -1406,11 +1697,6 @@ int check_flv_file(const flvmeta_opts * opts) {
             }
         }
 
-        /* we need to release the info.keyframes pointer, because
-           as opposed to update.c, these amf data do not get added
-           into another object, therefore keep memory ownership */
-        amf_data_free(info.keyframes);
-
         /* missing width or height can cause size problem in various players */
         if (info.have_video) {
             if (!have_width) {
@@ -1458,11 +1744,18 @@ int check_flv_file(const flvmeta_opts * opts) {
     }
 
 end:
+    trace_unwind(trace_level);
     report_end(opts, &ctxt, errors, warnings);
 
     amf_data_free(on_metadata);
     amf_data_free(on_metadata_name);
-    flv_close(flv_in);
+
+    /* we need to release the info.keyframes pointer, because
+       as opposed to update.c, these amf data do not get added
+       into another object, therefore keep memory ownership */
+    amf_data_free(info.keyframes);
+
+    input_close(opts, flv_in);
 
     return (errors > 0) ? ERROR_INVALID_FLV_FILE : OK;
 }
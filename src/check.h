@@ -23,6 +23,7 @@
 #define __CHECK_H__
 
 #include "flvmeta.h"
+#include "sink.h"
 
 /* message level codes */
 #define LEVEL_FATAL     "F"
@@ -131,13 +132,25 @@
 #define INFO_TIMESTAMP_USE_EXTENDED         LEVEL_INFO      TOPIC_TIMESTAMPS        "082"
 #define INFO_GENERAL_LARGE_FILE             LEVEL_INFO      TOPIC_GENERAL_FORMAT    "083"
 #define FATAL_CONSECUTIVE_UNKNOWN_TAGS      LEVEL_FATAL     TOPIC_TAG_TYPES         "084"
+#define INFO_GENERAL_ERROR_LIMIT            LEVEL_INFO      TOPIC_GENERAL_FORMAT    "085"
+#define ERROR_PREV_TAG_SIZE_BAD_LAST        LEVEL_ERROR     TOPIC_PREV_TAG_SIZE     "086"
+#define INFO_GENERAL_SAMPLE                 LEVEL_INFO      TOPIC_GENERAL_FORMAT    "087"
+#define ERROR_GENERAL_TRUNCATED             LEVEL_ERROR     TOPIC_GENERAL_FORMAT    "088"
+#define WARNING_PREV_TAG_SIZE_NO_BACKWARD   LEVEL_WARNING   TOPIC_PREV_TAG_SIZE     "089"
+#define INFO_GENERAL_TAIL                   LEVEL_INFO      TOPIC_GENERAL_FORMAT    "090"
+#define ERROR_KEYFRAMES_POS_NO_TAG          LEVEL_ERROR     TOPIC_KEYFRAMES         "091"
+#define ERROR_KEYFRAMES_POS_NO_KEYFRAME     LEVEL_ERROR     TOPIC_KEYFRAMES         "092"
+#define WARNING_KEYFRAMES_MISSING           LEVEL_WARNING   TOPIC_KEYFRAMES         "093"
+#define WARNING_KEYFRAMES_POS_ORDER         LEVEL_WARNING   TOPIC_KEYFRAMES         "094"
+#define INFO_KEYFRAMES_VERIFIED             LEVEL_INFO      TOPIC_KEYFRAMES         "095"
+#define ERROR_KEYFRAMES_POS_TIME_BAD        LEVEL_ERROR     TOPIC_KEYFRAMES         "096"
 
 #ifdef __cplusplus
 extern "C" {
 #endif /* __cplusplus */
 
-/* check FLV file validity */
-int check_flv_file(const flvmeta_opts * opts);
+/* check FLV file validity, writing the report into out */
+int check_flv_file(const flvmeta_opts * opts, output_sink * out);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,411 @@
+/*
+    FLVMeta - FLV Metadata Editor
+
+    Copyright (C) 2007-2014 Marc Noirot <marc.noirot AT gmail.com>
+
+    This file is part of FLVMeta.
+
+    FLVMeta is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    FLVMeta is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FLVMeta; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+#include "flvmeta.h"
+#include "flv.h"
+#include "amf.h"
+#include "concat.h"
+#include "info.h"
+#include "input.h"
+#include "progress.h"
+#include "stats.h"
+#include "trace.h"
+#include "util.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* sequence headers */
+#define CONCAT_VIDEO_HEADER 0
+#define CONCAT_AUDIO_HEADER 1
+
+/*
+    concatenation state, the same for the information and writing passes
+    so that both make the same decisions
+*/
+typedef struct __concat_state {
+    /* last sequence header of each stream, to drop identical ones */
+    byte * headers[2];
+    uint32 header_sizes[2];
+    uint8 have_header[2];
+    /* current tag body */
+    byte * buffer;
+    uint32 buffer_size;
+    /* offset of the current file in the output timeline */
+    uint32 timestamp_offset;
+    /* end of the output timeline */
+    uint32 timeline_end;
+    /* offset of the next tag in the output file, without onMetaData */
+    file_offset_t out_offset;
+} concat_state;
+
+/* timestamps of a stream in the current file */
+typedef struct __concat_stream {
+    uint8 have_timestamp;
+    uint32 last_timestamp;
+    uint32 frame_duration;
+} concat_stream;
+
+static void concat_state_init(concat_state * state) {
+    memset(state, 0, sizeof(concat_state));
+    state->out_offset = FLV_HEADER_SIZE + sizeof(uint32_be);
+}
+
+static void concat_state_free(concat_state * state) {
+    free(state->headers[CONCAT_VIDEO_HEADER]);
+    free(state->headers[CONCAT_AUDIO_HEADER]);
+    free(state->buffer);
+}
+
+/* read the current tag body into the state buffer */
+static int concat_read_body(concat_state * state, flv_stream * flv_in, uint32 body_length) {
+    if (body_length > state->buffer_size) {
+        byte * new_buffer = (byte *)realloc(state->buffer, body_length);
+        if (new_buffer == NULL) {
+            return ERROR_MEMORY;
+        }
+        state->buffer = new_buffer;
+        state->buffer_size = body_length;
+    }
+    if (flv_read_tag_body(flv_in, state->buffer, body_length) < body_length) {
+        return ERROR_EOF;
+    }
+    return OK;
+}
+
+/*
+    tell whether the current tag must be dropped, being a sequence header
+    identical to the previous one of its stream, or the end of an AVC
+    sequence followed by another file
+*/
+static int concat_drop_tag(concat_state * state, const flv_tag * tag, uint32 body_length, int last_file, int * result) {
+    int header;
+
+    *result = OK;
+    if (body_length < 2) {
+        return 0;
+    }
+
+    if (tag->type == FLV_TAG_TYPE_VIDEO
+    && flv_video_tag_codec_id(state->buffer[0]) == FLV_VIDEO_TAG_CODEC_AVC) {
+        if (state->buffer[1] == FLV_AVC_PACKET_TYPE_SEQUENCE_END) {
+            return !last_file;
+        }
+        if (state->buffer[1] != FLV_AVC_PACKET_TYPE_SEQUENCE_HEADER) {
+            return 0;
+        }
+        header = CONCAT_VIDEO_HEADER;
+    }
+    else if (tag->type == FLV_TAG_TYPE_AUDIO
+    && flv_audio_tag_sound_format(state->buffer[0]) == FLV_AUDIO_TAG_SOUND_FORMAT_AAC
+    && state->buffer[1] == FLV_AAC_PACKET_TYPE_SEQUENCE_HEADER) {
+        header = CONCAT_AUDIO_HEADER;
+    }
+    else {
+        return 0;
+    }
+
+    if (state->have_header[header]
+    && state->header_sizes[header] == body_length
+    && !memcmp(state->headers[header], state->buffer, body_length)) {
+        return 1;
+    }
+
+    /* new codec configuration */
+    free(state->headers[header]);
+    state->headers[header] = (byte *)malloc(body_length);
+    if (state->headers[header] == NULL) {
+        state->have_header[header] = 0;
+        *result = ERROR_MEMORY;
+        return 0;
+    }
+    memcpy(state->headers[header], state->buffer, body_length);
+    state->header_sizes[header] = body_length;
+    state->have_header[header] = 1;
+    return 0;
+}
+
+/* account for a tag of the output file */
+static int concat_add_tag(flv_info * info, flv_stream * flv_in, const flv_tag * tag, file_offset_t tag_offset, const concat_state * state, const flvmeta_opts * opts) {
+    flv_video_tag vt;
+    flv_audio_tag at;
+    int result;
+
+    result = flv_info_add_tag(info, tag, state->out_offset, opts);
+    if (result != OK) {
+        return result;
+    }
+
+    if (tag->type == FLV_TAG_TYPE_VIDEO) {
+        if (info->tag_body_length == 0) {
+            return flv_info_add_video_tag(info, flv_in, NULL, opts);
+        }
+        vt = state->buffer[0];
+        /* the video size is read from the body of the first keyframes */
+        if (!info->have_video_size && flv_video_tag_frame_type(vt) == FLV_VIDEO_TAG_FRAME_TYPE_KEYFRAME) {
+            flv_tag body_tag;
+            if (flv_seek_tag(flv_in, tag_offset) != FLV_OK
+            || flv_read_tag(flv_in, &body_tag) != FLV_OK
+            || flv_read_video_tag(flv_in, &vt) != FLV_OK) {
+                return ERROR_EOF;
+            }
+        }
+        return flv_info_add_video_tag(info, flv_in, &vt, opts);
+    }
+    else {
+        if (info->tag_body_length == 0) {
+            flv_info_add_audio_tag(info, NULL, opts);
+        }
+        else {
+            at = state->buffer[0];
+            flv_info_add_audio_tag(info, &at, opts);
+        }
+        return OK;
+    }
+}
+
+/* write a tag of the output file */
+static int concat_write_tag(FILE * flv_out, const flv_tag * tag, const concat_state * state, uint32 body_length) {
+    uint32_be size;
+
+    size = swap_uint32(FLV_TAG_SIZE + body_length);
+    if (flv_write_tag(flv_out, tag) != 1
+    || stats_fwrite(state->buffer, 1, body_length, flv_out) < body_length
+    || stats_fwrite(&size, sizeof(uint32_be), 1, flv_out) != 1) {
+        return ERROR_WRITE;
+    }
+    return OK;
+}
+
+/*
+    go through the tags of a file, accounting for them in info,
+    or writing them into flv_out
+*/
+static int concat_file(concat_state * state, const char * filename, int last_file, flv_info * info, FILE * flv_out, const flvmeta_opts * opts) {
+    flv_stream * flv_in;
+    flv_header header;
+    flv_tag tag;
+    file_offset_t filesize, offset;
+    concat_stream video, audio;
+    concat_stream * stream;
+    uint32 body_length, timestamp, first_timestamp, end;
+    int have_first_timestamp, result;
+
+    if (flvmeta_filesize(filename, &filesize) == 0) {
+        return ERROR_OPEN_READ;
+    }
+
+    flv_in = input_open(opts, filename);
+    if (flv_in == NULL) {
+        return ERROR_OPEN_READ;
+    }
+
+    if (input_read_header(opts, flv_in, &header) != FLV_OK) {
+        input_close(opts, flv_in);
+        return ERROR_NO_FLV;
+    }
+
+    memset(&video, 0, sizeof(concat_stream));
+    memset(&audio, 0, sizeof(concat_stream));
+    have_first_timestamp = 0;
+    first_timestamp = 0;
+    result = OK;
+
+    while (result == OK && flv_read_tag(flv_in, &tag) == FLV_OK) {
+        input_tag(opts, flv_in, &tag);
+        offset = flv_get_current_tag_offset(flv_in);
+        body_length = flv_tag_get_body_length(tag);
+
+        /* the file ends at the first truncated tag */
+        if (offset + FLV_TAG_SIZE + body_length > filesize) {
+            break;
+        }
+
+        /* script data belong to each file, and onMetaData is recomputed */
+        if (tag.type != FLV_TAG_TYPE_VIDEO && tag.type != FLV_TAG_TYPE_AUDIO) {
+            continue;
+        }
+
+        result = concat_read_body(state, flv_in, body_length);
+        if (result != OK
+        || concat_drop_tag(state, &tag, body_length, last_file, &result)
+        || result != OK) {
+            continue;
+        }
+
+        /* place the tag on the output timeline */
+        timestamp = flv_tag_get_timestamp(tag);
+        if (!have_first_timestamp) {
+            first_timestamp = timestamp;
+            have_first_timestamp = 1;
+        }
+        stream = (tag.type == FLV_TAG_TYPE_VIDEO) ? &video : &audio;
+        if (stream->have_timestamp && timestamp > stream->last_timestamp) {
+            stream->frame_duration = timestamp - stream->last_timestamp;
+        }
+        stream->last_timestamp = timestamp;
+        stream->have_timestamp = 1;
+
+        timestamp = state->timestamp_offset + ((timestamp > first_timestamp) ? timestamp - first_timestamp : 0);
+        flv_tag_set_timestamp(&tag, timestamp);
+
+        /* the next file starts after the last frame of the longest stream */
+        end = timestamp + stream->frame_duration;
+        if (end > state->timeline_end) {
+            state->timeline_end = end;
+        }
+
+        if (flv_out == NULL) {
+            result = concat_add_tag(info, flv_in, &tag, offset, state, opts);
+        }
+        else {
+            result = concat_write_tag(flv_out, &tag, state, body_length);
+        }
+        state->out_offset += FLV_TAG_SIZE + body_length + sizeof(uint32_be);
+    }
+
+    input_close(opts, flv_in);
+    state->timestamp_offset = state->timeline_end;
+    return result;
+}
+
+/* go through all the files to concatenate */
+static int concat_files(const flvmeta_opts * opts, flv_info * info, FILE * flv_out) {
+    concat_state state;
+    int i, result;
+
+    concat_state_init(&state);
+    result = OK;
+    for (i = 0; result == OK && i < opts->concat_count; ++i) {
+        if (opts->verbose) {
+            fprintf(stdout, "%s %s...\n", (flv_out == NULL) ? "Parsing" : "Copying", opts->concat_files[i]);
+        }
+        trace_begin((flv_out == NULL) ? "parse file" : "copy file", opts->concat_files[i]);
+        result = concat_file(&state, opts->concat_files[i], i == opts->concat_count - 1, info, flv_out, opts);
+        trace_end();
+    }
+    concat_state_free(&state);
+    return result;
+}
+
+/* write the output file header and computed onMetaData event */
+static int concat_write_header(FILE * flv_out, const flv_info * info, const flv_metadata * meta) {
+    flv_header header;
+    flv_tag omft;
+    uint32_be size;
+    uint32 on_metadata_name_size;
+    uint32 on_metadata_size;
+
+    memcpy(header.signature, FLV_SIGNATURE, sizeof(header.signature));
+    header.version = FLV_VERSION;
+    header.flags = (info->have_video ? FLV_FLAG_VIDEO : 0) | (info->have_audio ? FLV_FLAG_AUDIO : 0);
+    header.offset = swap_uint32(FLV_HEADER_SIZE);
+
+    on_metadata_name_size = (uint32)amf_data_size(meta->on_metadata_name);
+    on_metadata_size = (uint32)amf_data_size(meta->on_metadata);
+
+    omft.type = FLV_TAG_TYPE_META;
+    omft.body_length = uint32_to_uint24_be(on_metadata_name_size + on_metadata_size);
+    flv_tag_set_timestamp(&omft, 0);
+    omft.stream_id = uint32_to_uint24_be(0);
+
+    if (flv_write_header(flv_out, &header) != 1) {
+        return ERROR_WRITE;
+    }
+    size = swap_uint32(0);
+    if (stats_fwrite(&size, sizeof(uint32_be), 1, flv_out) != 1) {
+        return ERROR_WRITE;
+    }
+    size = swap_uint32(FLV_TAG_SIZE + on_metadata_name_size + on_metadata_size);
+    if (flv_write_tag(flv_out, &omft) != 1
+    || amf_data_file_write(meta->on_metadata_name, flv_out) < on_metadata_name_size
+    || amf_data_file_write(meta->on_metadata, flv_out) < on_metadata_size
+    || stats_fwrite(&size, sizeof(uint32_be), 1, flv_out) != 1) {
+        return ERROR_WRITE;
+    }
+    return OK;
+}
+
+int concat_flv_files(const flvmeta_opts * opts) {
+    flvmeta_opts concat_opts;
+    flv_info info;
+    flv_metadata meta;
+    FILE * flv_out;
+    file_offset_t total, filesize;
+    int i, res;
+
+    /* the output file must not overwrite the files being read */
+    total = 0;
+    for (i = 0; i < opts->concat_count; ++i) {
+        if (flvmeta_same_file(opts->concat_files[i], opts->output_file)) {
+            return ERROR_OPEN_WRITE;
+        }
+        if (flvmeta_filesize(opts->concat_files[i], &filesize) != 0) {
+            total += filesize;
+        }
+    }
+
+    /* both passes read every file */
+    progress_set_total(2 * total);
+
+    /* the computed metadata describe the output file only */
+    memcpy(&concat_opts, opts, sizeof(flvmeta_opts));
+    concat_opts.insert_onlastsecond = 0;
+    concat_opts.reset_timestamps = 0;
+    concat_opts.preserve_metadata = 0;
+
+    flv_info_reset(&info);
+    res = concat_files(&concat_opts, &info, NULL);
+    if (res != OK) {
+        flv_info_free(&info);
+        return res;
+    }
+
+    compute_metadata(&info, &meta, &concat_opts);
+
+    flv_out = fopen(opts->output_file, "wb");
+    if (flv_out == NULL) {
+        flv_info_free(&info);
+        flv_metadata_free(&meta);
+        return ERROR_OPEN_WRITE;
+    }
+
+    if (opts->verbose) {
+        fprintf(stdout, "Writing %s...\n", opts->output_file);
+    }
+
+    res = concat_write_header(flv_out, &info, &meta);
+    if (res == OK) {
+        res = concat_files(&concat_opts, &info, flv_out);
+    }
+    if (fclose(flv_out) != 0 && res == OK) {
+        res = ERROR_WRITE;
+    }
+
+    if (res == OK && opts->verbose) {
+        fprintf(stdout, "%s successfully written\n", opts->output_file);
+    }
+
+    flv_info_free(&info);
+    flv_metadata_free(&meta);
+    return res;
+}
@@ -0,0 +1,478 @@
+/*
+    FLVMeta - FLV Metadata Editor
+
+    Copyright (C) 2007-2014 Marc Noirot <marc.noirot AT gmail.com>
+
+    This file is part of FLVMeta.
+
+    FLVMeta is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    FLVMeta is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FLVMeta; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+#include "flvmeta.h"
+#include "flv.h"
+#include "amf.h"
+#include "cut.h"
+#include "info.h"
+#include "input.h"
+#include "keyframes.h"
+#include "stats.h"
+#include "util.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* maximum number of tags read at the start of the file to find the sequence headers */
+#define MAX_HEADER_SEARCH_TAGS 64
+
+/* sequence headers */
+#define CUT_VIDEO_HEADER 0
+#define CUT_AUDIO_HEADER 1
+
+/* part of the input file copied into the output file */
+typedef struct __cut_range {
+    /* offset of the first copied tag, a keyframe */
+    file_offset_t start;
+    /* offset of the tag following the last copied tag */
+    file_offset_t end;
+    /* timestamp of the first keyframe, rebased to zero */
+    uint32 start_timestamp;
+    /* extended timestamp fixing of the copied video and audio tags */
+    uint32 prev_timestamp[2];
+    uint8 timestamp_extended[2];
+    uint8 have_timestamp[2];
+    /* AVC and AAC sequence headers, copied before the tags */
+    file_offset_t headers[2];
+    uint8 have_header[2];
+} cut_range;
+
+/*
+    tell whether the current tag is an AVC or AAC sequence header,
+    reading the beginning of its body
+*/
+static int cut_read_sequence_header(flv_stream * flv_in, const flv_tag * tag, int * header) {
+    flv_video_tag vt;
+    flv_audio_tag at;
+    byte packet_type;
+
+    if (flv_tag_get_body_length(*tag) < 2) {
+        return 0;
+    }
+
+    if (tag->type == FLV_TAG_TYPE_VIDEO) {
+        if (flv_read_video_tag(flv_in, &vt) != FLV_OK
+        || flv_video_tag_codec_id(vt) != FLV_VIDEO_TAG_CODEC_AVC
+        || flv_read_tag_body(flv_in, &packet_type, 1) != 1) {
+            return 0;
+        }
+        *header = CUT_VIDEO_HEADER;
+        return (packet_type == FLV_AVC_PACKET_TYPE_SEQUENCE_HEADER);
+    }
+    else if (tag->type == FLV_TAG_TYPE_AUDIO) {
+        if (flv_read_audio_tag(flv_in, &at) != FLV_OK
+        || flv_audio_tag_sound_format(at) != FLV_AUDIO_TAG_SOUND_FORMAT_AAC
+        || flv_read_tag_body(flv_in, &packet_type, 1) != 1) {
+            return 0;
+        }
+        *header = CUT_AUDIO_HEADER;
+        return (packet_type == FLV_AAC_PACKET_TYPE_SEQUENCE_HEADER);
+    }
+    return 0;
+}
+
+/* find the sequence headers among the first tags of the file */
+static void cut_find_headers(flv_stream * flv_in, cut_range * range) {
+    flv_tag tag;
+    file_offset_t offset;
+    int header, i;
+
+    flv_reset(flv_in);
+    for (i = 0; i < MAX_HEADER_SEARCH_TAGS; ++i) {
+        if (flv_read_tag(flv_in, &tag) != FLV_OK) {
+            break;
+        }
+        offset = flv_get_current_tag_offset(flv_in);
+        if (offset >= range->start) {
+            break;
+        }
+
+        if (cut_read_sequence_header(flv_in, &tag, &header)) {
+            range->headers[header] = offset;
+            range->have_header[header] = 1;
+            if (range->have_header[CUT_VIDEO_HEADER] && range->have_header[CUT_AUDIO_HEADER]) {
+                break;
+            }
+        }
+    }
+}
+
+/* tell whether a tag of the range is one of the sequence headers copied first */
+static int cut_is_copied_header(const cut_range * range, file_offset_t offset) {
+    return (range->have_header[CUT_VIDEO_HEADER] && range->headers[CUT_VIDEO_HEADER] == offset)
+        || (range->have_header[CUT_AUDIO_HEADER] && range->headers[CUT_AUDIO_HEADER] == offset);
+}
+
+/*
+    number of timestamp wraps to add to a raw timestamp
+    so that it gets closest to the given fixed timestamp
+*/
+static uint8 cut_timestamp_wraps(uint32 timestamp, uint32 fixed_timestamp) {
+    if (fixed_timestamp <= timestamp) {
+        return 0;
+    }
+    return (uint8)((fixed_timestamp - timestamp + 0x800000) >> 24);
+}
+
+/* restart the extended timestamp fixing at the beginning of the range */
+static void cut_reset_timestamps(cut_range * range) {
+    range->have_timestamp[CUT_VIDEO_HEADER] = 0;
+    range->have_timestamp[CUT_AUDIO_HEADER] = 0;
+}
+
+/*
+    timestamp of a tag in the output file
+    the range starts in the middle of the file, so the wraps of each stream
+    are first deduced from the timestamp of the first keyframe, then followed
+*/
+static uint32 cut_rebase_timestamp(cut_range * range, const flv_tag * tag) {
+    uint32 timestamp = flv_tag_get_timestamp(*tag);
+    int stream = (tag->type == FLV_TAG_TYPE_VIDEO) ? CUT_VIDEO_HEADER : CUT_AUDIO_HEADER;
+
+    if (!range->have_timestamp[stream]) {
+        range->prev_timestamp[stream] = timestamp;
+        range->timestamp_extended[stream] = cut_timestamp_wraps(timestamp, range->start_timestamp);
+        range->have_timestamp[stream] = 1;
+    }
+    timestamp = flv_fix_extended_timestamp(timestamp, &range->prev_timestamp[stream], &range->timestamp_extended[stream]);
+    return (timestamp > range->start_timestamp) ? timestamp - range->start_timestamp : 0;
+}
+
+/* account for a copied tag, written at the given offset of the output file */
+static int cut_add_tag(flv_info * info, flv_stream * flv_in, const flv_tag * tag, file_offset_t offset, uint32 timestamp, const flvmeta_opts * opts) {
+    flv_tag out_tag;
+    flv_video_tag vt;
+    flv_audio_tag at;
+    int result;
+
+    memcpy(&out_tag, tag, sizeof(flv_tag));
+    flv_tag_set_timestamp(&out_tag, timestamp);
+
+    result = flv_info_add_tag(info, &out_tag, offset, opts);
+    if (result != OK) {
+        return result;
+    }
+
+    if (tag->type == FLV_TAG_TYPE_VIDEO) {
+        if (info->tag_body_length == 0) {
+            return flv_info_add_video_tag(info, flv_in, NULL, opts);
+        }
+        if (flv_read_video_tag(flv_in, &vt) != FLV_OK) {
+            return ERROR_EOF;
+        }
+        return flv_info_add_video_tag(info, flv_in, &vt, opts);
+    }
+    else {
+        if (info->tag_body_length == 0) {
+            flv_info_add_audio_tag(info, NULL, opts);
+            return OK;
+        }
+        if (flv_read_audio_tag(flv_in, &at) != FLV_OK) {
+            return ERROR_EOF;
+        }
+        flv_info_add_audio_tag(info, &at, opts);
+        return OK;
+    }
+}
+
+/*
+    gather information about the output file, and find where the range
+    actually ends, tags being complete and within the file
+*/
+static int cut_get_info(flv_stream * flv_in, cut_range * range, file_offset_t filesize, flv_info * info, const flvmeta_opts * opts) {
+    flv_tag tag;
+    file_offset_t offset, out_offset;
+    uint32 body_length;
+    int result, i;
+
+    flv_info_reset(info);
+
+    /* the computed onMetaData size is added by compute_metadata */
+    out_offset = FLV_HEADER_SIZE + sizeof(uint32_be);
+
+    for (i = CUT_VIDEO_HEADER; i <= CUT_AUDIO_HEADER; ++i) {
+        if (range->have_header[i]) {
+            if (flv_seek_tag(flv_in, range->headers[i]) != FLV_OK
+            || flv_read_tag(flv_in, &tag) != FLV_OK) {
+                return ERROR_EOF;
+            }
+            result = cut_add_tag(info, flv_in, &tag, out_offset, 0, opts);
+            if (result != OK) {
+                return result;
+            }
+            out_offset += FLV_TAG_SIZE + flv_tag_get_body_length(tag) + sizeof(uint32_be);
+        }
+    }
+
+    if (flv_seek_tag(flv_in, range->start) != FLV_OK) {
+        return ERROR_EOF;
+    }
+    cut_reset_timestamps(range);
+    offset = range->start;
+    while (offset < range->end && flv_read_tag(flv_in, &tag) == FLV_OK) {
+        input_tag(opts, flv_in, &tag);
+        offset = flv_get_current_tag_offset(flv_in);
+        body_length = flv_tag_get_body_length(tag);
+        if (offset >= range->end) {
+            break;
+        }
+
+        /* stop at the first truncated tag */
+        if (offset + FLV_TAG_SIZE + body_length > filesize) {
+            range->end = offset;
+            break;
+        }
+
+        /* script data refer to the original file, and onMetaData is recomputed */
+        if ((tag.type == FLV_TAG_TYPE_VIDEO || tag.type == FLV_TAG_TYPE_AUDIO)
+        && !cut_is_copied_header(range, offset)) {
+            result = cut_add_tag(info, flv_in, &tag, out_offset, cut_rebase_timestamp(range, &tag), opts);
+            if (result != OK) {
+                return result;
+            }
+            out_offset += FLV_TAG_SIZE + body_length + sizeof(uint32_be);
+        }
+
+        offset += FLV_TAG_SIZE + body_length + sizeof(uint32_be);
+    }
+    if (offset < range->end) {
+        range->end = offset;
+    }
+
+    return OK;
+}
+
+/* copy a tag of the input file with a new timestamp */
+static int cut_copy_tag(flv_stream * flv_in, FILE * flv_out, flv_tag * tag, uint32 timestamp, byte ** buffer, uint32 * buffer_size) {
+    uint32 body_length;
+    uint32_be size;
+
+    body_length = flv_tag_get_body_length(*tag);
+    if (body_length > *buffer_size) {
+        byte * new_buffer = (byte *)realloc(*buffer, body_length);
+        if (new_buffer == NULL) {
+            return ERROR_MEMORY;
+        }
+        *buffer = new_buffer;
+        *buffer_size = body_length;
+    }
+
+    if (flv_read_tag_body(flv_in, *buffer, body_length) < body_length) {
+        return ERROR_EOF;
+    }
+
+    flv_tag_set_timestamp(tag, timestamp);
+    size = swap_uint32(FLV_TAG_SIZE + body_length);
+    if (flv_write_tag(flv_out, tag) != 1
+    || stats_fwrite(*buffer, 1, body_length, flv_out) < body_length
+    || stats_fwrite(&size, sizeof(uint32_be), 1, flv_out) != 1) {
+        return ERROR_WRITE;
+    }
+    return OK;
+}
+
+/* write the output file */
+static int cut_write_flv(flv_stream * flv_in, FILE * flv_out, const flv_header * header, cut_range * range, const flv_metadata * meta, const flvmeta_opts * opts) {
+    uint32_be size;
+    uint32 on_metadata_name_size;
+    uint32 on_metadata_size;
+    flv_tag tag, omft;
+    file_offset_t offset;
+    byte * buffer;
+    uint32 buffer_size;
+    int result, i;
+
+    if (opts->verbose) {
+        fprintf(stdout, "Writing %s...\n", opts->output_file);
+    }
+
+    /* header, first previous tag size, and onMetaData */
+    on_metadata_name_size = (uint32)amf_data_size(meta->on_metadata_name);
+    on_metadata_size = (uint32)amf_data_size(meta->on_metadata);
+
+    omft.type = FLV_TAG_TYPE_META;
+    omft.body_length = uint32_to_uint24_be(on_metadata_name_size + on_metadata_size);
+    flv_tag_set_timestamp(&omft, 0);
+    omft.stream_id = uint32_to_uint24_be(0);
+
+    if (flv_write_header(flv_out, header) != 1) {
+        return ERROR_WRITE;
+    }
+    size = swap_uint32(0);
+    if (stats_fwrite(&size, sizeof(uint32_be), 1, flv_out) != 1) {
+        return ERROR_WRITE;
+    }
+    size = swap_uint32(FLV_TAG_SIZE + on_metadata_name_size + on_metadata_size);
+    if (flv_write_tag(flv_out, &omft) != 1
+    || amf_data_file_write(meta->on_metadata_name, flv_out) < on_metadata_name_size
+    || amf_data_file_write(meta->on_metadata, flv_out) < on_metadata_size
+    || stats_fwrite(&size, sizeof(uint32_be), 1, flv_out) != 1) {
+        return ERROR_WRITE;
+    }
+
+    buffer = NULL;
+    buffer_size = 0;
+    result = OK;
+
+    /* sequence headers */
+    for (i = CUT_VIDEO_HEADER; result == OK && i <= CUT_AUDIO_HEADER; ++i) {
+        if (range->have_header[i]) {
+            if (flv_seek_tag(flv_in, range->headers[i]) != FLV_OK
+            || flv_read_tag(flv_in, &tag) != FLV_OK) {
+                result = ERROR_EOF;
+            }
+            else {
+                result = cut_copy_tag(flv_in, flv_out, &tag, 0, &buffer, &buffer_size);
+            }
+        }
+    }
+
+    /* tags of the range */
+    if (result == OK && flv_seek_tag(flv_in, range->start) != FLV_OK) {
+        result = ERROR_EOF;
+    }
+    cut_reset_timestamps(range);
+    while (result == OK && flv_read_tag(flv_in, &tag) == FLV_OK) {
+        input_tag(opts, flv_in, &tag);
+        offset = flv_get_current_tag_offset(flv_in);
+        if (offset >= range->end) {
+            break;
+        }
+        if ((tag.type == FLV_TAG_TYPE_VIDEO || tag.type == FLV_TAG_TYPE_AUDIO)
+        && !cut_is_copied_header(range, offset)) {
+            result = cut_copy_tag(flv_in, flv_out, &tag, cut_rebase_timestamp(range, &tag), &buffer, &buffer_size);
+        }
+    }
+
+    free(buffer);
+
+    if (result == OK && opts->verbose) {
+        fprintf(stdout, "%s successfully written\n", opts->output_file);
+    }
+    return result;
+}
+
+int cut_flv_file(const flvmeta_opts * opts) {
+    flvmeta_opts cut_opts;
+    keyframe_index index;
+    cut_range range;
+    flv_stream * flv_in;
+    flv_header header;
+    flv_tag tag;
+    flv_info info;
+    flv_metadata meta;
+    file_offset_t filesize;
+    FILE * flv_out;
+    uint32 first, last;
+    number64 start_time;
+    int res;
+
+    /* cutting in place would overwrite the tags being copied */
+    if (flvmeta_same_file(opts->input_file, opts->output_file)) {
+        return ERROR_OPEN_WRITE;
+    }
+
+    if (flvmeta_filesize(opts->input_file, &filesize) == 0) {
+        return ERROR_OPEN_READ;
+    }
+
+    res = keyframe_index_read(&index, opts->input_file, opts);
+    if (res != OK) {
+        return res;
+    }
+
+    /* the range starts at the keyframe at or before the start time */
+    first = keyframe_index_find(&index, opts->cut_start);
+    /* and ends at the first keyframe at or after the end time */
+    last = keyframe_index_find(&index, opts->cut_end);
+    if (index.times[last] < opts->cut_end) {
+        ++last;
+    }
+    if (last <= first) {
+        last = first + 1;
+    }
+
+    memset(&range, 0, sizeof(cut_range));
+    start_time = index.times[first];
+    range.start = index.filepositions[first];
+    range.end = (last < index.count) ? index.filepositions[last] : filesize;
+    keyframe_index_free(&index);
+
+    flv_in = input_open(opts, opts->input_file);
+    if (flv_in == NULL) {
+        return ERROR_OPEN_READ;
+    }
+
+    if (input_read_header(opts, flv_in, &header) != FLV_OK) {
+        input_close(opts, flv_in);
+        return ERROR_NO_FLV;
+    }
+
+    /*
+        timestamps are rebased on the first keyframe, whose timestamp
+        may have wrapped around: the index time tells how many times
+    */
+    if (flv_seek_tag(flv_in, range.start) != FLV_OK
+    || flv_read_tag(flv_in, &tag) != FLV_OK) {
+        input_close(opts, flv_in);
+        return ERROR_EOF;
+    }
+    range.start_timestamp = flv_tag_get_timestamp(tag);
+    if (start_time >= 0 && start_time * 1000 < 4294967296.0) {
+        range.start_timestamp += cut_timestamp_wraps(range.start_timestamp, (uint32)(start_time * 1000)) << 24;
+    }
+
+    cut_find_headers(flv_in, &range);
+
+    /* the computed metadata describe the output file only */
+    memcpy(&cut_opts, opts, sizeof(flvmeta_opts));
+    cut_opts.insert_onlastsecond = 0;
+    cut_opts.reset_timestamps = 0;
+    cut_opts.preserve_metadata = 0;
+
+    res = cut_get_info(flv_in, &range, filesize, &info, &cut_opts);
+    if (res != OK) {
+        input_close(opts, flv_in);
+        flv_info_free(&info);
+        return res;
+    }
+
+    compute_metadata(&info, &meta, &cut_opts);
+    flv_info_free(&info);
+
+    flv_out = fopen(opts->output_file, "wb");
+    if (flv_out == NULL) {
+        input_close(opts, flv_in);
+        flv_metadata_free(&meta);
+        return ERROR_OPEN_WRITE;
+    }
+
+    res = cut_write_flv(flv_in, flv_out, &header, &range, &meta, &cut_opts);
+
+    if (fclose(flv_out) != 0 && res == OK) {
+        res = ERROR_WRITE;
+    }
+    input_close(opts, flv_in);
+    flv_metadata_free(&meta);
+    return res;
+}
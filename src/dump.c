@@ -20,10 +20,17 @@
     Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
 */
 #include "flvmeta.h"
+#include "dump_cbor.h"
+#include "dump_csv.h"
 #include "dump_json.h"
 #include "dump_raw.h"
 #include "dump_xml.h"
 #include "dump_yaml.h"
+#include "dump_yaml_strict.h"
+#include "info.h"
+#include "input.h"
+#include "keyframes.h"
+#include "util.h"
 
 #include <string.h>
 
@@ -136,14 +143,19 @@ const char * dump_string_get_aac_packet_type(flv_aac_packet_type type) {
 }
 
 /* dump metadata from a FLV file */
-int dump_metadata(const flvmeta_opts * options) {
+int dump_metadata(const flvmeta_opts * options, output_sink * out) {
     int retval;
     flv_parser parser;
+    dump_context ctxt;
+
     memset(&parser, 0, sizeof(flv_parser));
-    parser.user_data = (void*)options;
+    ctxt.options = options;
+    ctxt.out = out;
+    parser.user_data = &ctxt;
 
     switch (options->dump_format) {
         case FLVMETA_FORMAT_JSON:
+        case FLVMETA_FORMAT_NDJSON:
             dump_json_setup_metadata_dump(&parser);
             break;
         case FLVMETA_FORMAT_RAW:
@@ -153,11 +165,23 @@ int dump_metadata(const flvmeta_opts * options) {
             dump_xml_setup_metadata_dump(&parser);
             break;
         case FLVMETA_FORMAT_YAML:
-            dump_yaml_setup_metadata_dump(&parser);
+            if (options->dump_strict_yaml) {
+                dump_yaml_strict_setup_metadata_dump(&parser);
+            }
+            else {
+                dump_yaml_setup_metadata_dump(&parser);
+            }
+            break;
+        case FLVMETA_FORMAT_CBOR:
+            dump_cbor_setup_metadata_dump(&parser);
+            break;
+        case FLVMETA_FORMAT_CSV:
+        case FLVMETA_FORMAT_TSV:
+            dump_csv_setup_metadata_dump(&parser);
             break;
     }
 
-    retval = flv_parse(options->input_file, &parser);
+    retval = input_parse(options, options->input_file, &parser);
     if (retval == FLVMETA_DUMP_STOP_OK) {
         retval = FLV_OK;
     }
@@ -166,36 +190,141 @@ int dump_metadata(const flvmeta_opts * options) {
 }
 
 /* dump the full contents of an FLV file */
-int dump_flv_file(const flvmeta_opts * options) {
+int dump_flv_file(const flvmeta_opts * options, output_sink * out) {
     flv_parser parser;
     memset(&parser, 0, sizeof(flv_parser));
 
     switch (options->dump_format) {
         case FLVMETA_FORMAT_JSON:
-            return dump_json_file(&parser, options);
+            return dump_json_file(&parser, options, out);
+        case FLVMETA_FORMAT_NDJSON:
+            return dump_ndjson_file(&parser, options, out);
         case FLVMETA_FORMAT_RAW:
-            return dump_raw_file(&parser, options);
+            return dump_raw_file(&parser, options, out);
         case FLVMETA_FORMAT_XML:
-            return dump_xml_file(&parser, options);
+            return dump_xml_file(&parser, options, out);
         case FLVMETA_FORMAT_YAML:
-            return dump_yaml_file(&parser, options);
+            if (options->dump_strict_yaml) {
+                return dump_yaml_strict_file(&parser, options, out);
+            }
+            return dump_yaml_file(&parser, options, out);
+        case FLVMETA_FORMAT_CBOR:
+            return dump_cbor_file(&parser, options, out);
+        case FLVMETA_FORMAT_CSV:
+            return dump_csv_file(&parser, options, out, ',');
+        case FLVMETA_FORMAT_TSV:
+            return dump_csv_file(&parser, options, out, '\t');
         default:
             return OK;
     }
 }
 
 /* dump AMF data directly */
-int dump_amf_data(const amf_data * data, const flvmeta_opts * options) {
+int dump_amf_data(const amf_data * data, const flvmeta_opts * options, output_sink * out) {
     switch (options->dump_format) {
         case FLVMETA_FORMAT_JSON:
-            return dump_json_amf_data(data);
+        case FLVMETA_FORMAT_NDJSON:
+            return dump_json_amf_data(data, out);
         case FLVMETA_FORMAT_RAW:
-            return dump_raw_amf_data(data);
+            return dump_raw_amf_data(data, out);
         case FLVMETA_FORMAT_XML:
-            return dump_xml_amf_data(data);
+            return dump_xml_amf_data(data, out);
         case FLVMETA_FORMAT_YAML:
-            return dump_yaml_amf_data(data);
+            if (options->dump_strict_yaml) {
+                return dump_yaml_strict_amf_data(data, out);
+            }
+            return dump_yaml_amf_data(data, out);
+        case FLVMETA_FORMAT_CBOR:
+            return dump_cbor_amf_data(data, out);
+        case FLVMETA_FORMAT_CSV:
+            return dump_csv_amf_data(data, out, ',');
+        case FLVMETA_FORMAT_TSV:
+            return dump_csv_amf_data(data, out, '\t');
         default:
             return OK;
     }
 }
+
+/* dump information read from the end of an FLV file */
+int dump_file_info(const flvmeta_opts * options, output_sink * out) {
+    flv_stream * flv_in;
+    flv_header header;
+    flv_tail_info tail;
+    file_offset_t filesize;
+    amf_data * data;
+    int retval;
+
+    if (flvmeta_filesize(options->input_file, &filesize) == 0) {
+        return ERROR_OPEN_READ;
+    }
+
+    flv_in = input_open(options, options->input_file);
+    if (flv_in == NULL) {
+        return ERROR_OPEN_READ;
+    }
+
+    if (input_read_header(options, flv_in, &header) != FLV_OK) {
+        input_close(options, flv_in);
+        return ERROR_NO_FLV;
+    }
+
+    retval = get_flv_tail_info(flv_in, filesize, &tail);
+    input_close(options, flv_in);
+    if (retval != OK) {
+        return retval;
+    }
+
+    data = amf_associative_array_new();
+    if (data == NULL) {
+        return ERROR_MEMORY;
+    }
+
+    amf_associative_array_add(data, "filesize", amf_number_new((number64)tail.filesize));
+    amf_associative_array_add(data, "validsize", amf_number_new((number64)tail.valid_size));
+    amf_associative_array_add(data, "truncated", amf_boolean_new(tail.truncated));
+    amf_associative_array_add(data, "duration", amf_number_new(tail.duration));
+    amf_associative_array_add(data, "lasttimestamp", amf_number_new(tail.last_timestamp / 1000.0));
+    if (tail.have_video) {
+        amf_associative_array_add(data, "lastvideotimestamp", amf_number_new(tail.last_video_timestamp / 1000.0));
+    }
+    if (tail.have_audio) {
+        amf_associative_array_add(data, "lastaudiotimestamp", amf_number_new(tail.last_audio_timestamp / 1000.0));
+    }
+    amf_associative_array_add(data, "forwardscan", amf_boolean_new(tail.forward_scan));
+
+    retval = dump_amf_data(data, options, out);
+    amf_data_free(data);
+
+    return retval;
+}
+
+int dump_seek_point(const flvmeta_opts * options, output_sink * out) {
+    keyframe_index index;
+    amf_data * data;
+    uint32 keyframe;
+    int retval;
+
+    retval = keyframe_index_read(&index, options->input_file, options);
+    if (retval != OK) {
+        return retval;
+    }
+
+    keyframe = keyframe_index_find(&index, options->seek_time);
+
+    data = amf_associative_array_new();
+    if (data == NULL) {
+        keyframe_index_free(&index);
+        return ERROR_MEMORY;
+    }
+
+    amf_associative_array_add(data, "time", amf_number_new(index.times[keyframe]));
+    amf_associative_array_add(data, "fileposition", amf_number_new((number64)index.filepositions[keyframe]));
+    amf_associative_array_add(data, "keyframe", amf_number_new((number64)keyframe));
+    amf_associative_array_add(data, "source", amf_str(index.computed ? "tags" : "onMetaData"));
+    keyframe_index_free(&index);
+
+    retval = dump_amf_data(data, options, out);
+    amf_data_free(data);
+
+    return retval;
+}
@@ -23,6 +23,13 @@
 #define __DUMP_H__
 
 #include "flvmeta.h"
+#include "sink.h"
+
+/* user data of the metadata dump callbacks */
+typedef struct __dump_context {
+    const flvmeta_opts * options;
+    output_sink * out;
+} dump_context;
 
 #ifdef __cplusplus
 extern "C" {
@@ -40,13 +47,19 @@ const char * dump_string_get_sound_format(flv_audio_tag tag);
 const char * dump_string_get_aac_packet_type(flv_aac_packet_type type);
 
 /* dump metadata from a FLV file */
-int dump_metadata(const flvmeta_opts * options);
+int dump_metadata(const flvmeta_opts * options, output_sink * out);
 
 /* dump the full contents of an FLV file */
-int dump_flv_file(const flvmeta_opts * options);
+int dump_flv_file(const flvmeta_opts * options, output_sink * out);
 
 /* dump AMF data directly */
-int dump_amf_data(const amf_data * data, const flvmeta_opts * options);
+int dump_amf_data(const amf_data * data, const flvmeta_opts * options, output_sink * out);
+
+/* dump information read from the end of an FLV file */
+int dump_file_info(const flvmeta_opts * options, output_sink * out);
+
+/* dump the time and file position of the keyframe at or before the seek time */
+int dump_seek_point(const flvmeta_opts * options, output_sink * out);
 
 #ifdef __cplusplus
 }
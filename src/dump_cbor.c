@@ -0,0 +1,295 @@
+/*
+    FLVMeta - FLV Metadata Editor
+
+    Copyright (C) 2007-2014 Marc Noirot <marc.noirot AT gmail.com>
+
+    This file is part of FLVMeta.
+
+    FLVMeta is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    FLVMeta is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FLVMeta; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+#include "dump.h"
+#include "dump_cbor.h"
+#include "input.h"
+#include "cbor.h"
+
+#include <string.h>
+
+/* CBOR metadata dumping, each AMF type maps to a single CBOR type */
+static void cbor_amf_data_dump(const amf_data * data, output_sink * out) {
+    amf_node * node;
+
+    if (data == NULL) {
+        cbor_emit_null(out);
+        return;
+    }
+
+    switch (data->type) {
+        case AMF_TYPE_NUMBER:
+            cbor_emit_number(out, data->number_data);
+            break;
+        case AMF_TYPE_BOOLEAN:
+            cbor_emit_boolean(out, data->boolean_data);
+            break;
+        case AMF_TYPE_STRING:
+            cbor_emit_text(out, (char *)amf_string_get_bytes(data), amf_string_get_size(data));
+            break;
+        case AMF_TYPE_OBJECT:
+            cbor_emit_map_start(out, amf_object_size(data));
+            node = amf_object_first(data);
+            while (node != NULL) {
+                cbor_emit_text(out, 
+                    (char *)amf_string_get_bytes(amf_object_get_name(node)),
+                    amf_string_get_size(amf_object_get_name(node))
+                );
+                cbor_amf_data_dump(amf_object_get_data(node), out);
+                node = amf_object_next(node);
+            }
+            break;
+        case AMF_TYPE_NULL:
+            cbor_emit_null(out);
+            break;
+        case AMF_TYPE_UNDEFINED:
+            cbor_emit_undefined(out);
+            break;
+        case AMF_TYPE_ASSOCIATIVE_ARRAY:
+            cbor_emit_map_start(out, amf_associative_array_size(data));
+            node = amf_associative_array_first(data);
+            while (node != NULL) {
+                cbor_emit_text(out, 
+                    (char *)amf_string_get_bytes(amf_associative_array_get_name(node)),
+                    amf_string_get_size(amf_associative_array_get_name(node))
+                );
+                cbor_amf_data_dump(amf_associative_array_get_data(node), out);
+                node = amf_associative_array_next(node);
+            }
+            break;
+        case AMF_TYPE_ARRAY:
+            cbor_emit_array_start(out, amf_array_size(data));
+            node = amf_array_first(data);
+            while (node != NULL) {
+                cbor_amf_data_dump(amf_array_get(node), out);
+                node = amf_array_next(node);
+            }
+            break;
+        case AMF_TYPE_DATE:
+            /* tag 1: epoch-based date/time, in seconds */
+            cbor_emit_tag(out, 1);
+            cbor_emit_number(out, amf_date_get_milliseconds(data) / 1000);
+            break;
+        case AMF_TYPE_XML:
+            cbor_emit_text(out, (char *)data->xmlstring_data.mbstr, data->xmlstring_data.size);
+            break;
+        case AMF_TYPE_CLASS:
+        default:
+            /* keep the enclosing container well-formed */
+            cbor_emit_null(out);
+            break;
+    }
+}
+
+/* CBOR FLV file full dump callbacks */
+
+static int cbor_on_header(flv_header * header, flv_parser * parser) {
+    output_sink * out = (output_sink*) parser->user_data;
+
+    cbor_emit_map_start_indefinite(out);
+    cbor_emit_text_z(out, "magic");
+    cbor_emit_text(out, (char*)header->signature, 3);
+    cbor_emit_text_z(out, "hasVideo");
+    cbor_emit_boolean(out, flv_header_has_video(*header));
+    cbor_emit_text_z(out, "hasAudio");
+    cbor_emit_boolean(out, flv_header_has_audio(*header));
+    cbor_emit_text_z(out, "version");
+    cbor_emit_unsigned(out, header->version);
+    cbor_emit_text_z(out, "tags");
+    cbor_emit_array_start_indefinite(out);
+
+    return OK;
+}
+
+static int cbor_on_tag(flv_tag * tag, flv_parser * parser) {
+    output_sink * out = (output_sink*) parser->user_data;
+
+    /* the tag map is closed when its trailing size is read */
+    cbor_emit_map_start_indefinite(out);
+    cbor_emit_text_z(out, "type");
+    cbor_emit_unsigned(out, tag->type);
+    cbor_emit_text_z(out, "timestamp");
+    cbor_emit_unsigned(out, flv_tag_get_timestamp(*tag));
+    cbor_emit_text_z(out, "dataSize");
+    cbor_emit_unsigned(out, flv_tag_get_body_length(*tag));
+    cbor_emit_text_z(out, "offset");
+    cbor_emit_unsigned(out, (uint64)parser->stream->current_tag_offset);
+
+    return OK;
+}
+
+static int cbor_on_video_tag(flv_tag * tag, flv_video_tag vt, flv_parser * parser) {
+    output_sink * out = (output_sink*) parser->user_data;
+    int is_avc = (flv_video_tag_codec_id(vt) == FLV_VIDEO_TAG_CODEC_AVC);
+
+    cbor_emit_text_z(out, "videoData");
+    cbor_emit_map_start(out, is_avc ? 3 : 2);
+    cbor_emit_text_z(out, "codecID");
+    cbor_emit_unsigned(out, flv_video_tag_codec_id(vt));
+    cbor_emit_text_z(out, "frameType");
+    cbor_emit_unsigned(out, flv_video_tag_frame_type(vt));
+
+    /* if AVC, detect frame type and composition time */
+    if (is_avc) {
+        flv_avc_packet_type type;
+
+        /* packet type */
+        if (flv_read_tag_body(parser->stream, &type, sizeof(flv_avc_packet_type)) < sizeof(flv_avc_packet_type)) {
+            return ERROR_INVALID_TAG;
+        }
+
+        cbor_emit_text_z(out, "AVCData");
+        cbor_emit_map_start(out, type == FLV_AVC_PACKET_TYPE_NALU ? 2 : 1);
+        cbor_emit_text_z(out, "packetType");
+        cbor_emit_unsigned(out, type);
+
+        /* composition time, a signed 24-bit integer */
+        if (type == FLV_AVC_PACKET_TYPE_NALU) {
+            uint24_be composition_time;
+            sint32 cts;
+
+            if (flv_read_tag_body(parser->stream, &composition_time, sizeof(uint24_be)) < sizeof(uint24_be)) {
+                return ERROR_INVALID_TAG;
+            }
+
+            cts = (sint32)uint24_be_to_uint32(composition_time);
+            if (cts & 0x800000) {
+                cts -= 0x1000000;
+            }
+
+            cbor_emit_text_z(out, "compositionTimeOffset");
+            cbor_emit_integer(out, cts);
+        }
+    }
+
+    return OK;
+}
+
+static int cbor_on_audio_tag(flv_tag * tag, flv_audio_tag at, flv_parser * parser) {
+    output_sink * out = (output_sink*) parser->user_data;
+    int is_aac = (flv_audio_tag_sound_format(at) == FLV_AUDIO_TAG_SOUND_FORMAT_AAC);
+
+    cbor_emit_text_z(out, "audioData");
+    cbor_emit_map_start(out, is_aac ? 5 : 4);
+    cbor_emit_text_z(out, "type");
+    cbor_emit_unsigned(out, flv_audio_tag_sound_type(at));
+    cbor_emit_text_z(out, "size");
+    cbor_emit_unsigned(out, flv_audio_tag_sound_size(at));
+    cbor_emit_text_z(out, "rate");
+    cbor_emit_unsigned(out, flv_audio_tag_sound_rate(at));
+    cbor_emit_text_z(out, "format");
+    cbor_emit_unsigned(out, flv_audio_tag_sound_format(at));
+
+    /* if AAC, detect packet type */
+    if (is_aac) {
+        flv_aac_packet_type type;
+
+        /* packet type */
+        if (flv_read_tag_body(parser->stream, &type, sizeof(flv_aac_packet_type)) < sizeof(flv_aac_packet_type)) {
+            return ERROR_INVALID_TAG;
+        }
+
+        cbor_emit_text_z(out, "AACData");
+        cbor_emit_map_start(out, 1);
+        cbor_emit_text_z(out, "packetType");
+        cbor_emit_unsigned(out, type);
+    }
+
+    return OK;
+}
+
+static int cbor_on_metadata_tag(flv_tag * tag, amf_data * name, amf_data * data, flv_parser * parser) {
+    output_sink * out = (output_sink*) parser->user_data;
+
+    cbor_emit_text_z(out, "scriptDataObject");
+    cbor_emit_map_start(out, 2);
+    cbor_emit_text_z(out, "name");
+    cbor_emit_text(out, (char*)amf_string_get_bytes(name), amf_string_get_size(name));
+    cbor_emit_text_z(out, "metadata");
+    cbor_amf_data_dump(data, out);
+
+    return OK;
+}
+
+static int cbor_on_prev_tag_size(uint32 size, flv_parser * parser) {
+    output_sink * out = (output_sink*) parser->user_data;
+
+    cbor_emit_break(out);
+
+    return OK;
+}
+
+static int cbor_on_stream_end(flv_parser * parser) {
+    output_sink * out = (output_sink*) parser->user_data;
+
+    /* close the tags array, then the file map */
+    cbor_emit_break(out);
+    cbor_emit_break(out);
+
+    return OK;
+}
+
+/* CBOR FLV file metadata dump callback */
+static int cbor_on_metadata_tag_only(flv_tag * tag, amf_data * name, amf_data * data, flv_parser * parser) {
+    dump_context * ctxt = (dump_context*) parser->user_data;
+    const flvmeta_opts * options = ctxt->options;
+
+    if (options->metadata_event == NULL) {
+        if (!strcmp((char*)amf_string_get_bytes(name), "onMetaData")) {
+            dump_cbor_amf_data(data, ctxt->out);
+            return FLVMETA_DUMP_STOP_OK;
+        }
+    }
+    else {
+        if (!strcmp((char*)amf_string_get_bytes(name), options->metadata_event)) {
+            dump_cbor_amf_data(data, ctxt->out);
+        }
+    }
+    return OK;
+}
+
+/* setup dumping */
+
+void dump_cbor_setup_metadata_dump(flv_parser * parser) {
+    if (parser != NULL) {
+        parser->on_metadata_tag = cbor_on_metadata_tag_only;
+    }
+}
+
+int dump_cbor_file(flv_parser * parser, const flvmeta_opts * options, output_sink * out) {
+    parser->on_header = cbor_on_header;
+    parser->on_tag = cbor_on_tag;
+    parser->on_audio_tag = cbor_on_audio_tag;
+    parser->on_video_tag = cbor_on_video_tag;
+    parser->on_metadata_tag = cbor_on_metadata_tag;
+    parser->on_prev_tag_size = cbor_on_prev_tag_size;
+    parser->on_stream_end = cbor_on_stream_end;
+    parser->user_data = out;
+
+    return input_parse(options, options->input_file, parser);
+}
+
+int dump_cbor_amf_data(const amf_data * data, output_sink * out) {
+    /* dump AMF into a single CBOR data item */
+    cbor_amf_data_dump(data, out);
+
+    return OK;
+}
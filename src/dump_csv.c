@@ -0,0 +1,338 @@
+/*
+    FLVMeta - FLV Metadata Editor
+
+    Copyright (C) 2007-2014 Marc Noirot <marc.noirot AT gmail.com>
+
+    This file is part of FLVMeta.
+
+    FLVMeta is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    FLVMeta is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FLVMeta; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+#include "dump.h"
+#include "dump_csv.h"
+#include "input.h"
+#include "util.h"
+
+#include <stdio.h>
+#include <string.h>
+
+typedef struct __csv_writer {
+    char separator;
+    output_sink * out;
+} csv_writer;
+
+/* state of the tag currently being dumped */
+typedef struct __csv_row {
+    file_offset_t offset;
+    uint8 type;
+    uint32 body_length;
+    uint32 dts;
+    sint32 cts;
+    uint8 have_cts;
+    uint8 is_video;
+    uint8 keyframe;
+    uint8 codec;
+    uint8 is_audio;
+    uint8 sound_format;
+} csv_row;
+
+typedef struct __csv_dump {
+    csv_writer writer;
+    csv_row row;
+} csv_dump;
+
+/* write a field, quoting it when it contains special characters */
+static void csv_write_field(csv_writer * w, const char * str, size_t size) {
+    size_t i;
+    int quote = 0;
+
+    for (i = 0; i < size; ++i) {
+        if (str[i] == w->separator || str[i] == '"' || str[i] == '\n' || str[i] == '\r') {
+            quote = 1;
+            break;
+        }
+    }
+
+    if (quote == 0) {
+        sink_write(w->out, str, size);
+        return;
+    }
+
+    sink_write_char(w->out, '"');
+    for (i = 0; i < size; ++i) {
+        if (str[i] == '"') {
+            sink_write_char(w->out, '"');
+        }
+        sink_write_char(w->out, str[i]);
+    }
+    sink_write_char(w->out, '"');
+}
+
+static void csv_write_field_z(csv_writer * w, const char * str) {
+    csv_write_field(w, str, strlen(str));
+}
+
+/* CSV FLV file full dump callbacks */
+
+static int csv_on_header(flv_header * header, flv_parser * parser) {
+    csv_writer * w = &((csv_dump *)parser->user_data)->writer;
+    const char * columns[] = {
+        "offset", "type", "body_length", "dts", "cts", "keyframe", "codec", "sound_format"
+    };
+    size_t i;
+
+    for (i = 0; i < sizeof(columns) / sizeof(columns[0]); ++i) {
+        if (i > 0) {
+            sink_write_char(w->out, w->separator);
+        }
+        csv_write_field_z(w, columns[i]);
+    }
+    sink_write_char(w->out, '\n');
+
+    return OK;
+}
+
+static int csv_on_tag(flv_tag * tag, flv_parser * parser) {
+    csv_row * row = &((csv_dump *)parser->user_data)->row;
+
+    memset(row, 0, sizeof(csv_row));
+    row->offset = parser->stream->current_tag_offset;
+    row->type = tag->type;
+    row->body_length = flv_tag_get_body_length(*tag);
+    row->dts = flv_tag_get_timestamp(*tag);
+
+    return OK;
+}
+
+static int csv_on_video_tag(flv_tag * tag, flv_video_tag vt, flv_parser * parser) {
+    csv_row * row = &((csv_dump *)parser->user_data)->row;
+
+    row->is_video = 1;
+    row->codec = flv_video_tag_codec_id(vt);
+    row->keyframe = (flv_video_tag_frame_type(vt) == FLV_VIDEO_TAG_FRAME_TYPE_KEYFRAME);
+
+    /* if AVC, read the composition time */
+    if (row->codec == FLV_VIDEO_TAG_CODEC_AVC) {
+        flv_avc_packet_type type;
+
+        /* packet type */
+        if (flv_read_tag_body(parser->stream, &type, sizeof(flv_avc_packet_type)) < sizeof(flv_avc_packet_type)) {
+            return ERROR_INVALID_TAG;
+        }
+
+        if (type == FLV_AVC_PACKET_TYPE_NALU) {
+            uint24_be composition_time;
+
+            if (flv_read_tag_body(parser->stream, &composition_time, sizeof(uint24_be)) < sizeof(uint24_be)) {
+                return ERROR_INVALID_TAG;
+            }
+
+            /* signed 24-bit integer */
+            row->cts = (sint32)uint24_be_to_uint32(composition_time);
+            if (row->cts & 0x800000) {
+                row->cts -= 0x1000000;
+            }
+            row->have_cts = 1;
+        }
+    }
+
+    return OK;
+}
+
+static int csv_on_audio_tag(flv_tag * tag, flv_audio_tag at, flv_parser * parser) {
+    csv_row * row = &((csv_dump *)parser->user_data)->row;
+
+    row->is_audio = 1;
+    row->sound_format = flv_audio_tag_sound_format(at);
+
+    return OK;
+}
+
+/* the row is written once the whole tag has been read */
+static int csv_on_prev_tag_size(uint32 size, flv_parser * parser) {
+    csv_writer * w = &((csv_dump *)parser->user_data)->writer;
+    const csv_row * row = &((csv_dump *)parser->user_data)->row;
+    flv_tag tag;
+
+    tag.type = row->type;
+
+    sink_write_unsigned(w->out, (uint64)row->offset);
+    sink_write_char(w->out, w->separator);
+    csv_write_field_z(w, dump_string_get_tag_type(&tag));
+    sink_write_char(w->out, w->separator);
+    sink_write_unsigned(w->out, row->body_length);
+    sink_write_char(w->out, w->separator);
+    sink_write_unsigned(w->out, row->dts);
+    sink_write_char(w->out, w->separator);
+    if (row->have_cts) {
+        sink_write_integer(w->out, row->cts);
+    }
+    sink_write_char(w->out, w->separator);
+    if (row->is_video) {
+        sink_write_char(w->out, row->keyframe ? '1' : '0');
+    }
+    sink_write_char(w->out, w->separator);
+    if (row->is_video) {
+        sink_write_unsigned(w->out, row->codec);
+    }
+    sink_write_char(w->out, w->separator);
+    if (row->is_audio) {
+        sink_write_unsigned(w->out, row->sound_format);
+    }
+    sink_write_char(w->out, '\n');
+
+    return OK;
+}
+
+/* AMF data is flattened into path/value rows */
+static void csv_amf_data_dump(const amf_data * data, csv_writer * w, char * path, size_t path_length, size_t path_size) {
+    amf_node * node;
+    time_t time;
+    struct tm t;
+    char str[128];
+    size_t length;
+    uint32 index;
+
+    if (data == NULL) {
+        return;
+    }
+
+    switch (data->type) {
+        case AMF_TYPE_OBJECT:
+        case AMF_TYPE_ASSOCIATIVE_ARRAY:
+            node = amf_object_first(data);
+            while (node != NULL) {
+                amf_data * name = amf_object_get_name(node);
+
+                length = path_length;
+                if (length > 0 && length < path_size - 1) {
+                    path[length++] = '.';
+                }
+                if (length + amf_string_get_size(name) < path_size) {
+                    memcpy(path + length, amf_string_get_bytes(name), amf_string_get_size(name));
+                    length += amf_string_get_size(name);
+                }
+                csv_amf_data_dump(amf_object_get_data(node), w, path, length, path_size);
+                node = amf_object_next(node);
+            }
+            return;
+        case AMF_TYPE_ARRAY:
+            index = 0;
+            node = amf_array_first(data);
+            while (node != NULL) {
+                length = path_length;
+                if (length + 12 < path_size) {
+                    length += sprintf(path + length, "%s%u", (length > 0) ? "." : "", index);
+                }
+                csv_amf_data_dump(amf_array_get(node), w, path, length, path_size);
+                ++index;
+                node = amf_array_next(node);
+            }
+            return;
+        default:
+            break;
+    }
+
+    csv_write_field(w, path, path_length);
+    sink_write_char(w->out, w->separator);
+
+    switch (data->type) {
+        case AMF_TYPE_NUMBER:
+            length = sprintf(str, "%.12g", data->number_data);
+            sink_write(w->out, str, length);
+            break;
+        case AMF_TYPE_BOOLEAN:
+            csv_write_field_z(w, (data->boolean_data) ? "true" : "false");
+            break;
+        case AMF_TYPE_STRING:
+            csv_write_field(w, (char *)amf_string_get_bytes(data), amf_string_get_size(data));
+            break;
+        case AMF_TYPE_DATE:
+            time = amf_date_to_time_t(data);
+            flvmeta_localtime(&time, &t);
+            length = strftime(str, sizeof(str), "%Y-%m-%dT%H:%M:%S", &t);
+            sink_write(w->out, str, length);
+            break;
+        default:
+            break;
+    }
+
+    sink_write_char(w->out, '\n');
+}
+
+static void csv_amf_data_dump_rows(const amf_data * data, csv_writer * w) {
+    char path[1024];
+
+    csv_write_field_z(w, "key");
+    sink_write_char(w->out, w->separator);
+    csv_write_field_z(w, "value");
+    sink_write_char(w->out, '\n');
+
+    csv_amf_data_dump(data, w, path, 0, sizeof(path));
+}
+
+/* CSV FLV file metadata dump callback */
+static int csv_on_metadata_tag_only(flv_tag * tag, amf_data * name, amf_data * data, flv_parser * parser) {
+    dump_context * ctxt = (dump_context*) parser->user_data;
+    const flvmeta_opts * options = ctxt->options;
+    char separator = (options->dump_format == FLVMETA_FORMAT_TSV) ? '\t' : ',';
+
+    if (options->metadata_event == NULL) {
+        if (!strcmp((char*)amf_string_get_bytes(name), "onMetaData")) {
+            dump_csv_amf_data(data, ctxt->out, separator);
+            return FLVMETA_DUMP_STOP_OK;
+        }
+    }
+    else {
+        if (!strcmp((char*)amf_string_get_bytes(name), options->metadata_event)) {
+            dump_csv_amf_data(data, ctxt->out, separator);
+        }
+    }
+    return OK;
+}
+
+/* setup dumping */
+
+void dump_csv_setup_metadata_dump(flv_parser * parser) {
+    if (parser != NULL) {
+        parser->on_metadata_tag = csv_on_metadata_tag_only;
+    }
+}
+
+int dump_csv_file(flv_parser * parser, const flvmeta_opts * options, output_sink * out, char separator) {
+    csv_dump dump;
+
+    dump.writer.separator = separator;
+    dump.writer.out = out;
+    memset(&dump.row, 0, sizeof(csv_row));
+
+    parser->on_header = csv_on_header;
+    parser->on_tag = csv_on_tag;
+    parser->on_audio_tag = csv_on_audio_tag;
+    parser->on_video_tag = csv_on_video_tag;
+    parser->on_prev_tag_size = csv_on_prev_tag_size;
+    parser->user_data = &dump;
+
+    return input_parse(options, options->input_file, parser);
+}
+
+int dump_csv_amf_data(const amf_data * data, output_sink * out, char separator) {
+    csv_writer w;
+
+    w.separator = separator;
+    w.out = out;
+    csv_amf_data_dump_rows(data, &w);
+
+    return OK;
+}
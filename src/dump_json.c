@@ -21,17 +21,19 @@
 */
 #include "dump.h"
 #include "dump_json.h"
+#include "input.h"
 #include "json.h"
+#include "util.h"
 
 #include <stdio.h>
 #include <string.h>
 
 /* JSON metadata dumping */
-static void json_amf_data_dump(const amf_data * data, json_emitter * je) {
+void json_amf_data_dump(const amf_data * data, json_emitter * je) {
     if (data != NULL) {
         amf_node * node;
         time_t time;
-        struct tm * t;
+        struct tm t;
         char str[128];
 
         switch (data->type) {
@@ -85,9 +87,8 @@ static void json_amf_data_dump(const amf_data * data, json_emitter * je) {
                 break;
             case AMF_TYPE_DATE:
                 time = amf_date_to_time_t(data);
-                tzset();
-                t = localtime(&time);
-                strftime(str, sizeof(str), "%Y-%m-%dT%H:%M:%S", t);
+                flvmeta_localtime(&time, &t);
+                strftime(str, sizeof(str), "%Y-%m-%dT%H:%M:%S", &t);
                 json_emit_string(je, str, strlen(str));
                 break;
             case AMF_TYPE_XML: break;
@@ -254,19 +255,59 @@ static int json_on_stream_end(flv_parser * parser) {
     return OK;
 }
 
+/* NDJSON FLV file full dump callbacks */
+
+static int ndjson_on_header(flv_header * header, flv_parser * parser) {
+    json_emitter * je;
+    je = (json_emitter*)parser->user_data;
+
+    json_emit_object_start(je);
+    json_emit_object_key_z(je, "magic");
+    json_emit_string(je, (char*)header->signature, 3);
+    json_emit_object_key_z(je, "hasVideo");
+    json_emit_boolean(je, flv_header_has_video(*header));
+    json_emit_object_key_z(je, "hasAudio");
+    json_emit_boolean(je, flv_header_has_audio(*header));
+    json_emit_object_key_z(je, "version");
+    json_emit_integer(je, header->version);
+    json_emit_object_end(je);
+
+    /* every line is flushed as soon as it is complete,
+       so the dump of a growing file can be followed */
+    sink_write_char(je->out, '\n');
+    sink_flush(je->out);
+    json_emit_init(je, je->out);
+
+    return OK;
+}
+
+static int ndjson_on_prev_tag_size(uint32 size, flv_parser * parser) {
+    json_emitter * je;
+    je = (json_emitter*)parser->user_data;
+
+    json_emit_object_end(je);
+
+    sink_write_char(je->out, '\n');
+    sink_flush(je->out);
+    json_emit_init(je, je->out);
+
+    return OK;
+}
+
 /* JSON FLV file metadata dump callback */
 static int json_on_metadata_tag_only(flv_tag * tag, amf_data * name, amf_data * data, flv_parser * parser) {
-    flvmeta_opts * options = (flvmeta_opts*) parser->user_data;
+    dump_context * ctxt = (dump_context*) parser->user_data;
+    const flvmeta_opts * options = ctxt->options;
 
     if (options->metadata_event == NULL) {
         if (!strcmp((char*)amf_string_get_bytes(name), "onMetaData")) {
-            dump_json_amf_data(data);
+            dump_json_amf_data(data, ctxt->out);
             return FLVMETA_DUMP_STOP_OK;
         }
     }
     else {
         if (!strcmp((char*)amf_string_get_bytes(name), options->metadata_event)) {
-            dump_json_amf_data(data);
+            dump_json_amf_data(data, ctxt->out);
         }
     }
     return OK;
@@ -280,7 +321,7 @@ void dump_json_setup_metadata_dump(flv_parser * parser) {
     }
 }
 
-int dump_json_file(flv_parser * parser, const flvmeta_opts * options) {
+int dump_json_file(flv_parser * parser, const flvmeta_opts * options, output_sink * out) {
     json_emitter je;
 
     parser->on_header = json_on_header;
@@ -291,20 +332,36 @@ int dump_json_file(flv_parser * parser, const flvmeta_opts * options) {
     parser->on_prev_tag_size = json_on_prev_tag_size;
     parser->on_stream_end = json_on_stream_end;
 
-    json_emit_init(&je);
+    json_emit_init(&je, out);
+    parser->user_data = &je;
+
+    return input_parse(options, options->input_file, parser);
+}
+
+int dump_ndjson_file(flv_parser * parser, const flvmeta_opts * options, output_sink * out) {
+    json_emitter je;
+
+    parser->on_header = ndjson_on_header;
+    parser->on_tag = json_on_tag;
+    parser->on_audio_tag = json_on_audio_tag;
+    parser->on_video_tag = json_on_video_tag;
+    parser->on_metadata_tag = json_on_metadata_tag;
+    parser->on_prev_tag_size = ndjson_on_prev_tag_size;
+
+    json_emit_init(&je, out);
     parser->user_data = &je;
 
-    return flv_parse(options->input_file, parser);
+    return input_parse(options, options->input_file, parser);
 }
 
-int dump_json_amf_data(const amf_data * data) {
+int dump_json_amf_data(const amf_data * data, output_sink * out) {
     json_emitter je;
-    json_emit_init(&je);
+    json_emit_init(&je, out);
 
     /* dump AMF into JSON */
     json_amf_data_dump(data, &je);
 
-    printf("\n");
+    sink_write_char(out, '\n');
 
     return OK;
 }
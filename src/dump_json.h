@@ -22,7 +22,8 @@
 #ifndef __DUMP_JSON_H__
 #define __DUMP_JSON_H__
 
-#include "flvmeta.h"
+#include "dump.h"
+#include "json.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -30,8 +31,14 @@ extern "C" {
 
 /* JSON dumping functions */
 void dump_json_setup_metadata_dump(flv_parser * parser);
-int dump_json_file(flv_parser * parser, const flvmeta_opts * options);
-int dump_json_amf_data(const amf_data * data);
+int dump_json_file(flv_parser * parser, const flvmeta_opts * options, output_sink * out);
+int dump_json_amf_data(const amf_data * data, output_sink * out);
+
+/* emit AMF data as a JSON value */
+void json_amf_data_dump(const amf_data * data, json_emitter * je);
+
+/* NDJSON dumping functions, one JSON document per line */
+int dump_ndjson_file(flv_parser * parser, const flvmeta_opts * options, output_sink * out);
 
 #ifdef __cplusplus
 }
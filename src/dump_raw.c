@@ -21,50 +21,51 @@
 */
 #include "dump.h"
 #include "dump_raw.h"
+#include "input.h"
 
 #include <stdio.h>
 #include <string.h>
 
+/* raw full dump state */
+typedef struct __raw_context {
+    uint32 tag_number;
+    output_sink * out;
+} raw_context;
+
 /* raw FLV file full dump callbacks */
 
 static int raw_on_header(flv_header * header, flv_parser * parser) {
-    int * n;
-
-    n = (int*) malloc(sizeof(uint32));
-    if (n == NULL) {
-        return ERROR_MEMORY;
-    }
+    output_sink * out = ((raw_context*)parser->user_data)->out;
 
-    parser->user_data = n;
-    *n = 0;
-
-    printf("Magic: %.3s\n", header->signature);
-    printf("Version: %" PRI_BYTE "u\n", header->version);
-    printf("Has audio: %s\n", flv_header_has_audio(*header) ? "yes" : "no");
-    printf("Has video: %s\n", flv_header_has_video(*header) ? "yes" : "no");
-    printf("Offset: %u\n", swap_uint32(header->offset));
+    sink_printf(out, "Magic: %.3s\n", header->signature);
+    sink_printf(out, "Version: %" PRI_BYTE "u\n", header->version);
+    sink_printf(out, "Has audio: %s\n", flv_header_has_audio(*header) ? "yes" : "no");
+    sink_printf(out, "Has video: %s\n", flv_header_has_video(*header) ? "yes" : "no");
+    sink_printf(out, "Offset: %u\n", swap_uint32(header->offset));
     return OK;
 }
 
 static int raw_on_tag(flv_tag * tag, flv_parser * parser) {
-    int * n;
+    raw_context * rc = (raw_context*) parser->user_data;
+    output_sink * out = rc->out;
 
     /* increment current tag number */
-    n = ((int*)parser->user_data);
-    ++(*n);
+    ++rc->tag_number;
 
-    printf("--- Tag #%u at 0x%" FILE_OFFSET_PRINTF_FORMAT "X", *n, parser->stream->current_tag_offset);
-    printf(" (%" FILE_OFFSET_PRINTF_FORMAT "u) ---\n", parser->stream->current_tag_offset);
-    printf("Tag type: %s\n", dump_string_get_tag_type(tag));
-    printf("Body length: %u\n", flv_tag_get_body_length(*tag));
-    printf("Timestamp: %u\n", flv_tag_get_timestamp(*tag));
+    sink_printf(out, "--- Tag #%u at 0x%" FILE_OFFSET_PRINTF_FORMAT "X", rc->tag_number, parser->stream->current_tag_offset);
+    sink_printf(out, " (%" FILE_OFFSET_PRINTF_FORMAT "u) ---\n", parser->stream->current_tag_offset);
+    sink_printf(out, "Tag type: %s\n", dump_string_get_tag_type(tag));
+    sink_printf(out, "Body length: %u\n", flv_tag_get_body_length(*tag));
+    sink_printf(out, "Timestamp: %u\n", flv_tag_get_timestamp(*tag));
 
     return OK;
 }
 
 static int raw_on_video_tag(flv_tag * tag, flv_video_tag vt, flv_parser * parser) {
-    printf("* Video codec: %s\n", dump_string_get_video_codec(vt));
-    printf("* Video frame type: %s\n", dump_string_get_video_frame_type(vt));
+    output_sink * out = ((raw_context*)parser->user_data)->out;
+
+    sink_printf(out, "* Video codec: %s\n", dump_string_get_video_codec(vt));
+    sink_printf(out, "* Video frame type: %s\n", dump_string_get_video_frame_type(vt));
 
     /* if AVC, detect frame type and composition time */
     if (flv_video_tag_codec_id(vt) == FLV_VIDEO_TAG_CODEC_AVC) {
@@ -75,7 +76,7 @@ static int raw_on_video_tag(flv_tag * tag, flv_video_tag vt, flv_parser * parser
             return ERROR_INVALID_TAG;
         }
 
-        printf("* AVC packet type: %s\n", dump_string_get_avc_packet_type(type));
+        sink_printf(out, "* AVC packet type: %s\n", dump_string_get_avc_packet_type(type));
 
         /* composition time */
         if (type == FLV_AVC_PACKET_TYPE_NALU) {
@@ -85,7 +86,7 @@ static int raw_on_video_tag(flv_tag * tag, flv_video_tag vt, flv_parser * parser
                 return ERROR_INVALID_TAG;
             }
 
-            printf("* Composition time offset: %i\n", uint24_be_to_uint32(composition_time));
+            sink_printf(out, "* Composition time offset: %i\n", uint24_be_to_uint32(composition_time));
         }
     }
 
@@ -93,10 +94,12 @@ static int raw_on_video_tag(flv_tag * tag, flv_video_tag vt, flv_parser * parser
 }
 
 static int raw_on_audio_tag(flv_tag * tag, flv_audio_tag at, flv_parser * parser) {
-    printf("* Sound type: %s\n", dump_string_get_sound_type(at));
-    printf("* Sound size: %s\n", dump_string_get_sound_size(at));
-    printf("* Sound rate: %s\n", dump_string_get_sound_rate(at));
-    printf("* Sound format: %s\n", dump_string_get_sound_format(at));
+    output_sink * out = ((raw_context*)parser->user_data)->out;
+
+    sink_printf(out, "* Sound type: %s\n", dump_string_get_sound_type(at));
+    sink_printf(out, "* Sound size: %s\n", dump_string_get_sound_size(at));
+    sink_printf(out, "* Sound rate: %s\n", dump_string_get_sound_rate(at));
+    sink_printf(out, "* Sound format: %s\n", dump_string_get_sound_format(at));
 
     /* if AAC, detect packet type */
     if (flv_audio_tag_sound_format(at) == FLV_AUDIO_TAG_SOUND_FORMAT_AAC) {
@@ -107,43 +110,44 @@ static int raw_on_audio_tag(flv_tag * tag, flv_audio_tag at, flv_parser * parser
             return ERROR_INVALID_TAG;
         }
 
-        printf("* AAC packet type: %s\n", dump_string_get_aac_packet_type(type));
+        sink_printf(out, "* AAC packet type: %s\n", dump_string_get_aac_packet_type(type));
     }
 
     return OK;
 }
 
 static int raw_on_metadata_tag(flv_tag * tag, amf_data * name, amf_data * data, flv_parser * parser) {
-    printf("* Metadata event name: %s\n", amf_string_get_bytes(name));
-    printf("* Metadata contents: ");
-    amf_data_dump(stdout, data, 0);
-    printf("\n");
+    output_sink * out = ((raw_context*)parser->user_data)->out;
+
+    sink_write_z(out, "* Metadata event name: ");
+    sink_write(out, amf_string_get_bytes(name), amf_string_get_size(name));
+    sink_write_z(out, "\n* Metadata contents: ");
+    amf_data_dump(out, data, 0);
+    sink_write_char(out, '\n');
     return OK;
 }
 
 static int raw_on_prev_tag_size(uint32 size, flv_parser * parser) {
-    printf("Previous tag size: %u\n", size);
-    return OK;
-}
+    output_sink * out = ((raw_context*)parser->user_data)->out;
 
-static int raw_on_stream_end(flv_parser * parser) {
-    free(parser->user_data);
+    sink_printf(out, "Previous tag size: %u\n", size);
     return OK;
 }
 
 /* raw FLV file metadata dump callback */
 static int raw_on_metadata_tag_only(flv_tag * tag, amf_data * name, amf_data * data, flv_parser * parser) {
-    flvmeta_opts * options = (flvmeta_opts*) parser->user_data;
+    dump_context * ctxt = (dump_context*) parser->user_data;
+    const flvmeta_opts * options = ctxt->options;
 
     if (options->metadata_event == NULL) {
         if (!strcmp((char*)amf_string_get_bytes(name), "onMetaData")) {
-            dump_raw_amf_data(data);
+            dump_raw_amf_data(data, ctxt->out);
             return FLVMETA_DUMP_STOP_OK;
         }
     }
     else {
         if (!strcmp((char*)amf_string_get_bytes(name), options->metadata_event)) {
-            dump_raw_amf_data(data);
+            dump_raw_amf_data(data, ctxt->out);
         }
     }
     return OK;
@@ -157,20 +161,25 @@ void dump_raw_setup_metadata_dump(flv_parser * parser) {
     }
 }
 
-int dump_raw_file(flv_parser * parser, const flvmeta_opts * options) {
+int dump_raw_file(flv_parser * parser, const flvmeta_opts * options, output_sink * out) {
+    raw_context rc;
+
     parser->on_header = raw_on_header;
     parser->on_tag = raw_on_tag;
     parser->on_audio_tag = raw_on_audio_tag;
     parser->on_video_tag = raw_on_video_tag;
     parser->on_metadata_tag = raw_on_metadata_tag;
     parser->on_prev_tag_size = raw_on_prev_tag_size;
-    parser->on_stream_end = raw_on_stream_end;
 
-    return flv_parse(options->input_file, parser);
+    rc.tag_number = 0;
+    rc.out = out;
+    parser->user_data = &rc;
+
+    return input_parse(options, options->input_file, parser);
 }
 
-int dump_raw_amf_data(const amf_data * data) {
-    amf_data_dump(stdout, data, 0);
-    printf("\n");
+int dump_raw_amf_data(const amf_data * data, output_sink * out) {
+    amf_data_dump(out, data, 0);
+    sink_write_char(out, '\n');
     return OK;
 }
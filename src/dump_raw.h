@@ -22,7 +22,7 @@
 #ifndef __DUMP_RAW_H__
 #define __DUMP_RAW_H__
 
-#include "flvmeta.h"
+#include "dump.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -30,8 +30,8 @@ extern "C" {
 
 /* raw dumping functions */
 void dump_raw_setup_metadata_dump(flv_parser * parser);
-int dump_raw_file(flv_parser * parser, const flvmeta_opts * options);
-int dump_raw_amf_data(const amf_data * data);
+int dump_raw_file(flv_parser * parser, const flvmeta_opts * options, output_sink * out);
+int dump_raw_amf_data(const amf_data * data, output_sink * out);
 
 #ifdef __cplusplus
 }
@@ -21,135 +21,149 @@
 */
 #include "dump.h"
 #include "dump_xml.h"
+#include "input.h"
+#include "xml.h"
+#include "util.h"
 
 #include <stdio.h>
 #include <string.h>
 
-/* does the given string have XML tag markers ? */
-static int has_xml_markers(const char * str, int len) {
-    int i;
-    for (i = 0; i < len; i++) {
-        if (str[i] == '<' || str[i] == '>') {
-            return 1;
-        }
+/* write an element start tag, with the AMF namespace declaration at the root */
+static void xml_write_amf_element(xml_writer * xw, const char * ns, const char * name, int indent_level) {
+    xml_write_z(xw, "<");
+    xml_write_z(xw, ns);
+    xml_write_z(xw, name);
+    if (indent_level == 0) {
+        xml_write_z(xw, " xmlns");
+        xml_write_z(xw, ns);
+        xml_write_z(xw, "=\"http://schemas.flvmeta.org/AMF0/1.0/\"");
     }
-    return 0;
+}
+
+static void xml_write_amf_end_element(xml_writer * xw, const char * ns, const char * name, int indent_level) {
+    xml_write_indent(xw, indent_level * 2);
+    xml_write_z(xw, "</");
+    xml_write_z(xw, ns);
+    xml_write_z(xw, name);
+    xml_write_z(xw, ">\n");
+}
+
+static void xml_write_amf_entry(xml_writer * xw, const char * ns, const amf_data * name, int indent_level) {
+    xml_write_indent(xw, indent_level * 2);
+    xml_write_z(xw, "<");
+    xml_write_z(xw, ns);
+    xml_write_z(xw, "entry name=\"");
+    xml_write_escaped(xw, (char*)amf_string_get_bytes(name), amf_string_get_size(name));
+    xml_write_z(xw, "\">\n");
 }
 
 /* XML metadata dumping */
-static void xml_amf_data_dump(const amf_data * data, int qualified, int indent_level) {
+static void xml_amf_data_dump(const amf_data * data, int qualified, int indent_level, xml_writer * xw) {
     if (data != NULL) {
         amf_node * node;
         time_t time;
-        struct tm * t;
+        struct tm t;
         char datestr[128];
-        int markers;
         char * ns;
-        char ns_decl[50];
 
         /* namespace to use whether we're using qualified mode */
         ns = (qualified == 1) ? "amf:" : "";
 
-        /* if indent_level is zero, that means we're at the root of the xml document
-           therefore we need to insert the namespace definition */
-        if (indent_level == 0) {
-            sprintf(ns_decl, " xmlns%s=\"http://schemas.flvmeta.org/AMF0/1.0/\"", ns);
-        }
-        else {
-            strcpy(ns_decl, "");
-        }
-
         /* print indentation spaces */
-        printf("%*s", indent_level * 2, "");
+        xml_write_indent(xw, indent_level * 2);
 
         switch (data->type) {
             case AMF_TYPE_NUMBER:
-                printf("<%snumber%s value=\"%.12g\"/>\n", ns, ns_decl, data->number_data);
+                xml_write_amf_element(xw, ns, "number", indent_level);
+                xml_write_z(xw, " value=\"");
+                xml_write_number(xw, data->number_data);
+                xml_write_z(xw, "\"/>\n");
                 break;
             case AMF_TYPE_BOOLEAN:
-                printf("<%sboolean%s value=\"%s\"/>\n", ns, ns_decl, (data->boolean_data) ? "true" : "false");
+                xml_write_amf_element(xw, ns, "boolean", indent_level);
+                xml_write_z(xw, (data->boolean_data) ? " value=\"true\"/>\n" : " value=\"false\"/>\n");
                 break;
             case AMF_TYPE_STRING:
+                xml_write_amf_element(xw, ns, "string", indent_level);
                 if (amf_string_get_size(data) > 0) {
-                    printf("<%sstring%s>", ns, ns_decl);
-                    /* check whether the string contains xml characters, if so, CDATA it */
-                    markers = has_xml_markers((char*)amf_string_get_bytes(data), amf_string_get_size(data));
-                    if (markers) {
-                        printf("<![CDATA[");
-                    }
-                    /* do not print more than the actual length of string */
-                    printf("%.*s", (int)amf_string_get_size(data), amf_string_get_bytes(data));
-                    if (markers) {
-                        printf("]]>");
-                    }
-                    printf("</%sstring>\n", ns);
+                    xml_write_z(xw, ">");
+                    /* strings containing xml characters are written as CDATA */
+                    xml_write_text(xw, (char*)amf_string_get_bytes(data), amf_string_get_size(data));
+                    xml_write_amf_end_element(xw, ns, "string", 0);
                 }
                 else {
                     /* simplify empty xml element into a more compact form */
-                    printf("<%sstring%s/>\n", ns, ns_decl);
+                    xml_write_z(xw, "/>\n");
                 }
                 break;
             case AMF_TYPE_OBJECT:
+                xml_write_amf_element(xw, ns, "object", indent_level);
                 if (amf_object_size(data) > 0) {
-                    printf("<%sobject%s>\n", ns, ns_decl);
+                    xml_write_z(xw, ">\n");
                     node = amf_object_first(data);
                     while (node != NULL) {
-                        printf("%*s<%sentry name=\"%s\">\n", (indent_level + 1) * 2, "", ns, amf_string_get_bytes(amf_object_get_name(node)));
-                        xml_amf_data_dump(amf_object_get_data(node), qualified, indent_level + 2);
+                        xml_write_amf_entry(xw, ns, amf_object_get_name(node), indent_level + 1);
+                        xml_amf_data_dump(amf_object_get_data(node), qualified, indent_level + 2, xw);
                         node = amf_object_next(node);
-                        printf("%*s</%sentry>\n", (indent_level + 1) * 2, "", ns);
+                        xml_write_amf_end_element(xw, ns, "entry", indent_level + 1);
                     }
-                    printf("%*s</%sobject>\n", indent_level * 2, "", ns);
+                    xml_write_amf_end_element(xw, ns, "object", indent_level);
                 }
                 else {
                     /* simplify empty xml element into a more compact form */
-                    printf("<%sobject%s/>\n", ns, ns_decl);
+                    xml_write_z(xw, "/>\n");
                 }
                 break;
             case AMF_TYPE_NULL:
-                printf("<%snull%s/>\n", ns, ns_decl);
+                xml_write_amf_element(xw, ns, "null", indent_level);
+                xml_write_z(xw, "/>\n");
                 break;
             case AMF_TYPE_UNDEFINED:
-                printf("<%sundefined%s/>\n", ns, ns_decl);
+                xml_write_amf_element(xw, ns, "undefined", indent_level);
+                xml_write_z(xw, "/>\n");
                 break;
             case AMF_TYPE_ASSOCIATIVE_ARRAY:
+                xml_write_amf_element(xw, ns, "associativeArray", indent_level);
                 if (amf_associative_array_size(data) > 0) {
-                    printf("<%sassociativeArray%s>\n", ns, ns_decl);
+                    xml_write_z(xw, ">\n");
                     node = amf_associative_array_first(data);
                     while (node != NULL) {
-                        printf("%*s<%sentry name=\"%s\">\n", (indent_level + 1) * 2, "", ns, amf_string_get_bytes(amf_associative_array_get_name(node)));
-                        xml_amf_data_dump(amf_associative_array_get_data(node), qualified, indent_level + 2);
+                        xml_write_amf_entry(xw, ns, amf_associative_array_get_name(node), indent_level + 1);
+                        xml_amf_data_dump(amf_associative_array_get_data(node), qualified, indent_level + 2, xw);
                         node = amf_associative_array_next(node);
-                        printf("%*s</%sentry>\n", (indent_level + 1) * 2, "", ns);
+                        xml_write_amf_end_element(xw, ns, "entry", indent_level + 1);
                     }
-                    printf("%*s</%sassociativeArray>\n", indent_level * 2, "", ns);
+                    xml_write_amf_end_element(xw, ns, "associativeArray", indent_level);
                 }
                 else {
                     /* simplify empty xml element into a more compact form */
-                    printf("<%sassociativeArray%s/>\n", ns, ns_decl);
+                    xml_write_z(xw, "/>\n");
                 }
                 break;
             case AMF_TYPE_ARRAY:
+                xml_write_amf_element(xw, ns, "array", indent_level);
                 if (amf_array_size(data) > 0) {
-                    printf("<%sarray%s>\n", ns, ns_decl);
+                    xml_write_z(xw, ">\n");
                     node = amf_array_first(data);
                     while (node != NULL) {
-                        xml_amf_data_dump(amf_array_get(node), qualified, indent_level + 1);
+                        xml_amf_data_dump(amf_array_get(node), qualified, indent_level + 1, xw);
                         node = amf_array_next(node);
                     }
-                    printf("%*s</%sarray>\n", indent_level * 2, "", ns);
+                    xml_write_amf_end_element(xw, ns, "array", indent_level);
                 }
                 else {
                     /* simplify empty xml element into a more compact form */
-                    printf("<%sarray%s/>\n", ns, ns_decl);
+                    xml_write_z(xw, "/>\n");
                 }
                 break;
             case AMF_TYPE_DATE:
                 time = amf_date_to_time_t(data);
-                tzset();
-                t = localtime(&time);
-                strftime(datestr, sizeof(datestr), "%Y-%m-%dT%H:%M:%S", t);
-                printf("<%sdate%s value=\"%s\"/>\n", ns, ns_decl, datestr);
+                flvmeta_localtime(&time, &t);
+                strftime(datestr, sizeof(datestr), "%Y-%m-%dT%H:%M:%S", &t);
+                xml_write_amf_element(xw, ns, "date", indent_level);
+                xml_write_z(xw, " value=\"");
+                xml_write_z(xw, datestr);
+                xml_write_z(xw, "\"/>\n");
                 break;
             case AMF_TYPE_XML: break;
             case AMF_TYPE_CLASS: break;
@@ -161,41 +175,57 @@ static void xml_amf_data_dump(const amf_data * data, int qualified, int indent_l
 /* XML FLV file full dump callbacks */
 
 static int xml_on_header(flv_header * header, flv_parser * parser) {
-    puts("<?xml version=\"1.0\" encoding=\"utf-8\" standalone=\"yes\"?>");
-    printf("<flv xmlns=\"http://schemas.flvmeta.org/FLV/1.0/\" xmlns:amf=\"http://schemas.flvmeta.org/AMF0/1.0/\" hasVideo=\"%s\" hasAudio=\"%s\" version=\"%" PRI_BYTE "u\">\n",
-        flv_header_has_video(*header) ? "true" : "false",
-        flv_header_has_audio(*header) ? "true" : "false",
-        header->version);
+    xml_writer * xw = (xml_writer*)parser->user_data;
+
+    xml_write_z(xw, "<?xml version=\"1.0\" encoding=\"utf-8\" standalone=\"yes\"?>\n");
+    xml_write_z(xw, "<flv xmlns=\"http://schemas.flvmeta.org/FLV/1.0/\" xmlns:amf=\"http://schemas.flvmeta.org/AMF0/1.0/\"");
+    xml_write_z(xw, flv_header_has_video(*header) ? " hasVideo=\"true\"" : " hasVideo=\"false\"");
+    xml_write_z(xw, flv_header_has_audio(*header) ? " hasAudio=\"true\"" : " hasAudio=\"false\"");
+    xml_write_z(xw, " version=\"");
+    xml_write_unsigned(xw, header->version);
+    xml_write_z(xw, "\">\n");
     return OK;
 }
 
 static int xml_on_tag(flv_tag * tag, flv_parser * parser) {
-    printf("  <tag type=\"%s\" timestamp=\"%i\" dataSize=\"%i\"",
-        dump_string_get_tag_type(tag),
-        flv_tag_get_timestamp(*tag),
-        flv_tag_get_body_length(*tag));
-    printf(" offset=\"%" FILE_OFFSET_PRINTF_FORMAT "u\">\n",
-        parser->stream->current_tag_offset);
+    xml_writer * xw = (xml_writer*)parser->user_data;
+
+    xml_write_z(xw, "  <tag type=\"");
+    xml_write_z(xw, dump_string_get_tag_type(tag));
+    xml_write_z(xw, "\" timestamp=\"");
+    xml_write_unsigned(xw, flv_tag_get_timestamp(*tag));
+    xml_write_z(xw, "\" dataSize=\"");
+    xml_write_unsigned(xw, flv_tag_get_body_length(*tag));
+    xml_write_z(xw, "\" offset=\"");
+    xml_write_unsigned(xw, (uint64)parser->stream->current_tag_offset);
+    xml_write_z(xw, "\">\n");
 
     return OK;
 }
 
 static int xml_on_video_tag(flv_tag * tag, flv_video_tag vt, flv_parser * parser) {
-    printf("    <videoData codecID=\"%s\"", dump_string_get_video_codec(vt));
-    printf(" frameType=\"%s\"", dump_string_get_video_frame_type(vt));
+    xml_writer * xw = (xml_writer*)parser->user_data;
+
+    xml_write_z(xw, "    <videoData codecID=\"");
+    xml_write_z(xw, dump_string_get_video_codec(vt));
+    xml_write_z(xw, "\" frameType=\"");
+    xml_write_z(xw, dump_string_get_video_frame_type(vt));
+    xml_write_z(xw, "\"");
 
     /* if AVC, detect frame type and composition time */
     if (flv_video_tag_codec_id(vt) == FLV_VIDEO_TAG_CODEC_AVC) {
         flv_avc_packet_type type;
 
-        printf(">\n");
+        xml_write_z(xw, ">\n");
 
         /* packet type */
         if (flv_read_tag_body(parser->stream, &type, sizeof(flv_avc_packet_type)) < sizeof(flv_avc_packet_type)) {
             return ERROR_INVALID_TAG;
         }
 
-        printf("        <AVCData packetType=\"%s\"", dump_string_get_avc_packet_type(type));
+        xml_write_z(xw, "        <AVCData packetType=\"");
+        xml_write_z(xw, dump_string_get_avc_packet_type(type));
+        xml_write_z(xw, "\"");
 
         /* composition time */
         if (type == FLV_AVC_PACKET_TYPE_NALU) {
@@ -205,77 +235,97 @@ static int xml_on_video_tag(flv_tag * tag, flv_video_tag vt, flv_parser * parser
                 return ERROR_INVALID_TAG;
             }
 
-            printf(" compositionTimeOffset=\"%i\"", uint24_be_to_uint32(composition_time));
+            xml_write_z(xw, " compositionTimeOffset=\"");
+            xml_write_unsigned(xw, uint24_be_to_uint32(composition_time));
+            xml_write_z(xw, "\"");
         }
 
-        printf("/>\n");
-        printf("    </videoData>\n");
+        xml_write_z(xw, "/>\n");
+        xml_write_z(xw, "    </videoData>\n");
     }
     else {
-        printf("/>\n");
+        xml_write_z(xw, "/>\n");
     }
 
     return OK;
 }
 
 static int xml_on_audio_tag(flv_tag * tag, flv_audio_tag at, flv_parser * parser) {
-    printf("    <audioData type=\"%s\"", dump_string_get_sound_type(at));
-    printf(" size=\"%s\"", dump_string_get_sound_size(at));
-    printf(" rate=\"%s\"", dump_string_get_sound_rate(at));
-    printf(" format=\"%s\"", dump_string_get_sound_format(at));
+    xml_writer * xw = (xml_writer*)parser->user_data;
+
+    xml_write_z(xw, "    <audioData type=\"");
+    xml_write_z(xw, dump_string_get_sound_type(at));
+    xml_write_z(xw, "\" size=\"");
+    xml_write_z(xw, dump_string_get_sound_size(at));
+    xml_write_z(xw, "\" rate=\"");
+    xml_write_z(xw, dump_string_get_sound_rate(at));
+    xml_write_z(xw, "\" format=\"");
+    xml_write_z(xw, dump_string_get_sound_format(at));
+    xml_write_z(xw, "\"");
 
     /* if AAC, detect packet type */
     if (flv_audio_tag_sound_format(at) == FLV_AUDIO_TAG_SOUND_FORMAT_AAC) {
         flv_aac_packet_type type;
 
-        printf(">\n");
+        xml_write_z(xw, ">\n");
 
         /* packet type */
         if (flv_read_tag_body(parser->stream, &type, sizeof(flv_aac_packet_type)) < sizeof(flv_aac_packet_type)) {
             return ERROR_INVALID_TAG;
         }
 
-        printf("        <AACData packetType=\"%s\"/>\n", dump_string_get_aac_packet_type(type));
-        printf("    </audioData>\n");
+        xml_write_z(xw, "        <AACData packetType=\"");
+        xml_write_z(xw, dump_string_get_aac_packet_type(type));
+        xml_write_z(xw, "\"/>\n");
+        xml_write_z(xw, "    </audioData>\n");
     }
     else {
-        printf("/>\n");
+        xml_write_z(xw, "/>\n");
     }
 
     return OK;
 }
 
 static int xml_on_metadata_tag(flv_tag * tag, amf_data * name, amf_data * data, flv_parser * parser) {
-    printf("    <scriptDataObject name=\"%s\">\n", amf_string_get_bytes(name));
+    xml_writer * xw = (xml_writer*)parser->user_data;
+
+    xml_write_z(xw, "    <scriptDataObject name=\"");
+    xml_write_escaped(xw, (char*)amf_string_get_bytes(name), amf_string_get_size(name));
+    xml_write_z(xw, "\">\n");
     /* dump AMF data as XML, we start from level 3, meaning 6 indentations characters */
-    xml_amf_data_dump(data, 1, 3);
-    puts("    </scriptDataObject>");
+    xml_amf_data_dump(data, 1, 3, xw);
+    xml_write_z(xw, "    </scriptDataObject>\n");
     return OK;
 }
 
 static int xml_on_prev_tag_size(uint32 size, flv_parser * parser) {
-    puts("  </tag>");
+    xml_writer * xw = (xml_writer*)parser->user_data;
+
+    xml_write_z(xw, "  </tag>\n");
     return OK;
 }
 
 static int xml_on_stream_end(flv_parser * parser) {
-    puts("</flv>");
+    xml_writer * xw = (xml_writer*)parser->user_data;
+
+    xml_write_z(xw, "</flv>\n");
     return OK;
 }
 
 /* XML FLV file metadata dump callbacks */
 static int xml_on_metadata_tag_only(flv_tag * tag, amf_data * name, amf_data * data, flv_parser * parser) {
-    flvmeta_opts * options = (flvmeta_opts*) parser->user_data;
+    dump_context * ctxt = (dump_context*) parser->user_data;
+    const flvmeta_opts * options = ctxt->options;
 
     if (options->metadata_event == NULL) {
         if (!strcmp((char*)amf_string_get_bytes(name), "onMetaData")) {
-            dump_xml_amf_data(data);
+            dump_xml_amf_data(data, ctxt->out);
             return FLVMETA_DUMP_STOP_OK;
         }
     }
     else {
         if (!strcmp((char*)amf_string_get_bytes(name), options->metadata_event)) {
-            dump_xml_amf_data(data);
+            dump_xml_amf_data(data, ctxt->out);
         }
     }
     return OK;
@@ -288,7 +338,10 @@ void dump_xml_setup_metadata_dump(flv_parser * parser) {
     }
 }
 
-int dump_xml_file(flv_parser * parser, const flvmeta_opts * options) {
+int dump_xml_file(flv_parser * parser, const flvmeta_opts * options, output_sink * out) {
+    xml_writer xw;
+    xml_writer_init(&xw, out);
+
     parser->on_header = xml_on_header;
     parser->on_tag = xml_on_tag;
     parser->on_audio_tag = xml_on_audio_tag;
@@ -296,12 +349,17 @@ int dump_xml_file(flv_parser * parser, const flvmeta_opts * options) {
     parser->on_metadata_tag = xml_on_metadata_tag;
     parser->on_prev_tag_size = xml_on_prev_tag_size;
     parser->on_stream_end = xml_on_stream_end;
+    parser->user_data = &xw;
 
-    return flv_parse(options->input_file, parser);
+    return input_parse(options, options->input_file, parser);
 }
 
-int dump_xml_amf_data(const amf_data * data) {
-    puts("<?xml version=\"1.0\" encoding=\"utf-8\" standalone=\"yes\"?>");
-    xml_amf_data_dump(data, 0, 0);
+int dump_xml_amf_data(const amf_data * data, output_sink * out) {
+    xml_writer xw;
+    xml_writer_init(&xw, out);
+
+    xml_write_z(&xw, "<?xml version=\"1.0\" encoding=\"utf-8\" standalone=\"yes\"?>\n");
+    xml_amf_data_dump(data, 0, 0, &xw);
+
     return OK;
 }
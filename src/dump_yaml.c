@@ -21,230 +21,130 @@
 */
 #include "dump.h"
 #include "dump_yaml.h"
-#include "yaml.h"
+#include "input.h"
+#include "yaml_out.h"
+#include "util.h"
 
 #include <stdio.h>
 #include <string.h>
 
 /* YAML metadata dumping */
-static void amf_data_yaml_dump(const amf_data * data, yaml_emitter_t * emitter) {
-    if (data != NULL) {
-        amf_node * node;
-        yaml_event_t event;
-        time_t time;
-        struct tm * t;
-        char str[128];
-
-        switch (data->type) {
-            case AMF_TYPE_NUMBER:
-                sprintf(str, "%.12g", data->number_data);
-                yaml_scalar_event_initialize(&event, NULL, NULL, (yaml_char_t*)str, (int)strlen(str), 1, 1, YAML_ANY_SCALAR_STYLE);
-                yaml_emitter_emit(emitter, &event);
-                break;
-            case AMF_TYPE_BOOLEAN:
-                sprintf(str, (data->boolean_data) ? "true" : "false");
-                yaml_scalar_event_initialize(&event, NULL, NULL, (yaml_char_t*)str, (int)strlen(str), 1, 1, YAML_ANY_SCALAR_STYLE);
-                yaml_emitter_emit(emitter, &event);
-                break;
-            case AMF_TYPE_STRING:
-                yaml_scalar_event_initialize(&event, NULL, NULL, amf_string_get_bytes(data), (int)amf_string_get_size(data), 1, 1, YAML_ANY_SCALAR_STYLE);
-                yaml_emitter_emit(emitter, &event);
-                break;
-            case AMF_TYPE_OBJECT:
-                yaml_mapping_start_event_initialize(&event, NULL, NULL, 1, YAML_ANY_MAPPING_STYLE);
-                yaml_emitter_emit(emitter, &event);
-                node = amf_object_first(data);
-                while (node != NULL) {
-                    amf_data * name;
-                    name = amf_object_get_name(node);
-                    /* if this fails, we skip the current entry */
-                    if (yaml_scalar_event_initialize(&event, NULL, NULL, amf_string_get_bytes(name), amf_string_get_size(name), 1, 1, YAML_ANY_SCALAR_STYLE)) {
-                        yaml_emitter_emit(emitter, &event);
-                        amf_data_yaml_dump(amf_object_get_data(node), emitter);
-                    }
-                    node = amf_object_next(node);
-                }
-                yaml_mapping_end_event_initialize(&event);
-                yaml_emitter_emit(emitter, &event);
-                break;
-            case AMF_TYPE_NULL:
-            case AMF_TYPE_UNDEFINED:
-                yaml_scalar_event_initialize(&event, NULL, NULL, (yaml_char_t*)"null", 4, 1, 1, YAML_ANY_SCALAR_STYLE);
-                yaml_emitter_emit(emitter, &event);
-                break;
-            case AMF_TYPE_ASSOCIATIVE_ARRAY:
-                yaml_mapping_start_event_initialize(&event, NULL, NULL, 1, YAML_ANY_MAPPING_STYLE);
-                yaml_emitter_emit(emitter, &event);
-                node = amf_associative_array_first(data);
-                while (node != NULL) {
-                    amf_data * name;
-                    name = amf_associative_array_get_name(node);
-                    /* if this fails, we skip the current entry */
-                    if (yaml_scalar_event_initialize(&event, NULL, NULL, amf_string_get_bytes(name), amf_string_get_size(name), 1, 1, YAML_ANY_SCALAR_STYLE)) {
-                        yaml_emitter_emit(emitter, &event);
-                        amf_data_yaml_dump(amf_associative_array_get_data(node), emitter);
-                    }
-                    node = amf_associative_array_next(node);
-                }
-                yaml_mapping_end_event_initialize(&event);
-                yaml_emitter_emit(emitter, &event);
-                break;
-            case AMF_TYPE_ARRAY:
-                yaml_sequence_start_event_initialize(&event, NULL, NULL, 1, YAML_ANY_SEQUENCE_STYLE);
-                yaml_emitter_emit(emitter, &event);
-                node = amf_array_first(data);
-                while (node != NULL) {
-                    amf_data_yaml_dump(amf_array_get(node), emitter);
-                    node = amf_array_next(node);
-                }
-                yaml_sequence_end_event_initialize(&event);
-                yaml_emitter_emit(emitter, &event);
-                break;
-            case AMF_TYPE_DATE:
-                time = amf_date_to_time_t(data);
-                tzset();
-                t = localtime(&time);
-                strftime(str, sizeof(str), "%Y-%m-%dT%H:%M:%S", t);
-                yaml_scalar_event_initialize(&event, NULL, NULL, (yaml_char_t*)str, (int)strlen(str), 1, 1, YAML_ANY_SCALAR_STYLE);
-                yaml_emitter_emit(emitter, &event);
-                break;
-            case AMF_TYPE_XML: break;
-            case AMF_TYPE_CLASS: break;
-            default: break;
-        }
+static void amf_data_yaml_dump(const amf_data * data, yaml_out * yo) {
+    amf_node * node;
+    time_t time;
+    struct tm t;
+    char str[128];
+
+    if (data == NULL) {
+        yaml_out_scalar_z(yo, "null");
+        return;
+    }
+
+    switch (data->type) {
+        case AMF_TYPE_NUMBER:
+            yaml_out_number(yo, data->number_data);
+            break;
+        case AMF_TYPE_BOOLEAN:
+            yaml_out_boolean(yo, data->boolean_data);
+            break;
+        case AMF_TYPE_STRING:
+            yaml_out_scalar(yo, (char*)amf_string_get_bytes(data), amf_string_get_size(data));
+            break;
+        case AMF_TYPE_OBJECT:
+            yaml_out_mapping_start(yo);
+            node = amf_object_first(data);
+            while (node != NULL) {
+                amf_data * name;
+                name = amf_object_get_name(node);
+                yaml_out_scalar(yo, (char*)amf_string_get_bytes(name), amf_string_get_size(name));
+                amf_data_yaml_dump(amf_object_get_data(node), yo);
+                node = amf_object_next(node);
+            }
+            yaml_out_mapping_end(yo);
+            break;
+        case AMF_TYPE_ASSOCIATIVE_ARRAY:
+            yaml_out_mapping_start(yo);
+            node = amf_associative_array_first(data);
+            while (node != NULL) {
+                amf_data * name;
+                name = amf_associative_array_get_name(node);
+                yaml_out_scalar(yo, (char*)amf_string_get_bytes(name), amf_string_get_size(name));
+                amf_data_yaml_dump(amf_associative_array_get_data(node), yo);
+                node = amf_associative_array_next(node);
+            }
+            yaml_out_mapping_end(yo);
+            break;
+        case AMF_TYPE_ARRAY:
+            yaml_out_sequence_start(yo);
+            node = amf_array_first(data);
+            while (node != NULL) {
+                amf_data_yaml_dump(amf_array_get(node), yo);
+                node = amf_array_next(node);
+            }
+            yaml_out_sequence_end(yo);
+            break;
+        case AMF_TYPE_DATE:
+            time = amf_date_to_time_t(data);
+            flvmeta_localtime(&time, &t);
+            strftime(str, sizeof(str), "%Y-%m-%dT%H:%M:%S", &t);
+            yaml_out_scalar_z(yo, str);
+            break;
+        case AMF_TYPE_NULL:
+        case AMF_TYPE_UNDEFINED:
+        default:
+            /* values without YAML equivalent keep the document well-formed */
+            yaml_out_scalar_z(yo, "null");
+            break;
     }
 }
 
 /* YAML FLV file full dump callbacks */
 
 static int yaml_on_header(flv_header * header, flv_parser * parser) {
-    yaml_emitter_t * emitter;
-    yaml_event_t event;
-    char buffer[20];
-
-    emitter = (yaml_emitter_t *)parser->user_data;
-
-    yaml_mapping_start_event_initialize(&event, NULL, NULL, 1, YAML_ANY_MAPPING_STYLE);
-    yaml_emitter_emit(emitter, &event);
-
-    /* magic */
-    yaml_scalar_event_initialize(&event, NULL, NULL, (yaml_char_t*)"magic", 5, 1, 1, YAML_ANY_SCALAR_STYLE);
-    yaml_emitter_emit(emitter, &event);
-
-    sprintf(buffer, "%.3s", header->signature);
-    yaml_scalar_event_initialize(&event, NULL, NULL, (yaml_char_t*)buffer, (int)strlen(buffer), 1, 1, YAML_ANY_SCALAR_STYLE);
-    yaml_emitter_emit(emitter, &event);
-
-    /* hasVideo */
-    yaml_scalar_event_initialize(&event, NULL, NULL, (yaml_char_t*)"hasVideo", 8, 1, 1, YAML_ANY_SCALAR_STYLE);
-    yaml_emitter_emit(emitter, &event);
-
-    sprintf(buffer, "%s", flv_header_has_video(*header) ? "true" : "false");
-    yaml_scalar_event_initialize(&event, NULL, NULL, (yaml_char_t*)buffer, (int)strlen(buffer), 1, 1, YAML_ANY_SCALAR_STYLE);
-    yaml_emitter_emit(emitter, &event);
-
-    /* hasAudio */
-    yaml_scalar_event_initialize(&event, NULL, NULL, (yaml_char_t*)"hasAudio", 8, 1, 1, YAML_ANY_SCALAR_STYLE);
-    yaml_emitter_emit(emitter, &event);
-
-    sprintf(buffer, "%s", flv_header_has_audio(*header) ? "true" : "false");
-    yaml_scalar_event_initialize(&event, NULL, NULL, (yaml_char_t*)buffer, (int)strlen(buffer), 1, 1, YAML_ANY_SCALAR_STYLE);
-    yaml_emitter_emit(emitter, &event);
-
-    /* version */
-    yaml_scalar_event_initialize(&event, NULL, NULL, (yaml_char_t*)"version", 7, 1, 1, YAML_ANY_SCALAR_STYLE);
-    yaml_emitter_emit(emitter, &event);
-
-    sprintf(buffer, "%i", header->version);
-    yaml_scalar_event_initialize(&event, NULL, NULL, (yaml_char_t*)buffer, (int)strlen(buffer), 1, 1, YAML_ANY_SCALAR_STYLE);
-    yaml_emitter_emit(emitter, &event);
+    yaml_out * yo = (yaml_out *)parser->user_data;
+
+    yaml_out_mapping_start(yo);
+    yaml_out_scalar_z(yo, "magic");
+    yaml_out_scalar(yo, (char*)header->signature, 3);
+    yaml_out_scalar_z(yo, "hasVideo");
+    yaml_out_boolean(yo, flv_header_has_video(*header));
+    yaml_out_scalar_z(yo, "hasAudio");
+    yaml_out_boolean(yo, flv_header_has_audio(*header));
+    yaml_out_scalar_z(yo, "version");
+    yaml_out_unsigned(yo, header->version);
 
     /* start of tags array */
-    yaml_scalar_event_initialize(&event, NULL, NULL, (yaml_char_t*)"tags", 4, 1, 1, YAML_ANY_SCALAR_STYLE);
-    yaml_emitter_emit(emitter, &event);
-
-    yaml_sequence_start_event_initialize(&event, NULL, NULL, 1, YAML_ANY_SEQUENCE_STYLE);
-    yaml_emitter_emit(emitter, &event);
+    yaml_out_scalar_z(yo, "tags");
+    yaml_out_sequence_start(yo);
 
     return OK;
 }
 
 static int yaml_on_tag(flv_tag * tag, flv_parser * parser) {
-    const char * str;
-    yaml_emitter_t * emitter;
-    yaml_event_t event;
-    char buffer[20];
-
-    emitter = (yaml_emitter_t *)parser->user_data;
-
-    str = dump_string_get_tag_type(tag);
-
-    yaml_mapping_start_event_initialize(&event, NULL, NULL, 1, YAML_ANY_MAPPING_STYLE);
-    yaml_emitter_emit(emitter, &event);
-
-    /* type */
-    yaml_scalar_event_initialize(&event, NULL, NULL, (yaml_char_t*)"type", 4, 1, 1, YAML_ANY_SCALAR_STYLE);
-    yaml_emitter_emit(emitter, &event);
-
-    yaml_scalar_event_initialize(&event, NULL, NULL, (yaml_char_t*)str, (int)strlen(str), 1, 1, YAML_ANY_SCALAR_STYLE);
-    yaml_emitter_emit(emitter, &event);
-
-    /* timestamp */
-    yaml_scalar_event_initialize(&event, NULL, NULL, (yaml_char_t*)"timestamp", 9, 1, 1, YAML_ANY_SCALAR_STYLE);
-    yaml_emitter_emit(emitter, &event);
-
-    sprintf(buffer, "%i", flv_tag_get_timestamp(*tag));
-    yaml_scalar_event_initialize(&event, NULL, NULL, (yaml_char_t*)buffer, (int)strlen(buffer), 1, 1, YAML_ANY_SCALAR_STYLE);
-    yaml_emitter_emit(emitter, &event);
-
-    /* data size */
-    yaml_scalar_event_initialize(&event, NULL, NULL, (yaml_char_t*)"dataSize", 8, 1, 1, YAML_ANY_SCALAR_STYLE);
-    yaml_emitter_emit(emitter, &event);
-
-    sprintf(buffer, "%i", flv_tag_get_body_length(*tag));
-    yaml_scalar_event_initialize(&event, NULL, NULL, (yaml_char_t*)buffer, (int)strlen(buffer), 1, 1, YAML_ANY_SCALAR_STYLE);
-    yaml_emitter_emit(emitter, &event);
-
-    /* offset */
-    yaml_scalar_event_initialize(&event, NULL, NULL, (yaml_char_t*)"offset", 6, 1, 1, YAML_ANY_SCALAR_STYLE);
-    yaml_emitter_emit(emitter, &event);
-
-    sprintf(buffer, "%" FILE_OFFSET_PRINTF_FORMAT "u", parser->stream->current_tag_offset);
-    yaml_scalar_event_initialize(&event, NULL, NULL, (yaml_char_t*)buffer, (int)strlen(buffer), 1, 1, YAML_ANY_SCALAR_STYLE);
-    yaml_emitter_emit(emitter, &event);
+    yaml_out * yo = (yaml_out *)parser->user_data;
+
+    yaml_out_mapping_start(yo);
+    yaml_out_scalar_z(yo, "type");
+    yaml_out_scalar_z(yo, dump_string_get_tag_type(tag));
+    yaml_out_scalar_z(yo, "timestamp");
+    yaml_out_unsigned(yo, flv_tag_get_timestamp(*tag));
+    yaml_out_scalar_z(yo, "dataSize");
+    yaml_out_unsigned(yo, flv_tag_get_body_length(*tag));
+    yaml_out_scalar_z(yo, "offset");
+    yaml_out_file_offset(yo, parser->stream->current_tag_offset);
 
     return OK;
 }
 
 static int yaml_on_video_tag(flv_tag * tag, flv_video_tag vt, flv_parser * parser) {
-    const char * str;
-    yaml_emitter_t * emitter;
-    yaml_event_t event;
-    char buffer[20];
-
-    emitter = (yaml_emitter_t *)parser->user_data;
-
-    yaml_scalar_event_initialize(&event, NULL, NULL, (yaml_char_t*)"videoData", 9, 1, 1, YAML_ANY_SCALAR_STYLE);
-    yaml_emitter_emit(emitter, &event);
-
-    yaml_mapping_start_event_initialize(&event, NULL, NULL, 1, YAML_ANY_MAPPING_STYLE);
-    yaml_emitter_emit(emitter, &event);
-
-    str = dump_string_get_video_codec(vt);
-
-    yaml_scalar_event_initialize(&event, NULL, NULL, (yaml_char_t*)"codecID", 7, 1, 1, YAML_ANY_SCALAR_STYLE);
-    yaml_emitter_emit(emitter, &event);
-
-    yaml_scalar_event_initialize(&event, NULL, NULL, (yaml_char_t*)str, (int)strlen(str), 1, 1, YAML_ANY_SCALAR_STYLE);
-    yaml_emitter_emit(emitter, &event);
-
-    str = dump_string_get_video_frame_type(vt);
-
-    yaml_scalar_event_initialize(&event, NULL, NULL, (yaml_char_t*)"frameType", 9, 1, 1, YAML_ANY_SCALAR_STYLE);
-    yaml_emitter_emit(emitter, &event);
+    yaml_out * yo = (yaml_out *)parser->user_data;
 
-    yaml_scalar_event_initialize(&event, NULL, NULL, (yaml_char_t*)str, (int)strlen(str), 1, 1, YAML_ANY_SCALAR_STYLE);
-    yaml_emitter_emit(emitter, &event);
+    yaml_out_scalar_z(yo, "videoData");
+    yaml_out_mapping_start(yo);
+    yaml_out_scalar_z(yo, "codecID");
+    yaml_out_scalar_z(yo, dump_string_get_video_codec(vt));
+    yaml_out_scalar_z(yo, "frameType");
+    yaml_out_scalar_z(yo, dump_string_get_video_frame_type(vt));
 
     /* if AVC, detect frame type and composition time */
     if (flv_video_tag_codec_id(vt) == FLV_VIDEO_TAG_CODEC_AVC) {
@@ -255,19 +155,10 @@ static int yaml_on_video_tag(flv_tag * tag, flv_video_tag vt, flv_parser * parse
             return ERROR_INVALID_TAG;
         }
 
-        yaml_scalar_event_initialize(&event, NULL, NULL, (yaml_char_t*)"AVCData", 7, 1, 1, YAML_ANY_SCALAR_STYLE);
-        yaml_emitter_emit(emitter, &event);
-
-        yaml_mapping_start_event_initialize(&event, NULL, NULL, 1, YAML_ANY_MAPPING_STYLE);
-        yaml_emitter_emit(emitter, &event);
-
-        yaml_scalar_event_initialize(&event, NULL, NULL, (yaml_char_t*)"packetType", 10, 1, 1, YAML_ANY_SCALAR_STYLE);
-        yaml_emitter_emit(emitter, &event);
-
-        str = dump_string_get_avc_packet_type(type);
-
-        yaml_scalar_event_initialize(&event, NULL, NULL, (yaml_char_t*)str, (int)strlen(str), 1, 1, YAML_ANY_SCALAR_STYLE);
-        yaml_emitter_emit(emitter, &event);
+        yaml_out_scalar_z(yo, "AVCData");
+        yaml_out_mapping_start(yo);
+        yaml_out_scalar_z(yo, "packetType");
+        yaml_out_scalar_z(yo, dump_string_get_avc_packet_type(type));
 
         /* composition time */
         if (type == FLV_AVC_PACKET_TYPE_NALU) {
@@ -277,68 +168,31 @@ static int yaml_on_video_tag(flv_tag * tag, flv_video_tag vt, flv_parser * parse
                 return ERROR_INVALID_TAG;
             }
 
-            yaml_scalar_event_initialize(&event, NULL, NULL, (yaml_char_t*)"compositionTimeOffset", 21, 1, 1, YAML_ANY_SCALAR_STYLE);
-            yaml_emitter_emit(emitter, &event);
-
-            sprintf(buffer, "%i", uint24_be_to_uint32(composition_time));
-            yaml_scalar_event_initialize(&event, NULL, NULL, (yaml_char_t*)buffer, (int)strlen(buffer), 1, 1, YAML_ANY_SCALAR_STYLE);
-            yaml_emitter_emit(emitter, &event);
+            yaml_out_scalar_z(yo, "compositionTimeOffset");
+            yaml_out_unsigned(yo, uint24_be_to_uint32(composition_time));
         }
 
-        yaml_mapping_end_event_initialize(&event);
-        yaml_emitter_emit(emitter, &event);
+        yaml_out_mapping_end(yo);
     }
 
-    yaml_mapping_end_event_initialize(&event);
-    yaml_emitter_emit(emitter, &event);
+    yaml_out_mapping_end(yo);
 
     return OK;
 }
 
 static int yaml_on_audio_tag(flv_tag * tag, flv_audio_tag at, flv_parser * parser) {
-    const char * str;
-    yaml_emitter_t * emitter;
-    yaml_event_t event;
-
-    emitter = (yaml_emitter_t *)parser->user_data;
-
-    yaml_scalar_event_initialize(&event, NULL, NULL, (yaml_char_t*)"audioData", 9, 1, 1, YAML_ANY_SCALAR_STYLE);
-    yaml_emitter_emit(emitter, &event);
-
-    yaml_mapping_start_event_initialize(&event, NULL, NULL, 1, YAML_ANY_MAPPING_STYLE);
-    yaml_emitter_emit(emitter, &event);
-
-    str = dump_string_get_sound_type(at);
-
-    yaml_scalar_event_initialize(&event, NULL, NULL, (yaml_char_t*)"type", 4, 1, 1, YAML_ANY_SCALAR_STYLE);
-    yaml_emitter_emit(emitter, &event);
-
-    yaml_scalar_event_initialize(&event, NULL, NULL, (yaml_char_t*)str, (int)strlen(str), 1, 1, YAML_ANY_SCALAR_STYLE);
-    yaml_emitter_emit(emitter, &event);
-
-    str = dump_string_get_sound_size(at);
-
-    yaml_scalar_event_initialize(&event, NULL, NULL, (yaml_char_t*)"size", 4, 1, 1, YAML_ANY_SCALAR_STYLE);
-    yaml_emitter_emit(emitter, &event);
-
-    yaml_scalar_event_initialize(&event, NULL, NULL, (yaml_char_t*)str, (int)strlen(str), 1, 1, YAML_ANY_SCALAR_STYLE);
-    yaml_emitter_emit(emitter, &event);
-
-    str = dump_string_get_sound_rate(at);
-
-    yaml_scalar_event_initialize(&event, NULL, NULL, (yaml_char_t*)"rate", 4, 1, 1, YAML_ANY_SCALAR_STYLE);
-    yaml_emitter_emit(emitter, &event);
-
-    yaml_scalar_event_initialize(&event, NULL, NULL, (yaml_char_t*)str, (int)strlen(str), 1, 1, YAML_ANY_SCALAR_STYLE);
-    yaml_emitter_emit(emitter, &event);
-
-    str = dump_string_get_sound_format(at);
-
-    yaml_scalar_event_initialize(&event, NULL, NULL, (yaml_char_t*)"format", 6, 1, 1, YAML_ANY_SCALAR_STYLE);
-    yaml_emitter_emit(emitter, &event);
-
-    yaml_scalar_event_initialize(&event, NULL, NULL, (yaml_char_t*)str, (int)strlen(str), 1, 1, YAML_ANY_SCALAR_STYLE);
-    yaml_emitter_emit(emitter, &event);
+    yaml_out * yo = (yaml_out *)parser->user_data;
+
+    yaml_out_scalar_z(yo, "audioData");
+    yaml_out_mapping_start(yo);
+    yaml_out_scalar_z(yo, "type");
+    yaml_out_scalar_z(yo, dump_string_get_sound_type(at));
+    yaml_out_scalar_z(yo, "size");
+    yaml_out_scalar_z(yo, dump_string_get_sound_size(at));
+    yaml_out_scalar_z(yo, "rate");
+    yaml_out_scalar_z(yo, dump_string_get_sound_rate(at));
+    yaml_out_scalar_z(yo, "format");
+    yaml_out_scalar_z(yo, dump_string_get_sound_format(at));
 
     /* if AAC, detect packet type */
     if (flv_audio_tag_sound_format(at) == FLV_AUDIO_TAG_SOUND_FORMAT_AAC) {
@@ -349,84 +203,58 @@ static int yaml_on_audio_tag(flv_tag * tag, flv_audio_tag at, flv_parser * parse
             return ERROR_INVALID_TAG;
         }
 
-        yaml_scalar_event_initialize(&event, NULL, NULL, (yaml_char_t*)"AACData", 7, 1, 1, YAML_ANY_SCALAR_STYLE);
-        yaml_emitter_emit(emitter, &event);
-
-        yaml_mapping_start_event_initialize(&event, NULL, NULL, 1, YAML_ANY_MAPPING_STYLE);
-        yaml_emitter_emit(emitter, &event);
-
-        yaml_scalar_event_initialize(&event, NULL, NULL, (yaml_char_t*)"packetType", 10, 1, 1, YAML_ANY_SCALAR_STYLE);
-        yaml_emitter_emit(emitter, &event);
-
-        str = dump_string_get_aac_packet_type(type);
-
-        yaml_scalar_event_initialize(&event, NULL, NULL, (yaml_char_t*)str, (int)strlen(str), 1, 1, YAML_ANY_SCALAR_STYLE);
-        yaml_emitter_emit(emitter, &event);
-
-        yaml_mapping_end_event_initialize(&event);
-        yaml_emitter_emit(emitter, &event);
+        yaml_out_scalar_z(yo, "AACData");
+        yaml_out_mapping_start(yo);
+        yaml_out_scalar_z(yo, "packetType");
+        yaml_out_scalar_z(yo, dump_string_get_aac_packet_type(type));
+        yaml_out_mapping_end(yo);
     }
 
-    yaml_mapping_end_event_initialize(&event);
-    yaml_emitter_emit(emitter, &event);
+    yaml_out_mapping_end(yo);
 
     return OK;
 }
 
 static int yaml_on_metadata_tag(flv_tag * tag, amf_data * name, amf_data * data, flv_parser * parser) {
-    yaml_emitter_t * emitter;
-    yaml_event_t event;
-
-    emitter = (yaml_emitter_t *)parser->user_data;
-
-    yaml_scalar_event_initialize(&event, NULL, NULL, (yaml_char_t*)"scriptDataObject", 16, 1, 1, YAML_ANY_SCALAR_STYLE);
-    yaml_emitter_emit(emitter, &event);
+    yaml_out * yo = (yaml_out *)parser->user_data;
 
-    amf_data_yaml_dump(data, emitter);
+    yaml_out_scalar_z(yo, "scriptDataObject");
+    amf_data_yaml_dump(data, yo);
 
     return OK;
 }
 
 static int yaml_on_prev_tag_size(uint32 size, flv_parser * parser) {
-    yaml_emitter_t * emitter;
-    yaml_event_t event;
+    yaml_out * yo = (yaml_out *)parser->user_data;
 
-    emitter = (yaml_emitter_t *)parser->user_data;
-
-    yaml_mapping_end_event_initialize(&event);
-    yaml_emitter_emit(emitter, &event);
+    yaml_out_mapping_end(yo);
 
     return OK;
 }
 
 static int yaml_on_stream_end(flv_parser * parser) {
-    yaml_emitter_t * emitter;
-    yaml_event_t event;
-
-    emitter = (yaml_emitter_t *)parser->user_data;
-
-    yaml_sequence_end_event_initialize(&event);
-    yaml_emitter_emit(emitter, &event);
+    yaml_out * yo = (yaml_out *)parser->user_data;
 
-    yaml_mapping_end_event_initialize(&event);
-    yaml_emitter_emit(emitter, &event);
+    yaml_out_sequence_end(yo);
+    yaml_out_mapping_end(yo);
 
     return OK;
 }
 
 /* YAML FLV file metadata dump callbacks */
 static int yaml_on_metadata_tag_only(flv_tag * tag, amf_data * name, amf_data * data, flv_parser * parser) {
-    flvmeta_opts * options = (flvmeta_opts*) parser->user_data;
+    dump_context * ctxt = (dump_context*) parser->user_data;
+    const flvmeta_opts * options = ctxt->options;
 
     if (options->metadata_event == NULL) {
         if (!strcmp((char*)amf_string_get_bytes(name), "onMetaData")) {
-            dump_yaml_amf_data(data);
+            dump_yaml_amf_data(data, ctxt->out);
             return FLVMETA_DUMP_STOP_OK;
         }
     }
     else {
         if (!strcmp((char*)amf_string_get_bytes(name), options->metadata_event)) {
-            dump_yaml_amf_data(data);
+            dump_yaml_amf_data(data, ctxt->out);
         }
     }
     return OK;
@@ -439,11 +267,14 @@ void dump_yaml_setup_metadata_dump(flv_parser * parser) {
     }
 }
 
-int dump_yaml_file(flv_parser * parser, const flvmeta_opts * options) {
-    yaml_emitter_t emitter;
-    yaml_event_t event;
+int dump_yaml_file(flv_parser * parser, const flvmeta_opts * options, output_sink * out) {
+    yaml_out yo;
     int ret;
 
+    if (!yaml_out_init(&yo, out)) {
+        return ERROR_MEMORY;
+    }
+
     parser->on_header = yaml_on_header;
     parser->on_tag = yaml_on_tag;
     parser->on_audio_tag = yaml_on_audio_tag;
@@ -452,47 +283,32 @@ int dump_yaml_file(flv_parser * parser, const flvmeta_opts * options) {
     parser->on_prev_tag_size = yaml_on_prev_tag_size;
     parser->on_stream_end = yaml_on_stream_end;
 
-    yaml_emitter_initialize(&emitter);
-    yaml_emitter_set_output_file(&emitter, stdout);
-    yaml_emitter_open(&emitter);
+    yaml_out_document_start(&yo);
 
-    yaml_document_start_event_initialize(&event, NULL, NULL, NULL, 0);
-    yaml_emitter_emit(&emitter, &event);
+    parser->user_data = &yo;
 
-    parser->user_data = &emitter;
+    ret = input_parse(options, options->input_file, parser);
 
-    ret = flv_parse(options->input_file, parser);
-
-    yaml_document_end_event_initialize(&event, 1);
-    yaml_emitter_emit(&emitter, &event);
-
-    yaml_emitter_flush(&emitter);
-    yaml_emitter_close(&emitter);
-    yaml_emitter_delete(&emitter);
+    yaml_out_document_end(&yo);
+    yaml_out_close(&yo);
 
     return ret;
 }
 
-int dump_yaml_amf_data(const amf_data * data) {
-    yaml_emitter_t emitter;
-    yaml_event_t event;
+int dump_yaml_amf_data(const amf_data * data, output_sink * out) {
+    yaml_out yo;
 
-    yaml_emitter_initialize(&emitter);
-    yaml_emitter_set_output_file(&emitter, stdout);
-    yaml_emitter_open(&emitter);
+    if (!yaml_out_init(&yo, out)) {
+        return ERROR_MEMORY;
+    }
 
-    yaml_document_start_event_initialize(&event, NULL, NULL, NULL, 0);
-    yaml_emitter_emit(&emitter, &event);
+    yaml_out_document_start(&yo);
 
     /* dump AMF into YAML */
-    amf_data_yaml_dump(data, &emitter);
-
-    yaml_document_end_event_initialize(&event, 1);
-    yaml_emitter_emit(&emitter, &event);
+    amf_data_yaml_dump(data, &yo);
 
-    yaml_emitter_flush(&emitter);
-    yaml_emitter_close(&emitter);
-    yaml_emitter_delete(&emitter);
+    yaml_out_document_end(&yo);
+    yaml_out_close(&yo);
 
     return OK;
 }
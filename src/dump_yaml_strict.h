@@ -0,0 +1,40 @@
+/*
+    FLVMeta - FLV Metadata Editor
+
+    Copyright (C) 2007-2014 Marc Noirot <marc.noirot AT gmail.com>
+
+    This file is part of FLVMeta.
+
+    FLVMeta is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    FLVMeta is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FLVMeta; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+#ifndef __DUMP_YAML_STRICT_H__
+#define __DUMP_YAML_STRICT_H__
+
+#include "dump.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/* YAML dumping functions using the libyaml emitter */
+void dump_yaml_strict_setup_metadata_dump(flv_parser * parser);
+int dump_yaml_strict_file(flv_parser * parser, const flvmeta_opts * options, output_sink * out);
+int dump_yaml_strict_amf_data(const amf_data * data, output_sink * out);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __DUMP_YAML_STRICT_H__ */
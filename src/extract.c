@@ -0,0 +1,445 @@
+/*
+    FLVMeta - FLV Metadata Editor
+
+    Copyright (C) 2007-2014 Marc Noirot <marc.noirot AT gmail.com>
+
+    This file is part of FLVMeta.
+
+    FLVMeta is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    FLVMeta is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FLVMeta; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+#include "flvmeta.h"
+#include "flv.h"
+#include "extract.h"
+#include "input.h"
+#include "sink.h"
+#include "util.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* ADTS header without CRC, and the largest frame it can describe */
+#define ADTS_HEADER_SIZE        7
+#define ADTS_MAX_FRAME_LENGTH   0x1FFF
+
+/* AVC NAL unit types */
+#define AVC_NAL_UNIT_TYPE_IDR   5
+#define AVC_NAL_UNIT_TYPE_SPS   7
+#define AVC_NAL_UNIT_TYPE_PPS   8
+
+#define avc_nal_unit_type(nal)  ((nal)[0] & 0x1F)
+
+/* codec of the extracted stream before its first tag */
+#define EXTRACT_NO_CODEC        -1
+
+static const byte annex_b_start_code[] = { 0x00, 0x00, 0x00, 0x01 };
+
+typedef struct __extract_context {
+    const flvmeta_opts * options;
+    FILE * out_file;
+    output_sink out;
+    /* current tag body, without its audio or video header byte */
+    byte * buffer;
+    uint32 buffer_size;
+    int codec;
+    uint8 have_unsupported_codec;
+    /* from the AAC AudioSpecificConfig */
+    uint8 have_aac_config;
+    uint8 aac_profile;
+    uint8 aac_frequency_index;
+    uint8 aac_channels;
+    /* AAC frames too large for an ADTS header */
+    uint32 skipped_frames;
+    /* from the AVCDecoderConfigurationRecord, parameter sets in Annex B form */
+    uint8 have_avc_config;
+    uint8 nal_length_size;
+    byte * parameter_sets;
+    uint32 parameter_sets_size;
+} extract_context;
+
+/* read the rest of the current tag body into the context buffer */
+static int extract_read_body(extract_context * ctx, flv_stream * flv_in, const flv_tag * tag, uint32 * size) {
+    /* the audio or video header byte has already been read */
+    *size = flv_tag_get_body_length(*tag) - 1;
+
+    if (*size > ctx->buffer_size) {
+        byte * new_buffer = (byte *)realloc(ctx->buffer, *size);
+        if (new_buffer == NULL) {
+            return ERROR_MEMORY;
+        }
+        ctx->buffer = new_buffer;
+        ctx->buffer_size = *size;
+    }
+
+    if (flv_read_tag_body(flv_in, ctx->buffer, *size) < *size) {
+        /* truncated file, keep the frames extracted so far */
+        return FLVMETA_DUMP_STOP_OK;
+    }
+    return OK;
+}
+
+/*
+    the first tag with a supported codec selects the extracted stream,
+    tags with another codec are skipped
+*/
+static int extract_select_codec(extract_context * ctx, int codec, int supported) {
+    if (ctx->codec == EXTRACT_NO_CODEC && supported) {
+        ctx->codec = codec;
+    }
+    if (ctx->codec != codec) {
+        ctx->have_unsupported_codec = 1;
+        return 0;
+    }
+    return 1;
+}
+
+static int extract_on_header(flv_header * header, flv_parser * parser) {
+    extract_context * ctx = (extract_context *)parser->user_data;
+
+    ctx->out_file = fopen(ctx->options->output_file, "wb");
+    if (ctx->out_file == NULL) {
+        return ERROR_OPEN_WRITE;
+    }
+    sink_init_file(&ctx->out, ctx->out_file);
+
+    if (ctx->options->verbose) {
+        fprintf(stdout, "Writing %s...\n", ctx->options->output_file);
+    }
+    return OK;
+}
+
+/*
+    audio extraction
+*/
+
+static int extract_read_aac_config(extract_context * ctx, const byte * data, uint32 size) {
+    uint8 object_type, frequency_index, channels;
+
+    if (size < 2) {
+        return ERROR_INVALID_TAG;
+    }
+    object_type = data[0] >> 3;
+    frequency_index = ((data[0] & 0x07) << 1) | (data[1] >> 7);
+    channels = (data[1] >> 3) & 0x0F;
+
+    /* explicit HE-AAC signaling: ADTS describes the core AAC stream */
+    if (object_type == 5 || object_type == 29) {
+        if (size < 3) {
+            return ERROR_INVALID_TAG;
+        }
+        /* skip the extension sampling frequency index */
+        object_type = (data[2] >> 2) & 0x1F;
+    }
+
+    /* ADTS can only carry the first four object types, with an indexed frequency */
+    if (object_type < 1 || object_type > 4 || frequency_index > 12) {
+        return ERROR_UNSUPPORTED_CODEC;
+    }
+
+    ctx->aac_profile = object_type - 1;
+    ctx->aac_frequency_index = frequency_index;
+    ctx->aac_channels = channels;
+    ctx->have_aac_config = 1;
+    return OK;
+}
+
+static int extract_write_adts_frame(extract_context * ctx, const byte * data, uint32 size) {
+    byte header[ADTS_HEADER_SIZE];
+    uint32 frame_length;
+
+    frame_length = size + ADTS_HEADER_SIZE;
+    if (frame_length > ADTS_MAX_FRAME_LENGTH) {
+        /* the 13-bit frame length cannot describe it, skip the frame */
+        ++ctx->skipped_frames;
+        return OK;
+    }
+
+    /* MPEG-4 syncword without CRC */
+    header[0] = 0xFF;
+    header[1] = 0xF1;
+    header[2] = (byte)((ctx->aac_profile << 6) | (ctx->aac_frequency_index << 2) | (ctx->aac_channels >> 2));
+    header[3] = (byte)(((ctx->aac_channels & 0x03) << 6) | (frame_length >> 11));
+    header[4] = (byte)((frame_length >> 3) & 0xFF);
+    /* variable bitrate buffer fullness, one raw data block */
+    header[5] = (byte)(((frame_length & 0x07) << 5) | 0x1F);
+    header[6] = 0xFC;
+
+    sink_write(&ctx->out, header, ADTS_HEADER_SIZE);
+    sink_write(&ctx->out, data, size);
+    return OK;
+}
+
+static int extract_on_audio_tag(flv_tag * tag, flv_audio_tag at, flv_parser * parser) {
+    extract_context * ctx = (extract_context *)parser->user_data;
+    uint32 size;
+    int format, res;
+
+    format = flv_audio_tag_sound_format(at);
+    if (format == FLV_AUDIO_TAG_SOUND_FORMAT_MP3_8) {
+        format = FLV_AUDIO_TAG_SOUND_FORMAT_MP3;
+    }
+    if (!extract_select_codec(ctx, format, format == FLV_AUDIO_TAG_SOUND_FORMAT_AAC || format == FLV_AUDIO_TAG_SOUND_FORMAT_MP3)) {
+        return OK;
+    }
+
+    res = extract_read_body(ctx, parser->stream, tag, &size);
+    if (res != OK) {
+        return res;
+    }
+
+    if (format == FLV_AUDIO_TAG_SOUND_FORMAT_AAC) {
+        if (size < 1) {
+            return OK;
+        }
+        if (ctx->buffer[0] == FLV_AAC_PACKET_TYPE_SEQUENCE_HEADER) {
+            return extract_read_aac_config(ctx, ctx->buffer + 1, size - 1);
+        }
+        /* raw frames before the first sequence header cannot be framed */
+        if (ctx->buffer[0] == FLV_AAC_PACKET_TYPE_RAW && ctx->have_aac_config) {
+            res = extract_write_adts_frame(ctx, ctx->buffer + 1, size - 1);
+        }
+    }
+    else {
+        /* MP3 frames carry their own headers */
+        sink_write(&ctx->out, ctx->buffer, size);
+    }
+
+    if (res == OK && ctx->out.error) {
+        res = ERROR_WRITE;
+    }
+    return res;
+}
+
+/*
+    video extraction
+*/
+
+/* find the next length prefixed NAL unit of a packet, returning 0 at its end */
+static int extract_next_nal_unit(const extract_context * ctx, const byte * data, uint32 size, uint32 * offset, const byte ** nal, uint32 * nal_size) {
+    uint32 length;
+    uint8 i;
+
+    if (size - *offset < ctx->nal_length_size) {
+        return 0;
+    }
+    length = 0;
+    for (i = 0; i < ctx->nal_length_size; ++i) {
+        length = (length << 8) | data[(*offset)++];
+    }
+    /* a truncated NAL unit ends the packet */
+    if (length > size - *offset) {
+        return 0;
+    }
+
+    *nal = data + *offset;
+    *nal_size = length;
+    *offset += length;
+    return 1;
+}
+
+/* append a length prefixed SPS or PPS of the configuration to the parameter sets */
+static int extract_add_parameter_set(extract_context * ctx, const byte * data, uint32 size, uint32 * offset) {
+    uint32 length;
+    byte * new_sets;
+
+    if (size - *offset < 2) {
+        return ERROR_INVALID_TAG;
+    }
+    length = (data[*offset] << 8) | data[*offset + 1];
+    *offset += 2;
+    if (length > size - *offset) {
+        return ERROR_INVALID_TAG;
+    }
+
+    new_sets = (byte *)realloc(ctx->parameter_sets, ctx->parameter_sets_size + sizeof(annex_b_start_code) + length);
+    if (new_sets == NULL) {
+        return ERROR_MEMORY;
+    }
+    ctx->parameter_sets = new_sets;
+    memcpy(new_sets + ctx->parameter_sets_size, annex_b_start_code, sizeof(annex_b_start_code));
+    ctx->parameter_sets_size += sizeof(annex_b_start_code);
+    memcpy(new_sets + ctx->parameter_sets_size, data + *offset, length);
+    ctx->parameter_sets_size += length;
+    *offset += length;
+    return OK;
+}
+
+static int extract_read_avc_config(extract_context * ctx, const byte * data, uint32 size) {
+    uint32 offset;
+    int count, res;
+
+    /* version, profile, compatibility, level, length size, SPS count */
+    if (size < 6) {
+        return ERROR_INVALID_TAG;
+    }
+
+    /* a new configuration replaces the previous parameter sets */
+    ctx->parameter_sets_size = 0;
+    ctx->nal_length_size = (data[4] & 0x03) + 1;
+
+    offset = 6;
+    for (count = data[5] & 0x1F; count > 0; --count) {
+        res = extract_add_parameter_set(ctx, data, size, &offset);
+        if (res != OK) {
+            return res;
+        }
+    }
+
+    if (offset >= size) {
+        return ERROR_INVALID_TAG;
+    }
+    for (count = data[offset++]; count > 0; --count) {
+        res = extract_add_parameter_set(ctx, data, size, &offset);
+        if (res != OK) {
+            return res;
+        }
+    }
+
+    ctx->have_avc_config = 1;
+    return OK;
+}
+
+static int extract_write_nal_units(extract_context * ctx, const byte * data, uint32 size) {
+    const byte * nal;
+    uint32 offset, nal_size;
+    int has_parameter_sets;
+
+    /* IDR access units without in-band parameter sets get the configured ones */
+    has_parameter_sets = 0;
+    offset = 0;
+    while (extract_next_nal_unit(ctx, data, size, &offset, &nal, &nal_size)) {
+        if (nal_size > 0 && (avc_nal_unit_type(nal) == AVC_NAL_UNIT_TYPE_SPS
+        || avc_nal_unit_type(nal) == AVC_NAL_UNIT_TYPE_PPS)) {
+            has_parameter_sets = 1;
+        }
+    }
+
+    offset = 0;
+    while (extract_next_nal_unit(ctx, data, size, &offset, &nal, &nal_size)) {
+        if (nal_size == 0) {
+            continue;
+        }
+        if (avc_nal_unit_type(nal) == AVC_NAL_UNIT_TYPE_IDR && !has_parameter_sets) {
+            sink_write(&ctx->out, ctx->parameter_sets, ctx->parameter_sets_size);
+            has_parameter_sets = 1;
+        }
+        sink_write(&ctx->out, annex_b_start_code, sizeof(annex_b_start_code));
+        sink_write(&ctx->out, nal, nal_size);
+    }
+    return OK;
+}
+
+static int extract_on_video_tag(flv_tag * tag, flv_video_tag vt, flv_parser * parser) {
+    extract_context * ctx = (extract_context *)parser->user_data;
+    uint32 size;
+    int codec, res;
+
+    /* command frames carry no picture */
+    if (flv_video_tag_frame_type(vt) == FLV_VIDEO_TAG_FRAME_TYPE_COMMAND_FRAME) {
+        return OK;
+    }
+    codec = flv_video_tag_codec_id(vt);
+    if (!extract_select_codec(ctx, codec, codec == FLV_VIDEO_TAG_CODEC_AVC)) {
+        return OK;
+    }
+
+    res = extract_read_body(ctx, parser->stream, tag, &size);
+    if (res != OK) {
+        return res;
+    }
+
+    /* packet type and composition time */
+    if (size < 4) {
+        return OK;
+    }
+    if (ctx->buffer[0] == FLV_AVC_PACKET_TYPE_SEQUENCE_HEADER) {
+        return extract_read_avc_config(ctx, ctx->buffer + 4, size - 4);
+    }
+    /* NAL units before the first sequence header cannot be decoded */
+    if (ctx->buffer[0] == FLV_AVC_PACKET_TYPE_NALU && ctx->have_avc_config) {
+        res = extract_write_nal_units(ctx, ctx->buffer + 4, size - 4);
+    }
+
+    if (res == OK && ctx->out.error) {
+        res = ERROR_WRITE;
+    }
+    return res;
+}
+
+static int extract_stream(const flvmeta_opts * options, flv_parser * parser) {
+    extract_context ctx;
+    int res;
+
+    /* the output file must not overwrite the file being read */
+    if (flvmeta_same_file(options->input_file, options->output_file)) {
+        return ERROR_OPEN_WRITE;
+    }
+
+    memset(&ctx, 0, sizeof(extract_context));
+    ctx.options = options;
+    ctx.codec = EXTRACT_NO_CODEC;
+
+    parser->on_header = extract_on_header;
+    parser->user_data = &ctx;
+
+    res = input_parse(options, options->input_file, parser);
+
+    /* a truncated file still yields its complete frames */
+    if (res == FLVMETA_DUMP_STOP_OK || (res == ERROR_EOF && ctx.out_file != NULL)) {
+        res = OK;
+    }
+
+    if (ctx.out_file != NULL) {
+        if (sink_close(&ctx.out) && res == OK) {
+            res = ERROR_WRITE;
+        }
+        if (fclose(ctx.out_file) != 0 && res == OK) {
+            res = ERROR_WRITE;
+        }
+    }
+
+    if (res == OK && ctx.codec == EXTRACT_NO_CODEC) {
+        res = ctx.have_unsupported_codec ? ERROR_UNSUPPORTED_CODEC : ERROR_NO_STREAM;
+    }
+
+    if (ctx.skipped_frames > 0 && !options->quiet) {
+        fprintf(stderr, "warning: %lu AAC frame(s) larger than %d bytes skipped\n",
+            (unsigned long)ctx.skipped_frames, ADTS_MAX_FRAME_LENGTH - ADTS_HEADER_SIZE);
+    }
+
+    if (res == OK && options->verbose) {
+        fprintf(stdout, "%s successfully written\n", options->output_file);
+    }
+
+    free(ctx.buffer);
+    free(ctx.parameter_sets);
+    return res;
+}
+
+int extract_audio(const flvmeta_opts * options) {
+    flv_parser parser;
+
+    memset(&parser, 0, sizeof(flv_parser));
+    parser.on_audio_tag = extract_on_audio_tag;
+    return extract_stream(options, &parser);
+}
+
+int extract_video(const flvmeta_opts * options) {
+    flv_parser parser;
+
+    memset(&parser, 0, sizeof(flv_parser));
+    parser.on_video_tag = extract_on_video_tag;
+    return extract_stream(options, &parser);
+}
@@ -20,6 +20,8 @@
     Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
 */
 #include "flv.h"
+#include "probes.h"
+#include "stats.h"
 
 #include <string.h>
 
@@ -28,6 +30,18 @@ void flv_tag_set_timestamp(flv_tag * tag, uint32 timestamp) {
     tag->timestamp_extended = (uint8)((timestamp & 0xFF000000) >> 24);
 }
 
+uint32 flv_fix_extended_timestamp(uint32 timestamp, uint32 * prev_timestamp, uint8 * timestamp_extended) {
+    if (timestamp < *prev_timestamp
+    && *prev_timestamp - timestamp > 0xF00000) {
+        ++*timestamp_extended;
+    }
+    *prev_timestamp = timestamp;
+    if (*timestamp_extended > 0) {
+        timestamp += *timestamp_extended << 24;
+    }
+    return timestamp;
+}
+
 /* FLV stream functions */
 flv_stream * flv_open(const char * file) {
     flv_stream * stream = (flv_stream *) malloc(sizeof(flv_stream));
@@ -54,10 +68,10 @@ int flv_read_header(flv_stream * stream, flv_header * header) {
         return FLV_ERROR_EOF;
     }
 
-    if (fread(&header->signature, sizeof(header->signature), 1, stream->flvin) == 0
-    || fread(&header->version, sizeof(header->version), 1, stream->flvin) == 0
-    || fread(&header->flags, sizeof(header->flags), 1, stream->flvin) == 0
-    || fread(&header->offset, sizeof(header->offset), 1, stream->flvin) == 0) {
+    if (stats_fread(&header->signature, sizeof(header->signature), 1, stream->flvin) == 0
+    || stats_fread(&header->version, sizeof(header->version), 1, stream->flvin) == 0
+    || stats_fread(&header->flags, sizeof(header->flags), 1, stream->flvin) == 0
+    || stats_fread(&header->offset, sizeof(header->offset), 1, stream->flvin) == 0) {
         return FLV_ERROR_EOF;
     }
 
@@ -81,12 +95,12 @@ int flv_read_prev_tag_size(flv_stream * stream, uint32 * prev_tag_size) {
 
     /* skip remaining tag body bytes */
     if (stream->state == FLV_STREAM_STATE_TAG_BODY) {
-        lfs_fseek(stream->flvin, stream->current_tag_offset + FLV_TAG_SIZE + uint24_be_to_uint32(stream->current_tag.body_length), SEEK_SET);
+        stats_fseek(stream->flvin, stream->current_tag_offset + FLV_TAG_SIZE + uint24_be_to_uint32(stream->current_tag.body_length), SEEK_SET);
         stream->state = FLV_STREAM_STATE_PREV_TAG_SIZE;
     }
 
     if (stream->state == FLV_STREAM_STATE_PREV_TAG_SIZE) {
-        if (fread(&val, sizeof(uint32_be), 1, stream->flvin) == 0) {
+        if (stats_fread(&val, sizeof(uint32_be), 1, stream->flvin) == 0) {
             return FLV_ERROR_EOF;
         }
         else {
@@ -109,35 +123,37 @@ int flv_read_tag(flv_stream * stream, flv_tag * tag) {
 
     /* skip header */
     if (stream->state == FLV_STREAM_STATE_START) {
-        lfs_fseek(stream->flvin, FLV_HEADER_SIZE, SEEK_CUR);
+        stats_fseek(stream->flvin, FLV_HEADER_SIZE, SEEK_CUR);
         stream->state = FLV_STREAM_STATE_PREV_TAG_SIZE;
     }
 
     /* skip current tag body */
     if (stream->state == FLV_STREAM_STATE_TAG_BODY) {
-        lfs_fseek(stream->flvin, stream->current_tag_offset + FLV_TAG_SIZE + uint24_be_to_uint32(stream->current_tag.body_length), SEEK_SET);
+        stats_fseek(stream->flvin, stream->current_tag_offset + FLV_TAG_SIZE + uint24_be_to_uint32(stream->current_tag.body_length), SEEK_SET);
         stream->state = FLV_STREAM_STATE_PREV_TAG_SIZE;
     }
 
     /* skip previous tag size */
     if (stream->state == FLV_STREAM_STATE_PREV_TAG_SIZE) {
-        lfs_fseek(stream->flvin, sizeof(uint32_be), SEEK_CUR);
+        stats_fseek(stream->flvin, sizeof(uint32_be), SEEK_CUR);
         stream->state = FLV_STREAM_STATE_TAG;
     }
 
     if (stream->state == FLV_STREAM_STATE_TAG) {
         stream->current_tag_offset = lfs_ftell(stream->flvin);
 
-        if (fread(&tag->type, sizeof(tag->type), 1, stream->flvin) == 0
-        || fread(&tag->body_length, sizeof(tag->body_length), 1, stream->flvin) == 0
-        || fread(&tag->timestamp, sizeof(tag->timestamp), 1, stream->flvin) == 0
-        || fread(&tag->timestamp_extended, sizeof(tag->timestamp_extended), 1, stream->flvin) == 0
-        || fread(&tag->stream_id, sizeof(tag->stream_id), 1, stream->flvin) == 0) {
+        if (stats_fread(&tag->type, sizeof(tag->type), 1, stream->flvin) == 0
+        || stats_fread(&tag->body_length, sizeof(tag->body_length), 1, stream->flvin) == 0
+        || stats_fread(&tag->timestamp, sizeof(tag->timestamp), 1, stream->flvin) == 0
+        || stats_fread(&tag->timestamp_extended, sizeof(tag->timestamp_extended), 1, stream->flvin) == 0
+        || stats_fread(&tag->stream_id, sizeof(tag->stream_id), 1, stream->flvin) == 0) {
             return FLV_ERROR_EOF;
         }
         else {
+            stats_count_tag(tag->type);
             memcpy(&stream->current_tag, tag, sizeof(flv_tag));
             stream->current_tag_body_length = uint24_be_to_uint32(tag->body_length);
+            FLVMETA_PROBE4(read_tag, stream->current_tag_offset, tag->type, stream->current_tag_body_length, flv_tag_get_timestamp(*tag));
             stream->current_tag_body_overflow = 0;
             stream->state = FLV_STREAM_STATE_TAG_BODY;
             return FLV_OK;
@@ -160,7 +176,7 @@ int flv_read_audio_tag(flv_stream * stream, flv_audio_tag * tag) {
         return FLV_ERROR_EMPTY_TAG;
     }
 
-    if (fread(tag, sizeof(flv_audio_tag), 1, stream->flvin) == 0) {
+    if (stats_fread(tag, sizeof(flv_audio_tag), 1, stream->flvin) == 0) {
         return FLV_ERROR_EOF;
     }
 
@@ -175,7 +191,7 @@ int flv_read_audio_tag(flv_stream * stream, flv_audio_tag * tag) {
     if (stream->current_tag_body_length == 0) {
         stream->state = FLV_STREAM_STATE_PREV_TAG_SIZE;
         if (stream->current_tag_body_overflow > 0) {
-            lfs_fseek(stream->flvin, -(file_offset_t)stream->current_tag_body_overflow, SEEK_CUR);
+            stats_fseek(stream->flvin, -(file_offset_t)stream->current_tag_body_overflow, SEEK_CUR);
         }
     }
 
@@ -194,7 +210,7 @@ int flv_read_video_tag(flv_stream * stream, flv_video_tag * tag) {
         return FLV_ERROR_EMPTY_TAG;
     }
 
-    if (fread(tag, sizeof(flv_video_tag), 1, stream->flvin) == 0) {
+    if (stats_fread(tag, sizeof(flv_video_tag), 1, stream->flvin) == 0) {
         return FLV_ERROR_EOF;
     }
 
@@ -209,7 +225,7 @@ int flv_read_video_tag(flv_stream * stream, flv_video_tag * tag) {
     if (stream->current_tag_body_length == 0) {
         stream->state = FLV_STREAM_STATE_PREV_TAG_SIZE;
         if (stream->current_tag_body_overflow > 0) {
-            lfs_fseek(stream->flvin, -(file_offset_t)stream->current_tag_body_overflow, SEEK_CUR);
+            stats_fseek(stream->flvin, -(file_offset_t)stream->current_tag_body_overflow, SEEK_CUR);
         }
     }
 
@@ -254,7 +270,7 @@ int flv_read_metadata(flv_stream * stream, amf_data ** name, amf_data ** data) {
 
         stream->state = FLV_STREAM_STATE_PREV_TAG_SIZE;
         if (stream->current_tag_body_overflow > 0) {
-            lfs_fseek(stream->flvin, -(file_offset_t)stream->current_tag_body_overflow, SEEK_CUR);
+            stats_fseek(stream->flvin, -(file_offset_t)stream->current_tag_body_overflow, SEEK_CUR);
         }
 
         return FLV_ERROR_INVALID_METADATA;
@@ -283,7 +299,7 @@ int flv_read_metadata(flv_stream * stream, amf_data ** name, amf_data ** data) {
     if (stream->current_tag_body_length == 0) {
         stream->state = FLV_STREAM_STATE_PREV_TAG_SIZE;
         if (stream->current_tag_body_overflow > 0) {
-            lfs_fseek(stream->flvin, -(file_offset_t)stream->current_tag_body_overflow, SEEK_CUR);
+            stats_fseek(stream->flvin, -(file_offset_t)stream->current_tag_body_overflow, SEEK_CUR);
         }
     }
 
@@ -301,7 +317,8 @@ size_t flv_read_tag_body(flv_stream * stream, void * buffer, size_t buffer_size)
     }
 
     bytes_number = (buffer_size > stream->current_tag_body_length) ? stream->current_tag_body_length : buffer_size;
-    bytes_number = fread(buffer, sizeof(byte), bytes_number, stream->flvin);
+    bytes_number = stats_fread(buffer, sizeof(byte), bytes_number, stream->flvin);
+    FLVMETA_PROBE2(read_tag_body, stream->current_tag_offset, bytes_number);
 
     stream->current_tag_body_length -= (uint32)bytes_number;
 
@@ -327,8 +344,34 @@ void flv_reset(flv_stream * stream) {
         stream->current_tag_offset = 0;
         stream->state = FLV_STREAM_STATE_START;
 
-        lfs_fseek(stream->flvin, 0, SEEK_SET);
+        stats_fseek(stream->flvin, 0, SEEK_SET);
+    }
+}
+
+/* go to the tag starting at the given offset */
+int flv_seek_tag(flv_stream * stream, file_offset_t offset) {
+    if (stream == NULL || stream->flvin == NULL) {
+        return FLV_ERROR_EOF;
+    }
+
+    if (stats_fseek(stream->flvin, offset, SEEK_SET) != 0) {
+        return FLV_ERROR_EOF;
+    }
+
+    stream->current_tag_body_length = 0;
+    stream->current_tag_body_overflow = 0;
+    stream->state = FLV_STREAM_STATE_TAG;
+    return FLV_OK;
+}
+
+/* go to the previous tag size located at the given offset */
+int flv_seek_prev_tag_size(flv_stream * stream, file_offset_t offset) {
+    if (flv_seek_tag(stream, offset) != FLV_OK) {
+        return FLV_ERROR_EOF;
     }
+
+    stream->state = FLV_STREAM_STATE_PREV_TAG_SIZE;
+    return FLV_OK;
 }
 
 void flv_close(flv_stream * stream) {
@@ -398,27 +441,27 @@ size_t flv_copy_prev_tag_size(void *to, uint32 prev_tag_size, size_t buffer_size
 
 /* FLV stdio writing helper functions */
 size_t flv_write_header(FILE * out, const flv_header * header) {
-    if (fwrite(&header->signature, sizeof(header->signature), 1, out) == 0)
+    if (stats_fwrite(&header->signature, sizeof(header->signature), 1, out) == 0)
         return 0;
-    if (fwrite(&header->version, sizeof(header->version), 1, out) == 0)
+    if (stats_fwrite(&header->version, sizeof(header->version), 1, out) == 0)
         return 0;
-    if (fwrite(&header->flags, sizeof(header->flags), 1, out) == 0)
+    if (stats_fwrite(&header->flags, sizeof(header->flags), 1, out) == 0)
         return 0;
-    if (fwrite(&header->offset, sizeof(header->offset), 1, out) == 0)
+    if (stats_fwrite(&header->offset, sizeof(header->offset), 1, out) == 0)
         return 0;
     return 1;
 }
 
 size_t flv_write_tag(FILE * out, const flv_tag * tag) {
-    if (fwrite(&tag->type, sizeof(tag->type), 1, out) == 0)
+    if (stats_fwrite(&tag->type, sizeof(tag->type), 1, out) == 0)
         return 0;
-    if (fwrite(&tag->body_length, sizeof(tag->body_length), 1, out) == 0)
+    if (stats_fwrite(&tag->body_length, sizeof(tag->body_length), 1, out) == 0)
         return 0;
-    if (fwrite(&tag->timestamp, sizeof(tag->timestamp), 1, out) == 0)
+    if (stats_fwrite(&tag->timestamp, sizeof(tag->timestamp), 1, out) == 0)
         return 0;
-    if (fwrite(&tag->timestamp_extended, sizeof(tag->timestamp_extended), 1, out) == 0)
+    if (stats_fwrite(&tag->timestamp_extended, sizeof(tag->timestamp_extended), 1, out) == 0)
         return 0;
-    if (fwrite(&tag->stream_id, sizeof(tag->stream_id), 1, out) == 0)
+    if (stats_fwrite(&tag->stream_id, sizeof(tag->stream_id), 1, out) == 0)
         return 0;
     return 1;
 }
@@ -22,11 +22,6 @@
 #ifndef __FLV_H__
 #define __FLV_H__
 
-/* Configuration of the sources */
-#ifdef HAVE_CONFIG_H
-# include <config.h>
-#endif
-
 #include "types.h"
 #include "amf.h"
 
@@ -157,6 +152,12 @@ extern "C" {
 /* FLV helper functions */
 void flv_tag_set_timestamp(flv_tag * tag, uint32 timestamp);
 
+/*
+    fix a timestamp of a stream which wrapped around, given the previous
+    timestamp of the stream and its number of wraps, both updated
+*/
+uint32 flv_fix_extended_timestamp(uint32 timestamp, uint32 * prev_timestamp, uint8 * timestamp_extended);
+
 /* FLV stream */
 #define FLV_STREAM_STATE_START          0
 #define FLV_STREAM_STATE_TAG            1
@@ -184,6 +185,8 @@ size_t flv_read_tag_body(flv_stream * stream, void * buffer, size_t buffer_size)
 file_offset_t flv_get_current_tag_offset(flv_stream * stream);
 file_offset_t flv_get_offset(flv_stream * stream);
 void flv_reset(flv_stream * stream);
+int flv_seek_tag(flv_stream * stream, file_offset_t offset);
+int flv_seek_prev_tag_size(flv_stream * stream, file_offset_t offset);
 void flv_close(flv_stream * stream);
 
 /* FLV buffer copy helper functions */
@@ -19,15 +19,45 @@
     along with FLVMeta; if not, write to the Free Software
     Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
 */
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
 #include <getopt.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
-#include "flvmeta.h"
-#include "check.h"
-#include "dump.h"
-#include "update.h"
+#include "libflvmeta.h"
+#include "progress.h"
+#include "serve.h"
+#include "stats.h"
+#include "trace.h"
+
+/* default duration of the checked sample, in seconds */
+#define DEFAULT_CHECK_SAMPLE 10
+
+/*
+    Long-only options
+*/
+enum {
+    MAX_ERRORS_OPTION_ID = 256,
+    FIRST_ERROR_OPTION_ID,
+    SAMPLE_OPTION_ID,
+    TAIL_OPTION_ID,
+    SEEK_INDEX_OPTION_ID,
+    STRICT_YAML_OPTION_ID,
+    SEEK_OPTION_ID,
+    CUT_OPTION_ID,
+    CONCAT_OPTION_ID,
+    SEGMENT_OPTION_ID,
+    FMP4_OPTION_ID,
+    SERVE_OPTION_ID,
+    WORKERS_OPTION_ID,
+    STATS_OPTION_ID,
+    TRACE_OPTION_ID,
+    PROGRESS_OPTION_ID
+};
 
 /*
     Command-line options
@@ -37,14 +67,32 @@ static struct option long_options[] = {
     { "full-dump",          no_argument,        NULL, 'F'},
     { "check",              no_argument,        NULL, 'C'},
     { "update",             no_argument,        NULL, 'U'},
+    { "info",               no_argument,        NULL, 'I'},
+    { "seek",               required_argument,  NULL, SEEK_OPTION_ID},
+    { "cut",                required_argument,  NULL, CUT_OPTION_ID},
+    { "concat",             no_argument,        NULL, CONCAT_OPTION_ID},
+    { "extract-audio",      no_argument,        NULL, 'A'},
+    { "extract-video",      no_argument,        NULL, 'E'},
+    { "segment",            required_argument,  NULL, SEGMENT_OPTION_ID},
+    { "fmp4",               no_argument,        NULL, FMP4_OPTION_ID},
+#ifndef WIN32
+    { "serve",              no_argument,        NULL, SERVE_OPTION_ID},
+    { "workers",            required_argument,  NULL, WORKERS_OPTION_ID},
+#endif /* WIN32 */
     { "dump-format",        required_argument,  NULL, 'd'},
     { "json",               no_argument,        NULL, 'j'},
     { "raw",                no_argument,        NULL, 'r'},
     { "xml",                no_argument,        NULL, 'x'},
     { "yaml",               no_argument,        NULL, 'y'},
+    { "strict-yaml",        no_argument,        NULL, STRICT_YAML_OPTION_ID},
     { "event",              required_argument,  NULL, 'e'},
     { "level",              required_argument,  NULL, 'l'},
     { "quiet",              no_argument,        NULL, 'q'},
+    { "max-errors",         required_argument,  NULL, MAX_ERRORS_OPTION_ID},
+    { "first-error",        no_argument,        NULL, FIRST_ERROR_OPTION_ID},
+    { "sample",             optional_argument,  NULL, SAMPLE_OPTION_ID},
+    { "tail",               no_argument,        NULL, TAIL_OPTION_ID},
+    { "seek-index",         no_argument,        NULL, SEEK_INDEX_OPTION_ID},
     { "print-metadata",     no_argument,        NULL, 'm'},
     { "add",                required_argument,  NULL, 'a'},
     { "no-lastsecond",      no_argument,        NULL, 's'},
@@ -54,6 +102,9 @@ static struct option long_options[] = {
     { "reset-timestamps",   no_argument,        NULL, 't'},
     { "all-keyframes",      no_argument,        NULL, 'k'},
     { "verbose",            no_argument,        NULL, 'v'},
+    { "stats",              optional_argument,  NULL, STATS_OPTION_ID},
+    { "trace",              required_argument,  NULL, TRACE_OPTION_ID},
+    { "progress",           optional_argument,  NULL, PROGRESS_OPTION_ID},
     { "version",            no_argument,        NULL, 'V'},
     { "help",               no_argument,        NULL, 'h'},
     { 0, 0, 0, 0 }
@@ -64,6 +115,9 @@ static struct option long_options[] = {
 #define FULL_DUMP_COMMAND           "F"
 #define CHECK_COMMAND               "C"
 #define UPDATE_COMMAND              "U"
+#define INFO_COMMAND                "I"
+#define EXTRACT_AUDIO_COMMAND       "A"
+#define EXTRACT_VIDEO_COMMAND       "E"
 #define DUMP_FORMAT_OPTION          "d:"
 #define JSON_OPTION                 "j"
 #define RAW_OPTION                  "r"
@@ -106,15 +160,37 @@ static void help(const char * name) {
            "                            the file is valid, or 10 if it contains errors\n"
            "  -U, --update              update computed onMetaData tag from INPUT_FILE\n"
            "                            into OUTPUT_FILE (default with output file)\n"
-           /*    "  -A, --extract-audio       extract raw audio data into OUTPUT_FILE\n"*/
-           /*    "  -E, --extract-video       extract raw video data into OUTPUT_FILE\n"*/
+           "  -I, --info                print the duration and completeness of INPUT_FILE,\n"
+           "                            read from its end, using the specified format\n"
+           "      --seek=TIME           print the time and file position of the keyframe\n"
+           "                            at or before TIME seconds, using the specified format\n"
+           "      --cut=START,END       copy the tags of INPUT_FILE from the keyframe at or\n"
+           "                            before START seconds to the keyframe at or after END\n"
+           "                            seconds into OUTPUT_FILE, with computed onMetaData\n"
+           "      --concat              join INPUT_FILE and the following files into\n"
+           "                            OUTPUT_FILE, given last, with continuous timestamps\n"
+#ifndef WIN32
+           "      --serve               answer JSON requests on the Unix socket INPUT_FILE\n"
+#endif /* WIN32 */
+           "  -A, --extract-audio       extract the AAC (as ADTS) or MP3 audio stream of\n"
+           "                            INPUT_FILE into OUTPUT_FILE\n"
+           "  -E, --extract-video       extract the AVC video stream of INPUT_FILE into\n"
+           "                            OUTPUT_FILE, as an Annex B byte stream\n"
+           "      --segment=SECONDS     split INPUT_FILE into keyframe-aligned chunks of\n"
+           "                            about SECONDS seconds named after OUTPUT_FILE,\n"
+           "                            printing a JSON manifest of the chunks\n"
+           "      --fmp4                remux the AVC and AAC streams of INPUT_FILE into\n"
+           "                            OUTPUT_FILE as fragmented MP4, one fragment per GOP\n"
            "\nDump options:\n"
            "  -d, --dump-format=TYPE    dump format is of type TYPE\n"
-           "                            TYPE is 'xml' (default), 'json', 'raw', or 'yaml'\n"
+           "                            TYPE is 'xml' (default), 'json', 'raw', 'yaml',\n"
+           "                            'ndjson' (one JSON line per tag), 'cbor',\n"
+           "                            or 'csv' and 'tsv' (one row per tag)\n"
            "  -j, --json                equivalent to --dump-format=json\n"
            "  -r, --raw                 equivalent to --dump-format=raw\n"
            "  -x, --xml                 equivalent to --dump-format=xml\n"
            "  -y, --yaml                equivalent to --dump-format=yaml\n"
+           "      --strict-yaml         generate YAML output through libyaml\n"
            "  -e, --event=EVENT         specify the event to be dumped instead of 'onMetadata'\n"
            "\nCheck options:\n"
            "  -l, --level=LEVEL         print only messages where level is at least LEVEL\n"
@@ -122,6 +198,14 @@ static void help(const char * name) {
            "  -q, --quiet               do not print messages, only return the status code\n"
            "  -x, --xml                 generate an XML report\n"
            "  -j, --json                generate a JSON report\n"
+           "      --max-errors=N        stop checking after N errors\n"
+           "      --first-error         stop checking at the first error\n"
+           "      --sample[=SECONDS]    only check the header, the first SECONDS\n"
+           "                            (default 10) and the last tag of the file\n"
+           "      --tail                only check the header and the last tags of the\n"
+           "                            file, to detect truncated files quickly\n"
+           "      --seek-index          only check that each keyframe listed in onMetaData\n"
+           "                            can be found at its file position\n"
            "\nUpdate options:\n"
            "  -m, --print-metadata      print metadata to stdout after update using\n"
            "                            the specified format\n"
@@ -133,8 +217,20 @@ static void help(const char * name) {
            "                            (the default is to stop with an error)\n"
            "  -t, --reset-timestamps    reset timestamps so OUTPUT_FILE starts at zero\n"
            "  -k, --all-keyframes       index all keyframe tags, including duplicate timestamps\n"
+#ifndef WIN32
+           "\nServe options:\n"
+           "      --workers=N           number of worker threads (default 4)\n"
+#endif /* WIN32 */
            "\nCommon options:\n"
            "  -v, --verbose             display informative messages\n"
+           "      --stats[=FORMAT]      print time, I/O, tag and allocation statistics\n"
+           "                            on standard error, FORMAT is 'text' (default)\n"
+           "                            or 'json'\n"
+           "      --trace=FILE          write the processing steps into FILE as Trace\n"
+           "                            Event Format spans, for chrome://tracing or\n"
+           "                            Perfetto\n"
+           "      --progress[=SECONDS]  report the progress of the files being read on\n"
+           "                            standard error every SECONDS (default 1)\n"
            "\nMiscellaneous:\n"
            "  -V, --version             print version information and exit\n"
            "  -h, --help                display this information and exit\n");
@@ -151,6 +247,9 @@ static int parse_command_line(int argc, char ** argv, flvmeta_opts * options) {
             FULL_DUMP_COMMAND
             CHECK_COMMAND
             UPDATE_COMMAND
+            INFO_COMMAND
+            EXTRACT_AUDIO_COMMAND
+            EXTRACT_VIDEO_COMMAND
             DUMP_FORMAT_OPTION
             JSON_OPTION
             RAW_OPTION
@@ -203,6 +302,109 @@ static int parse_command_line(int argc, char ** argv, flvmeta_opts * options) {
                 }
                 options->command = FLVMETA_UPDATE_COMMAND;
                 break;
+            case 'I':
+                if (options->command != FLVMETA_DEFAULT_COMMAND) {
+                    fprintf(stderr, "%s: only one command can be specified -- %s\n", argv[0], argv[optind]);
+                    return EXIT_FAILURE;
+                }
+                options->command = FLVMETA_INFO_COMMAND;
+                break;
+            case 'A':
+                if (options->command != FLVMETA_DEFAULT_COMMAND) {
+                    fprintf(stderr, "%s: only one command can be specified -- %s\n", argv[0], argv[optind]);
+                    return EXIT_FAILURE;
+                }
+                options->command = FLVMETA_EXTRACT_AUDIO_COMMAND;
+                break;
+            case 'E':
+                if (options->command != FLVMETA_DEFAULT_COMMAND) {
+                    fprintf(stderr, "%s: only one command can be specified -- %s\n", argv[0], argv[optind]);
+                    return EXIT_FAILURE;
+                }
+                options->command = FLVMETA_EXTRACT_VIDEO_COMMAND;
+                break;
+            case SEEK_OPTION_ID:
+                if (options->command != FLVMETA_DEFAULT_COMMAND) {
+                    fprintf(stderr, "%s: only one command can be specified -- %s\n", argv[0], argv[optind]);
+                    return EXIT_FAILURE;
+                }
+                {
+                    char * end;
+                    double value = strtod(optarg, &end);
+                    if (*optarg == 0 || *end != 0 || value != value) {
+                        fprintf(stderr, "%s: invalid seek time -- %s\n", argv[0], optarg);
+                        usage(argv[0]);
+                        return EXIT_FAILURE;
+                    }
+                    options->seek_time = value;
+                }
+                options->command = FLVMETA_SEEK_COMMAND;
+                break;
+            case CONCAT_OPTION_ID:
+                if (options->command != FLVMETA_DEFAULT_COMMAND) {
+                    fprintf(stderr, "%s: only one command can be specified -- %s\n", argv[0], argv[optind]);
+                    return EXIT_FAILURE;
+                }
+                options->command = FLVMETA_CONCAT_COMMAND;
+                break;
+            case CUT_OPTION_ID:
+                if (options->command != FLVMETA_DEFAULT_COMMAND) {
+                    fprintf(stderr, "%s: only one command can be specified -- %s\n", argv[0], argv[optind]);
+                    return EXIT_FAILURE;
+                }
+                {
+                    char * end;
+                    double start_value, end_value;
+                    start_value = strtod(optarg, &end);
+                    if (end == optarg || *end != ',') {
+                        fprintf(stderr, "%s: invalid cut range -- %s\n", argv[0], optarg);
+                        usage(argv[0]);
+                        return EXIT_FAILURE;
+                    }
+                    end_value = strtod(end + 1, &end);
+                    if (*end != 0 || !(start_value >= 0) || !(end_value > start_value)) {
+                        fprintf(stderr, "%s: invalid cut range -- %s\n", argv[0], optarg);
+                        usage(argv[0]);
+                        return EXIT_FAILURE;
+                    }
+                    options->cut_start = start_value;
+                    options->cut_end = end_value;
+                }
+                options->command = FLVMETA_CUT_COMMAND;
+                break;
+            case SEGMENT_OPTION_ID:
+                if (options->command != FLVMETA_DEFAULT_COMMAND) {
+                    fprintf(stderr, "%s: only one command can be specified -- %s\n", argv[0], argv[optind]);
+                    return EXIT_FAILURE;
+                }
+                {
+                    char * end;
+                    double value = strtod(optarg, &end);
+                    if (*optarg == 0 || *end != 0 || !(value > 0)) {
+                        fprintf(stderr, "%s: invalid segment duration -- %s\n", argv[0], optarg);
+                        usage(argv[0]);
+                        return EXIT_FAILURE;
+                    }
+                    options->segment_duration = value;
+                }
+                options->command = FLVMETA_SEGMENT_COMMAND;
+                break;
+            case FMP4_OPTION_ID:
+                if (options->command != FLVMETA_DEFAULT_COMMAND) {
+                    fprintf(stderr, "%s: only one command can be specified -- %s\n", argv[0], argv[optind]);
+                    return EXIT_FAILURE;
+                }
+                options->command = FLVMETA_FMP4_COMMAND;
+                break;
+#ifndef WIN32
+            case SERVE_OPTION_ID:
+                if (options->command != FLVMETA_DEFAULT_COMMAND) {
+                    fprintf(stderr, "%s: only one command can be specified -- %s\n", argv[0], argv[optind]);
+                    return EXIT_FAILURE;
+                }
+                options->command = FLVMETA_SERVE_COMMAND;
+                break;
+#endif /* WIN32 */
             /*
                 options
             */
@@ -227,12 +429,41 @@ static int parse_command_line(int argc, char ** argv, flvmeta_opts * options) {
                 }
                 break;
             case 'q': options->quiet = 1; break;
+            case MAX_ERRORS_OPTION_ID:
+                {
+                    char * end;
+                    long value = strtol(optarg, &end, 10);
+                    if (*optarg == 0 || *end != 0 || value < 0 || value > 0x7FFFFFFF) {
+                        fprintf(stderr, "%s: invalid error limit -- %s\n", argv[0], optarg);
+                        usage(argv[0]);
+                        return EXIT_FAILURE;
+                    }
+                    options->check_max_errors = (int)value;
+                } break;
+            case FIRST_ERROR_OPTION_ID: options->check_max_errors = 1; break;
+            case TAIL_OPTION_ID: options->check_tail = 1; break;
+            case SEEK_INDEX_OPTION_ID: options->check_seek_index = 1; break;
+            case SAMPLE_OPTION_ID:
+                if (optarg == NULL) {
+                    options->check_sample = DEFAULT_CHECK_SAMPLE;
+                }
+                else {
+                    char * end;
+                    long value = strtol(optarg, &end, 10);
+                    if (*optarg == 0 || *end != 0 || value <= 0 || value > 0x3FFFFF) {
+                        fprintf(stderr, "%s: invalid sample duration -- %s\n", argv[0], optarg);
+                        usage(argv[0]);
+                        return EXIT_FAILURE;
+                    }
+                    options->check_sample = (int)value;
+                }
+                break;
             /* dump options */
             case 'd':
                 if (!strcmp(optarg, "xml")) {
                     options->dump_format = FLVMETA_FORMAT_XML;
                 }
-                if (!strcmp(optarg, "raw")) {
+                else if (!strcmp(optarg, "raw")) {
                     options->dump_format = FLVMETA_FORMAT_RAW;
                 }
                 else if (!strcmp(optarg, "json")) {
@@ -241,6 +472,18 @@ static int parse_command_line(int argc, char ** argv, flvmeta_opts * options) {
                 else if (!strcmp(optarg, "yaml")) {
                     options->dump_format = FLVMETA_FORMAT_YAML;
                 }
+                else if (!strcmp(optarg, "ndjson")) {
+                    options->dump_format = FLVMETA_FORMAT_NDJSON;
+                }
+                else if (!strcmp(optarg, "cbor")) {
+                    options->dump_format = FLVMETA_FORMAT_CBOR;
+                }
+                else if (!strcmp(optarg, "csv")) {
+                    options->dump_format = FLVMETA_FORMAT_CSV;
+                }
+                else if (!strcmp(optarg, "tsv")) {
+                    options->dump_format = FLVMETA_FORMAT_TSV;
+                }
                 else {
                     fprintf(stderr, "%s: invalid output format -- %s\n", argv[0], optarg);
                     usage(argv[0]);
@@ -259,6 +502,7 @@ static int parse_command_line(int argc, char ** argv, flvmeta_opts * options) {
                 options->check_report_format = FLVMETA_FORMAT_XML;
                 break;
             case 'y': options->dump_format = FLVMETA_FORMAT_YAML;    break;
+            case STRICT_YAML_OPTION_ID: options->dump_strict_yaml = 1; break;
             case 'e': options->metadata_event = optarg;              break;
             /* update options */
             case 'm': options->dump_metadata = 1;                    break;
@@ -285,11 +529,53 @@ static int parse_command_line(int argc, char ** argv, flvmeta_opts * options) {
             case 'i': options->error_handling = FLVMETA_IGNORE_ERRORS;   break;
             case 't': options->reset_timestamps = 1;                     break;
             case 'k': options->all_keyframes = 1;                        break;
+#ifndef WIN32
+            /* serve options */
+            case WORKERS_OPTION_ID:
+                {
+                    char * end;
+                    long value = strtol(optarg, &end, 10);
+                    if (*optarg == 0 || *end != 0 || value < 1 || value > SERVE_MAX_WORKERS) {
+                        fprintf(stderr, "%s: invalid number of workers -- %s\n", argv[0], optarg);
+                        usage(argv[0]);
+                        return EXIT_FAILURE;
+                    }
+                    options->serve_workers = (int)value;
+                } break;
+#endif /* WIN32 */
 
             /*
                 common options
             */
             case 'v': options->verbose = 1;  break;
+            case STATS_OPTION_ID:
+                options->stats = 1;
+                if (optarg == NULL || !strcmp(optarg, "text")) {
+                    options->stats_format = FLVMETA_FORMAT_RAW;
+                }
+                else if (!strcmp(optarg, "json")) {
+                    options->stats_format = FLVMETA_FORMAT_JSON;
+                }
+                else {
+                    fprintf(stderr, "%s: invalid stats format -- %s\n", argv[0], optarg);
+                    usage(argv[0]);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case TRACE_OPTION_ID: options->trace_file = optarg; break;
+            case PROGRESS_OPTION_ID:
+                options->progress = 1;
+                if (optarg != NULL) {
+                    char * end;
+                    double value = strtod(optarg, &end);
+                    if (*optarg == 0 || *end != 0 || !(value > 0)) {
+                        fprintf(stderr, "%s: invalid progress interval -- %s\n", argv[0], optarg);
+                        usage(argv[0]);
+                        return EXIT_FAILURE;
+                    }
+                    options->progress_interval = value;
+                }
+                break;
             /*
                 Miscellaneous
             */
@@ -327,10 +613,50 @@ static int parse_command_line(int argc, char ** argv, flvmeta_opts * options) {
         return EXIT_FAILURE;
     }
 
+    /* concatenated files, followed by the output file */
+    if (options->command == FLVMETA_CONCAT_COMMAND) {
+        if (argc - optind < 2) {
+            fprintf(stderr, "%s: no output file\n", argv[0]);
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+        options->concat_files = &argv[optind];
+        options->concat_count = argc - optind - 1;
+        options->output_file = argv[argc - 1];
+        return OK;
+    }
+
     /* output filename */
     if (++optind < argc) {
         options->output_file = argv[optind];
     }
+    else if (options->command == FLVMETA_CUT_COMMAND
+    || options->command == FLVMETA_EXTRACT_AUDIO_COMMAND
+    || options->command == FLVMETA_EXTRACT_VIDEO_COMMAND
+    || options->command == FLVMETA_SEGMENT_COMMAND
+    || options->command == FLVMETA_FMP4_COMMAND) {
+        fprintf(stderr, "%s: no output file\n", argv[0]);
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    /* spans from concurrent workers cannot be traced */
+    if (options->command == FLVMETA_SERVE_COMMAND && options->trace_file != NULL) {
+        fprintf(stderr, "%s: --trace cannot be used with --serve\n", argv[0]);
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+    /* the counters are shared by the whole process, not by each worker */
+    if (options->command == FLVMETA_SERVE_COMMAND && options->stats) {
+        fprintf(stderr, "%s: --stats cannot be used with --serve\n", argv[0]);
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+    if (options->command == FLVMETA_SERVE_COMMAND && options->progress) {
+        fprintf(stderr, "%s: --progress cannot be used with --serve\n", argv[0]);
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
 
     /* determine command if default */
     if (options->command == FLVMETA_DEFAULT_COMMAND && options->output_file != NULL) {
@@ -350,58 +676,67 @@ static int parse_command_line(int argc, char ** argv, flvmeta_opts * options) {
 
 int main(int argc, char ** argv) {
     int errcode;
+    flvmeta_context * ctx;
+    flvmeta_opts * options;
 
     /* flvmeta default options */
-    static flvmeta_opts options;
-    options.command = FLVMETA_DEFAULT_COMMAND;
-    options.input_file = NULL;
-    options.output_file = NULL;
-    options.metadata = NULL;
-    options.check_level = FLVMETA_CHECK_LEVEL_WARNING;
-    options.quiet = 0;
-    options.check_report_format = FLVMETA_FORMAT_RAW;
-    options.dump_metadata = 0;
-    options.insert_onlastsecond = 1;
-    options.reset_timestamps = 0;
-    options.all_keyframes = 0;
-    options.preserve_metadata = 0;
-    options.error_handling = FLVMETA_EXIT_ON_ERROR;
-    options.dump_format = FLVMETA_FORMAT_XML;
-    options.verbose = 0;
-    options.metadata_event = NULL;
-
+    ctx = flvmeta_context_new();
+    if (ctx == NULL) {
+        fprintf(stderr, "%s: memory allocation error\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    options = flvmeta_context_get_options(ctx);
 
     /* Command-line parsing */
-    errcode = parse_command_line(argc, argv, &options);
+    errcode = parse_command_line(argc, argv, options);
 
-    /* free metadata if necessary */
-    if ((errcode != OK || options.command != FLVMETA_UPDATE_COMMAND) && options.metadata != NULL) {
-        amf_data_free(options.metadata);
+    /* trace file */
+    if (errcode == OK && options->trace_file != NULL && trace_open(options->trace_file) != OK) {
+        fprintf(stderr, "%s: cannot open %s for writing\n", argv[0], options->trace_file);
+        errcode = EXIT_FAILURE;
     }
 
     if (errcode == OK) {
         /* execute command */
-        switch (options.command) {
-            case FLVMETA_DUMP_COMMAND: errcode = dump_metadata(&options); break;
-            case FLVMETA_FULL_DUMP_COMMAND: errcode = dump_flv_file(&options); break;
-            case FLVMETA_CHECK_COMMAND: errcode = check_flv_file(&options); break;
-            case FLVMETA_UPDATE_COMMAND: errcode = update_metadata(&options); break;
+        switch (options->command) {
             case FLVMETA_VERSION_COMMAND: version(); break;
             case FLVMETA_HELP_COMMAND: help(argv[0]); break;
+            default: errcode = flvmeta_execute(ctx);
         }
 
         /* error report */
         switch (errcode) {
-            case ERROR_OPEN_READ: fprintf(stderr, "%s: cannot open %s for reading\n", argv[0], options.input_file); break;
-            case ERROR_NO_FLV: fprintf(stderr, "%s: %s is not a valid FLV file\n", argv[0], options.input_file); break;
+            case ERROR_OPEN_READ: fprintf(stderr, "%s: cannot open %s for reading\n", argv[0], options->input_file); break;
+            case ERROR_NO_FLV: fprintf(stderr, "%s: %s is not a valid FLV file\n", argv[0], options->input_file); break;
             case ERROR_EOF: fprintf(stderr, "%s: unexpected end of file\n", argv[0]); break;
             case ERROR_MEMORY: fprintf(stderr, "%s: memory allocation error\n", argv[0]); break;
             case ERROR_EMPTY_TAG: fprintf(stderr, "%s: empty FLV tag\n", argv[0]); break;
-            case ERROR_OPEN_WRITE: fprintf(stderr, "%s: cannot open %s for writing\n", argv[0], options.output_file); break;
+            case ERROR_OPEN_WRITE: fprintf(stderr, "%s: cannot open %s for writing\n", argv[0], options->output_file); break;
             case ERROR_INVALID_TAG: fprintf(stderr, "%s: invalid FLV tag\n", argv[0]); break;
-            case ERROR_WRITE: fprintf(stderr, "%s: unable to write to %s\n", argv[0], options.output_file); break;
+            case ERROR_WRITE: fprintf(stderr, "%s: unable to write to %s\n", argv[0], (options->output_file != NULL) ? options->output_file : "standard output"); break;
+            case ERROR_SOCKET: fprintf(stderr, "%s: cannot listen on %s\n", argv[0], options->input_file); break;
+            case ERROR_NO_KEYFRAMES: fprintf(stderr, "%s: no keyframes found in %s\n", argv[0], options->input_file); break;
+            case ERROR_UNSUPPORTED_CODEC: fprintf(stderr, "%s: unsupported codec in %s\n", argv[0], options->input_file); break;
+            case ERROR_NO_STREAM: fprintf(stderr, "%s: no stream to extract from %s\n", argv[0], options->input_file); break;
+        }
+
+        /* statistics report */
+        if (options->stats) {
+            output_sink err;
+            sink_init_file(&err, stderr);
+            stats_report(&err, options->stats_format);
+            sink_close(&err);
         }
     }
 
+    if (trace_close() != OK) {
+        fprintf(stderr, "%s: unable to write to %s\n", argv[0], options->trace_file);
+        if (errcode == OK) {
+            errcode = EXIT_FAILURE;
+        }
+    }
+
+    flvmeta_context_free(ctx);
+
     return errcode;
 }
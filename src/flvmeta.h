@@ -22,11 +22,6 @@
 #ifndef __FLVMETA_H__
 #define __FLVMETA_H__
 
-/* Configuration of the sources */
-#ifdef HAVE_CONFIG_H
-# include <config.h>
-#endif
-
 #include "flv.h"
 
 /* copyright string */
@@ -49,14 +44,35 @@
 /* stop file parsing without error */
 #define FLVMETA_DUMP_STOP_OK 10
 
+/* socket creation or listening error of the serve command */
+#define ERROR_SOCKET 11
+
+/* no keyframe could be found in the file */
+#define ERROR_NO_KEYFRAMES 12
+
+/* the stream to extract uses a codec that cannot be extracted */
+#define ERROR_UNSUPPORTED_CODEC 13
+
+/* the file contains no stream to extract */
+#define ERROR_NO_STREAM 14
+
 /* commands */
-#define FLVMETA_DEFAULT_COMMAND     0
-#define FLVMETA_DUMP_COMMAND        1
-#define FLVMETA_FULL_DUMP_COMMAND   2
-#define FLVMETA_CHECK_COMMAND       3
-#define FLVMETA_UPDATE_COMMAND      4
-#define FLVMETA_VERSION_COMMAND     5
-#define FLVMETA_HELP_COMMAND        6
+#define FLVMETA_DEFAULT_COMMAND           0
+#define FLVMETA_DUMP_COMMAND              1
+#define FLVMETA_FULL_DUMP_COMMAND         2
+#define FLVMETA_CHECK_COMMAND             3
+#define FLVMETA_UPDATE_COMMAND            4
+#define FLVMETA_VERSION_COMMAND           5
+#define FLVMETA_HELP_COMMAND              6
+#define FLVMETA_INFO_COMMAND              7
+#define FLVMETA_SERVE_COMMAND             8
+#define FLVMETA_SEEK_COMMAND              9
+#define FLVMETA_CUT_COMMAND               10
+#define FLVMETA_CONCAT_COMMAND            11
+#define FLVMETA_EXTRACT_AUDIO_COMMAND     12
+#define FLVMETA_EXTRACT_VIDEO_COMMAND     13
+#define FLVMETA_SEGMENT_COMMAND           14
+#define FLVMETA_FMP4_COMMAND              15
 
 /* error handling */
 #define FLVMETA_EXIT_ON_ERROR       0
@@ -74,6 +90,10 @@
 #define FLVMETA_FORMAT_RAW          1
 #define FLVMETA_FORMAT_JSON         2
 #define FLVMETA_FORMAT_YAML         3
+#define FLVMETA_FORMAT_NDJSON       4
+#define FLVMETA_FORMAT_CBOR         5
+#define FLVMETA_FORMAT_CSV          6
+#define FLVMETA_FORMAT_TSV          7
 
 /* flvmeta options */
 typedef struct __flvmeta_opts {
@@ -85,14 +105,31 @@ typedef struct __flvmeta_opts {
     int check_level;
     int quiet;
     int check_report_format;
+    int check_max_errors;
+    int check_sample;
+    int check_tail;
+    int check_seek_index;
     int insert_onlastsecond;
     int reset_timestamps;
     int all_keyframes;
     int preserve_metadata;
     int error_handling;
     int dump_format;
+    int dump_strict_yaml;
     int verbose;
     char * metadata_event;
+    int serve_workers;
+    number64 seek_time;
+    number64 cut_start;
+    number64 cut_end;
+    char ** concat_files;
+    int concat_count;
+    number64 segment_duration;
+    int stats;
+    int stats_format;
+    char * trace_file;
+    int progress;
+    number64 progress_interval;
 } flvmeta_opts;
 
 #endif /* __FLVMETA_H__ */
@@ -0,0 +1,929 @@
+/*
+    FLVMeta - FLV Metadata Editor
+
+    Copyright (C) 2007-2014 Marc Noirot <marc.noirot AT gmail.com>
+
+    This file is part of FLVMeta.
+
+    FLVMeta is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    FLVMeta is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FLVMeta; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+#include "flvmeta.h"
+#include "flv.h"
+#include "avc.h"
+#include "fmp4.h"
+#include "input.h"
+#include "sink.h"
+#include "util.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* maximum number of tags read at the start of the file to find the sequence headers */
+#define MAX_HEADER_SEARCH_TAGS 64
+
+/* timescales, FLV timestamps being in milliseconds */
+#define FMP4_MOVIE_TIMESCALE 1000
+#define FMP4_VIDEO_TIMESCALE 90000
+
+/* fragment duration of files without video, in milliseconds */
+#define FMP4_AUDIO_FRAGMENT_DURATION 1000
+
+/* sample durations used until two samples of a track have been seen */
+#define FMP4_DEFAULT_VIDEO_DURATION 3600
+#define FMP4_DEFAULT_AUDIO_DURATION 1024
+
+/* tracks */
+#define FMP4_VIDEO_TRACK 0
+#define FMP4_AUDIO_TRACK 1
+
+/* sample flags, telling whether a sample depends on others */
+#define FMP4_SAMPLE_SYNC        0x02000000
+#define FMP4_SAMPLE_NON_SYNC    0x01010000
+
+/* track fragment header and run flags */
+#define TFHD_DEFAULT_BASE_IS_MOOF               0x020000
+#define TRUN_DATA_OFFSET                        0x000001
+#define TRUN_SAMPLE_DURATION                    0x000100
+#define TRUN_SAMPLE_SIZE                        0x000200
+#define TRUN_SAMPLE_FLAGS                       0x000400
+#define TRUN_SAMPLE_COMPOSITION_TIME_OFFSET     0x000800
+
+/* AudioSpecificConfig sampling frequencies */
+static const uint32 aac_sampling_frequencies[] = {
+    96000, 88200, 64000, 48000, 44100, 32000, 24000, 22050, 16000, 12000, 11025, 8000, 7350
+};
+
+/* identity transformation matrix of movie and track headers */
+static const uint32 mp4_unity_matrix[] = {
+    0x00010000, 0, 0, 0, 0x00010000, 0, 0, 0, 0x40000000
+};
+
+/* growable buffer in which boxes are built */
+typedef struct __mp4_buffer {
+    byte * data;
+    size_t size;
+    size_t capacity;
+    int error;
+} mp4_buffer;
+
+typedef struct __fmp4_sample {
+    uint64 dts;
+    uint32 size;
+    uint32 flags;
+    sint32 composition_offset;
+} fmp4_sample;
+
+typedef struct __fmp4_track {
+    uint8 present;
+    uint32 id;
+    uint32 timescale;
+    /* AVCDecoderConfigurationRecord or AudioSpecificConfig */
+    byte * config;
+    uint32 config_size;
+    uint32 width;
+    uint32 height;
+    uint32 sample_rate;
+    uint8 channels;
+    /* samples of the current fragment, and their data */
+    fmp4_sample * samples;
+    uint32 sample_count;
+    uint32 sample_capacity;
+    mp4_buffer data;
+    uint32 last_duration;
+} fmp4_track;
+
+typedef struct __fmp4_state {
+    const flvmeta_opts * opts;
+    flv_stream * flv_in;
+    output_sink out;
+    fmp4_track tracks[2];
+    mp4_buffer boxes;
+    uint32 sequence_number;
+    uint8 have_unsupported_codec;
+    /* current tag body */
+    byte * buffer;
+    uint32 buffer_size;
+    /* extended timestamp fixing */
+    uint32 prev_timestamp_video;
+    uint32 prev_timestamp_audio;
+    uint8 timestamp_extended_video;
+    uint8 timestamp_extended_audio;
+    /* first timestamp, when resetting timestamps */
+    uint8 have_first_timestamp;
+    uint32 first_timestamp;
+} fmp4_state;
+
+/*
+    box building
+*/
+
+static void mp4_write(mp4_buffer * b, const void * data, size_t size) {
+    if (b->error) {
+        return;
+    }
+    if (b->size + size > b->capacity) {
+        size_t capacity = (b->capacity == 0) ? 4096 : b->capacity;
+        byte * new_data;
+
+        while (capacity < b->size + size) {
+            capacity *= 2;
+        }
+        new_data = (byte *)realloc(b->data, capacity);
+        if (new_data == NULL) {
+            b->error = 1;
+            return;
+        }
+        b->data = new_data;
+        b->capacity = capacity;
+    }
+    memcpy(b->data + b->size, data, size);
+    b->size += size;
+}
+
+static void mp4_write_u8(mp4_buffer * b, uint32 value) {
+    byte data = (byte)value;
+    mp4_write(b, &data, 1);
+}
+
+static void mp4_write_u16(mp4_buffer * b, uint32 value) {
+    byte data[2];
+    data[0] = (byte)(value >> 8);
+    data[1] = (byte)value;
+    mp4_write(b, data, 2);
+}
+
+static void mp4_write_u24(mp4_buffer * b, uint32 value) {
+    byte data[3];
+    data[0] = (byte)(value >> 16);
+    data[1] = (byte)(value >> 8);
+    data[2] = (byte)value;
+    mp4_write(b, data, 3);
+}
+
+static void mp4_write_u32(mp4_buffer * b, uint32 value) {
+    byte data[4];
+    data[0] = (byte)(value >> 24);
+    data[1] = (byte)(value >> 16);
+    data[2] = (byte)(value >> 8);
+    data[3] = (byte)value;
+    mp4_write(b, data, 4);
+}
+
+static void mp4_write_u64(mp4_buffer * b, uint64 value) {
+    mp4_write_u32(b, (uint32)(value >> 32));
+    mp4_write_u32(b, (uint32)value);
+}
+
+static void mp4_write_zeros(mp4_buffer * b, size_t count) {
+    static const byte zeros[32] = { 0 };
+    mp4_write(b, zeros, count);
+}
+
+static void mp4_set_u32(mp4_buffer * b, size_t offset, uint32 value) {
+    if (!b->error) {
+        b->data[offset] = (byte)(value >> 24);
+        b->data[offset + 1] = (byte)(value >> 16);
+        b->data[offset + 2] = (byte)(value >> 8);
+        b->data[offset + 3] = (byte)value;
+    }
+}
+
+/* start a box whose size is set by mp4_box_end */
+static size_t mp4_box_start(mp4_buffer * b, const char * type) {
+    size_t offset = b->size;
+    mp4_write_u32(b, 0);
+    mp4_write(b, type, 4);
+    return offset;
+}
+
+static size_t mp4_full_box_start(mp4_buffer * b, const char * type, uint8 version, uint32 flags) {
+    size_t offset = mp4_box_start(b, type);
+    mp4_write_u8(b, version);
+    mp4_write_u24(b, flags);
+    return offset;
+}
+
+static void mp4_box_end(mp4_buffer * b, size_t offset) {
+    mp4_set_u32(b, offset, (uint32)(b->size - offset));
+}
+
+/* MPEG-4 descriptor header, with a fixed four byte length */
+static void mp4_write_descriptor(mp4_buffer * b, uint8 tag, uint32 length) {
+    mp4_write_u8(b, tag);
+    mp4_write_u8(b, 0x80 | ((length >> 21) & 0x7F));
+    mp4_write_u8(b, 0x80 | ((length >> 14) & 0x7F));
+    mp4_write_u8(b, 0x80 | ((length >> 7) & 0x7F));
+    mp4_write_u8(b, length & 0x7F);
+}
+
+/*
+    initialization segment
+*/
+
+static void fmp4_write_sample_entry(mp4_buffer * b, const fmp4_track * track, int type) {
+    size_t entry, box;
+    uint32 es_length, decoder_config_length;
+
+    if (type == FMP4_VIDEO_TRACK) {
+        entry = mp4_box_start(b, "avc1");
+        mp4_write_zeros(b, 6);
+        /* data reference index */
+        mp4_write_u16(b, 1);
+        mp4_write_zeros(b, 16);
+        mp4_write_u16(b, track->width);
+        mp4_write_u16(b, track->height);
+        /* 72 dpi */
+        mp4_write_u32(b, 0x00480000);
+        mp4_write_u32(b, 0x00480000);
+        mp4_write_u32(b, 0);
+        /* frame count, compressor name, depth */
+        mp4_write_u16(b, 1);
+        mp4_write_zeros(b, 32);
+        mp4_write_u16(b, 0x0018);
+        mp4_write_u16(b, 0xFFFF);
+
+        box = mp4_box_start(b, "avcC");
+        mp4_write(b, track->config, track->config_size);
+        mp4_box_end(b, box);
+    }
+    else {
+        entry = mp4_box_start(b, "mp4a");
+        mp4_write_zeros(b, 6);
+        mp4_write_u16(b, 1);
+        mp4_write_zeros(b, 8);
+        mp4_write_u16(b, track->channels);
+        mp4_write_u16(b, 16);
+        mp4_write_u32(b, 0);
+        mp4_write_u32(b, (track->sample_rate <= 0xFFFF) ? track->sample_rate << 16 : 0);
+
+        /* ES descriptor, holding the AudioSpecificConfig */
+        decoder_config_length = 13 + 5 + track->config_size;
+        es_length = 3 + 5 + decoder_config_length + 5 + 1;
+
+        box = mp4_full_box_start(b, "esds", 0, 0);
+        mp4_write_descriptor(b, 0x03, es_length);
+        mp4_write_u16(b, track->id);
+        mp4_write_u8(b, 0);
+        mp4_write_descriptor(b, 0x04, decoder_config_length);
+        /* MPEG-4 audio, audio stream */
+        mp4_write_u8(b, 0x40);
+        mp4_write_u8(b, 0x15);
+        mp4_write_u24(b, 0);
+        mp4_write_u32(b, 0);
+        mp4_write_u32(b, 0);
+        mp4_write_descriptor(b, 0x05, track->config_size);
+        mp4_write(b, track->config, track->config_size);
+        /* SL config, predefined for MP4 files */
+        mp4_write_descriptor(b, 0x06, 1);
+        mp4_write_u8(b, 0x02);
+        mp4_box_end(b, box);
+    }
+    mp4_box_end(b, entry);
+}
+
+static void fmp4_write_trak(mp4_buffer * b, const fmp4_track * track, int type) {
+    size_t trak, mdia, minf, dinf, stbl, box;
+    int i;
+
+    trak = mp4_box_start(b, "trak");
+
+    /* track enabled and used in the presentation */
+    box = mp4_full_box_start(b, "tkhd", 0, 3);
+    mp4_write_u32(b, 0);
+    mp4_write_u32(b, 0);
+    mp4_write_u32(b, track->id);
+    mp4_write_u32(b, 0);
+    /* unknown duration */
+    mp4_write_u32(b, 0);
+    mp4_write_zeros(b, 8);
+    /* layer, alternate group, volume */
+    mp4_write_u16(b, 0);
+    mp4_write_u16(b, 0);
+    mp4_write_u16(b, (type == FMP4_AUDIO_TRACK) ? 0x0100 : 0);
+    mp4_write_u16(b, 0);
+    for (i = 0; i < 9; ++i) {
+        mp4_write_u32(b, mp4_unity_matrix[i]);
+    }
+    mp4_write_u32(b, track->width << 16);
+    mp4_write_u32(b, track->height << 16);
+    mp4_box_end(b, box);
+
+    mdia = mp4_box_start(b, "mdia");
+
+    box = mp4_full_box_start(b, "mdhd", 0, 0);
+    mp4_write_u32(b, 0);
+    mp4_write_u32(b, 0);
+    mp4_write_u32(b, track->timescale);
+    mp4_write_u32(b, 0);
+    /* undetermined language */
+    mp4_write_u16(b, 0x55C4);
+    mp4_write_u16(b, 0);
+    mp4_box_end(b, box);
+
+    box = mp4_full_box_start(b, "hdlr", 0, 0);
+    mp4_write_u32(b, 0);
+    mp4_write(b, (type == FMP4_VIDEO_TRACK) ? "vide" : "soun", 4);
+    mp4_write_zeros(b, 12);
+    if (type == FMP4_VIDEO_TRACK) {
+        mp4_write(b, "VideoHandler", 13);
+    }
+    else {
+        mp4_write(b, "SoundHandler", 13);
+    }
+    mp4_box_end(b, box);
+
+    minf = mp4_box_start(b, "minf");
+    if (type == FMP4_VIDEO_TRACK) {
+        box = mp4_full_box_start(b, "vmhd", 0, 1);
+        mp4_write_zeros(b, 8);
+    }
+    else {
+        box = mp4_full_box_start(b, "smhd", 0, 0);
+        mp4_write_zeros(b, 4);
+    }
+    mp4_box_end(b, box);
+
+    /* media data in the same file */
+    dinf = mp4_box_start(b, "dinf");
+    box = mp4_full_box_start(b, "dref", 0, 0);
+    mp4_write_u32(b, 1);
+    mp4_box_end(b, mp4_full_box_start(b, "url ", 0, 1));
+    mp4_box_end(b, box);
+    mp4_box_end(b, dinf);
+
+    /* samples are described by the fragments */
+    stbl = mp4_box_start(b, "stbl");
+    box = mp4_full_box_start(b, "stsd", 0, 0);
+    mp4_write_u32(b, 1);
+    fmp4_write_sample_entry(b, track, type);
+    mp4_box_end(b, box);
+    box = mp4_full_box_start(b, "stts", 0, 0);
+    mp4_write_u32(b, 0);
+    mp4_box_end(b, box);
+    box = mp4_full_box_start(b, "stsc", 0, 0);
+    mp4_write_u32(b, 0);
+    mp4_box_end(b, box);
+    box = mp4_full_box_start(b, "stsz", 0, 0);
+    mp4_write_u32(b, 0);
+    mp4_write_u32(b, 0);
+    mp4_box_end(b, box);
+    box = mp4_full_box_start(b, "stco", 0, 0);
+    mp4_write_u32(b, 0);
+    mp4_box_end(b, box);
+    mp4_box_end(b, stbl);
+
+    mp4_box_end(b, minf);
+    mp4_box_end(b, mdia);
+    mp4_box_end(b, trak);
+}
+
+/* write the ftyp and moov boxes */
+static int fmp4_write_init_segment(fmp4_state * state) {
+    mp4_buffer * b = &state->boxes;
+    size_t moov, mvex, box;
+    int i;
+
+    b->size = 0;
+
+    box = mp4_box_start(b, "ftyp");
+    mp4_write(b, "iso5", 4);
+    mp4_write_u32(b, 512);
+    mp4_write(b, "iso5iso6mp41", 12);
+    mp4_box_end(b, box);
+
+    moov = mp4_box_start(b, "moov");
+
+    box = mp4_full_box_start(b, "mvhd", 0, 0);
+    mp4_write_u32(b, 0);
+    mp4_write_u32(b, 0);
+    mp4_write_u32(b, FMP4_MOVIE_TIMESCALE);
+    mp4_write_u32(b, 0);
+    /* rate and volume */
+    mp4_write_u32(b, 0x00010000);
+    mp4_write_u16(b, 0x0100);
+    mp4_write_zeros(b, 10);
+    for (i = 0; i < 9; ++i) {
+        mp4_write_u32(b, mp4_unity_matrix[i]);
+    }
+    mp4_write_zeros(b, 24);
+    /* next track id */
+    mp4_write_u32(b, 3);
+    mp4_box_end(b, box);
+
+    for (i = FMP4_VIDEO_TRACK; i <= FMP4_AUDIO_TRACK; ++i) {
+        if (state->tracks[i].present) {
+            fmp4_write_trak(b, &state->tracks[i], i);
+        }
+    }
+
+    mvex = mp4_box_start(b, "mvex");
+    for (i = FMP4_VIDEO_TRACK; i <= FMP4_AUDIO_TRACK; ++i) {
+        if (state->tracks[i].present) {
+            box = mp4_full_box_start(b, "trex", 0, 0);
+            mp4_write_u32(b, state->tracks[i].id);
+            /* sample description index, then defaults overridden by each run */
+            mp4_write_u32(b, 1);
+            mp4_write_u32(b, 0);
+            mp4_write_u32(b, 0);
+            mp4_write_u32(b, 0);
+            mp4_box_end(b, box);
+        }
+    }
+    mp4_box_end(b, mvex);
+
+    mp4_box_end(b, moov);
+
+    if (b->error) {
+        return ERROR_MEMORY;
+    }
+    sink_write(&state->out, b->data, b->size);
+    return OK;
+}
+
+/*
+    fragments
+*/
+
+static int fmp4_add_sample(fmp4_track * track, uint64 dts, const byte * data, uint32 size, uint32 flags, sint32 composition_offset) {
+    fmp4_sample * sample;
+
+    if (track->sample_count == track->sample_capacity) {
+        uint32 capacity = (track->sample_capacity == 0) ? 64 : track->sample_capacity * 2;
+        fmp4_sample * new_samples = (fmp4_sample *)realloc(track->samples, capacity * sizeof(fmp4_sample));
+        if (new_samples == NULL) {
+            return ERROR_MEMORY;
+        }
+        track->samples = new_samples;
+        track->sample_capacity = capacity;
+    }
+
+    sample = &track->samples[track->sample_count++];
+    sample->dts = dts;
+    sample->size = size;
+    sample->flags = flags;
+    sample->composition_offset = composition_offset;
+
+    mp4_write(&track->data, data, size);
+    return track->data.error ? ERROR_MEMORY : OK;
+}
+
+/* duration of a sample of the fragment, the last one lasting as long as the previous */
+static uint32 fmp4_sample_duration(fmp4_track * track, uint32 index) {
+    if (index + 1 < track->sample_count) {
+        const fmp4_sample * sample = &track->samples[index];
+        const fmp4_sample * next = sample + 1;
+        track->last_duration = (next->dts > sample->dts) ? (uint32)(next->dts - sample->dts) : 0;
+    }
+    return track->last_duration;
+}
+
+static void fmp4_write_traf(mp4_buffer * b, fmp4_track * track, int type, size_t * data_offset) {
+    size_t traf, box;
+    uint32 flags, i;
+    uint8 version;
+
+    traf = mp4_box_start(b, "traf");
+
+    box = mp4_full_box_start(b, "tfhd", 0, TFHD_DEFAULT_BASE_IS_MOOF);
+    mp4_write_u32(b, track->id);
+    mp4_box_end(b, box);
+
+    box = mp4_full_box_start(b, "tfdt", 1, 0);
+    mp4_write_u64(b, track->samples[0].dts);
+    mp4_box_end(b, box);
+
+    flags = TRUN_DATA_OFFSET | TRUN_SAMPLE_DURATION | TRUN_SAMPLE_SIZE | TRUN_SAMPLE_FLAGS;
+    version = 0;
+    if (type == FMP4_VIDEO_TRACK) {
+        flags |= TRUN_SAMPLE_COMPOSITION_TIME_OFFSET;
+        /* negative composition offsets need a version 1 run */
+        for (i = 0; i < track->sample_count; ++i) {
+            if (track->samples[i].composition_offset < 0) {
+                version = 1;
+                break;
+            }
+        }
+    }
+
+    box = mp4_full_box_start(b, "trun", version, flags);
+    mp4_write_u32(b, track->sample_count);
+    /* set once the moof size is known */
+    *data_offset = b->size;
+    mp4_write_u32(b, 0);
+    for (i = 0; i < track->sample_count; ++i) {
+        mp4_write_u32(b, fmp4_sample_duration(track, i));
+        mp4_write_u32(b, track->samples[i].size);
+        mp4_write_u32(b, track->samples[i].flags);
+        if (type == FMP4_VIDEO_TRACK) {
+            mp4_write_u32(b, (uint32)track->samples[i].composition_offset);
+        }
+    }
+    mp4_box_end(b, box);
+
+    mp4_box_end(b, traf);
+}
+
+/* write the samples gathered so far as a moof and mdat pair */
+static int fmp4_write_fragment(fmp4_state * state) {
+    mp4_buffer * b = &state->boxes;
+    size_t moof, box, data_offsets[2];
+    uint32 data_offset;
+    uint32 mdat_size;
+    int i;
+
+    if (state->tracks[FMP4_VIDEO_TRACK].sample_count == 0
+    && state->tracks[FMP4_AUDIO_TRACK].sample_count == 0) {
+        return OK;
+    }
+
+    b->size = 0;
+    moof = mp4_box_start(b, "moof");
+
+    box = mp4_full_box_start(b, "mfhd", 0, 0);
+    mp4_write_u32(b, ++state->sequence_number);
+    mp4_box_end(b, box);
+
+    for (i = FMP4_VIDEO_TRACK; i <= FMP4_AUDIO_TRACK; ++i) {
+        if (state->tracks[i].sample_count > 0) {
+            fmp4_write_traf(b, &state->tracks[i], i, &data_offsets[i]);
+        }
+    }
+    mp4_box_end(b, moof);
+
+    /* sample data follow the mdat header, video first */
+    data_offset = (uint32)(b->size - moof) + 8;
+    mdat_size = 8;
+    for (i = FMP4_VIDEO_TRACK; i <= FMP4_AUDIO_TRACK; ++i) {
+        if (state->tracks[i].sample_count > 0) {
+            mp4_set_u32(b, data_offsets[i], data_offset);
+            data_offset += (uint32)state->tracks[i].data.size;
+            mdat_size += (uint32)state->tracks[i].data.size;
+        }
+    }
+    mp4_write_u32(b, mdat_size);
+    mp4_write(b, "mdat", 4);
+
+    if (b->error) {
+        return ERROR_MEMORY;
+    }
+
+    sink_write(&state->out, b->data, b->size);
+    for (i = FMP4_VIDEO_TRACK; i <= FMP4_AUDIO_TRACK; ++i) {
+        if (state->tracks[i].sample_count > 0) {
+            sink_write(&state->out, state->tracks[i].data.data, state->tracks[i].data.size);
+        }
+        state->tracks[i].sample_count = 0;
+        state->tracks[i].data.size = 0;
+    }
+
+    return state->out.error ? ERROR_WRITE : OK;
+}
+
+/*
+    input
+*/
+
+/* read the current tag body into the state buffer */
+static int fmp4_read_body(fmp4_state * state, uint32 body_length) {
+    if (body_length > state->buffer_size) {
+        byte * new_buffer = (byte *)realloc(state->buffer, body_length);
+        if (new_buffer == NULL) {
+            return ERROR_MEMORY;
+        }
+        state->buffer = new_buffer;
+        state->buffer_size = body_length;
+    }
+    if (flv_read_tag_body(state->flv_in, state->buffer, body_length) < body_length) {
+        return ERROR_EOF;
+    }
+    return OK;
+}
+
+/* keep the codec configuration of a track */
+static int fmp4_set_config(fmp4_track * track, const byte * config, uint32 size) {
+    track->config = (byte *)malloc(size);
+    if (track->config == NULL) {
+        return ERROR_MEMORY;
+    }
+    memcpy(track->config, config, size);
+    track->config_size = size;
+    track->present = 1;
+    return OK;
+}
+
+static int fmp4_set_video_config(fmp4_state * state, uint32 body_length) {
+    fmp4_track * track = &state->tracks[FMP4_VIDEO_TRACK];
+    const byte * record;
+    uint32 size;
+
+    /* video tag header, packet type and composition time */
+    if (body_length < 5 + 7) {
+        return OK;
+    }
+    record = state->buffer + 5;
+    size = body_length - 5;
+
+    if (parse_avc_resolution(record, size, &track->width, &track->height) != FLV_OK) {
+        return ERROR_INVALID_TAG;
+    }
+    track->id = FMP4_VIDEO_TRACK + 1;
+    track->timescale = FMP4_VIDEO_TIMESCALE;
+    track->last_duration = FMP4_DEFAULT_VIDEO_DURATION;
+    return fmp4_set_config(track, record, size);
+}
+
+static int fmp4_set_audio_config(fmp4_state * state, uint32 body_length) {
+    fmp4_track * track = &state->tracks[FMP4_AUDIO_TRACK];
+    const byte * config;
+    uint32 frequency_index;
+
+    /* audio tag header and packet type */
+    if (body_length < 2 + 2) {
+        return OK;
+    }
+    config = state->buffer + 2;
+
+    /* the sampling frequency is the timescale of the track */
+    frequency_index = ((config[0] & 0x07) << 1) | (config[1] >> 7);
+    if (frequency_index >= sizeof(aac_sampling_frequencies) / sizeof(uint32)) {
+        state->have_unsupported_codec = 1;
+        return OK;
+    }
+    track->sample_rate = aac_sampling_frequencies[frequency_index];
+    track->channels = (config[1] >> 3) & 0x0F;
+    if (track->channels == 0) {
+        track->channels = (flv_audio_tag_sound_type(state->buffer[0]) == FLV_AUDIO_TAG_SOUND_TYPE_STEREO) ? 2 : 1;
+    }
+
+    track->id = FMP4_AUDIO_TRACK + 1;
+    track->timescale = track->sample_rate;
+    track->last_duration = FMP4_DEFAULT_AUDIO_DURATION;
+    return fmp4_set_config(track, config, body_length - 2);
+}
+
+/* find the sequence headers among the first tags of the file */
+static int fmp4_find_configs(fmp4_state * state) {
+    flv_tag tag;
+    uint32 body_length;
+    int result, i;
+
+    for (i = 0; i < MAX_HEADER_SEARCH_TAGS; ++i) {
+        if (flv_read_tag(state->flv_in, &tag) != FLV_OK) {
+            break;
+        }
+        body_length = flv_tag_get_body_length(tag);
+        if ((tag.type != FLV_TAG_TYPE_VIDEO && tag.type != FLV_TAG_TYPE_AUDIO) || body_length < 2) {
+            continue;
+        }
+        if (fmp4_read_body(state, body_length) != OK) {
+            break;
+        }
+
+        result = OK;
+        if (tag.type == FLV_TAG_TYPE_VIDEO) {
+            if (flv_video_tag_codec_id(state->buffer[0]) != FLV_VIDEO_TAG_CODEC_AVC) {
+                state->have_unsupported_codec = 1;
+            }
+            else if (state->buffer[1] == FLV_AVC_PACKET_TYPE_SEQUENCE_HEADER
+            && !state->tracks[FMP4_VIDEO_TRACK].present) {
+                result = fmp4_set_video_config(state, body_length);
+            }
+        }
+        else {
+            if (flv_audio_tag_sound_format(state->buffer[0]) != FLV_AUDIO_TAG_SOUND_FORMAT_AAC) {
+                state->have_unsupported_codec = 1;
+            }
+            else if (state->buffer[1] == FLV_AAC_PACKET_TYPE_SEQUENCE_HEADER
+            && !state->tracks[FMP4_AUDIO_TRACK].present) {
+                result = fmp4_set_audio_config(state, body_length);
+            }
+        }
+        if (result != OK) {
+            return result;
+        }
+
+        if (state->tracks[FMP4_VIDEO_TRACK].present && state->tracks[FMP4_AUDIO_TRACK].present) {
+            break;
+        }
+    }
+
+    if (!state->tracks[FMP4_VIDEO_TRACK].present && !state->tracks[FMP4_AUDIO_TRACK].present) {
+        return state->have_unsupported_codec ? ERROR_UNSUPPORTED_CODEC : ERROR_NO_STREAM;
+    }
+    return OK;
+}
+
+/* timestamp of a tag, fixing extended timestamps as write_flv does */
+static uint32 fmp4_fix_timestamp(fmp4_state * state, const flv_tag * tag) {
+    uint32 timestamp = flv_tag_get_timestamp(*tag);
+
+    if (tag->type == FLV_TAG_TYPE_AUDIO) {
+        timestamp = flv_fix_extended_timestamp(timestamp, &state->prev_timestamp_audio, &state->timestamp_extended_audio);
+    }
+    else {
+        timestamp = flv_fix_extended_timestamp(timestamp, &state->prev_timestamp_video, &state->timestamp_extended_video);
+    }
+
+    /* non-zero starting timestamp handling */
+    if (state->opts->reset_timestamps) {
+        if (!state->have_first_timestamp) {
+            state->first_timestamp = timestamp;
+            state->have_first_timestamp = 1;
+        }
+        timestamp = (timestamp > state->first_timestamp) ? timestamp - state->first_timestamp : 0;
+    }
+    return timestamp;
+}
+
+static int fmp4_add_video_tag(fmp4_state * state, uint32 body_length, uint32 timestamp) {
+    fmp4_track * track = &state->tracks[FMP4_VIDEO_TRACK];
+    sint32 composition_time;
+    int keyframe, result;
+
+    if (flv_video_tag_codec_id(state->buffer[0]) != FLV_VIDEO_TAG_CODEC_AVC
+    || state->buffer[1] != FLV_AVC_PACKET_TYPE_NALU
+    || body_length <= 5) {
+        return OK;
+    }
+
+    /* each group of pictures is a fragment */
+    keyframe = (flv_video_tag_frame_type(state->buffer[0]) == FLV_VIDEO_TAG_FRAME_TYPE_KEYFRAME);
+    if (keyframe && track->sample_count > 0) {
+        result = fmp4_write_fragment(state);
+        if (result != OK) {
+            return result;
+        }
+    }
+
+    /* signed 24-bit composition time */
+    composition_time = (state->buffer[2] << 16) | (state->buffer[3] << 8) | state->buffer[4];
+    if (composition_time & 0x800000) {
+        composition_time -= 0x1000000;
+    }
+
+    return fmp4_add_sample(track,
+        (uint64)timestamp * (FMP4_VIDEO_TIMESCALE / 1000),
+        state->buffer + 5, body_length - 5,
+        keyframe ? FMP4_SAMPLE_SYNC : FMP4_SAMPLE_NON_SYNC,
+        composition_time * (FMP4_VIDEO_TIMESCALE / 1000));
+}
+
+static int fmp4_add_audio_tag(fmp4_state * state, uint32 body_length, uint32 timestamp) {
+    fmp4_track * track = &state->tracks[FMP4_AUDIO_TRACK];
+    uint64 dts;
+    int result;
+
+    if (flv_audio_tag_sound_format(state->buffer[0]) != FLV_AUDIO_TAG_SOUND_FORMAT_AAC
+    || state->buffer[1] != FLV_AAC_PACKET_TYPE_RAW
+    || body_length <= 2) {
+        return OK;
+    }
+
+    dts = (uint64)timestamp * track->timescale / 1000;
+
+    /* without video, fragments have a fixed duration */
+    if (!state->tracks[FMP4_VIDEO_TRACK].present && track->sample_count > 0
+    && dts - track->samples[0].dts >= (uint64)track->timescale * FMP4_AUDIO_FRAGMENT_DURATION / 1000) {
+        result = fmp4_write_fragment(state);
+        if (result != OK) {
+            return result;
+        }
+    }
+
+    return fmp4_add_sample(track, dts, state->buffer + 2, body_length - 2, FMP4_SAMPLE_SYNC, 0);
+}
+
+/* remux the tags of the input file, in a single pass */
+static int fmp4_remux(fmp4_state * state) {
+    flv_tag tag;
+    uint32 body_length;
+    uint32 timestamp;
+    int result;
+
+    result = fmp4_write_init_segment(state);
+    if (result != OK) {
+        return result;
+    }
+
+    input_rewind(state->opts, state->flv_in);
+    while (flv_read_tag(state->flv_in, &tag) == FLV_OK) {
+        input_tag(state->opts, state->flv_in, &tag);
+        body_length = flv_tag_get_body_length(tag);
+
+        /* tracks without configuration are not remuxed */
+        if (!(tag.type == FLV_TAG_TYPE_VIDEO && state->tracks[FMP4_VIDEO_TRACK].present)
+        && !(tag.type == FLV_TAG_TYPE_AUDIO && state->tracks[FMP4_AUDIO_TRACK].present)) {
+            continue;
+        }
+        if (body_length < 2) {
+            continue;
+        }
+
+        /* stop at the first truncated tag */
+        result = fmp4_read_body(state, body_length);
+        if (result == ERROR_EOF) {
+            break;
+        }
+        else if (result != OK) {
+            return result;
+        }
+
+        timestamp = fmp4_fix_timestamp(state, &tag);
+        if (tag.type == FLV_TAG_TYPE_VIDEO) {
+            result = fmp4_add_video_tag(state, body_length, timestamp);
+        }
+        else {
+            result = fmp4_add_audio_tag(state, body_length, timestamp);
+        }
+        if (result != OK) {
+            return result;
+        }
+    }
+
+    return fmp4_write_fragment(state);
+}
+
+static void fmp4_state_free(fmp4_state * state) {
+    int i;
+
+    for (i = FMP4_VIDEO_TRACK; i <= FMP4_AUDIO_TRACK; ++i) {
+        free(state->tracks[i].config);
+        free(state->tracks[i].samples);
+        free(state->tracks[i].data.data);
+    }
+    free(state->boxes.data);
+    free(state->buffer);
+}
+
+int remux_fmp4_file(const flvmeta_opts * options) {
+    fmp4_state state;
+    flv_header header;
+    FILE * out_file;
+    int res;
+
+    /* the output file must not overwrite the file being read */
+    if (flvmeta_same_file(options->input_file, options->output_file)) {
+        return ERROR_OPEN_WRITE;
+    }
+
+    memset(&state, 0, sizeof(fmp4_state));
+    state.opts = options;
+
+    state.flv_in = input_open(options, options->input_file);
+    if (state.flv_in == NULL) {
+        return ERROR_OPEN_READ;
+    }
+    if (input_read_header(options, state.flv_in, &header) != FLV_OK) {
+        input_close(options, state.flv_in);
+        return ERROR_NO_FLV;
+    }
+
+    res = fmp4_find_configs(&state);
+    if (res != OK) {
+        input_close(options, state.flv_in);
+        fmp4_state_free(&state);
+        return res;
+    }
+
+    out_file = fopen(options->output_file, "wb");
+    if (out_file == NULL) {
+        input_close(options, state.flv_in);
+        fmp4_state_free(&state);
+        return ERROR_OPEN_WRITE;
+    }
+    sink_init_file(&state.out, out_file);
+
+    if (options->verbose) {
+        fprintf(stdout, "Writing %s...\n", options->output_file);
+    }
+
+    res = fmp4_remux(&state);
+
+    if (sink_close(&state.out) && res == OK) {
+        res = ERROR_WRITE;
+    }
+    if (fclose(out_file) != 0 && res == OK) {
+        res = ERROR_WRITE;
+    }
+
+    if (res == OK && options->verbose) {
+        fprintf(stdout, "%s successfully written\n", options->output_file);
+    }
+
+    input_close(options, state.flv_in);
+    fmp4_state_free(&state);
+    return res;
+}
@@ -19,8 +19,13 @@
     along with FLVMeta; if not, write to the Free Software
     Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
 */
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
 #include "info.h"
 #include "avc.h"
+#include "input.h"
 
 #include <string.h>
 
@@ -168,37 +173,9 @@ static int compute_video_size(flv_stream * flv_in, flv_info * info, uint32 body_
 }
 
 /*
-    read the flv file thoroughly to get all necessary information.
-
-    we need to check :
-    - timestamp of first audio for audio delay
-    - whether we have audio and video
-    - first frames codecs (audio, video)
-    - total audio and video data sizes
-    - keyframe offsets and timestamps
-    - whether the last video frame is a keyframe
-    - last keyframe timestamp
-    - onMetaData tag total size
-    - total tags size
-    - first tag after onMetaData offset
-    - last timestamp
-    - real video data size, number of frames, duration to compute framerate and video data rate
-    - real audio data size, duration to compute audio data rate
-    - video headers to find width and height. (depends on the encoding)
+    reset the information accumulator
 */
-int get_flv_info(flv_stream * flv_in, flv_info * info, const flvmeta_opts * opts) {
-    uint32 prev_timestamp_video;
-    uint32 prev_timestamp_audio;
-    uint32 prev_timestamp_meta;
-    uint8 timestamp_extended_video;
-    uint8 timestamp_extended_audio;
-    uint8 timestamp_extended_meta;
-    uint8 have_video_size;
-    uint8 have_first_timestamp;
-    uint32 tag_number;
-    int result;
-    flv_tag ft;
-
+void flv_info_reset(flv_info * info) {
     info->have_video = 0;
     info->have_audio = 0;
     info->video_width = 0;
@@ -226,25 +203,9 @@ int get_flv_info(flv_stream * flv_in, flv_info * info, const flvmeta_opts * opts
     info->last_timestamp = 0;
     info->video_frame_duration = 0;
     info->audio_frame_duration = 0;
-    info->total_prev_tags_size = 0;
     info->have_on_last_second = 0;
     info->last_media_frame_type = 0;
     info->original_on_metadata = NULL;
-    info->keyframes = NULL;
-    info->times = NULL;
-    info->filepositions = NULL;
-
-    if (opts->verbose) {
-        fprintf(stdout, "Parsing %s...\n", opts->input_file);
-    }
-
-    /*
-        read FLV header
-    */
-
-    if (flv_read_header(flv_in, &(info->header)) != FLV_OK) {
-        return ERROR_NO_FLV;
-    }
 
     info->keyframes = amf_object_new();
     info->times = amf_array_new();
@@ -256,76 +217,296 @@ int get_flv_info(flv_stream * flv_in, flv_info * info, const flvmeta_opts * opts
     info->total_prev_tags_size = sizeof(uint32_be);
 
     /* first timestamp */
-    have_first_timestamp = 0;
+    info->have_first_timestamp = 0;
 
     /* extended timestamp initialization */
-    prev_timestamp_video = 0;
-    prev_timestamp_audio = 0;
-    prev_timestamp_meta = 0;
-    timestamp_extended_video = 0;
-    timestamp_extended_audio = 0;
-    timestamp_extended_meta = 0;
-    tag_number = 0;
-    have_video_size = 0;
+    info->prev_timestamp_video = 0;
+    info->prev_timestamp_audio = 0;
+    info->prev_timestamp_meta = 0;
+    info->timestamp_extended_video = 0;
+    info->timestamp_extended_audio = 0;
+    info->timestamp_extended_meta = 0;
+    info->tag_number = 0;
+    info->have_video_size = 0;
+
+    info->tag_offset = 0;
+    info->tag_body_length = 0;
+    info->tag_timestamp = 0;
+}
 
-    while (flv_read_tag(flv_in, &ft) == FLV_OK) {
-        file_offset_t offset;
-        uint32 body_length;
-        uint32 timestamp;
+/*
+    account for a tag header, and fix its timestamp
+    the corrected timestamp is available in info->tag_timestamp
+*/
+int flv_info_add_tag(flv_info * info, const flv_tag * tag, file_offset_t offset, const flvmeta_opts * opts) {
+    uint32 body_length;
+    uint32 timestamp;
 
-        offset = flv_get_current_tag_offset(flv_in);
-        body_length = flv_tag_get_body_length(ft);
-        timestamp = flv_tag_get_timestamp(ft);
+    body_length = flv_tag_get_body_length(*tag);
+    timestamp = flv_tag_get_timestamp(*tag);
 
-        /* extended timestamp fixing */
-        if (ft.type == FLV_TAG_TYPE_META) {
-            if (timestamp < prev_timestamp_meta
-            && prev_timestamp_meta - timestamp > 0xF00000) {
-                ++timestamp_extended_meta;
-            }
-            prev_timestamp_meta = timestamp;
-            if (timestamp_extended_meta > 0) {
-                timestamp += timestamp_extended_meta << 24;
+    ++info->tag_number;
+
+    /* extended timestamp fixing */
+    if (tag->type == FLV_TAG_TYPE_META) {
+        timestamp = flv_fix_extended_timestamp(timestamp, &info->prev_timestamp_meta, &info->timestamp_extended_meta);
+    }
+    else if (tag->type == FLV_TAG_TYPE_AUDIO) {
+        timestamp = flv_fix_extended_timestamp(timestamp, &info->prev_timestamp_audio, &info->timestamp_extended_audio);
+    }
+    else if (tag->type == FLV_TAG_TYPE_VIDEO) {
+        timestamp = flv_fix_extended_timestamp(timestamp, &info->prev_timestamp_video, &info->timestamp_extended_video);
+    }
+
+    /* non-zero starting timestamp handling */
+    if (!info->have_first_timestamp && tag->type != FLV_TAG_TYPE_META) {
+        info->first_timestamp = timestamp;
+        info->have_first_timestamp = 1;
+    }
+    if (opts->reset_timestamps && timestamp > 0) {
+        timestamp -= info->first_timestamp;
+    }
+
+    info->tag_offset = offset;
+    info->tag_body_length = body_length;
+    info->tag_timestamp = timestamp;
+
+    /* update the info struct only if the tag is valid */
+    if (tag->type == FLV_TAG_TYPE_META
+    || tag->type == FLV_TAG_TYPE_AUDIO
+    || tag->type == FLV_TAG_TYPE_VIDEO) {
+        if (info->biggest_tag_body_size < body_length) {
+            info->biggest_tag_body_size = body_length;
+        }
+        info->last_timestamp = timestamp;
+    }
+    else {
+        if (opts->error_handling == FLVMETA_FIX_ERRORS) {
+            /* TODO : fix errors if possible */
+        }
+        else if (opts->error_handling == FLVMETA_IGNORE_ERRORS) {
+            /* let's continue the parsing */
+            if (opts->verbose) {
+                fprintf(stdout, "Warning: invalid tag at 0x%" FILE_OFFSET_PRINTF_FORMAT "X\n", offset);
             }
+            info->total_prev_tags_size += sizeof(uint32_be);
         }
-        else if (ft.type == FLV_TAG_TYPE_AUDIO) {
-            if (timestamp < prev_timestamp_audio
-            && prev_timestamp_audio - timestamp > 0xF00000) {
-                ++timestamp_extended_audio;
+        else {
+            return ERROR_INVALID_TAG;
+        }
+    }
+
+    return OK;
+}
+
+/*
+    account for the current script data tag
+    name is NULL if the tag body is empty,
+    *data is set to NULL if the accumulator keeps it
+*/
+void flv_info_add_metadata(flv_info * info, amf_data * name, amf_data ** data, const flvmeta_opts * opts) {
+    uint32 body_length = info->tag_body_length;
+
+    if (body_length == 0) {
+        if (opts->verbose) {
+            fprintf(stdout, "Warning: empty metadata tag at 0x%" FILE_OFFSET_PRINTF_FORMAT "X\n", info->tag_offset);
+        }
+    }
+
+    /* check metadata name */
+    if (body_length > 0 && amf_data_get_type(name) == AMF_TYPE_STRING) {
+        char * str = (char *)amf_string_get_bytes(name);
+        size_t len = (size_t)amf_string_get_size(name);
+
+        /* get info only on the first onMetaData we read */
+        if (info->on_metadata_size == 0 && !strncmp(str, "onMetaData", len)) {
+            info->on_metadata_size = body_length + FLV_TAG_SIZE + sizeof(uint32_be);
+            info->on_metadata_offset = info->tag_offset;
+
+            /* if we want to preserve existing metadata, then extract them */
+            if (opts->preserve_metadata == 1) {
+                /* we need an AMF associative array here, so we must
+                   discard errors and mis-typed data */
+                if (amf_data_get_error_code(*data) != AMF_ERROR_OK
+                || amf_data_get_type(*data) != AMF_TYPE_ASSOCIATIVE_ARRAY) {
+                    amf_data_free(*data);
+                    *data = amf_associative_array_new();
+                }
+
+                info->original_on_metadata = *data;
+                *data = NULL;
             }
-            prev_timestamp_audio = timestamp;
-            if (timestamp_extended_audio > 0) {
-                timestamp += timestamp_extended_audio << 24;
+        }
+        else {
+            if (!strncmp(str, "onLastSecond", len)) {
+                info->have_on_last_second = 1;
             }
+            info->meta_data_size += (body_length + FLV_TAG_SIZE);
+            info->total_prev_tags_size += sizeof(uint32_be);
         }
-        else if (ft.type == FLV_TAG_TYPE_VIDEO) {
-            if (timestamp < prev_timestamp_video
-            && prev_timestamp_video - timestamp > 0xF00000) {
-                ++timestamp_extended_video;
+    }
+    /* just ignore metadata that don't have a proper name */
+    else {
+        info->meta_data_size += (body_length + FLV_TAG_SIZE);
+        info->total_prev_tags_size += sizeof(uint32_be);
+    }
+}
+
+/*
+    account for the current video tag
+    vt is NULL if the tag body is empty, otherwise the stream
+    must be positioned right after the video tag header
+*/
+int flv_info_add_video_tag(flv_info * info, flv_stream * flv_in, const flv_video_tag * vt, const flvmeta_opts * opts) {
+    uint32 body_length = info->tag_body_length;
+    uint32 timestamp = info->tag_timestamp;
+    int result;
+
+    /* do not take video frame into account if body length is zero and we ignore errors */
+    if (vt == NULL) {
+        if (opts->verbose) {
+            fprintf(stdout, "Warning: empty video tag at 0x%" FILE_OFFSET_PRINTF_FORMAT "X\n", info->tag_offset);
+        }
+    }
+    else {
+        if (info->have_video != 1) {
+            info->have_video = 1;
+            info->video_codec = flv_video_tag_codec_id(*vt);
+            info->video_first_timestamp = timestamp;
+        }
+
+        if (info->have_video_size != 1
+        && flv_video_tag_frame_type(*vt) == FLV_VIDEO_TAG_FRAME_TYPE_KEYFRAME) {
+            /* read first video frame to get critical info */
+            result = compute_video_size(flv_in, info, body_length - sizeof(flv_video_tag));
+            if (result != FLV_OK) {
+                return result;
             }
-            prev_timestamp_video = timestamp;
-            if (timestamp_extended_video > 0) {
-                timestamp += timestamp_extended_video << 24;
+
+            if (info->video_width > 0 && info->video_height > 0) {
+                info->have_video_size = 1;
             }
+            /* if we cannot fetch that information from the first tag, we'll try
+               for each following video key frame */
         }
 
-        /* non-zero starting timestamp handling */
-        if (!have_first_timestamp && ft.type != FLV_TAG_TYPE_META) {
-            info->first_timestamp = timestamp;
-            have_first_timestamp = 1;
+        /* add keyframe to list */
+        if (flv_video_tag_frame_type(*vt) == FLV_VIDEO_TAG_FRAME_TYPE_KEYFRAME) {
+            /* do not add keyframe if the previous one has the same timestamp */
+            if (!info->have_keyframes
+            || (info->have_keyframes && info->last_keyframe_timestamp != timestamp)
+            || opts->all_keyframes) {
+                info->have_keyframes = 1;
+                info->last_keyframe_timestamp = timestamp;
+                amf_array_push(info->times, amf_number_new(timestamp / 1000.0));
+                amf_array_push(info->filepositions, amf_number_new((number64)info->tag_offset));
+            }
+            /* is last frame a key frame ? if so, we can seek to end */
+            info->can_seek_to_end = 1;
         }
-        if (opts->reset_timestamps && timestamp > 0) {
-            timestamp -= info->first_timestamp;
+        else {
+            info->can_seek_to_end = 0;
         }
 
-        /* update the info struct only if the tag is valid */
-        if (ft.type == FLV_TAG_TYPE_META
-        || ft.type == FLV_TAG_TYPE_AUDIO
-        || ft.type == FLV_TAG_TYPE_VIDEO) {
-            if (info->biggest_tag_body_size < body_length) {
-                info->biggest_tag_body_size = body_length;
-            }
-            info->last_timestamp = timestamp;
+        info->real_video_data_size += (body_length - 1);
+    }
+
+    info->video_frames_number++;
+
+    /*
+        we assume all video frames have the same size as the first one
+    */
+    if (info->video_frame_duration == 0) {
+        info->video_frame_duration = timestamp - info->video_first_timestamp;
+    }
+
+    info->last_media_frame_type = FLV_TAG_TYPE_VIDEO;
+
+    info->video_data_size += (body_length + FLV_TAG_SIZE);
+    info->total_prev_tags_size += sizeof(uint32_be);
+
+    return FLV_OK;
+}
+
+/*
+    account for the current audio tag
+    at is NULL if the tag body is empty
+*/
+void flv_info_add_audio_tag(flv_info * info, const flv_audio_tag * at, const flvmeta_opts * opts) {
+    uint32 body_length = info->tag_body_length;
+    uint32 timestamp = info->tag_timestamp;
+
+    /* do not take audio frame into account if body length is zero and we ignore errors */
+    if (at == NULL) {
+        if (opts->verbose) {
+            fprintf(stdout, "Warning: empty audio tag at 0x%" FILE_OFFSET_PRINTF_FORMAT "X\n", info->tag_offset);
+        }
+    }
+    else {
+        if (info->have_audio != 1) {
+            info->have_audio = 1;
+            info->audio_codec = flv_audio_tag_sound_format(*at);
+            info->audio_rate = flv_audio_tag_sound_rate(*at);
+            info->audio_size = flv_audio_tag_sound_size(*at);
+            info->audio_stereo = flv_audio_tag_sound_type(*at);
+            info->audio_first_timestamp = timestamp;
+        }
+        /* we assume all audio frames have the same size as the first one */
+        if (info->audio_frame_duration == 0) {
+            info->audio_frame_duration = timestamp - info->audio_first_timestamp;
+        }
+
+        info->real_audio_data_size += (body_length - 1);
+    }
+
+    info->last_media_frame_type = FLV_TAG_TYPE_AUDIO;
+
+    info->audio_data_size += (body_length + FLV_TAG_SIZE);
+    info->total_prev_tags_size += sizeof(uint32_be);
+}
+
+/*
+    read the flv file thoroughly to get all necessary information.
+
+    we need to check :
+    - timestamp of first audio for audio delay
+    - whether we have audio and video
+    - first frames codecs (audio, video)
+    - total audio and video data sizes
+    - keyframe offsets and timestamps
+    - whether the last video frame is a keyframe
+    - last keyframe timestamp
+    - onMetaData tag total size
+    - total tags size
+    - first tag after onMetaData offset
+    - last timestamp
+    - real video data size, number of frames, duration to compute framerate and video data rate
+    - real audio data size, duration to compute audio data rate
+    - video headers to find width and height. (depends on the encoding)
+*/
+int get_flv_info(flv_stream * flv_in, flv_info * info, const flvmeta_opts * opts) {
+    int result;
+    flv_tag ft;
+
+    flv_info_reset(info);
+
+    if (opts->verbose) {
+        fprintf(stdout, "Parsing %s...\n", opts->input_file);
+    }
+
+    /*
+        read FLV header
+    */
+
+    if (input_read_header(opts, flv_in, &(info->header)) != FLV_OK) {
+        return ERROR_NO_FLV;
+    }
+
+    while (flv_read_tag(flv_in, &ft) == FLV_OK) {
+        input_tag(opts, flv_in, &ft);
+        result = flv_info_add_tag(info, &ft, flv_get_current_tag_offset(flv_in), opts);
+        if (result != OK) {
+            return result;
         }
 
         if (ft.type == FLV_TAG_TYPE_META) {
@@ -333,12 +514,7 @@ int get_flv_info(flv_stream * flv_in, flv_info * info, const flvmeta_opts * opts
             int retval;
             tag_name = data = NULL;
 
-            if (body_length == 0) {
-                if (opts->verbose) {
-                    fprintf(stdout, "Warning: empty metadata tag at 0x%" FILE_OFFSET_PRINTF_FORMAT "X\n", offset);
-                }
-            }
-            else {
+            if (info->tag_body_length > 0) {
                 retval = flv_read_metadata(flv_in, &tag_name, &data);
                 if (retval == FLV_ERROR_EOF) {
                     amf_data_free(tag_name);
@@ -347,12 +523,12 @@ int get_flv_info(flv_stream * flv_in, flv_info * info, const flvmeta_opts * opts
                 }
                 else if (retval == FLV_ERROR_INVALID_METADATA_NAME) {
                     if (opts->verbose) {
-                        fprintf(stdout, "Warning: invalid metadata name at 0x%" FILE_OFFSET_PRINTF_FORMAT "X\n", offset);
+                        fprintf(stdout, "Warning: invalid metadata name at 0x%" FILE_OFFSET_PRINTF_FORMAT "X\n", info->tag_offset);
                     }
                 }
                 else if (retval == FLV_ERROR_INVALID_METADATA) {
                     if (opts->verbose) {
-                        fprintf(stdout, "Warning: invalid metadata at 0x%" FILE_OFFSET_PRINTF_FORMAT "X\n", offset);
+                        fprintf(stdout, "Warning: invalid metadata at 0x%" FILE_OFFSET_PRINTF_FORMAT "X\n", info->tag_offset);
                     }
                     if (opts->error_handling == FLVMETA_EXIT_ON_ERROR) {
                         amf_data_free(tag_name);
@@ -362,176 +538,247 @@ int get_flv_info(flv_stream * flv_in, flv_info * info, const flvmeta_opts * opts
                 }
             }
 
-            /* check metadata name */
-            if (body_length > 0 && amf_data_get_type(tag_name) == AMF_TYPE_STRING) {
-                char * name = (char *)amf_string_get_bytes(tag_name);
-                size_t len = (size_t)amf_string_get_size(tag_name);
-
-                /* get info only on the first onMetaData we read */
-                if (info->on_metadata_size == 0 && !strncmp(name, "onMetaData", len)) {
-                    info->on_metadata_size = body_length + FLV_TAG_SIZE + sizeof(uint32_be);
-                    info->on_metadata_offset = offset;
-
-                    /* if we want to preserve existing metadata, then extract them */
-                    if (opts->preserve_metadata == 1) {
-                        /* we need an AMF associative array here, so we must
-                           discard errors and mis-typed data */
-                        if (amf_data_get_error_code(data) != AMF_ERROR_OK
-                        || amf_data_get_type(data) != AMF_TYPE_ASSOCIATIVE_ARRAY) {
-                            amf_data_free(data);
-                            data = amf_associative_array_new();
-                        }
-
-                        info->original_on_metadata = data;
-                    }
-                    else {
-                        amf_data_free(data);
-                    }
-                }
-                else {
-                    if (!strncmp(name, "onLastSecond", len)) {
-                        info->have_on_last_second = 1;
-                    }
-                    info->meta_data_size += (body_length + FLV_TAG_SIZE);
-                    info->total_prev_tags_size += sizeof(uint32_be);
-                    if (data != NULL) {
-                        amf_data_free(data);
-                    }
-                }
-            }
-            /* just ignore metadata that don't have a proper name */
-            else {
-                info->meta_data_size += (body_length + FLV_TAG_SIZE);
-                info->total_prev_tags_size += sizeof(uint32_be);
-                amf_data_free(data);
-            }
+            flv_info_add_metadata(info, tag_name, &data, opts);
             amf_data_free(tag_name);
+            amf_data_free(data);
         }
         else if (ft.type == FLV_TAG_TYPE_VIDEO) {
             flv_video_tag vt;
 
-            /* do not take video frame into account if body length is zero and we ignore errors */
-            if (body_length == 0) {
-                if (opts->verbose) {
-                    fprintf(stdout, "Warning: empty video tag at 0x%" FILE_OFFSET_PRINTF_FORMAT "X\n", offset);
-                }
+            if (info->tag_body_length == 0) {
+                result = flv_info_add_video_tag(info, flv_in, NULL, opts);
             }
             else {
                 if (flv_read_video_tag(flv_in, &vt) != FLV_OK) {
                     return ERROR_EOF;
                 }
+                result = flv_info_add_video_tag(info, flv_in, &vt, opts);
+            }
+            if (result != FLV_OK) {
+                return result;
+            }
+        }
+        else if (ft.type == FLV_TAG_TYPE_AUDIO) {
+            flv_audio_tag at;
 
-                if (info->have_video != 1) {
-                    info->have_video = 1;
-                    info->video_codec = flv_video_tag_codec_id(vt);
-                    info->video_first_timestamp = timestamp;
+            if (info->tag_body_length == 0) {
+                flv_info_add_audio_tag(info, NULL, opts);
+            }
+            else {
+                if (flv_read_audio_tag(flv_in, &at) != FLV_OK) {
+                    return ERROR_EOF;
                 }
+                flv_info_add_audio_tag(info, &at, opts);
+            }
+        }
+    }
 
-                if (have_video_size != 1
-                && flv_video_tag_frame_type(vt) == FLV_VIDEO_TAG_FRAME_TYPE_KEYFRAME) {
-                    /* read first video frame to get critical info */
-                    result = compute_video_size(flv_in, info, body_length - sizeof(flv_video_tag));
-                    if (result != FLV_OK) {
-                        return result;
-                    }
+    if (opts->verbose) {
+        fprintf(stdout, "Found %d tags\n", info->tag_number);
+    }
 
-                    if (info->video_width > 0 && info->video_height > 0) {
-                        have_video_size = 1;
-                    }
-                    /* if we cannot fetch that information from the first tag, we'll try
-                       for each following video key frame */
-                }
+    return OK;
+}
 
-                /* add keyframe to list */
-                if (flv_video_tag_frame_type(vt) == FLV_VIDEO_TAG_FRAME_TYPE_KEYFRAME) {
-                    /* do not add keyframe if the previous one has the same timestamp */
-                    if (!info->have_keyframes
-                    || (info->have_keyframes && info->last_keyframe_timestamp != timestamp)
-                    || opts->all_keyframes) {
-                        info->have_keyframes = 1;
-                        info->last_keyframe_timestamp = timestamp;
-                        amf_array_push(info->times, amf_number_new(timestamp / 1000.0));
-                        amf_array_push(info->filepositions, amf_number_new((number64)offset));
-                    }
-                    /* is last frame a key frame ? if so, we can seek to end */
-                    info->can_seek_to_end = 1;
-                }
-                else {
-                    info->can_seek_to_end = 0;
-                }
+/* maximum number of tags read from the end of the file */
+#define MAX_TAIL_TAGS 64
 
-                info->real_video_data_size += (body_length - 1);    
-            }
+/* maximum number of tags read from the start of the file to find the first timestamp */
+#define MAX_HEAD_TAGS 16
 
-            info->video_frames_number++;
+/*
+    account for a tag found while reading the end of the file,
+    either backwards or forwards
+*/
+static void tail_info_add_tag(flv_tail_info * tail, const flv_tag * tag, int backwards) {
+    uint32 timestamp = flv_tag_get_timestamp(*tag);
+    uint32 * last, * duration;
+    uint8 * have;
 
-            /*
-                we assume all video frames have the same size as the first one
-            */
-            if (info->video_frame_duration == 0) {
-                info->video_frame_duration = timestamp - info->video_first_timestamp;
-            }
+    ++tail->tags_read;
 
-            info->last_media_frame_type = FLV_TAG_TYPE_VIDEO;
+    if (tag->type == FLV_TAG_TYPE_VIDEO) {
+        have = &tail->have_video;
+        last = &tail->last_video_timestamp;
+        duration = &tail->video_frame_duration;
+    }
+    else if (tag->type == FLV_TAG_TYPE_AUDIO) {
+        have = &tail->have_audio;
+        last = &tail->last_audio_timestamp;
+        duration = &tail->audio_frame_duration;
+    }
+    else {
+        if (!backwards || tail->tags_read == 1) {
+            tail->last_timestamp = timestamp;
+        }
+        return;
+    }
 
-            info->video_data_size += (body_length + FLV_TAG_SIZE);
-            info->total_prev_tags_size += sizeof(uint32_be);
+    if (backwards) {
+        /* the first tag met is the last one of the file */
+        if (tail->tags_read == 1) {
+            tail->last_timestamp = timestamp;
         }
-        else if (ft.type == FLV_TAG_TYPE_AUDIO) {
-            flv_audio_tag at;
+        if (tail->last_media_frame_type == 0) {
+            tail->last_media_frame_type = tag->type;
+        }
+        if (!*have) {
+            *have = 1;
+            *last = timestamp;
+        }
+        else if (*duration == 0 && *last > timestamp) {
+            *duration = *last - timestamp;
+        }
+    }
+    else {
+        tail->last_timestamp = timestamp;
+        tail->last_media_frame_type = tag->type;
+        if (*have && timestamp > *last) {
+            *duration = timestamp - *last;
+        }
+        *have = 1;
+        *last = timestamp;
+    }
+}
 
-            /* do not take audio frame into account if body length is zero and we ignore errors */
-            if (body_length == 0) {
-                if (opts->verbose) {
-                    fprintf(stdout, "Warning: empty audio tag at 0x%" FILE_OFFSET_PRINTF_FORMAT "X\n", offset);
-                }
-            }
-            else {
-                if (flv_read_audio_tag(flv_in, &at) != FLV_OK) {
-                    return ERROR_EOF;
-                }
-            
-                if (info->have_audio != 1) {
-                    info->have_audio = 1;
-                    info->audio_codec = flv_audio_tag_sound_format(at);
-                    info->audio_rate = flv_audio_tag_sound_rate(at);
-                    info->audio_size = flv_audio_tag_sound_size(at);
-                    info->audio_stereo = flv_audio_tag_sound_type(at);
-                    info->audio_first_timestamp = timestamp;
-                }
-                /* we assume all audio frames have the same size as the first one */
-                if (info->audio_frame_duration == 0) {
-                    info->audio_frame_duration = timestamp - info->audio_first_timestamp;
-                }
+/*
+    walk the file backwards from its end using previous tag sizes,
+    returns 0 if the chain is broken before enough tags could be read
+*/
+static int tail_info_walk_backwards(flv_stream * flv_in, flv_tail_info * tail, uint8 want_video, uint8 want_audio) {
+    file_offset_t offset;
+    uint32 prev_tag_size;
+    flv_tag tag;
+
+    offset = tail->filesize - sizeof(uint32_be);
+    while (tail->tags_read < MAX_TAIL_TAGS && offset > (file_offset_t)(FLV_HEADER_SIZE + sizeof(uint32_be))) {
+        if (flv_seek_prev_tag_size(flv_in, offset) != FLV_OK
+        || flv_read_prev_tag_size(flv_in, &prev_tag_size) != FLV_OK) {
+            return 0;
+        }
 
-                info->real_audio_data_size += (body_length - 1);
-            }
-            
-            info->last_media_frame_type = FLV_TAG_TYPE_AUDIO;
+        /* the previous tag size must designate a valid tag */
+        if (prev_tag_size < FLV_TAG_SIZE
+        || prev_tag_size > offset - FLV_HEADER_SIZE - sizeof(uint32_be)
+        || flv_seek_tag(flv_in, offset - prev_tag_size) != FLV_OK
+        || flv_read_tag(flv_in, &tag) != FLV_OK
+        || (tag.type != FLV_TAG_TYPE_AUDIO && tag.type != FLV_TAG_TYPE_VIDEO && tag.type != FLV_TAG_TYPE_META)
+        || flv_tag_get_body_length(tag) + FLV_TAG_SIZE != prev_tag_size) {
+            return 0;
+        }
 
-            info->audio_data_size += (body_length + FLV_TAG_SIZE);
-            info->total_prev_tags_size += sizeof(uint32_be);
+        tail_info_add_tag(tail, &tag, 1);
+
+        /* stop as soon as frame durations are known for the expected streams */
+        if ((!want_video || tail->video_frame_duration > 0)
+        && (!want_audio || tail->audio_frame_duration > 0)) {
+            break;
         }
-        else {
-            if (opts->error_handling == FLVMETA_FIX_ERRORS) {
-                /* TODO : fix errors if possible */
-            }
-            else if (opts->error_handling == FLVMETA_IGNORE_ERRORS) {
-                /* let's continue the parsing */
-                if (opts->verbose) {
-                    fprintf(stdout, "Warning: invalid tag at 0x%" FILE_OFFSET_PRINTF_FORMAT "X\n", offset);
-                }
-                info->total_prev_tags_size += sizeof(uint32_be);
-            }
-            else {
-                return ERROR_INVALID_TAG;
-            }
+
+        offset -= prev_tag_size + sizeof(uint32_be);
+    }
+
+    return 1;
+}
+
+/*
+    read the whole file forwards, skipping tag bodies, to find
+    the last complete tag
+*/
+static void tail_info_scan_forwards(flv_stream * flv_in, flv_tail_info * tail) {
+    file_offset_t offset;
+    flv_tag tag;
+
+    tail->have_video = 0;
+    tail->have_audio = 0;
+    tail->last_timestamp = 0;
+    tail->last_video_timestamp = 0;
+    tail->last_audio_timestamp = 0;
+    tail->video_frame_duration = 0;
+    tail->audio_frame_duration = 0;
+    tail->last_media_frame_type = 0;
+    tail->tags_read = 0;
+
+    offset = FLV_HEADER_SIZE + sizeof(uint32_be);
+    tail->valid_size = offset;
+
+    flv_seek_tag(flv_in, offset);
+    while (flv_read_tag(flv_in, &tag) == FLV_OK) {
+        offset += FLV_TAG_SIZE + flv_tag_get_body_length(tag) + sizeof(uint32_be);
+
+        /* stop at garbage or at an incomplete tag */
+        if ((tag.type != FLV_TAG_TYPE_AUDIO && tag.type != FLV_TAG_TYPE_VIDEO && tag.type != FLV_TAG_TYPE_META)
+        || offset > tail->filesize) {
+            break;
         }
-        ++tag_number;
+
+        tail_info_add_tag(tail, &tag, 0);
+        tail->valid_size = offset;
     }
+}
 
-    if (opts->verbose) {
-        fprintf(stdout, "Found %d tags\n", tag_number);
+/*
+    duration from the first timestamp to the end of the last frame,
+    unwrapping 24-bit timestamps which went past 0xFFFFFF without
+    using the extended byte, as flv_fix_extended_timestamp does
+*/
+static number64 tail_info_duration(uint32 first_timestamp, uint32 last_timestamp, uint32 frame_duration) {
+    number64 elapsed;
+
+    elapsed = (number64)last_timestamp - (number64)first_timestamp;
+    if (last_timestamp < first_timestamp && first_timestamp - last_timestamp > 0xF00000) {
+        elapsed += 0x1000000;
+    }
+    /* last tags out of order with the first one */
+    if (elapsed < 0) {
+        elapsed = 0;
+    }
+    return (elapsed + frame_duration) / 1000.0;
+}
+
+/*
+    get information about the end of the file without reading it entirely:
+    the last tags are read backwards thanks to the previous tag sizes,
+    and a forward scan is only performed if that chain is broken.
+    the stream header must have been read and validated by the caller.
+*/
+int get_flv_tail_info(flv_stream * flv_in, file_offset_t filesize, flv_tail_info * tail) {
+    flv_header header;
+    flv_tag tag;
+    uint32 head_tags;
+
+    memset(tail, 0, sizeof(flv_tail_info));
+    tail->filesize = filesize;
+    tail->valid_size = filesize;
+
+    /* read the header again, to know which streams to look for */
+    flv_reset(flv_in);
+    if (flv_read_header(flv_in, &header) != FLV_OK) {
+        return ERROR_NO_FLV;
+    }
+
+    /* first timestamp, from the first audio or video tag */
+    head_tags = 0;
+    while (head_tags < MAX_HEAD_TAGS && flv_read_tag(flv_in, &tag) == FLV_OK) {
+        if (tag.type == FLV_TAG_TYPE_AUDIO || tag.type == FLV_TAG_TYPE_VIDEO) {
+            tail->first_timestamp = flv_tag_get_timestamp(tag);
+            break;
+        }
+        ++head_tags;
+    }
+
+    if (!tail_info_walk_backwards(flv_in, tail, flv_header_has_video(header), flv_header_has_audio(header))) {
+        tail->forward_scan = 1;
+        tail_info_scan_forwards(flv_in, tail);
+    }
+
+    tail->truncated = (tail->valid_size < tail->filesize);
+
+    if (tail->last_media_frame_type == FLV_TAG_TYPE_AUDIO) {
+        tail->duration = tail_info_duration(tail->first_timestamp, tail->last_audio_timestamp, tail->audio_frame_duration);
+    }
+    else if (tail->last_media_frame_type == FLV_TAG_TYPE_VIDEO) {
+        tail->duration = tail_info_duration(tail->first_timestamp, tail->last_video_timestamp, tail->video_frame_duration);
     }
 
     return OK;
@@ -557,11 +804,12 @@ void compute_metadata(flv_info * info, flv_metadata * meta, const flvmeta_opts *
     meta->on_last_second = amf_associative_array_new();
     meta->on_metadata_name = amf_str("onMetaData");
 
+    /* user-defined metadata is copied, so the options can be reused */
     if (opts->metadata == NULL) {
         meta->on_metadata = amf_associative_array_new();
     }
     else {
-        meta->on_metadata = opts->metadata;
+        meta->on_metadata = amf_data_clone(opts->metadata);
     }
 
     amf_associative_array_add(meta->on_metadata, "hasMetadata", amf_boolean_new(1));
@@ -655,6 +903,8 @@ void compute_metadata(flv_info * info, flv_metadata * meta, const flvmeta_opts *
     }
     amf_associative_array_add(meta->on_metadata, "hasKeyframes", amf_boolean_new(info->have_keyframes));
     amf_associative_array_add(meta->on_metadata, "keyframes", info->keyframes);
+    /* the keyframes index now belongs to onMetaData */
+    info->keyframes = NULL;
 
     /* merge metadata from input file if we specified the preserve option */
     if (opts->preserve_metadata) {
@@ -717,3 +967,25 @@ void compute_metadata(flv_info * info, flv_metadata * meta, const flvmeta_opts *
 
     amf_number_set_value(amf_total_filesize, (number64)total_filesize);
 }
+
+/* release the data owned by the information */
+void flv_info_free(flv_info * info) {
+    amf_data_free(info->keyframes);
+    info->keyframes = NULL;
+    info->times = NULL;
+    info->filepositions = NULL;
+    amf_data_free(info->original_on_metadata);
+    info->original_on_metadata = NULL;
+}
+
+/* release computed metadata */
+void flv_metadata_free(flv_metadata * meta) {
+    amf_data_free(meta->on_last_second_name);
+    amf_data_free(meta->on_last_second);
+    amf_data_free(meta->on_metadata_name);
+    amf_data_free(meta->on_metadata);
+    meta->on_last_second_name = NULL;
+    meta->on_last_second = NULL;
+    meta->on_metadata_name = NULL;
+    meta->on_metadata = NULL;
+}
@@ -60,8 +60,40 @@ typedef struct __flv_info {
     amf_data * keyframes;
     amf_data * times;
     amf_data * filepositions;
+    /* accumulator state */
+    uint32 prev_timestamp_video;
+    uint32 prev_timestamp_audio;
+    uint32 prev_timestamp_meta;
+    uint8 timestamp_extended_video;
+    uint8 timestamp_extended_audio;
+    uint8 timestamp_extended_meta;
+    uint8 have_video_size;
+    uint8 have_first_timestamp;
+    uint32 tag_number;
+    file_offset_t tag_offset;
+    uint32 tag_body_length;
+    uint32 tag_timestamp;
 } flv_info;
 
+/* information gathered from the end of the file */
+typedef struct __flv_tail_info {
+    file_offset_t filesize;
+    file_offset_t valid_size;
+    uint8 truncated;
+    uint8 forward_scan;
+    uint8 have_video;
+    uint8 have_audio;
+    uint32 first_timestamp;
+    uint32 last_timestamp;
+    uint32 last_video_timestamp;
+    uint32 last_audio_timestamp;
+    uint32 video_frame_duration;
+    uint32 audio_frame_duration;
+    uint8 last_media_frame_type;
+    number64 duration;
+    uint32 tags_read;
+} flv_tail_info;
+
 typedef struct __flv_metadata {
     amf_data * on_last_second_name;
     amf_data * on_last_second;
@@ -73,12 +105,33 @@ typedef struct __flv_metadata {
 extern "C" {
 #endif /* __cplusplus */
 
+/*
+    incremental information gathering: reset the accumulator, then feed it
+    each tag header, followed by the matching body observation
+*/
+void flv_info_reset(flv_info * info);
+
+int flv_info_add_tag(flv_info * info, const flv_tag * tag, file_offset_t offset, const flvmeta_opts * opts);
+
+void flv_info_add_metadata(flv_info * info, amf_data * name, amf_data ** data, const flvmeta_opts * opts);
+
+int flv_info_add_video_tag(flv_info * info, flv_stream * flv_in, const flv_video_tag * vt, const flvmeta_opts * opts);
+
+void flv_info_add_audio_tag(flv_info * info, const flv_audio_tag * at, const flvmeta_opts * opts);
+
 int get_flv_info(flv_stream * flv_in, flv_info * info, const flvmeta_opts * opts);
 
+int get_flv_tail_info(flv_stream * flv_in, file_offset_t filesize, flv_tail_info * tail);
+
 void compute_metadata(flv_info * info, flv_metadata * meta, const flvmeta_opts * opts);
 
 void compute_current_metadata(flv_info * info, flv_metadata * meta);
 
+/* release the data owned by the information, once metadata have been computed or not */
+void flv_info_free(flv_info * info);
+
+void flv_metadata_free(flv_metadata * meta);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
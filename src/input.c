@@ -0,0 +1,125 @@
+/*
+    FLVMeta - FLV Metadata Editor
+
+    Copyright (C) 2007-2014 Marc Noirot <marc.noirot AT gmail.com>
+
+    This file is part of FLVMeta.
+
+    FLVMeta is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    FLVMeta is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FLVMeta; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+#include "input.h"
+#include "progress.h"
+#include "trace.h"
+
+/* the trace file is opened by the flvmeta command itself */
+#define input_traced(opts)  ((opts)->trace_file != NULL)
+
+/*
+    parser whose tags are reported before being handed to the original
+    callback, the other callbacks see the original user data and stream
+*/
+typedef struct __input_parser {
+    flv_parser parser;
+    const flvmeta_opts * opts;
+    int (* on_tag)(flv_tag * tag, flv_parser * parser);
+} input_parser;
+
+flv_stream * input_open(const flvmeta_opts * opts, const char * filename) {
+    flv_stream * flv_in;
+
+    if (input_traced(opts)) {
+        trace_begin("open", filename);
+    }
+    flv_in = flv_open(filename);
+    if (input_traced(opts)) {
+        trace_end();
+    }
+
+    if (flv_in != NULL && opts->progress) {
+        progress_open(filename);
+    }
+    return flv_in;
+}
+
+int input_read_header(const flvmeta_opts * opts, flv_stream * flv_in, flv_header * header) {
+    int result;
+
+    if (input_traced(opts)) {
+        trace_begin("read header", NULL);
+    }
+    result = flv_read_header(flv_in, header);
+    if (input_traced(opts)) {
+        trace_end();
+    }
+    return result;
+}
+
+void input_rewind(const flvmeta_opts * opts, flv_stream * flv_in) {
+    flv_reset(flv_in);
+    if (opts->progress) {
+        progress_rewind();
+    }
+}
+
+void input_tag(const flvmeta_opts * opts, flv_stream * flv_in, const flv_tag * tag) {
+    if (opts->progress) {
+        progress_tag(flv_get_current_tag_offset(flv_in) + FLV_TAG_SIZE + flv_tag_get_body_length(*tag) + sizeof(uint32_be));
+    }
+}
+
+void input_close(const flvmeta_opts * opts, flv_stream * flv_in) {
+    if (flv_in != NULL) {
+        flv_close(flv_in);
+        if (opts->progress) {
+            progress_close();
+        }
+    }
+}
+
+static int input_on_tag(flv_tag * tag, flv_parser * parser) {
+    input_parser * ip = (input_parser *)parser;
+
+    input_tag(ip->opts, parser->stream, tag);
+    return (ip->on_tag != NULL) ? ip->on_tag(tag, parser) : FLV_OK;
+}
+
+int input_parse(const flvmeta_opts * opts, const char * filename, flv_parser * parser) {
+    input_parser ip;
+    int result;
+
+    if (input_traced(opts)) {
+        trace_begin("parse", filename);
+    }
+
+    if (opts->progress) {
+        ip.parser = *parser;
+        ip.parser.on_tag = input_on_tag;
+        ip.opts = opts;
+        ip.on_tag = parser->on_tag;
+
+        progress_open(filename);
+        result = flv_parse(filename, &ip.parser);
+        progress_close();
+        parser->stream = ip.parser.stream;
+    }
+    else {
+        result = flv_parse(filename, parser);
+    }
+
+    if (input_traced(opts)) {
+        trace_end();
+    }
+    return result;
+}
@@ -0,0 +1,59 @@
+/*
+    FLVMeta - FLV Metadata Editor
+
+    Copyright (C) 2007-2014 Marc Noirot <marc.noirot AT gmail.com>
+
+    This file is part of FLVMeta.
+
+    FLVMeta is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    FLVMeta is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FLVMeta; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+#ifndef __INPUT_H__
+#define __INPUT_H__
+
+#include "flvmeta.h"
+#include "flv.h"
+
+/**
+    Input files of the commands.
+    These wrap the FLV reader with the trace spans and the progress
+    reports requested by the command options, so that the reader itself
+    never touches the process-wide trace and progress state.
+*/
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/* open an input file, NULL if it cannot be read */
+flv_stream * input_open(const flvmeta_opts * opts, const char * filename);
+
+int input_read_header(const flvmeta_opts * opts, flv_stream * flv_in, flv_header * header);
+
+/* go back to the beginning of the file for a new pass */
+void input_rewind(const flvmeta_opts * opts, flv_stream * flv_in);
+
+/* the given tag has just been read */
+void input_tag(const flvmeta_opts * opts, flv_stream * flv_in, const flv_tag * tag);
+
+void input_close(const flvmeta_opts * opts, flv_stream * flv_in);
+
+/* flv_parse with the same trace and progress */
+int input_parse(const flvmeta_opts * opts, const char * filename, flv_parser * parser);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __INPUT_H__ */
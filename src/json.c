@@ -26,115 +26,137 @@
 #include <stdio.h>
 #include <string.h>
 
-static void json_print_string(const char * str, size_t bytes) {
-    size_t i;
-    printf("\"");
+/* escape sequence for a character, or NULL if it can be copied as is */
+static const char * json_get_escape(char c) {
+    switch (c) {
+        case '\"': return "\\\"";
+        case '\\': return "\\\\";
+        case '/':  return "\\/";
+        case '\b': return "\\b";
+        case '\f': return "\\f";
+        case '\n': return "\\n";
+        case '\r': return "\\r";
+        case '\t': return "\\t";
+        default:   return NULL;
+    }
+}
+
+static void json_print_string(output_sink * out, const char * str, size_t bytes) {
+    size_t start, i;
+    const char * escape;
+
+    sink_write_char(out, '\"');
+    start = 0;
     for (i = 0; i < bytes; ++i) {
-        switch (str[i]) {
-            case '\"': printf("\\\""); break;
-            case '\\': printf("\\\\"); break;
-            case '/':  printf("\\/");  break;
-            case '\b': printf("\\b");  break;
-            case '\f': printf("\\f");  break;
-            case '\n': printf("\\n");  break;
-            case '\r': printf("\\r");  break;
-            case '\t': printf("\\t");  break;
-
-            default: 
-                if (iscntrl(str[i])) {
-                    printf("\\u%.4u", str[i]);
-                }
-                else {
-                    printf("%c", str[i]);
-                }
+        escape = json_get_escape(str[i]);
+        if (escape == NULL && !iscntrl(str[i])) {
+            continue;
+        }
+
+        /* copy the run of plain characters, then the escape sequence */
+        sink_write(out, str + start, i - start);
+        if (escape != NULL) {
+            sink_write_z(out, escape);
         }
+        else {
+            sink_printf(out, "\\u%.4u", str[i]);
+        }
+        start = i + 1;
     }
-    printf("\"");
+    sink_write(out, str + start, bytes - start);
+    sink_write_char(out, '\"');
 }
 
 static void json_print_comma(json_emitter * je) {
     if (je->print_comma != 0) {
-        printf(",");
+        sink_write_char(je->out, ',');
         je->print_comma = 0;
     }
 }
 
-void json_emit_init(json_emitter * je) {
+void json_emit_init(json_emitter * je, output_sink * out) {
     je->print_comma = 0;
+    je->out = out;
 }
 
 void json_emit_object_start(json_emitter * je) {
     json_print_comma(je);
-    printf("{");
+    sink_write_char(je->out, '{');
 }
 
 void json_emit_object_key(json_emitter * je, const char * str, size_t bytes) {
     json_print_comma(je);
-    json_print_string(str, bytes);
-    printf(":");
+    json_print_string(je->out, str, bytes);
+    sink_write_char(je->out, ':');
     je->print_comma = 0;
 }
 
 void json_emit_object_key_z(json_emitter * je, const char * str) {
     json_print_comma(je);
-    json_print_string(str, strlen(str));
-    printf(":");
+    json_print_string(je->out, str, strlen(str));
+    sink_write_char(je->out, ':');
     je->print_comma = 0;
 }
 
 void json_emit_object_end(json_emitter * je) {
-    printf("}");
+    sink_write_char(je->out, '}');
     je->print_comma = 1;
 }
 
 void json_emit_array_start(json_emitter * je) {
     json_print_comma(je);
-    printf("[");
+    sink_write_char(je->out, '[');
 }
 
 void json_emit_array_end(json_emitter * je) {
-    printf("]");
+    sink_write_char(je->out, ']');
     je->print_comma = 1;
 }
 
 void json_emit_boolean(json_emitter * je, byte value) {
     json_print_comma(je);
-    printf("%s", value != 0 ? "true" : "false");
+    sink_write_z(je->out, value != 0 ? "true" : "false");
     je->print_comma = 1;
 }
 
 void json_emit_null(json_emitter * je) {
     json_print_comma(je);
-    printf("null");
+    sink_write_z(je->out, "null");
     je->print_comma = 1;
 }
 
 void json_emit_integer(json_emitter * je, int value) {
     json_print_comma(je);
-    printf("%i", value);
+    sink_write_integer(je->out, value);
     je->print_comma = 1;
 }
 
 void json_emit_file_offset(json_emitter * je, file_offset_t value) {
     json_print_comma(je);
-    printf("%" FILE_OFFSET_PRINTF_FORMAT "u", value);
+    sink_write_unsigned(je->out, (uint64)value);
     je->print_comma = 1;
 }
 
 void json_emit_number(json_emitter * je, number64 value) {
     json_print_comma(je);
-    printf("%.12g", value);
+    sink_printf(je->out, "%.12g", value);
     je->print_comma = 1;
 }
 
 void json_emit_string(json_emitter * je, const char * str, size_t bytes) {
     json_print_comma(je);
-    json_print_string(str, bytes);
+    json_print_string(je->out, str, bytes);
     je->print_comma = 1;
 }
 
 void json_emit_string_z(json_emitter * je, const char * str) {
     json_print_comma(je);
-    json_print_string(str, strlen(str));
+    json_print_string(je->out, str, strlen(str));
+    je->print_comma = 1;
+}
+
+void json_emit_raw(json_emitter * je, const char * str, size_t bytes) {
+    json_print_comma(je);
+    sink_write(je->out, str, bytes);
     je->print_comma = 1;
 }
@@ -23,17 +23,19 @@
 #ifndef __JSON_H__
 #define __JSON_H__
 
+#include "sink.h"
 #include "types.h"
 
 /**
     This is a basic JSON emitter.
-    It prints JSON-formatted data to stdout without creating
+    It writes JSON-formatted data to an output sink without creating
     an in-memory tree.
 */
 
 /* json emitter structure */
 typedef struct __json_emitter {
     byte print_comma;
+    output_sink * out;
 } json_emitter;
 
 
@@ -41,7 +43,7 @@ typedef struct __json_emitter {
 extern "C" {
 #endif /* __cplusplus */
 
-void json_emit_init(json_emitter * je);
+void json_emit_init(json_emitter * je, output_sink * out);
 
 void json_emit_object_start(json_emitter * je);
 
@@ -69,6 +71,9 @@ void json_emit_string(json_emitter * je, const char * str, size_t bytes);
 
 void json_emit_string_z(json_emitter * je, const char * str);
 
+/* emit an already formatted JSON value */
+void json_emit_raw(json_emitter * je, const char * str, size_t bytes);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
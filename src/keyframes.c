@@ -0,0 +1,199 @@
+/*
+    FLVMeta - FLV Metadata Editor
+
+    Copyright (C) 2007-2014 Marc Noirot <marc.noirot AT gmail.com>
+
+    This file is part of FLVMeta.
+
+    FLVMeta is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    FLVMeta is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FLVMeta; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+#include "keyframes.h"
+#include "info.h"
+#include "input.h"
+#include "util.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/* maximum number of tags read at the start of the file to find onMetaData */
+#define MAX_METADATA_SEARCH_TAGS 16
+
+void keyframe_index_init(keyframe_index * index) {
+    index->count = 0;
+    index->times = NULL;
+    index->filepositions = NULL;
+    index->computed = 0;
+}
+
+void keyframe_index_free(keyframe_index * index) {
+    free(index->times);
+    free(index->filepositions);
+    keyframe_index_init(index);
+}
+
+int keyframe_index_pack(keyframe_index * index, const amf_data * times, const amf_data * filepositions, file_offset_t filesize) {
+    amf_node * t_node, * f_node;
+    amf_data * f_time, * f_position;
+    number64 time, position;
+    uint32 count, i;
+
+    keyframe_index_free(index);
+
+    if (amf_data_get_type(times) != AMF_TYPE_ARRAY || amf_data_get_type(filepositions) != AMF_TYPE_ARRAY) {
+        return ERROR_NO_KEYFRAMES;
+    }
+    count = amf_array_size(times);
+    if (count == 0 || count != amf_array_size(filepositions)) {
+        return ERROR_NO_KEYFRAMES;
+    }
+
+    index->times = (number64 *)malloc(count * sizeof(number64));
+    index->filepositions = (file_offset_t *)malloc(count * sizeof(file_offset_t));
+    if (index->times == NULL || index->filepositions == NULL) {
+        keyframe_index_free(index);
+        return ERROR_MEMORY;
+    }
+
+    t_node = amf_array_first(times);
+    f_node = amf_array_first(filepositions);
+    for (i = 0; i < count; ++i) {
+        f_time = amf_array_get(t_node);
+        f_position = amf_array_get(f_node);
+        t_node = amf_array_next(t_node);
+        f_node = amf_array_next(f_node);
+
+        if (amf_data_get_type(f_time) != AMF_TYPE_NUMBER || amf_data_get_type(f_position) != AMF_TYPE_NUMBER) {
+            break;
+        }
+        time = amf_number_get_value(f_time);
+        position = amf_number_get_value(f_position);
+
+        /* binary searches need sorted entries, pointing inside the file */
+        if ((i > 0 && (!(time >= index->times[i - 1]) || position <= (number64)index->filepositions[i - 1]))
+            || position < FLV_HEADER_SIZE + sizeof(uint32_be)
+            || position + FLV_TAG_SIZE > (number64)filesize
+            || position != (number64)(file_offset_t)position
+        ) {
+            break;
+        }
+
+        index->times[i] = time;
+        index->filepositions[i] = (file_offset_t)position;
+    }
+
+    if (i < count) {
+        keyframe_index_free(index);
+        return ERROR_NO_KEYFRAMES;
+    }
+    index->count = count;
+    return OK;
+}
+
+/* pack the keyframes index of the onMetaData event found at the start of the file */
+static int keyframe_index_read_metadata(keyframe_index * index, flv_stream * flv_in, file_offset_t filesize, const flvmeta_opts * opts) {
+    flv_header header;
+    flv_tag tag;
+    amf_data * name, * data, * keyframes;
+    int i, retval;
+
+    if (input_read_header(opts, flv_in, &header) != FLV_OK) {
+        return ERROR_NO_FLV;
+    }
+
+    retval = ERROR_NO_KEYFRAMES;
+    for (i = 0; i < MAX_METADATA_SEARCH_TAGS; ++i) {
+        if (flv_read_tag(flv_in, &tag) != FLV_OK) {
+            break;
+        }
+        if (tag.type != FLV_TAG_TYPE_META || flv_tag_get_body_length(tag) == 0) {
+            continue;
+        }
+
+        name = data = NULL;
+        if (flv_read_metadata(flv_in, &name, &data) == FLV_OK
+            && amf_data_get_type(name) == AMF_TYPE_STRING
+            && !strcmp((char*)amf_string_get_bytes(name), "onMetaData")
+        ) {
+            keyframes = NULL;
+            if (amf_data_get_type(data) == AMF_TYPE_ASSOCIATIVE_ARRAY) {
+                keyframes = amf_associative_array_get(data, "keyframes");
+            }
+            if (amf_data_get_type(keyframes) == AMF_TYPE_OBJECT) {
+                retval = keyframe_index_pack(index,
+                    amf_object_get(keyframes, "times"),
+                    amf_object_get(keyframes, "filepositions"),
+                    filesize);
+            }
+            amf_data_free(name);
+            amf_data_free(data);
+            break;
+        }
+        amf_data_free(name);
+        amf_data_free(data);
+    }
+
+    return retval;
+}
+
+int keyframe_index_read(keyframe_index * index, const char * filename, const flvmeta_opts * opts) {
+    flv_stream * flv_in;
+    flv_info info;
+    file_offset_t filesize;
+    int retval;
+
+    keyframe_index_init(index);
+
+    if (flvmeta_filesize(filename, &filesize) == 0) {
+        return ERROR_OPEN_READ;
+    }
+
+    flv_in = input_open(opts, filename);
+    if (flv_in == NULL) {
+        return ERROR_OPEN_READ;
+    }
+
+    retval = keyframe_index_read_metadata(index, flv_in, filesize, opts);
+    if (retval == ERROR_NO_KEYFRAMES) {
+        /* compute the index from the whole file */
+        input_rewind(opts, flv_in);
+        retval = get_flv_info(flv_in, &info, opts);
+        if (retval == OK) {
+            retval = keyframe_index_pack(index, info.times, info.filepositions, filesize);
+            index->computed = 1;
+        }
+        flv_info_free(&info);
+    }
+
+    input_close(opts, flv_in);
+    return retval;
+}
+
+uint32 keyframe_index_find(const keyframe_index * index, number64 time) {
+    uint32 low, high, middle;
+
+    /* search the first keyframe after the given time */
+    low = 0;
+    high = index->count;
+    while (low < high) {
+        middle = low + (high - low) / 2;
+        if (index->times[middle] <= time) {
+            low = middle + 1;
+        }
+        else {
+            high = middle;
+        }
+    }
+    return (low > 0) ? low - 1 : 0;
+}
@@ -0,0 +1,66 @@
+/*
+    FLVMeta - FLV Metadata Editor
+
+    Copyright (C) 2007-2014 Marc Noirot <marc.noirot AT gmail.com>
+
+    This file is part of FLVMeta.
+
+    FLVMeta is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    FLVMeta is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FLVMeta; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+#ifndef __KEYFRAMES_H__
+#define __KEYFRAMES_H__
+
+#include "flvmeta.h"
+
+/*
+    Keyframes index packed into arrays, so that the keyframe at a given
+    time can be found by a binary search instead of walking AMF lists.
+*/
+typedef struct __keyframe_index {
+    uint32 count;
+    number64 * times;
+    file_offset_t * filepositions;
+    /* index computed from the tags, the onMetaData one being absent or invalid */
+    uint8 computed;
+} keyframe_index;
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+void keyframe_index_init(keyframe_index * index);
+
+void keyframe_index_free(keyframe_index * index);
+
+/*
+    pack AMF times and filepositions arrays, returns ERROR_NO_KEYFRAMES if they
+    are missing, empty, or not sorted positions within a file of the given size
+*/
+int keyframe_index_pack(keyframe_index * index, const amf_data * times, const amf_data * filepositions, file_offset_t filesize);
+
+/*
+    read the keyframes index of a file from its onMetaData event,
+    or compute it from the file tags if that index is missing or invalid
+*/
+int keyframe_index_read(keyframe_index * index, const char * filename, const flvmeta_opts * opts);
+
+/* last keyframe at or before the given time in seconds, or first keyframe, the index must not be empty */
+uint32 keyframe_index_find(const keyframe_index * index, number64 time);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __KEYFRAMES_H__ */
@@ -0,0 +1,261 @@
+/*
+    FLVMeta - FLV Metadata Editor
+
+    Copyright (C) 2007-2014 Marc Noirot <marc.noirot AT gmail.com>
+
+    This file is part of FLVMeta.
+
+    FLVMeta is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    FLVMeta is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FLVMeta; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include "libflvmeta.h"
+#include "check.h"
+#include "concat.h"
+#include "cut.h"
+#include "dump.h"
+#include "extract.h"
+#include "fmp4.h"
+#include "segment.h"
+#include "progress.h"
+#include "serve.h"
+#include "stats.h"
+#include "update.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifdef WIN32
+# include <fcntl.h>
+# include <io.h>
+#endif /* WIN32 */
+
+const char * flvmeta_version(void) {
+    return PACKAGE_VERSION;
+}
+
+struct __flvmeta_context {
+    flvmeta_opts options;
+    /* dumps and reports output, standard output if NULL */
+    output_sink * out;
+};
+
+void flvmeta_opts_init(flvmeta_opts * options) {
+    options->command = FLVMETA_DEFAULT_COMMAND;
+    options->input_file = NULL;
+    options->output_file = NULL;
+    options->metadata = NULL;
+    options->check_level = FLVMETA_CHECK_LEVEL_WARNING;
+    options->quiet = 0;
+    options->check_report_format = FLVMETA_FORMAT_RAW;
+    options->check_max_errors = 0;
+    options->check_sample = 0;
+    options->check_tail = 0;
+    options->check_seek_index = 0;
+    options->dump_metadata = 0;
+    options->insert_onlastsecond = 1;
+    options->reset_timestamps = 0;
+    options->all_keyframes = 0;
+    options->preserve_metadata = 0;
+    options->error_handling = FLVMETA_EXIT_ON_ERROR;
+    options->dump_format = FLVMETA_FORMAT_XML;
+    options->dump_strict_yaml = 0;
+    options->verbose = 0;
+    options->metadata_event = NULL;
+    options->serve_workers = SERVE_DEFAULT_WORKERS;
+    options->seek_time = 0;
+    options->cut_start = 0;
+    options->cut_end = 0;
+    options->concat_files = NULL;
+    options->concat_count = 0;
+    options->segment_duration = 0;
+    options->stats = 0;
+    options->stats_format = FLVMETA_FORMAT_RAW;
+    options->trace_file = NULL;
+    options->progress = 0;
+    options->progress_interval = PROGRESS_DEFAULT_INTERVAL;
+}
+
+flvmeta_context * flvmeta_context_new(void) {
+    flvmeta_context * ctx = (flvmeta_context *)malloc(sizeof(flvmeta_context));
+    if (ctx != NULL) {
+        flvmeta_opts_init(&ctx->options);
+        ctx->out = NULL;
+    }
+    return ctx;
+}
+
+void flvmeta_context_free(flvmeta_context * ctx) {
+    if (ctx != NULL) {
+        amf_data_free(ctx->options.metadata);
+        free(ctx);
+    }
+}
+
+void flvmeta_context_set_command(flvmeta_context * ctx, int command) {
+    ctx->options.command = command;
+}
+
+void flvmeta_context_set_input_file(flvmeta_context * ctx, const char * filename) {
+    ctx->options.input_file = (char *)filename;
+}
+
+void flvmeta_context_set_output_file(flvmeta_context * ctx, const char * filename) {
+    ctx->options.output_file = (char *)filename;
+}
+
+void flvmeta_context_set_format(flvmeta_context * ctx, int format) {
+    ctx->options.dump_format = format;
+    ctx->options.check_report_format = format;
+}
+
+void flvmeta_context_set_output(flvmeta_context * ctx, output_sink * out) {
+    ctx->out = out;
+}
+
+flvmeta_opts * flvmeta_context_get_options(flvmeta_context * ctx) {
+    return &ctx->options;
+}
+
+int flvmeta_execute(flvmeta_context * ctx) {
+    const flvmeta_opts * options = &ctx->options;
+    output_sink std_out;
+    output_sink * out;
+    int retval;
+
+    out = ctx->out;
+    if (out == NULL) {
+#ifdef WIN32
+        if (options->dump_format == FLVMETA_FORMAT_CBOR) {
+            /* prevent the C runtime from translating line feeds */
+            _setmode(_fileno(stdout), _O_BINARY);
+        }
+#endif /* WIN32 */
+        sink_init_file(&std_out, stdout);
+        out = &std_out;
+    }
+
+    if (options->stats) {
+        stats_enable();
+    }
+    if (options->progress) {
+        progress_enable(options->progress_interval);
+    }
+
+    switch (options->command) {
+        case FLVMETA_DUMP_COMMAND:
+            stats_phase_start(STATS_PHASE_DUMP);
+            retval = dump_metadata(options, out);
+            stats_phase_end(STATS_PHASE_DUMP);
+            break;
+        case FLVMETA_FULL_DUMP_COMMAND:
+            stats_phase_start(STATS_PHASE_DUMP);
+            retval = dump_flv_file(options, out);
+            stats_phase_end(STATS_PHASE_DUMP);
+            break;
+        case FLVMETA_CHECK_COMMAND:
+            stats_phase_start(STATS_PHASE_CHECK);
+            retval = check_flv_file(options, out);
+            stats_phase_end(STATS_PHASE_CHECK);
+            break;
+        case FLVMETA_UPDATE_COMMAND: retval = update_metadata(options, out); break;
+        case FLVMETA_INFO_COMMAND: retval = dump_file_info(options, out); break;
+        case FLVMETA_SEEK_COMMAND: retval = dump_seek_point(options, out); break;
+        case FLVMETA_CUT_COMMAND: retval = cut_flv_file(options); break;
+        case FLVMETA_CONCAT_COMMAND: retval = concat_flv_files(options); break;
+        case FLVMETA_EXTRACT_AUDIO_COMMAND: retval = extract_audio(options); break;
+        case FLVMETA_EXTRACT_VIDEO_COMMAND: retval = extract_video(options); break;
+        case FLVMETA_SEGMENT_COMMAND: retval = segment_flv_file(options, out); break;
+        case FLVMETA_FMP4_COMMAND: retval = remux_fmp4_file(options); break;
+#ifndef WIN32
+        case FLVMETA_SERVE_COMMAND: retval = serve_unix_socket(options); break;
+#endif /* WIN32 */
+        default: retval = OK;
+    }
+
+    /* report write failures of the output */
+    if (out == &std_out) {
+        if (sink_close(out) != 0 && retval == OK) {
+            retval = ERROR_WRITE;
+        }
+    }
+    else {
+        sink_flush(out);
+    }
+
+    return retval;
+}
+
+const char * flvmeta_error_string(int errcode) {
+    switch (errcode) {
+        case OK: return "no error";
+        case ERROR_OPEN_READ: return "cannot open file for reading";
+        case ERROR_NO_FLV: return "not a valid FLV file";
+        case ERROR_EOF: return "unexpected end of file";
+        case ERROR_MEMORY: return "memory allocation error";
+        case ERROR_EMPTY_TAG: return "empty FLV tag";
+        case ERROR_OPEN_WRITE: return "cannot open file for writing";
+        case ERROR_INVALID_TAG: return "invalid FLV tag";
+        case ERROR_WRITE: return "write error";
+        case ERROR_INVALID_FLV_FILE: return "invalid FLV file";
+        case ERROR_SOCKET: return "socket error";
+        case ERROR_NO_KEYFRAMES: return "no keyframes";
+        case ERROR_UNSUPPORTED_CODEC: return "unsupported codec";
+        case ERROR_NO_STREAM: return "no stream to extract";
+        default: return "unknown error";
+    }
+}
+
+int flvmeta_get_info(const flvmeta_context * ctx, const char * filename, flv_info * info) {
+    flv_stream * flv_in;
+    int retval;
+
+    flv_in = flv_open(filename);
+    if (flv_in == NULL) {
+        return ERROR_OPEN_READ;
+    }
+
+    retval = get_flv_info(flv_in, info, &ctx->options);
+    flv_close(flv_in);
+
+    if (retval != OK) {
+        flv_info_free(info);
+    }
+    return retval;
+}
+
+void flvmeta_compute_metadata(const flvmeta_context * ctx, flv_info * info, flv_metadata * meta) {
+    compute_metadata(info, meta, &ctx->options);
+}
+
+int flvmeta_seek(const flvmeta_context * ctx, const char * filename, number64 time, number64 * keyframe_time, file_offset_t * fileposition) {
+    keyframe_index index;
+    uint32 keyframe;
+    int retval;
+
+    retval = keyframe_index_read(&index, filename, &ctx->options);
+    if (retval != OK) {
+        return retval;
+    }
+
+    keyframe = keyframe_index_find(&index, time);
+    *keyframe_time = index.times[keyframe];
+    *fileposition = index.filepositions[keyframe];
+
+    keyframe_index_free(&index);
+    return OK;
+}
@@ -0,0 +1,116 @@
+/*
+    FLVMeta - FLV Metadata Editor
+
+    Copyright (C) 2007-2014 Marc Noirot <marc.noirot AT gmail.com>
+
+    This file is part of FLVMeta.
+
+    FLVMeta is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    FLVMeta is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FLVMeta; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+#ifndef __LIBFLVMETA_H__
+#define __LIBFLVMETA_H__
+
+#include "flvmeta.h"
+#include "amf.h"
+#include "flv.h"
+#include "info.h"
+#include "keyframes.h"
+#include "sink.h"
+
+/**
+    FLVMeta library.
+    All operations run within a context holding their options and the
+    sink receiving their output. The library keeps no global state,
+    apart from the process-wide statistics of the --stats option, and
+    the trace and progress reports of the --trace and --progress
+    options, only touched by commands whose options request them: the
+    FLV reader itself never does. Distinct contexts can be used
+    concurrently from several threads, as long as each context is used
+    by a single thread at a time.
+*/
+
+/* opaque context, created by flvmeta_context_new */
+typedef struct __flvmeta_context flvmeta_context;
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/* library version */
+const char * flvmeta_version(void);
+
+/* initialize options with their defaults, for the functions taking options */
+void flvmeta_opts_init(flvmeta_opts * options);
+
+/* create a context with the default options, NULL if out of memory */
+flvmeta_context * flvmeta_context_new(void);
+
+/* release a context and the data it owns, such as user-defined metadata */
+void flvmeta_context_free(flvmeta_context * ctx);
+
+/*
+    Context settings.
+    The file names are not copied, and must outlive the context.
+*/
+void flvmeta_context_set_command(flvmeta_context * ctx, int command);
+
+void flvmeta_context_set_input_file(flvmeta_context * ctx, const char * filename);
+
+void flvmeta_context_set_output_file(flvmeta_context * ctx, const char * filename);
+
+/* format of the dumps and of the check reports */
+void flvmeta_context_set_format(flvmeta_context * ctx, int format);
+
+/* dumps and reports output, standard output if NULL */
+void flvmeta_context_set_output(flvmeta_context * ctx, output_sink * out);
+
+/*
+    All the options of a context, as filled by the flvmeta command line.
+    Fields are only ever appended to flvmeta_opts, so that its offsets
+    stay stable across versions of the library.
+*/
+flvmeta_opts * flvmeta_context_get_options(flvmeta_context * ctx);
+
+/* execute the dump, full dump, check, update, info, seek, cut, concat, extraction, segment, fmp4 or serve command of a context */
+int flvmeta_execute(flvmeta_context * ctx);
+
+/* description of an error status */
+const char * flvmeta_error_string(int errcode);
+
+/*
+    Gather information from an FLV file.
+    If successful, the information must be released with flv_info_free.
+*/
+int flvmeta_get_info(const flvmeta_context * ctx, const char * filename, flv_info * info);
+
+/*
+    Compute the onMetaData and onLastSecond events from file information.
+    The metadata must be released with flv_metadata_free.
+*/
+void flvmeta_compute_metadata(const flvmeta_context * ctx, flv_info * info, flv_metadata * meta);
+
+/*
+    Find the time and file position of the last keyframe at or before a time
+    in seconds, or of the first keyframe, for players seeking in a file.
+    The onMetaData keyframes index is used when valid, otherwise the index is
+    computed from the file tags.
+*/
+int flvmeta_seek(const flvmeta_context * ctx, const char * filename, number64 time, number64 * keyframe_time, file_offset_t * fileposition);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __LIBFLVMETA_H__ */
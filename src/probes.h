@@ -0,0 +1,59 @@
+/*
+    FLVMeta - FLV Metadata Editor
+
+    Copyright (C) 2007-2014 Marc Noirot <marc.noirot AT gmail.com>
+
+    This file is part of FLVMeta.
+
+    FLVMeta is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    FLVMeta is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FLVMeta; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+#ifndef __PROBES_H__
+#define __PROBES_H__
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+/**
+    Static tracing probes.
+    When flvmeta is configured with FLVMETA_USDT, these macros expand to
+    the USDT probes of <sys/sdt.h>, under the flvmeta provider, which
+    DTrace, SystemTap or bpftrace can attach to. A probe which is not
+    attached only costs a nop instruction. Otherwise they expand to
+    nothing at all.
+
+    Probes and arguments:
+    read_tag         tag offset, type, body length, timestamp
+    read_tag_body    tag offset, bytes read
+    amf_read_start
+    amf_read_done    AMF type of the data read
+    write_tag        input tag offset, type, body length, timestamp
+    check_message    level, code string, offset, message string
+*/
+
+#ifdef FLVMETA_USDT
+# include <sys/sdt.h>
+# define FLVMETA_PROBE0(name) DTRACE_PROBE(flvmeta, name)
+# define FLVMETA_PROBE1(name, a) DTRACE_PROBE1(flvmeta, name, a)
+# define FLVMETA_PROBE2(name, a, b) DTRACE_PROBE2(flvmeta, name, a, b)
+# define FLVMETA_PROBE4(name, a, b, c, d) DTRACE_PROBE4(flvmeta, name, a, b, c, d)
+#else /* FLVMETA_USDT */
+# define FLVMETA_PROBE0(name)
+# define FLVMETA_PROBE1(name, a)
+# define FLVMETA_PROBE2(name, a, b)
+# define FLVMETA_PROBE4(name, a, b, c, d)
+#endif /* FLVMETA_USDT */
+
+#endif /* __PROBES_H__ */
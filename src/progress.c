@@ -0,0 +1,206 @@
+/*
+    FLVMeta - FLV Metadata Editor
+
+    Copyright (C) 2007-2014 Marc Noirot <marc.noirot AT gmail.com>
+
+    This file is part of FLVMeta.
+
+    FLVMeta is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    FLVMeta is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FLVMeta; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+#include "progress.h"
+#include "flvmeta.h"
+#include "stats.h"
+#include "util.h"
+
+#include <stdio.h>
+
+/* tags read between two clock reads, unless a megabyte has been read */
+#define PROGRESS_CHECK_TAGS     64
+#define PROGRESS_CHECK_BYTES    0x100000
+
+#define MEGABYTE                1048576.0
+
+typedef struct __flvmeta_progress {
+    int enabled;
+    double interval;
+    double next_report;
+    /* current pass */
+    const char * filename;
+    file_offset_t filesize;
+    file_offset_t offset;
+    file_offset_t checked_offset;
+    uint32 pass;
+    uint32 tags;
+    uint32 unchecked_tags;
+    double start;
+    /* whole batch */
+    file_offset_t total;
+    file_offset_t done;
+    double batch_start;
+} flvmeta_progress;
+
+static flvmeta_progress progress;
+
+/* print a duration as hours, minutes and seconds */
+static void progress_print_time(double seconds) {
+    unsigned long s = (unsigned long)(seconds + 0.5);
+    if (s >= 3600) {
+        fprintf(stderr, "%lu:%02lu:%02lu", s / 3600, (s / 60) % 60, s % 60);
+    }
+    else {
+        fprintf(stderr, "%lu:%02lu", s / 60, s % 60);
+    }
+}
+
+/* print the estimated remaining time of a task, once it has started */
+static void progress_print_eta(file_offset_t done, file_offset_t size, double elapsed) {
+    fprintf(stderr, ", ETA ");
+    if (done > 0 && size > done) {
+        progress_print_time(elapsed * (double)(size - done) / (double)done);
+    }
+    else if (done > 0) {
+        progress_print_time(0);
+    }
+    else {
+        fprintf(stderr, "?");
+    }
+}
+
+static void progress_report(double now) {
+    double elapsed = now - progress.start;
+
+    fprintf(stderr, "%s", progress.filename);
+    if (progress.pass > 1) {
+        fprintf(stderr, " (pass %u)", progress.pass);
+    }
+    fprintf(stderr, ": %.1f/%.1f MB", progress.offset / MEGABYTE, progress.filesize / MEGABYTE);
+    if (progress.filesize > 0) {
+        fprintf(stderr, " (%.1f%%)", 100.0 * progress.offset / progress.filesize);
+    }
+    if (elapsed > 0) {
+        fprintf(stderr, ", %.1f MB/s, %.0f tags/s", progress.offset / MEGABYTE / elapsed, progress.tags / elapsed);
+    }
+    progress_print_eta(progress.offset, progress.filesize, elapsed);
+
+    if (progress.total > 0) {
+        file_offset_t done = progress.done + progress.offset;
+        fprintf(stderr, " | total %.1f/%.1f MB (%.1f%%)", done / MEGABYTE, progress.total / MEGABYTE, 100.0 * done / progress.total);
+        progress_print_eta(done, progress.total, now - progress.batch_start);
+    }
+    fprintf(stderr, "\n");
+}
+
+/* end the current pass, reporting its completion */
+static void progress_end_pass(void) {
+    double elapsed;
+
+    if (progress.filename == NULL || progress.tags == 0) {
+        return;
+    }
+
+    elapsed = stats_wall_time() - progress.start;
+    fprintf(stderr, "%s", progress.filename);
+    if (progress.pass > 1) {
+        fprintf(stderr, " (pass %u)", progress.pass);
+    }
+    fprintf(stderr, ": %.1f MB, %u tags read in ", progress.offset / MEGABYTE, progress.tags);
+    progress_print_time(elapsed);
+    if (elapsed > 0) {
+        fprintf(stderr, ", %.1f MB/s", progress.offset / MEGABYTE / elapsed);
+    }
+    fprintf(stderr, "\n");
+
+    progress.done += progress.offset;
+    ++progress.pass;
+}
+
+/* start a pass from the beginning of the current file */
+static void progress_start_pass(void) {
+    progress.offset = 0;
+    progress.checked_offset = 0;
+    progress.tags = 0;
+    progress.unchecked_tags = 0;
+    progress.start = stats_wall_time();
+    progress.next_report = progress.start + progress.interval;
+}
+
+void progress_enable(double interval) {
+    progress.enabled = 1;
+    progress.interval = interval;
+    progress.filename = NULL;
+    progress.total = 0;
+    progress.done = 0;
+    progress.batch_start = stats_wall_time();
+}
+
+int progress_enabled(void) {
+    return progress.enabled;
+}
+
+void progress_set_total(file_offset_t total) {
+    progress.total = total;
+    progress.done = 0;
+    progress.batch_start = stats_wall_time();
+}
+
+void progress_open(const char * filename) {
+    if (progress.enabled) {
+        progress.filename = filename;
+        if (flvmeta_filesize(filename, &progress.filesize) == 0) {
+            progress.filesize = 0;
+        }
+        progress.pass = 1;
+        progress_start_pass();
+    }
+}
+
+void progress_rewind(void) {
+    if (progress.enabled) {
+        progress_end_pass();
+        progress_start_pass();
+    }
+}
+
+void progress_close(void) {
+    if (progress.enabled) {
+        progress_end_pass();
+        progress.filename = NULL;
+    }
+}
+
+void progress_tag(file_offset_t end_offset) {
+    double now;
+
+    if (!progress.enabled || progress.filename == NULL) {
+        return;
+    }
+
+    progress.offset = end_offset;
+    ++progress.tags;
+
+    /* the clock is only read every few tags, or every megabyte */
+    if (++progress.unchecked_tags < PROGRESS_CHECK_TAGS
+    && end_offset - progress.checked_offset < PROGRESS_CHECK_BYTES) {
+        return;
+    }
+    progress.unchecked_tags = 0;
+    progress.checked_offset = end_offset;
+
+    now = stats_wall_time();
+    if (now >= progress.next_report) {
+        progress_report(now);
+        progress.next_report = now + progress.interval;
+    }
+}
@@ -0,0 +1,66 @@
+/*
+    FLVMeta - FLV Metadata Editor
+
+    Copyright (C) 2007-2014 Marc Noirot <marc.noirot AT gmail.com>
+
+    This file is part of FLVMeta.
+
+    FLVMeta is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    FLVMeta is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FLVMeta; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+#ifndef __PROGRESS_H__
+#define __PROGRESS_H__
+
+#include "types.h"
+
+/**
+    Progress reporting.
+    When enabled, each pass over the tags of an input file reports on
+    standard error, at a fixed interval, its offset in the file, its
+    throughput and its estimated remaining time, followed by the
+    progress of the whole batch when a total has been declared.
+    Like statistics, progress is process-wide; the tag loop only pays
+    for a test while it is disabled, and for an occasional clock read
+    while it is enabled.
+*/
+
+/* default interval between reports, in seconds */
+#define PROGRESS_DEFAULT_INTERVAL   1.0
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+void progress_enable(double interval);
+
+int progress_enabled(void);
+
+/* declare the number of bytes read by the whole batch, all passes included */
+void progress_set_total(file_offset_t total);
+
+/* an input file is opened, rewound for a new pass, or closed */
+void progress_open(const char * filename);
+
+void progress_rewind(void);
+
+void progress_close(void);
+
+/* a tag ending at the given offset has been read */
+void progress_tag(file_offset_t end_offset);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __PROGRESS_H__ */
@@ -0,0 +1,598 @@
+/*
+    FLVMeta - FLV Metadata Editor
+
+    Copyright (C) 2007-2014 Marc Noirot <marc.noirot AT gmail.com>
+
+    This file is part of FLVMeta.
+
+    FLVMeta is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    FLVMeta is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FLVMeta; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+#include "flvmeta.h"
+#include "flv.h"
+#include "amf.h"
+#include "info.h"
+#include "input.h"
+#include "json.h"
+#include "segment.h"
+#include "stats.h"
+#include "trace.h"
+#include "util.h"
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* size of the buffer used to copy the tags of a chunk into its file */
+#define SEGMENT_COPY_BUFFER_SIZE 65536
+
+/* sequence headers */
+#define SEGMENT_VIDEO_HEADER 0
+#define SEGMENT_AUDIO_HEADER 1
+#define SEGMENT_NO_HEADER   -1
+
+typedef struct __segment_state {
+    const flvmeta_opts * opts;
+    uint8 reset_timestamps;
+    flv_stream * flv_in;
+    uint8 input_has_video;
+    /* tags of the current chunk, copied into its file once complete */
+    FILE * data;
+    file_offset_t data_size;
+    byte * copy_buffer;
+    uint8 chunk_open;
+    uint32 chunk_number;
+    uint32 chunk_timestamp;
+    /* chunks start at the first keyframe past a multiple of the duration */
+    uint32 first_timestamp;
+    uint32 boundary_index;
+    /* information about the current chunk, and its next tag offset */
+    flv_info info;
+    file_offset_t out_offset;
+    /* video size carried over from the previous chunks */
+    uint8 have_video_size;
+    uint32 video_width;
+    uint32 video_height;
+    /* last sequence header of each stream, and whether the chunk has it */
+    flv_tag header_tags[2];
+    byte * headers[2];
+    uint32 header_sizes[2];
+    uint8 have_header[2];
+    uint8 header_written[2];
+    /* current tag body */
+    byte * buffer;
+    uint32 buffer_size;
+    /* extended timestamp fixing */
+    uint32 prev_timestamp_video;
+    uint32 prev_timestamp_audio;
+    uint8 timestamp_extended_video;
+    uint8 timestamp_extended_audio;
+    /* chunk file names are built from the output file name */
+    char * prefix;
+    char * filename;
+    json_emitter je;
+} segment_state;
+
+/* chunk files are named after the output file, without its extension */
+static int segment_state_init(segment_state * state, const flvmeta_opts * opts, output_sink * out) {
+    size_t length;
+
+    memset(state, 0, sizeof(segment_state));
+    state->opts = opts;
+
+    length = strlen(opts->output_file);
+    state->prefix = (char *)malloc(length + 1);
+    state->filename = (char *)malloc(length + 16);
+    state->copy_buffer = (byte *)malloc(SEGMENT_COPY_BUFFER_SIZE);
+    if (state->prefix == NULL || state->filename == NULL || state->copy_buffer == NULL) {
+        return ERROR_MEMORY;
+    }
+    strcpy(state->prefix, opts->output_file);
+    if (length > 4 && state->prefix[length - 4] == '.'
+    && tolower((unsigned char)state->prefix[length - 3]) == 'f'
+    && tolower((unsigned char)state->prefix[length - 2]) == 'l'
+    && tolower((unsigned char)state->prefix[length - 1]) == 'v') {
+        state->prefix[length - 4] = 0;
+    }
+
+    json_emit_init(&state->je, out);
+    return OK;
+}
+
+static void segment_state_free(segment_state * state) {
+    if (state->chunk_open) {
+        flv_info_free(&state->info);
+    }
+    free(state->headers[SEGMENT_VIDEO_HEADER]);
+    free(state->headers[SEGMENT_AUDIO_HEADER]);
+    free(state->buffer);
+    free(state->copy_buffer);
+    free(state->prefix);
+    free(state->filename);
+}
+
+/* read the current tag body into the state buffer */
+static int segment_read_body(segment_state * state, uint32 body_length) {
+    if (body_length > state->buffer_size) {
+        byte * new_buffer = (byte *)realloc(state->buffer, body_length);
+        if (new_buffer == NULL) {
+            return ERROR_MEMORY;
+        }
+        state->buffer = new_buffer;
+        state->buffer_size = body_length;
+    }
+    if (flv_read_tag_body(state->flv_in, state->buffer, body_length) < body_length) {
+        return ERROR_EOF;
+    }
+    return OK;
+}
+
+/* timestamp of a tag, fixing extended timestamps as write_flv does */
+static uint32 segment_fix_timestamp(segment_state * state, const flv_tag * tag) {
+    uint32 timestamp = flv_tag_get_timestamp(*tag);
+
+    if (tag->type == FLV_TAG_TYPE_AUDIO) {
+        timestamp = flv_fix_extended_timestamp(timestamp, &state->prev_timestamp_audio, &state->timestamp_extended_audio);
+    }
+    else {
+        timestamp = flv_fix_extended_timestamp(timestamp, &state->prev_timestamp_video, &state->timestamp_extended_video);
+    }
+    return timestamp;
+}
+
+/* tell which sequence header the current tag is, if any */
+static int segment_sequence_header(const segment_state * state, const flv_tag * tag, uint32 body_length) {
+    if (body_length < 2) {
+        return SEGMENT_NO_HEADER;
+    }
+    if (tag->type == FLV_TAG_TYPE_VIDEO
+    && flv_video_tag_codec_id(state->buffer[0]) == FLV_VIDEO_TAG_CODEC_AVC
+    && state->buffer[1] == FLV_AVC_PACKET_TYPE_SEQUENCE_HEADER) {
+        return SEGMENT_VIDEO_HEADER;
+    }
+    if (tag->type == FLV_TAG_TYPE_AUDIO
+    && flv_audio_tag_sound_format(state->buffer[0]) == FLV_AUDIO_TAG_SOUND_FORMAT_AAC
+    && state->buffer[1] == FLV_AAC_PACKET_TYPE_SEQUENCE_HEADER) {
+        return SEGMENT_AUDIO_HEADER;
+    }
+    return SEGMENT_NO_HEADER;
+}
+
+/*
+    tell whether the current tag starts a new chunk: a video keyframe,
+    or any audio frame in files without video, past the next boundary
+*/
+static int segment_is_boundary(const segment_state * state, const flv_tag * tag, uint32 timestamp) {
+    if (tag->type == FLV_TAG_TYPE_VIDEO) {
+        if (flv_video_tag_frame_type(state->buffer[0]) != FLV_VIDEO_TAG_FRAME_TYPE_KEYFRAME) {
+            return 0;
+        }
+    }
+    else if (state->input_has_video) {
+        return 0;
+    }
+
+    return timestamp >= state->first_timestamp
+        && (timestamp - state->first_timestamp) >= state->boundary_index * state->opts->segment_duration * 1000.0;
+}
+
+/* timestamp of a tag in the current chunk */
+static uint32 segment_rebase_timestamp(const segment_state * state, uint32 timestamp) {
+    if (!state->reset_timestamps) {
+        return timestamp;
+    }
+    return (timestamp > state->chunk_timestamp) ? timestamp - state->chunk_timestamp : 0;
+}
+
+/*
+    write a tag into the chunk data and account for it, flv_in being NULL
+    for stored sequence headers, which are not read from the input file
+*/
+static int segment_write_tag(segment_state * state, flv_stream * flv_in, const flv_tag * tag, const byte * body, uint32 timestamp) {
+    flv_tag out_tag;
+    flv_video_tag vt;
+    flv_tag in_tag;
+    file_offset_t in_offset;
+    uint32 body_length;
+    uint32_be size;
+    int result;
+
+    body_length = flv_tag_get_body_length(*tag);
+    memcpy(&out_tag, tag, sizeof(flv_tag));
+    flv_tag_set_timestamp(&out_tag, timestamp);
+
+    result = flv_info_add_tag(&state->info, &out_tag, state->out_offset, state->opts);
+    if (result != OK) {
+        return result;
+    }
+
+    if (tag->type == FLV_TAG_TYPE_VIDEO) {
+        vt = body[0];
+        if (!state->info.have_video_size
+        && flv_video_tag_frame_type(vt) == FLV_VIDEO_TAG_FRAME_TYPE_KEYFRAME) {
+            if (flv_in != NULL) {
+                /* the video size is read from the input, right after the video tag header */
+                in_offset = flv_get_current_tag_offset(flv_in);
+                if (flv_seek_tag(flv_in, in_offset) != FLV_OK
+                || flv_read_tag(flv_in, &in_tag) != FLV_OK
+                || flv_read_video_tag(flv_in, &vt) != FLV_OK) {
+                    return ERROR_EOF;
+                }
+                result = flv_info_add_video_tag(&state->info, flv_in, &vt, state->opts);
+            }
+            else {
+                state->info.have_video_size = 1;
+                result = flv_info_add_video_tag(&state->info, NULL, &vt, state->opts);
+                state->info.have_video_size = 0;
+            }
+        }
+        else {
+            result = flv_info_add_video_tag(&state->info, NULL, &vt, state->opts);
+        }
+        if (result != OK) {
+            return result;
+        }
+    }
+    else {
+        flv_info_add_audio_tag(&state->info, body, state->opts);
+    }
+
+    size = swap_uint32(FLV_TAG_SIZE + body_length);
+    if (flv_write_tag(state->data, &out_tag) != 1
+    || stats_fwrite(body, 1, body_length, state->data) < body_length
+    || stats_fwrite(&size, sizeof(uint32_be), 1, state->data) != 1) {
+        return ERROR_WRITE;
+    }
+
+    state->out_offset += FLV_TAG_SIZE + body_length + sizeof(uint32_be);
+    state->data_size += FLV_TAG_SIZE + body_length + sizeof(uint32_be);
+    return OK;
+}
+
+/* start a chunk with the current tag, beginning with the last sequence headers */
+static int segment_start_chunk(segment_state * state, uint32 timestamp) {
+    int result, i;
+
+    if (state->chunk_number == 0) {
+        state->first_timestamp = timestamp;
+    }
+    state->chunk_timestamp = timestamp;
+    state->boundary_index = (uint32)((timestamp - state->first_timestamp) / (state->opts->segment_duration * 1000.0)) + 1;
+
+    flv_info_reset(&state->info);
+    if (state->have_video_size) {
+        state->info.have_video_size = 1;
+        state->info.video_width = state->video_width;
+        state->info.video_height = state->video_height;
+    }
+    state->chunk_open = 1;
+
+    /* the computed onMetaData size is added by compute_metadata */
+    state->out_offset = FLV_HEADER_SIZE + sizeof(uint32_be);
+    state->data_size = 0;
+    if (stats_fseek(state->data, 0, SEEK_SET) != 0) {
+        return ERROR_WRITE;
+    }
+
+    for (i = SEGMENT_VIDEO_HEADER; i <= SEGMENT_AUDIO_HEADER; ++i) {
+        state->header_written[i] = 0;
+        if (state->have_header[i]) {
+            result = segment_write_tag(state, NULL, &state->header_tags[i], state->headers[i], segment_rebase_timestamp(state, timestamp));
+            if (result != OK) {
+                return result;
+            }
+            state->header_written[i] = 1;
+        }
+    }
+    return OK;
+}
+
+/* write the chunk file header and computed onMetaData event */
+static int segment_write_header(FILE * flv_out, const flv_info * info, const flv_metadata * meta) {
+    flv_header header;
+    flv_tag omft;
+    uint32_be size;
+    uint32 on_metadata_name_size;
+    uint32 on_metadata_size;
+
+    memcpy(header.signature, FLV_SIGNATURE, sizeof(header.signature));
+    header.version = FLV_VERSION;
+    header.flags = (info->have_video ? FLV_FLAG_VIDEO : 0) | (info->have_audio ? FLV_FLAG_AUDIO : 0);
+    header.offset = swap_uint32(FLV_HEADER_SIZE);
+
+    on_metadata_name_size = (uint32)amf_data_size(meta->on_metadata_name);
+    on_metadata_size = (uint32)amf_data_size(meta->on_metadata);
+
+    omft.type = FLV_TAG_TYPE_META;
+    omft.body_length = uint32_to_uint24_be(on_metadata_name_size + on_metadata_size);
+    flv_tag_set_timestamp(&omft, 0);
+    omft.stream_id = uint32_to_uint24_be(0);
+
+    if (flv_write_header(flv_out, &header) != 1) {
+        return ERROR_WRITE;
+    }
+    size = swap_uint32(0);
+    if (stats_fwrite(&size, sizeof(uint32_be), 1, flv_out) != 1) {
+        return ERROR_WRITE;
+    }
+    size = swap_uint32(FLV_TAG_SIZE + on_metadata_name_size + on_metadata_size);
+    if (flv_write_tag(flv_out, &omft) != 1
+    || amf_data_file_write(meta->on_metadata_name, flv_out) < on_metadata_name_size
+    || amf_data_file_write(meta->on_metadata, flv_out) < on_metadata_size
+    || stats_fwrite(&size, sizeof(uint32_be), 1, flv_out) != 1) {
+        return ERROR_WRITE;
+    }
+    return OK;
+}
+
+/* copy the chunk data after the header of the chunk file */
+static int segment_copy_data(segment_state * state, FILE * flv_out) {
+    file_offset_t remaining;
+    size_t bytes;
+
+    if (stats_fseek(state->data, 0, SEEK_SET) != 0) {
+        return ERROR_WRITE;
+    }
+    remaining = state->data_size;
+    while (remaining > 0) {
+        bytes = (remaining > SEGMENT_COPY_BUFFER_SIZE) ? SEGMENT_COPY_BUFFER_SIZE : (size_t)remaining;
+        if (stats_fread(state->copy_buffer, 1, bytes, state->data) < bytes) {
+            return ERROR_WRITE;
+        }
+        if (stats_fwrite(state->copy_buffer, 1, bytes, flv_out) < bytes) {
+            return ERROR_WRITE;
+        }
+        remaining -= bytes;
+    }
+    return OK;
+}
+
+/* add a chunk to the manifest */
+static void segment_emit_chunk(segment_state * state, const flv_metadata * meta, file_offset_t size) {
+    const char * name;
+    const char * separator;
+
+    /* chunks are listed relative to the manifest */
+    name = state->filename;
+    separator = strrchr(name, '/');
+#ifdef WIN32
+    if (strrchr(name, '\\') > separator) {
+        separator = strrchr(name, '\\');
+    }
+#endif /* WIN32 */
+    if (separator != NULL) {
+        name = separator + 1;
+    }
+
+    json_emit_object_start(&state->je);
+    json_emit_object_key_z(&state->je, "file");
+    json_emit_string_z(&state->je, name);
+    json_emit_object_key_z(&state->je, "start");
+    json_emit_number(&state->je, state->chunk_timestamp / 1000.0);
+    json_emit_object_key_z(&state->je, "duration");
+    json_emit_number(&state->je, amf_number_get_value(amf_associative_array_get(meta->on_metadata, "duration")));
+    json_emit_object_key_z(&state->je, "size");
+    json_emit_file_offset(&state->je, size);
+    json_emit_object_end(&state->je);
+}
+
+/* write the current chunk into its own file */
+static int segment_finish_chunk(segment_state * state) {
+    flv_metadata meta;
+    FILE * flv_out;
+    file_offset_t size;
+    int result;
+
+    compute_metadata(&state->info, &meta, state->opts);
+
+    sprintf(state->filename, "%s-%05u.flv", state->prefix, (unsigned int)state->chunk_number);
+    trace_begin("write chunk", state->filename);
+    if (state->opts->verbose) {
+        fprintf(stdout, "Writing %s...\n", state->filename);
+    }
+
+    /* the chunk must not overwrite the file being read */
+    if (flvmeta_same_file(state->opts->input_file, state->filename)) {
+        result = ERROR_OPEN_WRITE;
+    }
+    else {
+        flv_out = fopen(state->filename, "wb");
+        if (flv_out == NULL) {
+            result = ERROR_OPEN_WRITE;
+        }
+        else {
+            result = segment_write_header(flv_out, &state->info, &meta);
+            if (result == OK) {
+                result = segment_copy_data(state, flv_out);
+            }
+            if (fclose(flv_out) != 0 && result == OK) {
+                result = ERROR_WRITE;
+            }
+        }
+    }
+
+    if (result == OK) {
+        size = FLV_HEADER_SIZE + sizeof(uint32_be)
+            + FLV_TAG_SIZE + amf_data_size(meta.on_metadata_name) + amf_data_size(meta.on_metadata) + sizeof(uint32_be)
+            + state->data_size;
+        segment_emit_chunk(state, &meta, size);
+
+        if (state->opts->verbose) {
+            fprintf(stdout, "%s successfully written\n", state->filename);
+        }
+    }
+
+    /* the next chunks keep the video size, since they may not carry it */
+    if (state->info.have_video_size) {
+        state->have_video_size = 1;
+        state->video_width = state->info.video_width;
+        state->video_height = state->info.video_height;
+    }
+
+    trace_end();
+    flv_metadata_free(&meta);
+    flv_info_free(&state->info);
+    state->chunk_open = 0;
+    ++state->chunk_number;
+    return result;
+}
+
+/*
+    keep the last sequence header of a stream, telling whether the tag
+    must be written, that is unless the chunk already has an identical one
+*/
+static int segment_store_header(segment_state * state, int header, const flv_tag * tag, uint32 body_length) {
+    if (state->have_header[header]
+    && state->header_sizes[header] == body_length
+    && memcmp(state->headers[header], state->buffer, body_length) == 0) {
+        if (state->header_written[header]) {
+            return 0;
+        }
+    }
+    else {
+        byte * new_header = (byte *)realloc(state->headers[header], body_length);
+        if (new_header == NULL) {
+            return ERROR_MEMORY;
+        }
+        memcpy(new_header, state->buffer, body_length);
+        memcpy(&state->header_tags[header], tag, sizeof(flv_tag));
+        state->headers[header] = new_header;
+        state->header_sizes[header] = body_length;
+        state->have_header[header] = 1;
+    }
+    state->header_written[header] = 1;
+    return 1;
+}
+
+/* copy the tags of the input file into the chunks, in a single pass */
+static int segment_tags(segment_state * state) {
+    flv_tag tag;
+    uint32 body_length;
+    uint32 timestamp;
+    int header, result;
+
+    while (flv_read_tag(state->flv_in, &tag) == FLV_OK) {
+        input_tag(state->opts, state->flv_in, &tag);
+        body_length = flv_tag_get_body_length(tag);
+
+        /* script data refer to the original file, and onMetaData is recomputed */
+        if ((tag.type != FLV_TAG_TYPE_VIDEO && tag.type != FLV_TAG_TYPE_AUDIO) || body_length == 0) {
+            continue;
+        }
+
+        /* stop at the first truncated tag */
+        result = segment_read_body(state, body_length);
+        if (result == ERROR_EOF) {
+            break;
+        }
+        else if (result != OK) {
+            return result;
+        }
+
+        timestamp = segment_fix_timestamp(state, &tag);
+        header = segment_sequence_header(state, &tag, body_length);
+
+        if (!state->chunk_open
+        || (header == SEGMENT_NO_HEADER && segment_is_boundary(state, &tag, timestamp))) {
+            if (state->chunk_open) {
+                result = segment_finish_chunk(state);
+                if (result != OK) {
+                    return result;
+                }
+            }
+            result = segment_start_chunk(state, timestamp);
+            if (result != OK) {
+                return result;
+            }
+        }
+
+        if (header != SEGMENT_NO_HEADER) {
+            result = segment_store_header(state, header, &tag, body_length);
+            if (result == 0) {
+                continue;
+            }
+            else if (result != 1) {
+                return result;
+            }
+        }
+
+        result = segment_write_tag(state, state->flv_in, &tag, state->buffer, segment_rebase_timestamp(state, timestamp));
+        if (result != OK) {
+            return result;
+        }
+    }
+
+    if (state->chunk_open) {
+        return segment_finish_chunk(state);
+    }
+    return OK;
+}
+
+int segment_flv_file(const flvmeta_opts * options, output_sink * out) {
+    flvmeta_opts segment_opts;
+    segment_state state;
+    flv_header header;
+    int res;
+
+    /* the computed metadata describe each chunk only */
+    memcpy(&segment_opts, options, sizeof(flvmeta_opts));
+    segment_opts.insert_onlastsecond = 0;
+    segment_opts.reset_timestamps = 0;
+    segment_opts.preserve_metadata = 0;
+
+    res = segment_state_init(&state, &segment_opts, out);
+    if (res != OK) {
+        segment_state_free(&state);
+        return res;
+    }
+    /* timestamps are rebased on each chunk by the segmenter itself */
+    state.reset_timestamps = (uint8)options->reset_timestamps;
+
+    state.flv_in = input_open(options, options->input_file);
+    if (state.flv_in == NULL) {
+        segment_state_free(&state);
+        return ERROR_OPEN_READ;
+    }
+    if (input_read_header(options, state.flv_in, &header) != FLV_OK) {
+        input_close(options, state.flv_in);
+        segment_state_free(&state);
+        return ERROR_NO_FLV;
+    }
+    state.input_has_video = (header.flags & FLV_FLAG_VIDEO) != 0;
+
+    state.data = flvmeta_tmpfile();
+    if (state.data == NULL) {
+        input_close(options, state.flv_in);
+        segment_state_free(&state);
+        return ERROR_OPEN_WRITE;
+    }
+
+    json_emit_object_start(&state.je);
+    json_emit_object_key_z(&state.je, "duration");
+    json_emit_number(&state.je, options->segment_duration);
+    json_emit_object_key_z(&state.je, "segments");
+    json_emit_array_start(&state.je);
+
+    res = segment_tags(&state);
+
+    json_emit_array_end(&state.je);
+    json_emit_object_end(&state.je);
+    sink_write_char(out, '\n');
+
+    fclose(state.data);
+    input_close(options, state.flv_in);
+    segment_state_free(&state);
+    return res;
+}
@@ -0,0 +1,43 @@
+/*
+    FLVMeta - FLV Metadata Editor
+
+    Copyright (C) 2007-2014 Marc Noirot <marc.noirot AT gmail.com>
+
+    This file is part of FLVMeta.
+
+    FLVMeta is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    FLVMeta is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FLVMeta; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+#ifndef __SEGMENT_H__
+#define __SEGMENT_H__
+
+#include "flvmeta.h"
+#include "sink.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/*
+    split the input file into keyframe-aligned chunks, each with its own
+    header, sequence headers and computed onMetaData event, and write
+    a JSON manifest of the chunks to the output sink
+*/
+extern int segment_flv_file(const flvmeta_opts * options, output_sink * out);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __SEGMENT_H__ */
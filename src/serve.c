@@ -0,0 +1,1367 @@
+/*
+    FLVMeta - FLV Metadata Editor
+
+    Copyright (C) 2007-2014 Marc Noirot <marc.noirot AT gmail.com>
+
+    This file is part of FLVMeta.
+
+    FLVMeta is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    FLVMeta is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FLVMeta; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include "serve.h"
+
+#ifndef WIN32
+
+#include "check.h"
+#include "dump_json.h"
+#include "info.h"
+#include "json.h"
+#include "keyframes.h"
+#include "libflvmeta.h"
+#include "sink.h"
+#include "update.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <float.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+/* maximum number of files kept in the cache */
+#define SERVE_CACHE_SIZE 256
+
+/* maximum size of a request line, and initial size of the request buffers */
+#define SERVE_REQUEST_SIZE 65536
+#define SERVE_REQUEST_INITIAL_SIZE 4096
+
+/* size of the response buffer of each worker */
+#define SERVE_RESPONSE_BUFFER_SIZE 65536
+
+/* maximum number of open connections, further clients are answered busy */
+#define SERVE_MAX_CONNECTIONS 256
+
+/*
+    connections idle for this long are closed, and responses not read
+    by their client for this long are abandoned, in seconds
+*/
+#define SERVE_IDLE_TIMEOUT 60
+
+/*
+    identity of a file version: its inode, size, and modification and
+    change times, to the nanosecond where available
+*/
+typedef struct __serve_key {
+    dev_t dev;
+    ino_t ino;
+    off_t size;
+    time_t mtime;
+    long mtime_nsec;
+    time_t ctime;
+    long ctime_nsec;
+} serve_key;
+
+/* information cached for a file, identified by its key */
+typedef struct __serve_entry {
+    serve_key key;
+    amf_data * on_metadata;
+    keyframe_index keyframes;
+    /* workers using the entry, which is freed on last release once evicted */
+    int refs;
+    int evicted;
+    struct __serve_entry * prev;
+    struct __serve_entry * next;
+} serve_entry;
+
+/* least recently used cache, most recently used entry first */
+typedef struct __serve_cache {
+    serve_entry * first;
+    serve_entry * last;
+    uint32 count;
+} serve_cache;
+
+/*
+    client connection, polled by the dispatcher until it holds complete
+    request lines, then handed to a worker which answers all of them
+*/
+typedef struct __serve_connection {
+    int fd;
+    char * request;
+    size_t length;
+    size_t size;
+    /* the end of a request too large to be answered is being skipped */
+    int discarding;
+    /* handed to a worker, and not polled until it is given back */
+    int busy;
+    /* closed by the client, or failed */
+    int closing;
+    time_t last_activity;
+} serve_connection;
+
+struct __serve_server;
+
+typedef struct __serve_worker {
+    struct __serve_server * server;
+    pthread_t thread;
+    char * response;
+} serve_worker;
+
+typedef struct __serve_server {
+    const flvmeta_opts * options;
+    pthread_mutex_t lock;
+    pthread_cond_t queue_not_empty;
+    /* connections holding requests, each queued at most once */
+    serve_connection * queue[SERVE_MAX_CONNECTIONS];
+    int queue_start;
+    int queue_count;
+    int stopping;
+    /* open connections, only managed by the dispatcher */
+    serve_connection * connections[SERVE_MAX_CONNECTIONS];
+    int connections_count;
+    /* pipe waking the dispatcher up when a connection is given back */
+    int wake[2];
+    serve_cache cache;
+    serve_worker * workers;
+    int workers_count;
+} serve_server;
+
+/* request fields, strings pointing into the request line */
+typedef struct __serve_request {
+    char * command;
+    char * file;
+    char * output;
+    char * level;
+    number64 time;
+    int have_time;
+} serve_request;
+
+/* growable buffer capturing check reports */
+typedef struct __serve_buffer {
+    char * data;
+    size_t length;
+    size_t size;
+} serve_buffer;
+
+/* set by the termination signals, which also wake the dispatcher up */
+static volatile sig_atomic_t serve_interrupted = 0;
+static int serve_signal_fd = -1;
+
+static void serve_on_signal(int sig) {
+    int saved_errno = errno;
+
+    serve_interrupted = 1;
+    if (serve_signal_fd >= 0 && write(serve_signal_fd, "", 1) < 0) {
+        /* the pipe is already full, the dispatcher will wake up anyway */
+    }
+    errno = saved_errno;
+}
+
+/* cache management */
+static void serve_entry_free(serve_entry * entry) {
+    amf_data_free(entry->on_metadata);
+    keyframe_index_free(&entry->keyframes);
+    free(entry);
+}
+
+static void serve_cache_unlink(serve_cache * cache, serve_entry * entry) {
+    if (entry->prev != NULL) {
+        entry->prev->next = entry->next;
+    }
+    else {
+        cache->first = entry->next;
+    }
+    if (entry->next != NULL) {
+        entry->next->prev = entry->prev;
+    }
+    else {
+        cache->last = entry->prev;
+    }
+    entry->prev = entry->next = NULL;
+    --cache->count;
+}
+
+static void serve_cache_push_front(serve_cache * cache, serve_entry * entry) {
+    entry->prev = NULL;
+    entry->next = cache->first;
+    if (cache->first != NULL) {
+        cache->first->prev = entry;
+    }
+    else {
+        cache->last = entry;
+    }
+    cache->first = entry;
+    ++cache->count;
+}
+
+static void serve_key_init(serve_key * key, const struct stat * st) {
+    key->dev = st->st_dev;
+    key->ino = st->st_ino;
+    key->size = st->st_size;
+    key->mtime = st->st_mtime;
+    key->ctime = st->st_ctime;
+#ifdef HAVE_STRUCT_STAT_ST_MTIM
+    key->mtime_nsec = st->st_mtim.tv_nsec;
+    key->ctime_nsec = st->st_ctim.tv_nsec;
+#else
+    key->mtime_nsec = 0;
+    key->ctime_nsec = 0;
+#endif
+}
+
+static int serve_key_equals(const serve_key * a, const serve_key * b) {
+    return a->ino == b->ino && a->dev == b->dev && a->size == b->size
+        && a->mtime == b->mtime && a->mtime_nsec == b->mtime_nsec
+        && a->ctime == b->ctime && a->ctime_nsec == b->ctime_nsec;
+}
+
+static serve_entry * serve_cache_find(serve_cache * cache, const serve_key * key) {
+    serve_entry * entry;
+
+    for (entry = cache->first; entry != NULL; entry = entry->next) {
+        if (serve_key_equals(&entry->key, key)) {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+/*
+    parse a file into a new cache entry, keyed by the file actually
+    parsed, even if it was replaced since it was looked up
+*/
+static int serve_entry_load(const char * filename, serve_entry ** result) {
+    flvmeta_opts options;
+    flv_stream * flv_in;
+    flv_info info;
+    struct stat st;
+    serve_entry * entry;
+    int retval;
+
+    flv_in = flv_open(filename);
+    if (flv_in == NULL) {
+        return ERROR_OPEN_READ;
+    }
+    if (fstat(fileno(flv_in->flvin), &st) != 0) {
+        flv_close(flv_in);
+        return ERROR_OPEN_READ;
+    }
+
+    /* keep the original onMetaData event */
+    flvmeta_opts_init(&options);
+    options.preserve_metadata = 1;
+
+    retval = get_flv_info(flv_in, &info, &options);
+    flv_close(flv_in);
+    if (retval != OK) {
+        flv_info_free(&info);
+        return retval;
+    }
+
+    entry = (serve_entry *)calloc(1, sizeof(serve_entry));
+    if (entry == NULL) {
+        flv_info_free(&info);
+        return ERROR_MEMORY;
+    }
+
+    serve_key_init(&entry->key, &st);
+
+    /* files without keyframes have an empty index */
+    keyframe_index_init(&entry->keyframes);
+    retval = keyframe_index_pack(&entry->keyframes, info.times, info.filepositions, (file_offset_t)st.st_size);
+    if (retval == ERROR_MEMORY) {
+        serve_entry_free(entry);
+        flv_info_free(&info);
+        return retval;
+    }
+
+    /* files without onMetaData event have none */
+    if (info.on_metadata_size > 0) {
+        entry->on_metadata = info.original_on_metadata;
+        info.original_on_metadata = NULL;
+    }
+
+    flv_info_free(&info);
+    *result = entry;
+    return OK;
+}
+
+/* get the entry of a file, loading it if needed */
+static int serve_cache_acquire(serve_server * server, const char * filename, serve_entry ** result) {
+    struct stat st;
+    serve_key key;
+    serve_entry * entry;
+    serve_entry * loaded;
+    serve_entry * evicted;
+    int retval;
+
+    if (stat(filename, &st) != 0) {
+        return ERROR_OPEN_READ;
+    }
+    serve_key_init(&key, &st);
+
+    pthread_mutex_lock(&server->lock);
+    entry = serve_cache_find(&server->cache, &key);
+    if (entry != NULL) {
+        serve_cache_unlink(&server->cache, entry);
+        serve_cache_push_front(&server->cache, entry);
+        ++entry->refs;
+        pthread_mutex_unlock(&server->lock);
+        *result = entry;
+        return OK;
+    }
+    pthread_mutex_unlock(&server->lock);
+
+    /* parse the file without holding the lock */
+    retval = serve_entry_load(filename, &loaded);
+    if (retval != OK) {
+        return retval;
+    }
+
+    pthread_mutex_lock(&server->lock);
+    /* another worker may have loaded the same file meanwhile */
+    entry = serve_cache_find(&server->cache, &loaded->key);
+    if (entry != NULL) {
+        serve_cache_unlink(&server->cache, entry);
+    }
+    else {
+        entry = loaded;
+        loaded = NULL;
+    }
+    serve_cache_push_front(&server->cache, entry);
+    ++entry->refs;
+
+    /* evict the least recently used entries */
+    while (server->cache.count > SERVE_CACHE_SIZE) {
+        evicted = server->cache.last;
+        serve_cache_unlink(&server->cache, evicted);
+        if (evicted->refs == 0) {
+            serve_entry_free(evicted);
+        }
+        else {
+            evicted->evicted = 1;
+        }
+    }
+    pthread_mutex_unlock(&server->lock);
+
+    if (loaded != NULL) {
+        serve_entry_free(loaded);
+    }
+    *result = entry;
+    return OK;
+}
+
+static void serve_cache_release(serve_server * server, serve_entry * entry) {
+    int release;
+
+    pthread_mutex_lock(&server->lock);
+    --entry->refs;
+    release = (entry->evicted && entry->refs == 0);
+    pthread_mutex_unlock(&server->lock);
+
+    if (release) {
+        serve_entry_free(entry);
+    }
+}
+
+/* request parsing */
+static char * serve_skip_spaces(char * p) {
+    while (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n') {
+        ++p;
+    }
+    return p;
+}
+
+static int serve_parse_hex4(const char * p, unsigned long * value) {
+    int i;
+
+    *value = 0;
+    for (i = 0; i < 4; ++i) {
+        char c = p[i];
+        *value <<= 4;
+        if (c >= '0' && c <= '9') {
+            *value |= (unsigned long)(c - '0');
+        }
+        else if (c >= 'a' && c <= 'f') {
+            *value |= (unsigned long)(c - 'a' + 10);
+        }
+        else if (c >= 'A' && c <= 'F') {
+            *value |= (unsigned long)(c - 'A' + 10);
+        }
+        else {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static char * serve_put_utf8(char * w, unsigned long c) {
+    if (c < 0x80) {
+        *w++ = (char)c;
+    }
+    else if (c < 0x800) {
+        *w++ = (char)(0xC0 | (c >> 6));
+        *w++ = (char)(0x80 | (c & 0x3F));
+    }
+    else if (c < 0x10000) {
+        *w++ = (char)(0xE0 | (c >> 12));
+        *w++ = (char)(0x80 | ((c >> 6) & 0x3F));
+        *w++ = (char)(0x80 | (c & 0x3F));
+    }
+    else {
+        *w++ = (char)(0xF0 | (c >> 18));
+        *w++ = (char)(0x80 | ((c >> 12) & 0x3F));
+        *w++ = (char)(0x80 | ((c >> 6) & 0x3F));
+        *w++ = (char)(0x80 | (c & 0x3F));
+    }
+    return w;
+}
+
+/*
+    decode a JSON string in place, p pointing to its opening quote,
+    returns the position following the closing quote or NULL on error
+*/
+static char * serve_parse_string(char * p, char ** value) {
+    char * w;
+    unsigned long code, low;
+    char c;
+
+    *value = w = ++p;
+    for (;;) {
+        c = *p++;
+        if (c == '"') {
+            *w = '\0';
+            return p;
+        }
+        if ((unsigned char)c < 0x20) {
+            return NULL;
+        }
+        if (c != '\\') {
+            *w++ = c;
+            continue;
+        }
+
+        c = *p++;
+        switch (c) {
+            case '"':
+            case '\\':
+            case '/': *w++ = c; break;
+            case 'b': *w++ = '\b'; break;
+            case 'f': *w++ = '\f'; break;
+            case 'n': *w++ = '\n'; break;
+            case 'r': *w++ = '\r'; break;
+            case 't': *w++ = '\t'; break;
+            case 'u':
+                if (!serve_parse_hex4(p, &code)) {
+                    return NULL;
+                }
+                p += 4;
+                /* surrogate pair */
+                if (code >= 0xD800 && code <= 0xDBFF && p[0] == '\\' && p[1] == 'u'
+                && serve_parse_hex4(p + 2, &low) && low >= 0xDC00 && low <= 0xDFFF) {
+                    code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                    p += 6;
+                }
+                w = serve_put_utf8(w, code);
+                break;
+            default: return NULL;
+        }
+    }
+}
+
+/* parse a request made of a flat JSON object, returns 0 if invalid */
+/*
+    parse a number following the JSON grammar, which excludes the hex,
+    infinite and NaN values strtod also accepts, returning the position
+    after the number, or NULL if it is invalid or out of range
+*/
+static char * serve_parse_number(char * p, number64 * value) {
+    char * start;
+    char * end;
+
+    start = p;
+    if (*p == '-') {
+        ++p;
+    }
+    if (*p == '0') {
+        ++p;
+    }
+    else if (*p >= '1' && *p <= '9') {
+        while (*p >= '0' && *p <= '9') {
+            ++p;
+        }
+    }
+    else {
+        return NULL;
+    }
+    if (*p == '.') {
+        ++p;
+        if (*p < '0' || *p > '9') {
+            return NULL;
+        }
+        while (*p >= '0' && *p <= '9') {
+            ++p;
+        }
+    }
+    if (*p == 'e' || *p == 'E') {
+        ++p;
+        if (*p == '+' || *p == '-') {
+            ++p;
+        }
+        if (*p < '0' || *p > '9') {
+            return NULL;
+        }
+        while (*p >= '0' && *p <= '9') {
+            ++p;
+        }
+    }
+
+    *value = strtod(start, &end);
+    if (end != p || *value > DBL_MAX || *value < -DBL_MAX) {
+        return NULL;
+    }
+    return p;
+}
+
+static int serve_parse_request(char * line, serve_request * req) {
+    char * p;
+    char * key;
+    char * str;
+    number64 value;
+
+    memset(req, 0, sizeof(serve_request));
+
+    p = serve_skip_spaces(line);
+    if (*p != '{') {
+        return 0;
+    }
+    p = serve_skip_spaces(p + 1);
+
+    if (*p != '}') {
+        for (;;) {
+            if (*p != '"') {
+                return 0;
+            }
+            p = serve_parse_string(p, &key);
+            if (p == NULL) {
+                return 0;
+            }
+            p = serve_skip_spaces(p);
+            if (*p != ':') {
+                return 0;
+            }
+            p = serve_skip_spaces(p + 1);
+
+            if (*p == '"') {
+                p = serve_parse_string(p, &str);
+                if (p == NULL) {
+                    return 0;
+                }
+                if (!strcmp(key, "command")) {
+                    req->command = str;
+                }
+                else if (!strcmp(key, "file")) {
+                    req->file = str;
+                }
+                else if (!strcmp(key, "output")) {
+                    req->output = str;
+                }
+                else if (!strcmp(key, "level")) {
+                    req->level = str;
+                }
+            }
+            else if (*p == '-' || (*p >= '0' && *p <= '9')) {
+                p = serve_parse_number(p, &value);
+                if (p == NULL) {
+                    return 0;
+                }
+                if (!strcmp(key, "time")) {
+                    req->time = value;
+                    req->have_time = 1;
+                }
+            }
+            else if (!strncmp(p, "true", 4) || !strncmp(p, "null", 4)) {
+                p += 4;
+            }
+            else if (!strncmp(p, "false", 5)) {
+                p += 5;
+            }
+            else {
+                /* nested objects and arrays are not supported */
+                return 0;
+            }
+
+            p = serve_skip_spaces(p);
+            if (*p == '}') {
+                break;
+            }
+            if (*p != ',') {
+                return 0;
+            }
+            p = serve_skip_spaces(p + 1);
+        }
+    }
+
+    p = serve_skip_spaces(p + 1);
+    return (*p == '\0');
+}
+
+/* responses */
+static void serve_respond_error(json_emitter * je, const char * message) {
+    json_emit_object_start(je);
+    json_emit_object_key_z(je, "status");
+    json_emit_string_z(je, "error");
+    json_emit_object_key_z(je, "message");
+    json_emit_string_z(je, message);
+    json_emit_object_end(je);
+}
+
+static void serve_respond_ok(json_emitter * je) {
+    json_emit_object_key_z(je, "status");
+    json_emit_string_z(je, "ok");
+}
+
+static void serve_dump(serve_server * server, const serve_request * req, json_emitter * je) {
+    serve_entry * entry;
+    int retval;
+
+    retval = serve_cache_acquire(server, req->file, &entry);
+    if (retval != OK) {
+        serve_respond_error(je, flvmeta_error_string(retval));
+        return;
+    }
+
+    json_emit_object_start(je);
+    serve_respond_ok(je);
+    json_emit_object_key_z(je, "metadata");
+    if (entry->on_metadata != NULL) {
+        json_amf_data_dump(entry->on_metadata, je);
+    }
+    else {
+        json_emit_null(je);
+    }
+    json_emit_object_end(je);
+
+    serve_cache_release(server, entry);
+}
+
+static void serve_keyframe(serve_server * server, const serve_request * req, json_emitter * je) {
+    serve_entry * entry;
+    uint32 index;
+    int retval;
+
+    if (!req->have_time) {
+        serve_respond_error(je, "missing time");
+        return;
+    }
+
+    retval = serve_cache_acquire(server, req->file, &entry);
+    if (retval != OK) {
+        serve_respond_error(je, flvmeta_error_string(retval));
+        return;
+    }
+
+    if (entry->keyframes.count == 0) {
+        serve_respond_error(je, flvmeta_error_string(ERROR_NO_KEYFRAMES));
+    }
+    else {
+        index = keyframe_index_find(&entry->keyframes, req->time);
+        json_emit_object_start(je);
+        serve_respond_ok(je);
+        json_emit_object_key_z(je, "time");
+        json_emit_number(je, entry->keyframes.times[index]);
+        json_emit_object_key_z(je, "offset");
+        json_emit_file_offset(je, entry->keyframes.filepositions[index]);
+        json_emit_object_end(je);
+    }
+
+    serve_cache_release(server, entry);
+}
+
+static size_t serve_buffer_write(const void * data, size_t size, void * user_data) {
+    serve_buffer * buffer = (serve_buffer *)user_data;
+    char * new_data;
+    size_t new_size;
+
+    if (buffer->length + size > buffer->size) {
+        new_size = buffer->size * 2 + size;
+        new_data = (char *)realloc(buffer->data, new_size);
+        if (new_data == NULL) {
+            return 0;
+        }
+        buffer->data = new_data;
+        buffer->size = new_size;
+    }
+    memcpy(buffer->data + buffer->length, data, size);
+    buffer->length += size;
+    return size;
+}
+
+static void serve_check(const serve_request * req, json_emitter * je) {
+    flvmeta_opts options;
+    output_sink report;
+    serve_buffer buffer;
+    char report_buffer[4096];
+    int retval;
+
+    flvmeta_opts_init(&options);
+    options.command = FLVMETA_CHECK_COMMAND;
+    options.input_file = req->file;
+    options.check_report_format = FLVMETA_FORMAT_JSON;
+
+    if (req->level != NULL) {
+        if (!strcmp(req->level, "info")) {
+            options.check_level = FLVMETA_CHECK_LEVEL_INFO;
+        }
+        else if (!strcmp(req->level, "warning")) {
+            options.check_level = FLVMETA_CHECK_LEVEL_WARNING;
+        }
+        else if (!strcmp(req->level, "error")) {
+            options.check_level = FLVMETA_CHECK_LEVEL_ERROR;
+        }
+        else if (!strcmp(req->level, "fatal")) {
+            options.check_level = FLVMETA_CHECK_LEVEL_FATAL;
+        }
+        else {
+            serve_respond_error(je, "invalid level");
+            return;
+        }
+    }
+
+    /* capture the report to embed it into the response */
+    buffer.data = NULL;
+    buffer.length = 0;
+    buffer.size = 0;
+    sink_init(&report, serve_buffer_write, NULL, &buffer, report_buffer, sizeof(report_buffer));
+    retval = check_flv_file(&options, &report);
+    if (sink_close(&report) != 0) {
+        retval = ERROR_MEMORY;
+    }
+
+    if (retval == OK || retval == ERROR_INVALID_FLV_FILE) {
+        /* the report ends with a line feed */
+        while (buffer.length > 0 && buffer.data[buffer.length - 1] == '\n') {
+            --buffer.length;
+        }
+        json_emit_object_start(je);
+        serve_respond_ok(je);
+        json_emit_object_key_z(je, "valid");
+        json_emit_boolean(je, retval == OK);
+        json_emit_object_key_z(je, "report");
+        json_emit_raw(je, buffer.data, buffer.length);
+        json_emit_object_end(je);
+    }
+    else {
+        serve_respond_error(je, flvmeta_error_string(retval));
+    }
+
+    free(buffer.data);
+}
+
+/* whether a path contains a ".." component */
+static int serve_has_parent_component(const char * path) {
+    const char * component;
+    size_t length;
+
+    component = path;
+    for (;;) {
+        length = strcspn(component, "/");
+        if (length == 2 && component[0] == '.' && component[1] == '.') {
+            return 1;
+        }
+        if (component[length] == '\0') {
+            return 0;
+        }
+        component += length + 1;
+    }
+}
+
+/*
+    whether the output of an update request is allowed: the input file
+    itself, or a relative path without ".." components, taken from the
+    directory of the input file, so that clients cannot write outside of
+    the directories they can already update files in
+*/
+static int serve_output_is_valid(const char * file, const char * output) {
+    if (output == NULL || !strcmp(output, file)) {
+        return 1;
+    }
+    return *output != '\0' && *output != '/' && !serve_has_parent_component(output);
+}
+
+/* path of the output of an update request, to be freed */
+static char * serve_output_path(const char * file, const char * output) {
+    const char * slash;
+    char * path;
+    size_t directory_length;
+
+    if (output == NULL || !strcmp(output, file)) {
+        output = file;
+        directory_length = 0;
+    }
+    else {
+        slash = strrchr(file, '/');
+        directory_length = (slash != NULL) ? (size_t)(slash - file) + 1 : 0;
+    }
+
+    path = (char *)malloc(directory_length + strlen(output) + 1);
+    if (path != NULL) {
+        memcpy(path, file, directory_length);
+        strcpy(path + directory_length, output);
+    }
+    return path;
+}
+
+static void serve_update(const serve_request * req, json_emitter * je) {
+    flvmeta_opts options;
+    char * output;
+    int retval;
+
+    if (!serve_output_is_valid(req->file, req->output)) {
+        serve_respond_error(je, "invalid output");
+        return;
+    }
+
+    output = serve_output_path(req->file, req->output);
+    if (output == NULL) {
+        serve_respond_error(je, flvmeta_error_string(ERROR_MEMORY));
+        return;
+    }
+
+    flvmeta_opts_init(&options);
+    options.command = FLVMETA_UPDATE_COMMAND;
+    options.input_file = req->file;
+    options.output_file = output;
+
+    /* no metadata dump is requested, so the update writes nothing to the sink */
+    retval = update_metadata(&options, NULL);
+    free(output);
+    if (retval == OK) {
+        json_emit_object_start(je);
+        serve_respond_ok(je);
+        json_emit_object_end(je);
+    }
+    else {
+        serve_respond_error(je, flvmeta_error_string(retval));
+    }
+}
+
+/* answer a single request line */
+static void serve_process(serve_server * server, char * line, output_sink * out) {
+    serve_request req;
+    json_emitter je;
+
+    /* ignore blank lines */
+    if (*serve_skip_spaces(line) == '\0') {
+        return;
+    }
+
+    json_emit_init(&je, out);
+
+    if (!serve_parse_request(line, &req)) {
+        serve_respond_error(&je, "invalid request");
+    }
+    else if (req.command == NULL) {
+        serve_respond_error(&je, "missing command");
+    }
+    else if (strcmp(req.command, "dump") && strcmp(req.command, "keyframe")
+    && strcmp(req.command, "check") && strcmp(req.command, "update")) {
+        serve_respond_error(&je, "unknown command");
+    }
+    else if (req.file == NULL) {
+        serve_respond_error(&je, "missing file");
+    }
+    else if (!strcmp(req.command, "dump")) {
+        serve_dump(server, &req, &je);
+    }
+    else if (!strcmp(req.command, "keyframe")) {
+        serve_keyframe(server, &req, &je);
+    }
+    else if (!strcmp(req.command, "check")) {
+        serve_check(&req, &je);
+    }
+    else {
+        serve_update(&req, &je);
+    }
+
+    sink_write_char(out, '\n');
+}
+
+/* connection handling */
+static size_t serve_socket_write(const void * data, size_t size, void * user_data) {
+    int fd = *(int *)user_data;
+    size_t written;
+    ssize_t n;
+
+    written = 0;
+    while (written < size) {
+        n = send(fd, (const char *)data + written, size - written, 0);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            /* including a client not reading its responses for too long */
+            break;
+        }
+        written += (size_t)n;
+    }
+    return written;
+}
+
+/* wake the dispatcher up, from a worker */
+static void serve_wake(serve_server * server) {
+    if (write(server->wake[1], "", 1) < 0) {
+        /* the pipe is already full, the dispatcher will wake up anyway */
+    }
+}
+
+/* answer every complete request line of a connection, in a worker */
+static void serve_answer(serve_worker * worker, serve_connection * connection) {
+    output_sink out;
+    json_emitter je;
+    char * request;
+    char * line_end;
+    size_t start;
+
+    request = connection->request;
+    sink_init(&out, serve_socket_write, NULL, &connection->fd, worker->response, SERVE_RESPONSE_BUFFER_SIZE);
+
+    start = 0;
+    while ((line_end = (char *)memchr(request + start, '\n', connection->length - start)) != NULL) {
+        *line_end = '\0';
+        if (connection->discarding) {
+            /* end of a request too large to be answered */
+            connection->discarding = 0;
+        }
+        else {
+            serve_process(worker->server, request + start, &out);
+        }
+        start = (size_t)(line_end - request) + 1;
+    }
+
+    if (start > 0) {
+        /* keep the incomplete line for the next read */
+        memmove(request, request + start, connection->length - start);
+        connection->length -= start;
+    }
+    else if (connection->length == SERVE_REQUEST_SIZE) {
+        if (!connection->discarding) {
+            json_emit_init(&je, &out);
+            serve_respond_error(&je, "request too large");
+            sink_write_char(&out, '\n');
+            connection->discarding = 1;
+        }
+        /* skip the request until its end */
+        connection->length = 0;
+    }
+
+    if (sink_close(&out) != 0) {
+        connection->closing = 1;
+    }
+}
+
+static void * serve_worker_main(void * arg) {
+    serve_worker * worker = (serve_worker *)arg;
+    serve_server * server = worker->server;
+    serve_connection * connection;
+
+    for (;;) {
+        pthread_mutex_lock(&server->lock);
+        while (server->queue_count == 0 && !server->stopping) {
+            pthread_cond_wait(&server->queue_not_empty, &server->lock);
+        }
+        if (server->stopping) {
+            pthread_mutex_unlock(&server->lock);
+            break;
+        }
+        connection = server->queue[server->queue_start];
+        server->queue_start = (server->queue_start + 1) % SERVE_MAX_CONNECTIONS;
+        --server->queue_count;
+        pthread_mutex_unlock(&server->lock);
+
+        serve_answer(worker, connection);
+
+        /* give the connection back to the dispatcher */
+        pthread_mutex_lock(&server->lock);
+        connection->busy = 0;
+        connection->last_activity = time(NULL);
+        pthread_mutex_unlock(&server->lock);
+        serve_wake(server);
+    }
+    return NULL;
+}
+
+/* hand a connection holding requests to the workers */
+static void serve_dispatch(serve_server * server, serve_connection * connection) {
+    pthread_mutex_lock(&server->lock);
+    connection->busy = 1;
+    server->queue[(server->queue_start + server->queue_count) % SERVE_MAX_CONNECTIONS] = connection;
+    ++server->queue_count;
+    pthread_cond_signal(&server->queue_not_empty);
+    pthread_mutex_unlock(&server->lock);
+}
+
+static int serve_is_busy(serve_server * server, serve_connection * connection) {
+    int busy;
+
+    pthread_mutex_lock(&server->lock);
+    busy = connection->busy;
+    pthread_mutex_unlock(&server->lock);
+    return busy;
+}
+
+/* accept a client, or answer that the server is busy */
+static void serve_accept(serve_server * server, int listener) {
+    serve_connection * connection;
+    struct timeval timeout;
+    static const char busy[] = "{\"status\":\"error\",\"message\":\"server busy\"}\n";
+    int client;
+
+    client = accept(listener, NULL, NULL);
+    if (client < 0) {
+        return;
+    }
+
+    if (server->connections_count == SERVE_MAX_CONNECTIONS) {
+        /* a fresh socket buffer always has room for this line */
+        if (send(client, busy, sizeof(busy) - 1, MSG_DONTWAIT) < 0) {
+            /* the client is gone already */
+        }
+        close(client);
+        return;
+    }
+
+    connection = (serve_connection *)calloc(1, sizeof(serve_connection));
+    if (connection != NULL) {
+        connection->request = (char *)malloc(SERVE_REQUEST_INITIAL_SIZE);
+    }
+    if (connection == NULL || connection->request == NULL) {
+        free(connection);
+        close(client);
+        return;
+    }
+    connection->fd = client;
+    connection->size = SERVE_REQUEST_INITIAL_SIZE;
+    connection->last_activity = time(NULL);
+
+    /* workers do not wait forever for clients not reading their responses */
+    timeout.tv_sec = SERVE_IDLE_TIMEOUT;
+    timeout.tv_usec = 0;
+    setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+    server->connections[server->connections_count++] = connection;
+}
+
+static void serve_close(serve_server * server, int index) {
+    serve_connection * connection = server->connections[index];
+
+    close(connection->fd);
+    free(connection->request);
+    free(connection);
+    server->connections[index] = server->connections[--server->connections_count];
+}
+
+/* read the available data of a connection, handing it to a worker once it holds requests */
+static void serve_read(serve_server * server, serve_connection * connection) {
+    char * new_request;
+    ssize_t n;
+
+    if (connection->length == connection->size) {
+        new_request = (char *)realloc(connection->request, connection->size * 2);
+        if (new_request == NULL) {
+            connection->closing = 1;
+            return;
+        }
+        connection->request = new_request;
+        connection->size *= 2;
+    }
+
+    n = read(connection->fd, connection->request + connection->length, connection->size - connection->length);
+    if (n < 0 && (errno == EINTR || errno == EAGAIN)) {
+        return;
+    }
+    if (n <= 0) {
+        /* requests sent before the end of the connection are still answered */
+        connection->closing = 1;
+    }
+    else {
+        connection->length += (size_t)n;
+        connection->last_activity = time(NULL);
+    }
+
+    if (memchr(connection->request, '\n', connection->length) != NULL
+    || connection->length == SERVE_REQUEST_SIZE) {
+        serve_dispatch(server, connection);
+    }
+}
+
+/*
+    close the connections which have ended or have been idle for too
+    long, returning the delay until the next idle timeout, in milliseconds
+*/
+static int serve_close_idle(serve_server * server) {
+    serve_connection * connection;
+    time_t now, deadline;
+    int i, delay;
+
+    now = time(NULL);
+    delay = -1;
+    for (i = server->connections_count - 1; i >= 0; --i) {
+        connection = server->connections[i];
+        if (serve_is_busy(server, connection)) {
+            continue;
+        }
+        deadline = connection->last_activity + SERVE_IDLE_TIMEOUT;
+        if (connection->closing || now >= deadline) {
+            serve_close(server, i);
+        }
+        else if (delay < 0 || (deadline - now) * 1000 < delay) {
+            delay = (int)(deadline - now) * 1000;
+        }
+    }
+    return delay;
+}
+
+/* open the listening socket, replacing a stale one */
+static int serve_listen(const char * path) {
+    struct sockaddr_un address;
+    struct stat st;
+    int fd;
+
+    if (strlen(path) >= sizeof(address.sun_path)) {
+        return -1;
+    }
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, path);
+
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+
+    if (lstat(path, &st) == 0 && S_ISSOCK(st.st_mode)) {
+        /* do not steal the socket of a running server */
+        if (connect(fd, (struct sockaddr *)&address, sizeof(address)) == 0) {
+            close(fd);
+            return -1;
+        }
+        unlink(path);
+    }
+
+    if (bind(fd, (struct sockaddr *)&address, sizeof(address)) != 0
+    || listen(fd, SOMAXCONN) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static int serve_start_workers(serve_server * server) {
+    serve_worker * worker;
+    int i;
+
+    server->workers = (serve_worker *)calloc((size_t)server->workers_count, sizeof(serve_worker));
+    if (server->workers == NULL) {
+        return 0;
+    }
+
+    for (i = 0; i < server->workers_count; ++i) {
+        worker = &server->workers[i];
+        worker->server = server;
+        worker->response = (char *)malloc(SERVE_RESPONSE_BUFFER_SIZE);
+        if (worker->response == NULL
+        || pthread_create(&worker->thread, NULL, serve_worker_main, worker) != 0) {
+            free(worker->response);
+            break;
+        }
+    }
+
+    /* run with the workers successfully started */
+    server->workers_count = i;
+    return (i > 0);
+}
+
+static void serve_stop_workers(serve_server * server) {
+    int i;
+
+    pthread_mutex_lock(&server->lock);
+    server->stopping = 1;
+    /* interrupt the connections being answered */
+    for (i = 0; i < server->connections_count; ++i) {
+        if (server->connections[i]->busy) {
+            shutdown(server->connections[i]->fd, SHUT_RDWR);
+        }
+    }
+    pthread_cond_broadcast(&server->queue_not_empty);
+    pthread_mutex_unlock(&server->lock);
+
+    for (i = 0; i < server->workers_count; ++i) {
+        pthread_join(server->workers[i].thread, NULL);
+        free(server->workers[i].response);
+    }
+    free(server->workers);
+}
+
+/* wait for the listener, the connections not being answered and the wake-up pipe */
+static int serve_poll(serve_server * server, int listener, int timeout) {
+    struct pollfd fds[SERVE_MAX_CONNECTIONS + 2];
+    serve_connection * polled[SERVE_MAX_CONNECTIONS];
+    char drain[64];
+    nfds_t count;
+    int i, n;
+
+    fds[0].fd = server->wake[0];
+    fds[0].events = POLLIN;
+    fds[1].fd = listener;
+    fds[1].events = POLLIN;
+    count = 2;
+    n = 0;
+    for (i = 0; i < server->connections_count; ++i) {
+        if (!serve_is_busy(server, server->connections[i])) {
+            polled[n++] = server->connections[i];
+            fds[count].fd = server->connections[i]->fd;
+            fds[count].events = POLLIN;
+            ++count;
+        }
+    }
+
+    if (poll(fds, count, timeout) < 0) {
+        return (errno == EINTR) ? 0 : -1;
+    }
+
+    if (fds[0].revents & POLLIN) {
+        while (read(server->wake[0], drain, sizeof(drain)) > 0) {
+            /* a worker is done or a signal was received */
+        }
+    }
+    for (i = 0; i < n; ++i) {
+        if (fds[i + 2].revents & (POLLIN | POLLHUP | POLLERR)) {
+            serve_read(server, polled[i]);
+        }
+    }
+    if (fds[1].revents & POLLIN) {
+        serve_accept(server, listener);
+    }
+    return 0;
+}
+
+int serve_unix_socket(const flvmeta_opts * options) {
+    serve_server server;
+    serve_entry * entry;
+    struct sigaction action, old_int, old_term, old_pipe;
+    sigset_t signals, old_signals;
+    int listener, retval, timeout;
+
+    listener = serve_listen(options->input_file);
+    if (listener < 0) {
+        return ERROR_SOCKET;
+    }
+
+    memset(&server, 0, sizeof(server));
+    server.options = options;
+    server.workers_count = (options->serve_workers > 0) ? options->serve_workers : SERVE_DEFAULT_WORKERS;
+
+    /* the dispatcher is woken up by the workers and the signals through a pipe */
+    if (pipe(server.wake) != 0) {
+        close(listener);
+        unlink(options->input_file);
+        return ERROR_SOCKET;
+    }
+    fcntl(server.wake[0], F_SETFL, fcntl(server.wake[0], F_GETFL) | O_NONBLOCK);
+    fcntl(server.wake[1], F_SETFL, fcntl(server.wake[1], F_GETFL) | O_NONBLOCK);
+    fcntl(listener, F_SETFL, fcntl(listener, F_GETFL) | O_NONBLOCK);
+
+    serve_interrupted = 0;
+    serve_signal_fd = server.wake[1];
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = serve_on_signal;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGINT, &action, &old_int);
+    sigaction(SIGTERM, &action, &old_term);
+    /* closed connections must not kill the server */
+    action.sa_handler = SIG_IGN;
+    sigaction(SIGPIPE, &action, &old_pipe);
+
+    pthread_mutex_init(&server.lock, NULL);
+    pthread_cond_init(&server.queue_not_empty, NULL);
+
+    /* termination signals never reach the workers, only the dispatcher */
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, &old_signals);
+
+    retval = OK;
+    if (!serve_start_workers(&server)) {
+        retval = ERROR_MEMORY;
+    }
+    else if (options->verbose) {
+        fprintf(stdout, "Serving requests on %s with %d workers\n", options->input_file, server.workers_count);
+        fflush(stdout);
+    }
+
+    pthread_sigmask(SIG_SETMASK, &old_signals, NULL);
+
+    timeout = -1;
+    while (retval == OK && !serve_interrupted) {
+        if (serve_poll(&server, listener, timeout) != 0) {
+            retval = ERROR_SOCKET;
+        }
+        timeout = serve_close_idle(&server);
+    }
+
+    if (server.workers != NULL) {
+        serve_stop_workers(&server);
+    }
+    while (server.connections_count > 0) {
+        serve_close(&server, 0);
+    }
+
+    close(listener);
+    unlink(options->input_file);
+
+    while (server.cache.first != NULL) {
+        entry = server.cache.first;
+        serve_cache_unlink(&server.cache, entry);
+        serve_entry_free(entry);
+    }
+
+    pthread_cond_destroy(&server.queue_not_empty);
+    pthread_mutex_destroy(&server.lock);
+
+    sigaction(SIGPIPE, &old_pipe, NULL);
+    sigaction(SIGTERM, &old_term, NULL);
+    sigaction(SIGINT, &old_int, NULL);
+
+    serve_signal_fd = -1;
+    close(server.wake[0]);
+    close(server.wake[1]);
+
+    return retval;
+}
+
+#endif /* WIN32 */
@@ -0,0 +1,50 @@
+/*
+    FLVMeta - FLV Metadata Editor
+
+    Copyright (C) 2007-2014 Marc Noirot <marc.noirot AT gmail.com>
+
+    This file is part of FLVMeta.
+
+    FLVMeta is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    FLVMeta is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FLVMeta; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+#ifndef __SERVE_H__
+#define __SERVE_H__
+
+#include "flvmeta.h"
+
+/* default number of worker threads */
+#define SERVE_DEFAULT_WORKERS 4
+
+/* maximum number of worker threads */
+#define SERVE_MAX_WORKERS 256
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/*
+    Serve requests on the Unix socket named by the input file, until the
+    process is interrupted by SIGINT or SIGTERM.
+    Each request is a JSON object on a single line, answered by a JSON
+    object on a single line. File information is kept in a cache, so
+    that repeated requests on the same files do not parse them again.
+*/
+int serve_unix_socket(const flvmeta_opts * options);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __SERVE_H__ */
@@ -0,0 +1,177 @@
+/*
+    FLVMeta - FLV Metadata Editor
+
+    Copyright (C) 2007-2014 Marc Noirot <marc.noirot AT gmail.com>
+
+    This file is part of FLVMeta.
+
+    FLVMeta is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    FLVMeta is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FLVMeta; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+#include "sink.h"
+#include "stats.h"
+
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SINK_MAX_FORMATTED_SIZE 1024
+
+/* stdio stream procedures */
+static size_t sink_file_write(const void * data, size_t size, void * user_data) {
+    return stats_fwrite(data, 1, size, (FILE *)user_data);
+}
+
+static int sink_file_flush(void * user_data) {
+    return fflush((FILE *)user_data);
+}
+
+/* hand the buffer contents over to the write procedure */
+static void sink_drain(output_sink * out) {
+    if (out->length > 0) {
+        if (out->write(out->buffer, out->length, out->user_data) < out->length) {
+            out->error = 1;
+        }
+        out->length = 0;
+    }
+}
+
+void sink_init(output_sink * out, sink_write_proc write, sink_flush_proc flush, void * user_data, char * buffer, size_t buffer_size) {
+    out->write = write;
+    out->flush = flush;
+    out->user_data = user_data;
+    out->length = 0;
+    out->error = 0;
+    out->owns_buffer = 0;
+
+    if (buffer_size == 0) {
+        buffer_size = SINK_DEFAULT_BUFFER_SIZE;
+    }
+
+    if (buffer == NULL) {
+        buffer = (char *)malloc(buffer_size);
+        if (buffer == NULL) {
+            buffer_size = 0;
+        }
+        else {
+            out->owns_buffer = 1;
+        }
+    }
+
+    out->buffer = buffer;
+    out->buffer_size = buffer_size;
+}
+
+void sink_init_file(output_sink * out, FILE * stream) {
+    sink_init(out, sink_file_write, sink_file_flush, stream, NULL, 0);
+}
+
+int sink_close(output_sink * out) {
+    sink_flush(out);
+    if (out->owns_buffer) {
+        free(out->buffer);
+    }
+    out->buffer = NULL;
+    out->buffer_size = 0;
+    out->owns_buffer = 0;
+    return out->error;
+}
+
+void sink_flush(output_sink * out) {
+    sink_drain(out);
+    if (out->flush != NULL && out->flush(out->user_data) != 0) {
+        out->error = 1;
+    }
+}
+
+void sink_write(output_sink * out, const void * data, size_t size) {
+    if (out->length + size > out->buffer_size) {
+        sink_drain(out);
+        if (size > out->buffer_size) {
+            /* too large to be buffered, write it directly */
+            if (out->write(data, size, out->user_data) < size) {
+                out->error = 1;
+            }
+            return;
+        }
+    }
+    memcpy(out->buffer + out->length, data, size);
+    out->length += size;
+}
+
+void sink_write_z(output_sink * out, const char * str) {
+    sink_write(out, str, strlen(str));
+}
+
+void sink_write_char(output_sink * out, char c) {
+    if (out->length < out->buffer_size) {
+        out->buffer[out->length++] = c;
+    }
+    else {
+        sink_write(out, &c, 1);
+    }
+}
+
+void sink_write_chars(output_sink * out, char c, size_t count) {
+    char chars[64];
+    size_t n;
+
+    memset(chars, c, (count < sizeof(chars)) ? count : sizeof(chars));
+    while (count > 0) {
+        n = (count < sizeof(chars)) ? count : sizeof(chars);
+        sink_write(out, chars, n);
+        count -= n;
+    }
+}
+
+void sink_write_unsigned(output_sink * out, uint64 value) {
+    char digits[20];
+    int n = sizeof(digits);
+
+    /* format the digits backwards, without going through printf */
+    do {
+        digits[--n] = (char)('0' + (int)(value % 10));
+        value /= 10;
+    } while (value != 0);
+
+    sink_write(out, digits + n, sizeof(digits) - n);
+}
+
+void sink_write_integer(output_sink * out, sint64 value) {
+    if (value < 0) {
+        sink_write_char(out, '-');
+        sink_write_unsigned(out, (uint64)0 - (uint64)value);
+    }
+    else {
+        sink_write_unsigned(out, (uint64)value);
+    }
+}
+
+void sink_printf(output_sink * out, const char * format, ...) {
+    char str[SINK_MAX_FORMATTED_SIZE];
+    va_list args;
+    int size;
+
+    va_start(args, format);
+    size = vsnprintf(str, sizeof(str), format, args);
+    va_end(args);
+
+    if (size > 0) {
+        /* truncated output */
+        if ((size_t)size >= sizeof(str)) {
+            size = sizeof(str) - 1;
+        }
+        sink_write(out, str, (size_t)size);
+    }
+}
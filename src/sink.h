@@ -0,0 +1,97 @@
+/*
+    FLVMeta - FLV Metadata Editor
+
+    Copyright (C) 2007-2014 Marc Noirot <marc.noirot AT gmail.com>
+
+    This file is part of FLVMeta.
+
+    FLVMeta is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    FLVMeta is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FLVMeta; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+#ifndef __SINK_H__
+#define __SINK_H__
+
+#include <stdio.h>
+
+#include "types.h"
+
+/**
+    Output sink.
+    Dumpers and reports write their output through a sink, which
+    accumulates data in a buffer and hands it over to a write procedure
+    in large blocks. The default sink writes to a stdio stream, but any
+    destination can be plugged in, such as memory or a socket.
+*/
+
+/* default size of the sink buffer */
+#define SINK_DEFAULT_BUFFER_SIZE (1024 * 1024)
+
+/* write procedure, returns the number of bytes written */
+typedef size_t (*sink_write_proc)(const void * data, size_t size, void * user_data);
+
+/* flush procedure, returns zero if successful */
+typedef int (*sink_flush_proc)(void * user_data);
+
+typedef struct __output_sink {
+    sink_write_proc write;
+    sink_flush_proc flush;
+    void * user_data;
+    char * buffer;
+    size_t buffer_size;
+    size_t length;
+    int owns_buffer;
+    int error;
+} output_sink;
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/*
+    Initialize a sink. If buffer is NULL, a buffer of buffer_size bytes
+    (or SINK_DEFAULT_BUFFER_SIZE if zero) is allocated and owned by the sink.
+    If the allocation fails, the sink works unbuffered.
+    The flush procedure can be NULL.
+*/
+void sink_init(output_sink * out, sink_write_proc write, sink_flush_proc flush, void * user_data, char * buffer, size_t buffer_size);
+
+/* initialize a sink writing to a stdio stream, with a default buffer */
+void sink_init_file(output_sink * out, FILE * stream);
+
+/* flush the sink, and free its buffer if owned, returns zero if no write failed */
+int sink_close(output_sink * out);
+
+/* hand buffered data over to the write procedure, then flush it */
+void sink_flush(output_sink * out);
+
+void sink_write(output_sink * out, const void * data, size_t size);
+
+void sink_write_z(output_sink * out, const char * str);
+
+void sink_write_char(output_sink * out, char c);
+
+void sink_write_chars(output_sink * out, char c, size_t count);
+
+void sink_write_unsigned(output_sink * out, uint64 value);
+
+void sink_write_integer(output_sink * out, sint64 value);
+
+/* formatted output, limited to 1024 characters */
+void sink_printf(output_sink * out, const char * format, ...);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __SINK_H__ */
@@ -0,0 +1,283 @@
+/*
+    FLVMeta - FLV Metadata Editor
+
+    Copyright (C) 2007-2014 Marc Noirot <marc.noirot AT gmail.com>
+
+    This file is part of FLVMeta.
+
+    FLVMeta is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    FLVMeta is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FLVMeta; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+#include "stats.h"
+#include "flvmeta.h"
+#include "flv.h"
+#include "json.h"
+#include "trace.h"
+
+#include <string.h>
+#include <time.h>
+
+#ifdef WIN32
+# include <windows.h>
+#else /* WIN32 */
+# include <sys/resource.h>
+#endif /* WIN32 */
+
+typedef struct __stats_phase {
+    double wall;
+    double cpu;
+    double start_wall;
+    double start_cpu;
+    uint32 count;
+} stats_phase;
+
+typedef struct __flvmeta_stats {
+    int enabled;
+    double start_wall;
+    double start_cpu;
+    stats_phase phases[STATS_PHASE_COUNT];
+    uint64 bytes_read;
+    uint64 read_calls;
+    uint64 seek_calls;
+    uint64 bytes_written;
+    uint64 write_calls;
+    uint64 audio_tags;
+    uint64 video_tags;
+    uint64 meta_tags;
+    uint64 other_tags;
+    uint64 amf_allocations;
+    uint64 amf_allocated_bytes;
+} flvmeta_stats;
+
+static flvmeta_stats stats;
+
+static const char * stats_phase_names[STATS_PHASE_COUNT] = {
+    "info", "metadata", "write", "copy", "dump", "check"
+};
+
+double stats_wall_time(void) {
+#ifdef WIN32
+    LARGE_INTEGER frequency, counter;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    return (double)counter.QuadPart / (double)frequency.QuadPart;
+#else /* WIN32 */
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+#endif /* WIN32 */
+}
+
+static double stats_cpu_time(void) {
+    return (double)clock() / CLOCKS_PER_SEC;
+}
+
+/* peak resident set size in kilobytes, or -1 if unknown */
+static sint64 stats_peak_rss(void) {
+#ifdef WIN32
+    return -1;
+#else /* WIN32 */
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return -1;
+    }
+# ifdef __APPLE__
+    /* bytes instead of kilobytes */
+    return usage.ru_maxrss / 1024;
+# else /* __APPLE__ */
+    return usage.ru_maxrss;
+# endif /* __APPLE__ */
+#endif /* WIN32 */
+}
+
+void stats_enable(void) {
+    memset(&stats, 0, sizeof(stats));
+    stats.enabled = 1;
+    stats.start_wall = stats_wall_time();
+    stats.start_cpu = stats_cpu_time();
+}
+
+int stats_enabled(void) {
+    return stats.enabled;
+}
+
+void stats_phase_start(int phase) {
+    trace_begin(stats_phase_names[phase], NULL);
+    if (stats.enabled) {
+        stats.phases[phase].start_wall = stats_wall_time();
+        stats.phases[phase].start_cpu = stats_cpu_time();
+    }
+}
+
+void stats_phase_end(int phase) {
+    if (stats.enabled) {
+        stats_phase * p = &stats.phases[phase];
+        p->wall += stats_wall_time() - p->start_wall;
+        p->cpu += stats_cpu_time() - p->start_cpu;
+        p->count++;
+    }
+    trace_end();
+}
+
+size_t stats_fread(void * buffer, size_t size, size_t count, FILE * stream) {
+    size_t n = fread(buffer, size, count, stream);
+    if (stats.enabled) {
+        stats.read_calls++;
+        stats.bytes_read += n * size;
+    }
+    return n;
+}
+
+size_t stats_fwrite(const void * buffer, size_t size, size_t count, FILE * stream) {
+    size_t n = fwrite(buffer, size, count, stream);
+    if (stats.enabled) {
+        stats.write_calls++;
+        stats.bytes_written += n * size;
+    }
+    return n;
+}
+
+int stats_fseek(FILE * stream, file_offset_t offset, int whence) {
+    if (stats.enabled) {
+        stats.seek_calls++;
+    }
+    return lfs_fseek(stream, offset, whence);
+}
+
+void stats_count_tag(uint8 type) {
+    if (stats.enabled) {
+        switch (type) {
+            case FLV_TAG_TYPE_AUDIO: stats.audio_tags++; break;
+            case FLV_TAG_TYPE_VIDEO: stats.video_tags++; break;
+            case FLV_TAG_TYPE_META: stats.meta_tags++; break;
+            default: stats.other_tags++;
+        }
+    }
+}
+
+void stats_count_amf_allocation(size_t size) {
+    if (stats.enabled) {
+        stats.amf_allocations++;
+        stats.amf_allocated_bytes += size;
+    }
+}
+
+static void stats_report_json(output_sink * out, double wall, double cpu, sint64 peak_rss) {
+    json_emitter je;
+    int i;
+
+    json_emit_init(&je, out);
+    json_emit_object_start(&je);
+    json_emit_object_key_z(&je, "phases");
+    json_emit_object_start(&je);
+    for (i = 0; i < STATS_PHASE_COUNT; i++) {
+        if (stats.phases[i].count > 0) {
+            json_emit_object_key_z(&je, stats_phase_names[i]);
+            json_emit_object_start(&je);
+            json_emit_object_key_z(&je, "wall");
+            json_emit_number(&je, stats.phases[i].wall);
+            json_emit_object_key_z(&je, "cpu");
+            json_emit_number(&je, stats.phases[i].cpu);
+            json_emit_object_key_z(&je, "count");
+            json_emit_integer(&je, (int)stats.phases[i].count);
+            json_emit_object_end(&je);
+        }
+    }
+    json_emit_object_end(&je);
+    json_emit_object_key_z(&je, "total");
+    json_emit_object_start(&je);
+    json_emit_object_key_z(&je, "wall");
+    json_emit_number(&je, wall);
+    json_emit_object_key_z(&je, "cpu");
+    json_emit_number(&je, cpu);
+    json_emit_object_end(&je);
+    json_emit_object_key_z(&je, "io");
+    json_emit_object_start(&je);
+    json_emit_object_key_z(&je, "bytes_read");
+    json_emit_file_offset(&je, (file_offset_t)stats.bytes_read);
+    json_emit_object_key_z(&je, "read_calls");
+    json_emit_file_offset(&je, (file_offset_t)stats.read_calls);
+    json_emit_object_key_z(&je, "seek_calls");
+    json_emit_file_offset(&je, (file_offset_t)stats.seek_calls);
+    json_emit_object_key_z(&je, "bytes_written");
+    json_emit_file_offset(&je, (file_offset_t)stats.bytes_written);
+    json_emit_object_key_z(&je, "write_calls");
+    json_emit_file_offset(&je, (file_offset_t)stats.write_calls);
+    json_emit_object_end(&je);
+    json_emit_object_key_z(&je, "tags_read");
+    json_emit_object_start(&je);
+    json_emit_object_key_z(&je, "audio");
+    json_emit_file_offset(&je, (file_offset_t)stats.audio_tags);
+    json_emit_object_key_z(&je, "video");
+    json_emit_file_offset(&je, (file_offset_t)stats.video_tags);
+    json_emit_object_key_z(&je, "meta");
+    json_emit_file_offset(&je, (file_offset_t)stats.meta_tags);
+    json_emit_object_key_z(&je, "other");
+    json_emit_file_offset(&je, (file_offset_t)stats.other_tags);
+    json_emit_object_end(&je);
+    json_emit_object_key_z(&je, "amf");
+    json_emit_object_start(&je);
+    json_emit_object_key_z(&je, "allocations");
+    json_emit_file_offset(&je, (file_offset_t)stats.amf_allocations);
+    json_emit_object_key_z(&je, "allocated_bytes");
+    json_emit_file_offset(&je, (file_offset_t)stats.amf_allocated_bytes);
+    json_emit_object_end(&je);
+    json_emit_object_key_z(&je, "peak_rss_kb");
+    if (peak_rss >= 0) {
+        json_emit_file_offset(&je, (file_offset_t)peak_rss);
+    }
+    else {
+        json_emit_null(&je);
+    }
+    json_emit_object_end(&je);
+    sink_write_char(out, '\n');
+}
+
+void stats_report(output_sink * out, int format) {
+    double wall, cpu;
+    sint64 peak_rss;
+    int i;
+
+    wall = stats_wall_time() - stats.start_wall;
+    cpu = stats_cpu_time() - stats.start_cpu;
+    peak_rss = stats_peak_rss();
+
+    /* the report itself is not measured */
+    stats.enabled = 0;
+
+    if (format == FLVMETA_FORMAT_JSON) {
+        stats_report_json(out, wall, cpu, peak_rss);
+        return;
+    }
+
+    sink_write_z(out, "phase          wall (s)     cpu (s)\n");
+    for (i = 0; i < STATS_PHASE_COUNT; i++) {
+        if (stats.phases[i].count > 0) {
+            sink_printf(out, "%-10s %12.6f %12.6f\n", stats_phase_names[i], stats.phases[i].wall, stats.phases[i].cpu);
+        }
+    }
+    sink_printf(out, "%-10s %12.6f %12.6f\n", "total", wall, cpu);
+    sink_printf(out, "read:      %" PRI_LL "u bytes, %" PRI_LL "u calls, %" PRI_LL "u seeks\n",
+        (unsigned long long)stats.bytes_read, (unsigned long long)stats.read_calls, (unsigned long long)stats.seek_calls);
+    sink_printf(out, "written:   %" PRI_LL "u bytes, %" PRI_LL "u calls\n",
+        (unsigned long long)stats.bytes_written, (unsigned long long)stats.write_calls);
+    sink_printf(out, "tags read: %" PRI_LL "u audio, %" PRI_LL "u video, %" PRI_LL "u meta, %" PRI_LL "u other\n",
+        (unsigned long long)stats.audio_tags, (unsigned long long)stats.video_tags,
+        (unsigned long long)stats.meta_tags, (unsigned long long)stats.other_tags);
+    sink_printf(out, "AMF:       %" PRI_LL "u allocations, %" PRI_LL "u bytes\n",
+        (unsigned long long)stats.amf_allocations, (unsigned long long)stats.amf_allocated_bytes);
+    if (peak_rss >= 0) {
+        sink_printf(out, "peak RSS: %" PRI_LL "d kB\n", (long long)peak_rss);
+    }
+}
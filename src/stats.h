@@ -0,0 +1,85 @@
+/*
+    FLVMeta - FLV Metadata Editor
+
+    Copyright (C) 2007-2014 Marc Noirot <marc.noirot AT gmail.com>
+
+    This file is part of FLVMeta.
+
+    FLVMeta is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    FLVMeta is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FLVMeta; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+#ifndef __STATS_H__
+#define __STATS_H__
+
+#include <stdio.h>
+
+#include "types.h"
+#include "sink.h"
+
+/**
+    Execution statistics.
+    When enabled, the time spent in the main processing phases, the file
+    input/output calls, the tags read and the AMF allocations are counted,
+    to be reported once the command is over. Statistics are process-wide:
+    they are meant for the command-line program, and must not be enabled
+    while several contexts run concurrently. When disabled, counting only
+    costs a test.
+*/
+
+/* measured phases */
+#define STATS_PHASE_INFO        0
+#define STATS_PHASE_METADATA    1
+#define STATS_PHASE_WRITE       2
+#define STATS_PHASE_COPY        3
+#define STATS_PHASE_DUMP        4
+#define STATS_PHASE_CHECK       5
+#define STATS_PHASE_COUNT       6
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/* reset the statistics and start collecting them */
+void stats_enable(void);
+
+int stats_enabled(void);
+
+/* monotonic wall clock time, in seconds */
+double stats_wall_time(void);
+
+/* phases are also traced as spans when tracing is enabled */
+void stats_phase_start(int phase);
+
+void stats_phase_end(int phase);
+
+/* counting replacements of the stdio functions */
+size_t stats_fread(void * buffer, size_t size, size_t count, FILE * stream);
+
+size_t stats_fwrite(const void * buffer, size_t size, size_t count, FILE * stream);
+
+int stats_fseek(FILE * stream, file_offset_t offset, int whence);
+
+/* count a tag read, as many times as it is read */
+void stats_count_tag(uint8 type);
+
+void stats_count_amf_allocation(size_t size);
+
+/* write the statistics, as text if format is FLVMETA_FORMAT_RAW, or JSON */
+void stats_report(output_sink * out, int format);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __STATS_H__ */
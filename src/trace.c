@@ -0,0 +1,129 @@
+/*
+    FLVMeta - FLV Metadata Editor
+
+    Copyright (C) 2007-2014 Marc Noirot <marc.noirot AT gmail.com>
+
+    This file is part of FLVMeta.
+
+    FLVMeta is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    FLVMeta is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FLVMeta; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include "trace.h"
+#include "flvmeta.h"
+#include "json.h"
+#include "stats.h"
+
+#include <stdio.h>
+
+typedef struct __flvmeta_trace {
+    FILE * file;
+    output_sink out;
+    json_emitter je;
+    double start;
+    int depth;
+} flvmeta_trace;
+
+static flvmeta_trace trace;
+
+/* write a duration event, in microseconds since the trace was opened */
+static void trace_emit(const char * phase, const char * name, const char * file) {
+    json_emit_object_start(&trace.je);
+    if (name != NULL) {
+        json_emit_object_key_z(&trace.je, "name");
+        json_emit_string_z(&trace.je, name);
+        json_emit_object_key_z(&trace.je, "cat");
+        json_emit_string_z(&trace.je, PACKAGE_NAME);
+    }
+    json_emit_object_key_z(&trace.je, "ph");
+    json_emit_string_z(&trace.je, phase);
+    json_emit_object_key_z(&trace.je, "ts");
+    json_emit_number(&trace.je, (stats_wall_time() - trace.start) * 1e6);
+    json_emit_object_key_z(&trace.je, "pid");
+    json_emit_integer(&trace.je, 1);
+    json_emit_object_key_z(&trace.je, "tid");
+    json_emit_integer(&trace.je, 1);
+    if (file != NULL) {
+        json_emit_object_key_z(&trace.je, "args");
+        json_emit_object_start(&trace.je);
+        json_emit_object_key_z(&trace.je, "file");
+        json_emit_string_z(&trace.je, file);
+        json_emit_object_end(&trace.je);
+    }
+    json_emit_object_end(&trace.je);
+    /* one event per line */
+    sink_write_char(&trace.out, '\n');
+}
+
+int trace_open(const char * filename) {
+    trace.file = fopen(filename, "wb");
+    if (trace.file == NULL) {
+        return ERROR_OPEN_WRITE;
+    }
+    sink_init_file(&trace.out, trace.file);
+    json_emit_init(&trace.je, &trace.out);
+    json_emit_array_start(&trace.je);
+    sink_write_char(&trace.out, '\n');
+    trace.start = stats_wall_time();
+    trace.depth = 0;
+    return OK;
+}
+
+int trace_close(void) {
+    int error;
+
+    if (trace.file == NULL) {
+        return OK;
+    }
+    trace_unwind(0);
+    json_emit_array_end(&trace.je);
+    sink_write_char(&trace.out, '\n');
+    error = sink_close(&trace.out);
+    if (fclose(trace.file) != 0) {
+        error = 1;
+    }
+    trace.file = NULL;
+    return (error != 0) ? ERROR_WRITE : OK;
+}
+
+int trace_enabled(void) {
+    return trace.file != NULL;
+}
+
+void trace_begin(const char * name, const char * file) {
+    if (trace.file != NULL) {
+        trace_emit("B", name, file);
+        ++trace.depth;
+    }
+}
+
+void trace_end(void) {
+    if (trace.file != NULL && trace.depth > 0) {
+        trace_emit("E", NULL, NULL);
+        --trace.depth;
+    }
+}
+
+int trace_depth(void) {
+    return trace.depth;
+}
+
+void trace_unwind(int depth) {
+    while (trace.depth > depth) {
+        trace_end();
+    }
+}
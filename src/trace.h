@@ -0,0 +1,63 @@
+/*
+    FLVMeta - FLV Metadata Editor
+
+    Copyright (C) 2007-2014 Marc Noirot <marc.noirot AT gmail.com>
+
+    This file is part of FLVMeta.
+
+    FLVMeta is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    FLVMeta is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FLVMeta; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+#ifndef __TRACE_H__
+#define __TRACE_H__
+
+#include "types.h"
+
+/**
+    Execution tracing.
+    When a trace file is open, spans are appended to it as duration events
+    of the Trace Event Format, which chrome://tracing and Perfetto can load.
+    Like statistics, tracing is process-wide and must not be used while
+    several contexts run concurrently. When no trace file is open, the
+    span functions only cost a test.
+*/
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/* start writing spans into the given file, returning OK or ERROR_OPEN_WRITE */
+int trace_open(const char * filename);
+
+/* end the open spans and close the trace file, returning OK or ERROR_WRITE */
+int trace_close(void);
+
+int trace_enabled(void);
+
+/* start a span, with an optional file name argument */
+void trace_begin(const char * name, const char * file);
+
+/* end the last started span */
+void trace_end(void);
+
+/* number of open spans, to end them all with trace_unwind on early exits */
+int trace_depth(void);
+
+void trace_unwind(int depth);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __TRACE_H__ */
@@ -21,7 +21,7 @@
 */
 #include "types.h"
 
-#ifndef WORDS_BIGENDIAN
+#ifndef FLVMETA_WORDS_BIGENDIAN
 
 /* swap 64 bits doubles */
 typedef union __convert_u {
@@ -42,7 +42,7 @@ number64 swap_number64(number64 n) {
            ((c.i & 0xFF00000000000000ULL) >> 56));
     return c.f;
 }
-#endif /* !defined WORDS_BIGENDIAN */
+#endif /* !defined FLVMETA_WORDS_BIGENDIAN */
 
 /* convert native integers into 24 bits big endian integers */
 uint24_be uint32_to_uint24_be(uint32 l) {
@@ -22,20 +22,18 @@
 #ifndef __TYPES_H__
 #define __TYPES_H__
 
-/* Configuration of the sources */
-#ifdef HAVE_CONFIG_H
-# include <config.h>
-#endif
+/* Platform configuration of the installed headers */
+#include "flvmeta_config.h"
 
-#ifdef HAVE_STDINT_H
+#ifdef FLVMETA_HAVE_STDINT_H
 # include <stdint.h>
 #endif
 
-#ifdef HAVE_SYS_TYPES_H
+#ifdef FLVMETA_HAVE_SYS_TYPES_H
 #  include <sys/types.h> /* off_t */
 #endif
 
-#ifdef HAVE_INTTYPES_H
+#ifdef FLVMETA_HAVE_INTTYPES_H
 # include <inttypes.h>
 #endif
 
@@ -60,11 +58,11 @@ typedef uint64_t uint64, uint64_le, uint64_be;
 typedef int64_t sint64, sint64_le, sint64_be;
 
 typedef
-#if SIZEOF_FLOAT == 8
+#if FLVMETA_SIZEOF_FLOAT == 8
 float
-#elif SIZEOF_DOUBLE == 8
+#elif FLVMETA_SIZEOF_DOUBLE == 8
 double
-#elif SIZEOF_LONG_DOUBLE == 8
+#elif FLVMETA_SIZEOF_LONG_DOUBLE == 8
 long double
 #else
 uint64_t
@@ -75,14 +73,14 @@ number64, number64_le, number64_be;
 extern "C" {
 #endif /* __cplusplus */
 
-#ifdef WORDS_BIGENDIAN
+#ifdef FLVMETA_WORDS_BIGENDIAN
 
 # define swap_uint16(x) (x)
 # define swap_sint16(x) (x)
 # define swap_uint32(x) (x)
 # define swap_number64(x) (x)
 
-#else /* !defined WORDS_BIGENDIAN */
+#else /* !defined FLVMETA_WORDS_BIGENDIAN */
 
 /* swap 16 bits integers */
 # define swap_uint16(x) ((uint16)((((x) & 0x00FFU) << 8) | \
@@ -99,7 +97,7 @@ extern "C" {
 /* swap 64 bits doubles */
 number64 swap_number64(number64);
 
-#endif /* WORDS_BIGENDIAN */
+#endif /* FLVMETA_WORDS_BIGENDIAN */
 
 /* convert big endian 24 bits integers to native integers */
 # define uint24_be_to_uint32(x) ((uint32)(((x).b[0] << 16) | \
@@ -120,22 +118,22 @@ uint24_be uint32_to_uint24_be(uint32);
 #endif
 
 /* large file support */
-#ifdef HAVE_FSEEKO
+#ifdef FLVMETA_HAVE_FSEEKO
 # define lfs_ftell ftello
 # define lfs_fseek fseeko
 
 typedef off_t file_offset_t;
 
 /* file offset printf specifier */
-# if SIZEOF_OFF_T == SIZEOF_LONG
+# if FLVMETA_SIZEOF_OFF_T == FLVMETA_SIZEOF_LONG
 #  define FILE_OFFSET_PRINTF_FORMAT PRI_L
-# elif SIZEOF_OFF_T == SIZEOF_LONG_LONG
+# elif FLVMETA_SIZEOF_OFF_T == FLVMETA_SIZEOF_LONG_LONG
 #  define FILE_OFFSET_PRINTF_FORMAT PRI_LL
 # else
 #  error("unknown off_t variant")
 # endif
 
-#else /* !HAVE_SEEKO */
+#else /* !FLVMETA_HAVE_SEEKO */
 
 # ifdef WIN32
 
@@ -158,7 +156,7 @@ typedef long file_offset_t;
 
 # endif /* WIN32 */
 
-#endif /* HAVE_FSEEKO */
+#endif /* FLVMETA_HAVE_FSEEKO */
 
 #ifdef __cplusplus
 }
@@ -24,6 +24,11 @@
 #include "amf.h"
 #include "dump.h"
 #include "info.h"
+#include "input.h"
+#include "probes.h"
+#include "progress.h"
+#include "stats.h"
+#include "trace.h"
 #include "update.h"
 #include "util.h"
 
@@ -36,6 +41,28 @@
 /*
     Write the flv output file
 */
+/* write the computed onMetaData tag, followed by its previous tag size */
+static int write_on_metadata(FILE * flv_out, const flv_tag * omft, const flv_metadata * meta, uint32 on_metadata_name_size, uint32 on_metadata_size) {
+    uint32_be size;
+    int res;
+
+    trace_begin("write onMetaData", NULL);
+    res = OK;
+    if (flv_write_tag(flv_out, omft) != 1
+    || amf_data_file_write(meta->on_metadata_name, flv_out) < on_metadata_name_size
+    || amf_data_file_write(meta->on_metadata, flv_out) < on_metadata_size) {
+        res = ERROR_WRITE;
+    }
+    else {
+        size = swap_uint32(FLV_TAG_SIZE + on_metadata_name_size + on_metadata_size);
+        if (stats_fwrite(&size, sizeof(uint32_be), 1, flv_out) != 1) {
+            res = ERROR_WRITE;
+        }
+    }
+    trace_end();
+    return res;
+}
+
 static int write_flv(flv_stream * flv_in, FILE * flv_out, const flv_info * info, const flv_metadata * meta, const flvmeta_opts * opts) {
     uint32_be size;
     uint32 on_metadata_name_size;
@@ -61,7 +88,7 @@ static int write_flv(flv_stream * flv_in, FILE * flv_out, const flv_info * info,
 
     /* first "previous tag size" */
     size = swap_uint32(0);
-    if (fwrite(&size, sizeof(uint32_be), 1, flv_out) != 1) {
+    if (stats_fwrite(&size, sizeof(uint32_be), 1, flv_out) != 1) {
         return ERROR_WRITE;
     }
 
@@ -75,18 +102,9 @@ static int write_flv(flv_stream * flv_in, FILE * flv_out, const flv_info * info,
     omft.stream_id = uint32_to_uint24_be(0);
     
     /* write the computed onMetaData tag first if it doesn't exist in the input file */
-    if (info->on_metadata_size == 0) {
-        if (flv_write_tag(flv_out, &omft) != 1
-        || amf_data_file_write(meta->on_metadata_name, flv_out) < on_metadata_name_size
-        || amf_data_file_write(meta->on_metadata, flv_out) < on_metadata_size) {
-            return ERROR_WRITE;
-        }
-
-        /* previous tag size */
-        size = swap_uint32(FLV_TAG_SIZE + on_metadata_name_size + on_metadata_size);
-        if (fwrite(&size, sizeof(uint32_be), 1, flv_out) != 1) {
-            return ERROR_WRITE;
-        }
+    if (info->on_metadata_size == 0
+    && write_on_metadata(flv_out, &omft, meta, on_metadata_name_size, on_metadata_size) != OK) {
+        return ERROR_WRITE;
     }
 
     /* extended timestamp initialization */
@@ -98,7 +116,7 @@ static int write_flv(flv_stream * flv_in, FILE * flv_out, const flv_info * info,
     timestamp_extended_meta = 0;
 
     /* copy the tags verbatim */
-    flv_reset(flv_in);
+    input_rewind(opts, flv_in);
 
     copy_buffer = (byte *)malloc(info->biggest_tag_body_size + FLV_TAG_SIZE);
     have_on_last_second = 0;
@@ -107,40 +125,20 @@ static int write_flv(flv_stream * flv_in, FILE * flv_out, const flv_info * info,
         uint32 body_length;
         uint32 timestamp;
 
+        input_tag(opts, flv_in, &ft);
         offset = flv_get_current_tag_offset(flv_in);
         body_length = flv_tag_get_body_length(ft);
         timestamp = flv_tag_get_timestamp(ft);
 
         /* extended timestamp fixing */
         if (ft.type == FLV_TAG_TYPE_META) {
-            if (timestamp < prev_timestamp_meta
-            && prev_timestamp_meta - timestamp > 0xF00000) {
-                ++timestamp_extended_meta;
-            }
-            prev_timestamp_meta = timestamp;
-            if (timestamp_extended_meta > 0) {
-                timestamp += timestamp_extended_meta << 24;
-            }
+            timestamp = flv_fix_extended_timestamp(timestamp, &prev_timestamp_meta, &timestamp_extended_meta);
         }
         else if (ft.type == FLV_TAG_TYPE_AUDIO) {
-            if (timestamp < prev_timestamp_audio
-            && prev_timestamp_audio - timestamp > 0xF00000) {
-                ++timestamp_extended_audio;
-            }
-            prev_timestamp_audio = timestamp;
-            if (timestamp_extended_audio > 0) {
-                timestamp += timestamp_extended_audio << 24;
-            }
+            timestamp = flv_fix_extended_timestamp(timestamp, &prev_timestamp_audio, &timestamp_extended_audio);
         }
         else if (ft.type == FLV_TAG_TYPE_VIDEO) {
-            if (timestamp < prev_timestamp_video
-            && prev_timestamp_video - timestamp > 0xF00000) {
-                ++timestamp_extended_video;
-            }
-            prev_timestamp_video = timestamp;
-            if (timestamp_extended_video > 0) {
-                timestamp += timestamp_extended_video << 24;
-            }
+            timestamp = flv_fix_extended_timestamp(timestamp, &prev_timestamp_video, &timestamp_extended_video);
         }
 
         /* non-zero starting timestamp handling */
@@ -153,16 +151,7 @@ static int write_flv(flv_stream * flv_in, FILE * flv_out, const flv_info * info,
         /* if we're at the offset of the first onMetaData tag in the input file,
            we write the one we computed instead, discarding the old one */
         if (info->on_metadata_offset == offset) {
-            if (flv_write_tag(flv_out, &omft) != 1
-            || amf_data_file_write(meta->on_metadata_name, flv_out) < on_metadata_name_size
-            || amf_data_file_write(meta->on_metadata, flv_out) < on_metadata_size) {
-                free(copy_buffer);
-                return ERROR_WRITE;
-            }
-
-            /* previous tag size */
-            size = swap_uint32(FLV_TAG_SIZE + on_metadata_name_size + on_metadata_size);
-            if (fwrite(&size, sizeof(uint32_be), 1, flv_out) != 1) {
+            if (write_on_metadata(flv_out, &omft, meta, on_metadata_name_size, on_metadata_size) != OK) {
                 free(copy_buffer);
                 return ERROR_WRITE;
             }
@@ -189,7 +178,7 @@ static int write_flv(flv_stream * flv_in, FILE * flv_out, const flv_info * info,
 
                 /* previous tag size */
                 size = swap_uint32(FLV_TAG_SIZE + on_last_second_name_size + on_last_second_size);
-                if (fwrite(&size, sizeof(uint32_be), 1, flv_out) != 1) {
+                if (stats_fwrite(&size, sizeof(uint32_be), 1, flv_out) != 1) {
                     free(copy_buffer);
                     return ERROR_WRITE;
                 }
@@ -223,22 +212,23 @@ static int write_flv(flv_stream * flv_in, FILE * flv_out, const flv_info * info,
                 else if (opts->error_handling == FLVMETA_IGNORE_ERRORS) {
                     /* just copy the whole tag and exit */
                     flv_write_tag(flv_out, &ft);
-                    fwrite(copy_buffer, 1, read_body, flv_out);
+                    stats_fwrite(copy_buffer, 1, read_body, flv_out);
                     free(copy_buffer);
                     size = swap_uint32(FLV_TAG_SIZE + read_body);
-                    fwrite(&size, sizeof(uint32_be), 1, flv_out);
+                    stats_fwrite(&size, sizeof(uint32_be), 1, flv_out);
                     return OK;
                 }
             }
             if (flv_write_tag(flv_out, &ft) != 1
-            || fwrite(copy_buffer, 1, body_length, flv_out) < body_length) {
+            || stats_fwrite(copy_buffer, 1, body_length, flv_out) < body_length) {
                 free(copy_buffer);
                 return ERROR_WRITE;
             }
+            FLVMETA_PROBE4(write_tag, offset, ft.type, body_length, timestamp);
 
             /* previous tag length */
             size = swap_uint32(FLV_TAG_SIZE + body_length);
-            if (fwrite(&size, sizeof(uint32_be), 1, flv_out) != 1) {
+            if (stats_fwrite(&size, sizeof(uint32_be), 1, flv_out) != 1) {
                 free(copy_buffer);
                 return ERROR_WRITE;
             }
@@ -254,14 +244,20 @@ static int write_flv(flv_stream * flv_in, FILE * flv_out, const flv_info * info,
 }
 
 /* copy a FLV file while adding onMetaData and optionnally onLastSecond events */
-int update_metadata(const flvmeta_opts * opts) {
+int update_metadata(const flvmeta_opts * opts, output_sink * out) {
     int res, in_place_update;
     flv_stream * flv_in;
     FILE * flv_out;
     flv_info info;
     flv_metadata meta;
+    file_offset_t filesize;
+
+    /* both passes read the whole file */
+    if (progress_enabled() && flvmeta_filesize(opts->input_file, &filesize) != 0) {
+        progress_set_total(2 * filesize);
+    }
 
-    flv_in = flv_open(opts->input_file);
+    flv_in = input_open(opts, opts->input_file);
     if (flv_in == NULL) {
         return ERROR_OPEN_READ;
     }
@@ -269,14 +265,18 @@ int update_metadata(const flvmeta_opts * opts) {
     /*
         get all necessary information from the flv file
     */
+    stats_phase_start(STATS_PHASE_INFO);
     res = get_flv_info(flv_in, &info, opts);
+    stats_phase_end(STATS_PHASE_INFO);
     if (res != OK) {
-        flv_close(flv_in);
-        amf_data_free(info.keyframes);
+        input_close(opts, flv_in);
+        flv_info_free(&info);
         return res;
     }
 
+    stats_phase_start(STATS_PHASE_METADATA);
     compute_metadata(&info, &meta, opts);
+    stats_phase_end(STATS_PHASE_METADATA);
 
     /*
         open output file
@@ -292,25 +292,24 @@ int update_metadata(const flvmeta_opts * opts) {
     }
 
     if (flv_out == NULL) {
-        flv_close(flv_in);
-        amf_data_free(meta.on_last_second_name);
-        amf_data_free(meta.on_last_second);
-        amf_data_free(meta.on_metadata_name);
-        amf_data_free(meta.on_metadata);
-        amf_data_free(info.original_on_metadata);
+        input_close(opts, flv_in);
+        flv_metadata_free(&meta);
+        flv_info_free(&info);
         return ERROR_OPEN_WRITE;
     }
 
     /*
         write the output file
     */
+    stats_phase_start(STATS_PHASE_WRITE);
     res = write_flv(flv_in, flv_out, &info, &meta, opts);
+    stats_phase_end(STATS_PHASE_WRITE);
 
-    flv_close(flv_in);
+    input_close(opts, flv_in);
     amf_data_free(meta.on_last_second_name);
     amf_data_free(meta.on_last_second);
     amf_data_free(meta.on_metadata_name);
-    amf_data_free(info.original_on_metadata);
+    flv_info_free(&info);
 
     /* copy data into the original file if needed */
     if (in_place_update == 1) {
@@ -325,11 +324,13 @@ int update_metadata(const flvmeta_opts * opts) {
         }
 
         /* copy temporary file contents into the final file */
-        lfs_fseek(flv_out, 0, SEEK_SET);
+        stats_phase_start(STATS_PHASE_COPY);
+        stats_fseek(flv_out, 0, SEEK_SET);
         while (!feof(flv_out)) {
-            bytes_read = fread(copy_buffer, sizeof(byte), COPY_BUFFER_SIZE, flv_out);
+            bytes_read = stats_fread(copy_buffer, sizeof(byte), COPY_BUFFER_SIZE, flv_out);
             if (bytes_read > 0) {
-                if (fwrite(copy_buffer, sizeof(byte), bytes_read, flv_out_real) < bytes_read) {
+                if (stats_fwrite(copy_buffer, sizeof(byte), bytes_read, flv_out_real) < bytes_read) {
+                    stats_phase_end(STATS_PHASE_COPY);
                     fclose(flv_out_real);
                     fclose(flv_out);
                     amf_data_free(meta.on_metadata);
@@ -337,6 +338,7 @@ int update_metadata(const flvmeta_opts * opts) {
                 }
             }
             else {
+                stats_phase_end(STATS_PHASE_COPY);
                 fclose(flv_out_real);
                 fclose(flv_out);
                 amf_data_free(meta.on_metadata);
@@ -345,12 +347,15 @@ int update_metadata(const flvmeta_opts * opts) {
         }
         
         fclose(flv_out_real);
+        stats_phase_end(STATS_PHASE_COPY);
     }
     fclose(flv_out);
 
     /* dump computed metadata if we have to */
     if (opts->dump_metadata == 1) {
-        dump_amf_data(meta.on_metadata, opts);
+        stats_phase_start(STATS_PHASE_DUMP);
+        dump_amf_data(meta.on_metadata, opts, out);
+        stats_phase_end(STATS_PHASE_DUMP);
     }
     
     amf_data_free(meta.on_metadata);
@@ -23,13 +23,14 @@
 #define __UPDATE_H__
 
 #include "flvmeta.h"
+#include "sink.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif /* __cplusplus */
 
-/* inject metadata from a FLV file into a new one */
-extern int update_metadata(const flvmeta_opts * options);
+/* inject metadata from a FLV file into a new one, dumping them into out if requested */
+extern int update_metadata(const flvmeta_opts * options, output_sink * out);
 
 #ifdef __cplusplus
 }
@@ -31,6 +31,8 @@
 
 #include "util.h"
 
+#include <string.h>
+
 int flvmeta_same_file(const char * file1, const char * file2) {
 #ifdef WIN32
     /* in Windows, we have to open the files and use GetFileInformationByHandle */
@@ -141,3 +143,17 @@ int flvmeta_filesize(const char *filename, file_offset_t *filesize) {
     }
 #endif /* WIN32 */
 }
+
+struct tm * flvmeta_localtime(const time_t * timep, struct tm * result) {
+#ifdef WIN32
+    if (localtime_s(result, timep) == 0) {
+        return result;
+    }
+#else /* WIN32 */
+    if (localtime_r(timep, result) != NULL) {
+        return result;
+    }
+#endif /* WIN32 */
+    memset(result, 0, sizeof(struct tm));
+    return NULL;
+}
@@ -23,6 +23,7 @@
 #define __UTIL_H__
 
 #include <stdio.h>
+#include <time.h>
 
 #include "types.h"
 
@@ -51,6 +52,12 @@ FILE * flvmeta_tmpfile(void);
 */
 int flvmeta_filesize(const char * filename, file_offset_t * filesize);
 
+/*
+    Re-entrant conversion of a time to local time.
+    The result structure is cleared if the conversion fails.
+*/
+struct tm * flvmeta_localtime(const time_t * timep, struct tm * result);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
@@ -0,0 +1,122 @@
+/*
+    FLVMeta - FLV Metadata Editor
+
+    Copyright (C) 2007-2014 Marc Noirot <marc.noirot AT gmail.com>
+
+    This file is part of FLVMeta.
+
+    FLVMeta is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    FLVMeta is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FLVMeta; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#include "xml.h"
+
+#include <string.h>
+
+/* entity replacing a markup character, or NULL if it can be copied as is */
+static const char * xml_get_entity(char c, int quotes) {
+    switch (c) {
+        case '&': return "&amp;";
+        case '<': return "&lt;";
+        case '>': return "&gt;";
+        case '\"': return (quotes != 0) ? "&quot;" : NULL;
+        default: return NULL;
+    }
+}
+
+static void xml_write_entities(xml_writer * xw, const char * str, size_t bytes, int quotes) {
+    size_t start, i;
+    const char * entity;
+
+    start = 0;
+    for (i = 0; i < bytes; ++i) {
+        entity = xml_get_entity(str[i], quotes);
+        if (entity != NULL) {
+            /* copy the run of plain characters, then the entity */
+            xml_write(xw, str + start, i - start);
+            xml_write_z(xw, entity);
+            start = i + 1;
+        }
+    }
+    xml_write(xw, str + start, bytes - start);
+}
+
+/* find the "]]>" sequence in a string which is not null-terminated */
+static const char * xml_find_cdata_end(const char * str, size_t bytes) {
+    size_t i;
+    for (i = 0; i + 2 < bytes; ++i) {
+        if (str[i] == ']' && str[i + 1] == ']' && str[i + 2] == '>') {
+            return str + i;
+        }
+    }
+    return NULL;
+}
+
+void xml_writer_init(xml_writer * xw, output_sink * out) {
+    xw->out = out;
+}
+
+void xml_writer_flush(xml_writer * xw) {
+    sink_flush(xw->out);
+}
+
+void xml_write(xml_writer * xw, const char * str, size_t bytes) {
+    sink_write(xw->out, str, bytes);
+}
+
+void xml_write_z(xml_writer * xw, const char * str) {
+    xml_write(xw, str, strlen(str));
+}
+
+void xml_write_indent(xml_writer * xw, int spaces) {
+    if (spaces > 0) {
+        sink_write_chars(xw->out, ' ', spaces);
+    }
+}
+
+void xml_write_unsigned(xml_writer * xw, uint64 value) {
+    sink_write_unsigned(xw->out, value);
+}
+
+void xml_write_number(xml_writer * xw, number64 value) {
+    sink_printf(xw->out, "%.12g", value);
+}
+
+void xml_write_escaped(xml_writer * xw, const char * str, size_t bytes) {
+    xml_write_entities(xw, str, bytes, 1);
+}
+
+void xml_write_escaped_z(xml_writer * xw, const char * str) {
+    xml_write_escaped(xw, str, strlen(str));
+}
+
+void xml_write_text(xml_writer * xw, const char * str, size_t bytes) {
+    const char * end;
+
+    if (memchr(str, '<', bytes) == NULL && memchr(str, '>', bytes) == NULL) {
+        xml_write_entities(xw, str, bytes, 0);
+        return;
+    }
+
+    /* CDATA sections cannot contain their own terminator, split around it */
+    xml_write_z(xw, "<![CDATA[");
+    while ((end = xml_find_cdata_end(str, bytes)) != NULL) {
+        xml_write(xw, str, end - str + 2);
+        xml_write_z(xw, "]]><![CDATA[");
+        bytes -= end - str + 2;
+        str = end + 2;
+    }
+    xml_write(xw, str, bytes);
+    xml_write_z(xw, "]]>");
+}
@@ -0,0 +1,72 @@
+/*
+    FLVMeta - FLV Metadata Editor
+
+    Copyright (C) 2007-2014 Marc Noirot <marc.noirot AT gmail.com>
+
+    This file is part of FLVMeta.
+
+    FLVMeta is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    FLVMeta is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FLVMeta; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#ifndef __XML_H__
+#define __XML_H__
+
+#include "sink.h"
+#include "types.h"
+
+/**
+    This is a basic streaming XML writer.
+    It writes markup to an output sink, escaping text in bulk
+    where needed.
+*/
+
+/* xml writer structure */
+typedef struct __xml_writer {
+    output_sink * out;
+} xml_writer;
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+void xml_writer_init(xml_writer * xw, output_sink * out);
+
+void xml_writer_flush(xml_writer * xw);
+
+/* raw markup, written as is */
+void xml_write(xml_writer * xw, const char * str, size_t bytes);
+
+void xml_write_z(xml_writer * xw, const char * str);
+
+void xml_write_indent(xml_writer * xw, int spaces);
+
+void xml_write_unsigned(xml_writer * xw, uint64 value);
+
+void xml_write_number(xml_writer * xw, number64 value);
+
+/* character data or attribute value, with markup characters escaped */
+void xml_write_escaped(xml_writer * xw, const char * str, size_t bytes);
+
+void xml_write_escaped_z(xml_writer * xw, const char * str);
+
+/* character data, wrapped in a CDATA section if it contains tag markers */
+void xml_write_text(xml_writer * xw, const char * str, size_t bytes);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __XML_H__ */
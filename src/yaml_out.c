@@ -0,0 +1,310 @@
+/*
+    FLVMeta - FLV Metadata Editor
+
+    Copyright (C) 2007-2014 Marc Noirot <marc.noirot AT gmail.com>
+
+    This file is part of FLVMeta.
+
+    FLVMeta is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    FLVMeta is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FLVMeta; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#include "yaml_out.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define YAML_OUT_ROOT       0
+#define YAML_OUT_MAPPING    1
+#define YAML_OUT_SEQUENCE   2
+
+#define YAML_OUT_INITIAL_DEPTH 16
+
+/* can the scalar be written without quotes in block context ? */
+static int yaml_out_is_plain(const char * str, size_t bytes) {
+    size_t i;
+
+    if (bytes == 0 || str[0] == ' ' || str[bytes - 1] == ' ') {
+        return 0;
+    }
+
+    /* document markers */
+    if (bytes >= 3 && (!strncmp(str, "---", 3) || !strncmp(str, "...", 3))) {
+        return 0;
+    }
+
+    /* indicators which cannot start a plain scalar */
+    if (strchr("#,[]{}&*!|>'\"%@`", str[0]) != NULL) {
+        return 0;
+    }
+    if ((str[0] == '-' || str[0] == '?' || str[0] == ':') && (bytes == 1 || str[1] == ' ')) {
+        return 0;
+    }
+
+    for (i = 0; i < bytes; ++i) {
+        unsigned char c = (unsigned char)str[i];
+        if (c < 0x20 || c >= 0x7F) {
+            return 0;
+        }
+        if (c == ':' && (i + 1 == bytes || str[i + 1] == ' ')) {
+            return 0;
+        }
+        if (c == '#' && str[i - 1] == ' ') {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+/* does the scalar need escape sequences ? */
+static int yaml_out_needs_escapes(const char * str, size_t bytes) {
+    size_t i;
+    for (i = 0; i < bytes; ++i) {
+        if ((unsigned char)str[i] < 0x20 || str[i] == 0x7F) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void yaml_out_write_scalar(output_sink * out, const char * str, size_t bytes) {
+    size_t start, i;
+
+    if (yaml_out_is_plain(str, bytes)) {
+        sink_write(out, str, bytes);
+    }
+    else if (!yaml_out_needs_escapes(str, bytes)) {
+        /* single-quoted style, quotes are doubled */
+        sink_write_char(out, '\'');
+        start = 0;
+        for (i = 0; i < bytes; ++i) {
+            if (str[i] == '\'') {
+                sink_write(out, str + start, i + 1 - start);
+                start = i;
+            }
+        }
+        sink_write(out, str + start, bytes - start);
+        sink_write_char(out, '\'');
+    }
+    else {
+        /* double-quoted style, with escape sequences */
+        sink_write_char(out, '"');
+        for (i = 0; i < bytes; ++i) {
+            unsigned char c = (unsigned char)str[i];
+            switch (c) {
+                case '"':  sink_write_z(out, "\\\""); break;
+                case '\\': sink_write_z(out, "\\\\"); break;
+                case '\0': sink_write_z(out, "\\0");  break;
+                case '\b': sink_write_z(out, "\\b");  break;
+                case '\t': sink_write_z(out, "\\t");  break;
+                case '\n': sink_write_z(out, "\\n");  break;
+                case '\r': sink_write_z(out, "\\r");  break;
+                default:
+                    if (c < 0x20 || c == 0x7F) {
+                        sink_printf(out, "\\x%.2X", c);
+                    }
+                    else {
+                        sink_write_char(out, (char)c);
+                    }
+            }
+        }
+        sink_write_char(out, '"');
+    }
+}
+
+static void yaml_out_indent(output_sink * out, int spaces) {
+    if (spaces > 0) {
+        sink_write_chars(out, ' ', spaces);
+    }
+}
+
+/* write what precedes a node: indentation, and the entry indicator in sequences */
+static void yaml_out_prefix(yaml_out * yo) {
+    yaml_out_frame * f = &yo->stack[yo->depth - 1];
+
+    if (f->type == YAML_OUT_ROOT || (f->type == YAML_OUT_MAPPING && f->expect_value)) {
+        return;
+    }
+
+    if (f->count > 0) {
+        yaml_out_indent(yo->out, f->indent);
+    }
+    else if (!f->inline_start) {
+        sink_write_char(yo->out, '\n');
+        yaml_out_indent(yo->out, f->indent);
+    }
+
+    if (f->type == YAML_OUT_SEQUENCE) {
+        sink_write(yo->out, "- ", 2);
+    }
+}
+
+/* a node has been written entirely */
+static void yaml_out_node_end(yaml_out * yo) {
+    yaml_out_frame * f = &yo->stack[yo->depth - 1];
+
+    if (f->type == YAML_OUT_MAPPING) {
+        if (f->expect_value) {
+            ++f->count;
+        }
+        f->expect_value = !f->expect_value;
+    }
+    else if (f->type == YAML_OUT_SEQUENCE) {
+        ++f->count;
+    }
+}
+
+static int yaml_out_push(yaml_out * yo, byte type) {
+    yaml_out_frame * parent;
+    yaml_out_frame * f;
+
+    if (yo->depth == yo->capacity) {
+        yaml_out_frame * stack;
+        stack = (yaml_out_frame *)realloc(yo->stack, 2 * yo->capacity * sizeof(yaml_out_frame));
+        if (stack == NULL) {
+            return 0;
+        }
+        yo->stack = stack;
+        yo->capacity *= 2;
+    }
+
+    parent = &yo->stack[yo->depth - 1];
+    f = &yo->stack[yo->depth++];
+    f->type = type;
+    f->count = 0;
+    f->expect_value = 0;
+
+    if (parent->type == YAML_OUT_SEQUENCE) {
+        /* the first entry follows the parent's entry indicator */
+        f->inline_start = 1;
+        f->indent = parent->indent + 2;
+    }
+    else {
+        /* sequences are not indented inside mappings */
+        f->inline_start = 0;
+        f->indent = parent->indent;
+        if (parent->type == YAML_OUT_MAPPING && type == YAML_OUT_MAPPING) {
+            f->indent += 2;
+        }
+    }
+
+    return 1;
+}
+
+static void yaml_out_pop(yaml_out * yo, const char * empty) {
+    yaml_out_frame * f = &yo->stack[--yo->depth];
+
+    /* empty collections are written in flow style */
+    if (f->count == 0) {
+        if (!f->inline_start) {
+            sink_write_char(yo->out, ' ');
+        }
+        sink_write_z(yo->out, empty);
+        sink_write_char(yo->out, '\n');
+    }
+
+    yaml_out_node_end(yo);
+}
+
+int yaml_out_init(yaml_out * yo, output_sink * out) {
+    yo->out = out;
+    yo->stack = (yaml_out_frame *)malloc(YAML_OUT_INITIAL_DEPTH * sizeof(yaml_out_frame));
+    if (yo->stack == NULL) {
+        return 0;
+    }
+    yo->capacity = YAML_OUT_INITIAL_DEPTH;
+    yo->depth = 0;
+    return 1;
+}
+
+void yaml_out_close(yaml_out * yo) {
+    free(yo->stack);
+    yo->stack = NULL;
+}
+
+void yaml_out_document_start(yaml_out * yo) {
+    yaml_out_frame * f = &yo->stack[0];
+
+    f->type = YAML_OUT_ROOT;
+    f->inline_start = 0;
+    f->expect_value = 0;
+    f->indent = 0;
+    f->count = 0;
+    yo->depth = 1;
+
+    sink_write(yo->out, "---", 3);
+}
+
+void yaml_out_document_end(yaml_out * yo) {
+    yo->depth = 0;
+}
+
+int yaml_out_mapping_start(yaml_out * yo) {
+    yaml_out_prefix(yo);
+    return yaml_out_push(yo, YAML_OUT_MAPPING);
+}
+
+void yaml_out_mapping_end(yaml_out * yo) {
+    yaml_out_pop(yo, "{}");
+}
+
+int yaml_out_sequence_start(yaml_out * yo) {
+    yaml_out_prefix(yo);
+    return yaml_out_push(yo, YAML_OUT_SEQUENCE);
+}
+
+void yaml_out_sequence_end(yaml_out * yo) {
+    yaml_out_pop(yo, "[]");
+}
+
+void yaml_out_scalar(yaml_out * yo, const char * str, size_t bytes) {
+    yaml_out_frame * f = &yo->stack[yo->depth - 1];
+    int is_key = (f->type == YAML_OUT_MAPPING && !f->expect_value);
+
+    yaml_out_prefix(yo);
+    if (f->type == YAML_OUT_ROOT || (f->type == YAML_OUT_MAPPING && f->expect_value)) {
+        sink_write_char(yo->out, ' ');
+    }
+
+    yaml_out_write_scalar(yo->out, str, bytes);
+
+    sink_write_char(yo->out, is_key ? ':' : '\n');
+
+    yaml_out_node_end(yo);
+}
+
+void yaml_out_scalar_z(yaml_out * yo, const char * str) {
+    yaml_out_scalar(yo, str, strlen(str));
+}
+
+void yaml_out_boolean(yaml_out * yo, byte value) {
+    yaml_out_scalar_z(yo, value != 0 ? "true" : "false");
+}
+
+void yaml_out_unsigned(yaml_out * yo, uint32 value) {
+    char str[16];
+    yaml_out_scalar(yo, str, sprintf(str, "%u", value));
+}
+
+void yaml_out_file_offset(yaml_out * yo, file_offset_t value) {
+    char str[32];
+    yaml_out_scalar(yo, str, sprintf(str, "%" FILE_OFFSET_PRINTF_FORMAT "u", value));
+}
+
+void yaml_out_number(yaml_out * yo, number64 value) {
+    char str[32];
+    yaml_out_scalar(yo, str, sprintf(str, "%.12g", value));
+}
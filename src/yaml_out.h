@@ -0,0 +1,91 @@
+/*
+    FLVMeta - FLV Metadata Editor
+
+    Copyright (C) 2007-2014 Marc Noirot <marc.noirot AT gmail.com>
+
+    This file is part of FLVMeta.
+
+    FLVMeta is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    FLVMeta is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FLVMeta; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#ifndef __YAML_OUT_H__
+#define __YAML_OUT_H__
+
+#include "sink.h"
+#include "types.h"
+
+/**
+    This is a basic YAML writer.
+    It writes block-style YAML to an output sink as the data is produced,
+    in the same layout as libyaml, without building events or
+    analyzing the document as a whole.
+*/
+
+/* collection being written */
+typedef struct __yaml_out_frame {
+    byte type;
+    byte inline_start;
+    byte expect_value;
+    int indent;
+    uint32 count;
+} yaml_out_frame;
+
+/* yaml writer structure */
+typedef struct __yaml_out {
+    output_sink * out;
+    yaml_out_frame * stack;
+    size_t depth;
+    size_t capacity;
+} yaml_out;
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+int yaml_out_init(yaml_out * yo, output_sink * out);
+
+void yaml_out_close(yaml_out * yo);
+
+void yaml_out_document_start(yaml_out * yo);
+
+void yaml_out_document_end(yaml_out * yo);
+
+int yaml_out_mapping_start(yaml_out * yo);
+
+void yaml_out_mapping_end(yaml_out * yo);
+
+int yaml_out_sequence_start(yaml_out * yo);
+
+void yaml_out_sequence_end(yaml_out * yo);
+
+/* mapping keys and values are written alternately */
+void yaml_out_scalar(yaml_out * yo, const char * str, size_t bytes);
+
+void yaml_out_scalar_z(yaml_out * yo, const char * str);
+
+void yaml_out_boolean(yaml_out * yo, byte value);
+
+void yaml_out_unsigned(yaml_out * yo, uint32 value);
+
+void yaml_out_file_offset(yaml_out * yo, file_offset_t value);
+
+void yaml_out_number(yaml_out * yo, number64 value);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __YAML_OUT_H__ */
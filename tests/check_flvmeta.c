@@ -3,11 +3,13 @@
 
 extern Suite * amf_types_suite(void);
 extern Suite * flv_suite(void);
+extern Suite * info_suite(void);
 
 int main(void) {
     int number_failed;
     SRunner * sr = srunner_create(amf_types_suite());
     srunner_add_suite(sr, flv_suite());
+    srunner_add_suite(sr, info_suite());
     
     /* srunner_set_log (sr, "check_amf.log"); */
 
@@ -0,0 +1,109 @@
+#include <check.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "src/info.h"
+
+#define TAIL_FILE "check_info_tail.flv"
+
+/* audio frames of 23 ms */
+#define TAIL_FRAME_DURATION 23
+
+/**
+    write an audio-only file of the given number of frames,
+    with 24-bit timestamps starting at the given one,
+    returning the size of the file
+*/
+static file_offset_t write_audio_file(uint32 first_timestamp, uint32 frames) {
+    static const unsigned char header[] = {
+        'F', 'L', 'V', 1, FLV_FLAG_AUDIO, 0, 0, 0, 9, 0, 0, 0, 0
+    };
+    unsigned char tag[FLV_TAG_SIZE + 4 + sizeof(uint32_be)];
+    file_offset_t size;
+    uint32 i, timestamp;
+    FILE * f;
+
+    f = fopen(TAIL_FILE, "wb");
+    fail_if(f == NULL, "cannot create " TAIL_FILE);
+    fwrite(header, sizeof(header), 1, f);
+    size = sizeof(header);
+
+    memset(tag, 0, sizeof(tag));
+    tag[0] = FLV_TAG_TYPE_AUDIO;
+    tag[3] = 4;
+    /* AAC raw frame */
+    tag[FLV_TAG_SIZE] = 0xAF;
+    tag[FLV_TAG_SIZE + 1] = 0x01;
+    tag[FLV_TAG_SIZE + 4 + 3] = FLV_TAG_SIZE + 4;
+
+    for (i = 0; i < frames; ++i) {
+        /* no extended byte, so timestamps wrap past 0xFFFFFF */
+        timestamp = (first_timestamp + i * TAIL_FRAME_DURATION) & 0xFFFFFF;
+        tag[4] = (unsigned char)(timestamp >> 16);
+        tag[5] = (unsigned char)(timestamp >> 8);
+        tag[6] = (unsigned char)timestamp;
+        fwrite(tag, sizeof(tag), 1, f);
+        size += sizeof(tag);
+    }
+
+    fclose(f);
+    return size;
+}
+
+static void read_tail_info(file_offset_t filesize, flv_tail_info * tail) {
+    flv_stream * flv_in;
+    int retval;
+
+    flv_in = flv_open(TAIL_FILE);
+    fail_if(flv_in == NULL, "cannot open " TAIL_FILE);
+    retval = get_flv_tail_info(flv_in, filesize, tail);
+    flv_close(flv_in);
+    remove(TAIL_FILE);
+    fail_unless(retval == OK, "expected OK, got %d", retval);
+}
+
+/**
+    tail information
+*/
+START_TEST(test_tail_info_duration) {
+    flv_tail_info tail;
+    uint32 duration;
+
+    read_tail_info(write_audio_file(1000, 100), &tail);
+
+    fail_unless(!tail.truncated, "file should not be truncated");
+    fail_unless(!tail.forward_scan, "file should be read backwards");
+    duration = (uint32)(tail.duration * 1000 + 0.5);
+    fail_unless(duration == 100 * TAIL_FRAME_DURATION,
+        "expected duration %d, got %d", 100 * TAIL_FRAME_DURATION, duration);
+}
+END_TEST
+
+START_TEST(test_tail_info_duration_wrapped) {
+    flv_tail_info tail;
+    uint32 duration;
+
+    /* 20 seconds of frames, wrapping after about 10 seconds */
+    read_tail_info(write_audio_file(0xFFFFFF - 10000, 870), &tail);
+
+    fail_unless(tail.last_audio_timestamp < tail.first_timestamp,
+        "last timestamp should have wrapped");
+    duration = (uint32)(tail.duration * 1000 + 0.5);
+    fail_unless(duration == 870 * TAIL_FRAME_DURATION,
+        "expected duration %d, got %d", 870 * TAIL_FRAME_DURATION, duration);
+}
+END_TEST
+
+/**
+    Info Suite
+*/
+Suite * info_suite(void) {
+    Suite * s = suite_create("FLV information");
+
+    /* tail information tests */
+    TCase * tc_tail = tcase_create("Tail information");
+    tcase_add_test(tc_tail, test_tail_info_duration);
+    tcase_add_test(tc_tail, test_tail_info_duration_wrapped);
+    suite_add_tcase(s, tc_tail);
+    return s;
+}
@@ -0,0 +1,448 @@
+/*
+    FLVMeta - FLV Metadata Editor
+
+    Copyright (C) 2007-2014 Marc Noirot <marc.noirot AT gmail.com>
+
+    This file is part of FLVMeta.
+
+    FLVMeta is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    FLVMeta is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FLVMeta; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "amf.h"
+#include "json.h"
+#include "libflvmeta.h"
+#include "memcount.h"
+
+/*
+    amfbench: microbenchmarks of the AMF0 functions on onMetaData shapes
+    that stress them, reporting the time and allocations per operation.
+    Each operation runs repeatedly for a minimum time, only the operation
+    itself being timed, not the preparation of its input or its cleanup.
+*/
+
+/* default minimal time spent on each benchmark, in seconds */
+#define AMFBENCH_DEFAULT_MIN_TIME 0.5
+
+/* shape parameters */
+#define AMFBENCH_KEYFRAMES      100000
+#define AMFBENCH_DEPTH          1000
+#define AMFBENCH_KEYS           10000
+#define AMFBENCH_STRINGS        256
+#define AMFBENCH_STRING_LENGTH  65535
+
+/* benchmarked tree, with its serialized form */
+typedef struct __amfbench_shape {
+    const char * name;
+    amf_data * data;
+    byte * buffer;
+    size_t size;
+} amfbench_shape;
+
+/* operation state, timed operations work on data and buffer */
+typedef struct __amfbench_state {
+    amfbench_shape * shape;
+    amf_data * data;
+    byte * buffer;
+} amfbench_state;
+
+/*
+    operation, returning the number of elementary operations performed,
+    with optional untimed setup and cleanup
+*/
+typedef struct __amfbench_op {
+    const char * name;
+    void (*setup)(amfbench_state * state);
+    size_t (*run)(amfbench_state * state);
+    void (*cleanup)(amfbench_state * state);
+} amfbench_op;
+
+static double amfbench_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/*
+    shapes
+*/
+
+/* onMetaData with a keyframes index */
+static amf_data * amfbench_keyframes(void) {
+    amf_data * data, * keyframes, * times, * filepositions;
+    uint32 i;
+
+    data = amf_associative_array_new();
+    amf_associative_array_add(data, "hasKeyframes", amf_boolean_new(1));
+    amf_associative_array_add(data, "hasVideo", amf_boolean_new(1));
+    amf_associative_array_add(data, "hasAudio", amf_boolean_new(1));
+    amf_associative_array_add(data, "hasMetadata", amf_boolean_new(1));
+    amf_associative_array_add(data, "canSeekToEnd", amf_boolean_new(1));
+    amf_associative_array_add(data, "duration", amf_number_new(AMFBENCH_KEYFRAMES * 2.0));
+    amf_associative_array_add(data, "datasize", amf_number_new(4e10));
+    amf_associative_array_add(data, "videosize", amf_number_new(3.8e10));
+    amf_associative_array_add(data, "framerate", amf_number_new(25));
+    amf_associative_array_add(data, "videodatarate", amf_number_new(1500));
+    amf_associative_array_add(data, "videocodecid", amf_number_new(7));
+    amf_associative_array_add(data, "width", amf_number_new(1280));
+    amf_associative_array_add(data, "height", amf_number_new(720));
+    amf_associative_array_add(data, "audiosize", amf_number_new(2e9));
+    amf_associative_array_add(data, "audiodatarate", amf_number_new(128));
+    amf_associative_array_add(data, "audiocodecid", amf_number_new(10));
+    amf_associative_array_add(data, "audiosamplerate", amf_number_new(44100));
+    amf_associative_array_add(data, "audiosamplesize", amf_number_new(16));
+    amf_associative_array_add(data, "stereo", amf_boolean_new(1));
+    amf_associative_array_add(data, "metadatacreator", amf_str("amfbench"));
+
+    keyframes = amf_object_new();
+    times = amf_array_new();
+    filepositions = amf_array_new();
+    for (i = 0; i < AMFBENCH_KEYFRAMES; i++) {
+        amf_array_push(times, amf_number_new(i * 2.0));
+        amf_array_push(filepositions, amf_number_new(i * 400000.0 + 13));
+    }
+    amf_object_add(keyframes, "times", times);
+    amf_object_add(keyframes, "filepositions", filepositions);
+    amf_associative_array_add(data, "keyframes", keyframes);
+    return data;
+}
+
+/* objects nested in each other */
+static amf_data * amfbench_deep(void) {
+    amf_data * data, * child;
+    uint32 i;
+
+    data = NULL;
+    for (i = 0; i < AMFBENCH_DEPTH; i++) {
+        child = data;
+        data = amf_object_new();
+        amf_object_add(data, "level", amf_number_new(AMFBENCH_DEPTH - i));
+        if (child != NULL) {
+            amf_object_add(data, "child", child);
+        }
+    }
+    return data;
+}
+
+/* associative array with many keys */
+static amf_data * amfbench_many_keys(void) {
+    amf_data * data;
+    char key[16];
+    uint32 i;
+
+    data = amf_associative_array_new();
+    for (i = 0; i < AMFBENCH_KEYS; i++) {
+        sprintf(key, "key%05u", (unsigned int)i);
+        amf_associative_array_add(data, key, amf_number_new(i));
+    }
+    return data;
+}
+
+/* object with the longest strings AMF0 allows */
+static amf_data * amfbench_long_strings(void) {
+    amf_data * data;
+    byte * str;
+    char key[16];
+    uint32 i;
+
+    str = (byte *) malloc(AMFBENCH_STRING_LENGTH);
+    if (str == NULL) {
+        return NULL;
+    }
+    for (i = 0; i < AMFBENCH_STRING_LENGTH; i++) {
+        str[i] = (byte)('a' + i % 26);
+    }
+    data = amf_object_new();
+    for (i = 0; i < AMFBENCH_STRINGS; i++) {
+        sprintf(key, "string%03u", (unsigned int)i);
+        amf_object_add(data, key, amf_string_new(str, AMFBENCH_STRING_LENGTH));
+    }
+    free(str);
+    return data;
+}
+
+/*
+    operations
+*/
+
+static void amfbench_setup_clone(amfbench_state * state) {
+    state->data = amf_data_clone(state->shape->data);
+}
+
+static void amfbench_cleanup_free(amfbench_state * state) {
+    amf_data_free(state->data);
+    state->data = NULL;
+}
+
+static size_t amfbench_read(amfbench_state * state) {
+    state->data = amf_data_buffer_read(state->shape->buffer, state->shape->size);
+    return 1;
+}
+
+static size_t amfbench_write(amfbench_state * state) {
+    amf_data_buffer_write(state->shape->data, state->buffer, state->shape->size);
+    return 1;
+}
+
+static size_t amfbench_size(amfbench_state * state) {
+    return (amf_data_size(state->shape->data) > 0) ? 1 : 0;
+}
+
+static size_t amfbench_clone(amfbench_state * state) {
+    state->data = amf_data_clone(state->shape->data);
+    return 1;
+}
+
+static size_t amfbench_free(amfbench_state * state) {
+    amf_data_free(state->data);
+    state->data = NULL;
+    return 1;
+}
+
+/* look up every key of the top-level object, or walk down nested objects */
+static size_t amfbench_object_get(amfbench_state * state) {
+    amf_data * data = state->shape->data;
+    amf_node * node;
+    size_t count = 0;
+
+    if (amf_object_get(data, "child") != NULL) {
+        while ((data = amf_object_get(data, "child")) != NULL) {
+            count++;
+        }
+        return count;
+    }
+
+    for (node = amf_object_first(data); node != NULL; node = amf_object_next(node)) {
+        amf_data * name = amf_object_get_name(node);
+        char key[32];
+        size_t length = amf_string_get_size(name);
+
+        if (length >= sizeof(key)) {
+            continue;
+        }
+        memcpy(key, amf_string_get_bytes(name), length);
+        key[length] = 0;
+        if (amf_object_get(data, key) != NULL) {
+            count++;
+        }
+    }
+    return count;
+}
+
+static const amfbench_op operations[] = {
+    { "amf_data_read",  NULL,                   amfbench_read,          amfbench_cleanup_free },
+    { "amf_data_write", NULL,                   amfbench_write,         NULL },
+    { "amf_data_size",  NULL,                   amfbench_size,          NULL },
+    { "amf_data_clone", NULL,                   amfbench_clone,         amfbench_cleanup_free },
+    { "amf_object_get", NULL,                   amfbench_object_get,    NULL },
+    { "amf_data_free",  amfbench_setup_clone,   amfbench_free,          NULL },
+    { NULL, NULL, NULL, NULL }
+};
+
+static void usage(const char * name) {
+    fprintf(stderr, "Usage: %s [OPTIONS]\n", name);
+    fprintf(stderr, "Try `%s --help' for more information.\n", name);
+}
+
+static void help(const char * name) {
+    printf("Usage: %s [OPTIONS]\n", name);
+    printf("\nMeasure the time and allocations per operation of the AMF0 functions\n"
+           "on large onMetaData trees.\n"
+           "\nOptions:\n"
+           "  -t, --min-time=SECONDS    run each benchmark at least SECONDS (default %g)\n"
+           "      --only=NAME           only run the shape or function named NAME\n"
+           "  -o, --output=FILE         write the results to FILE as JSON\n"
+           "  -h, --help                display this information and exit\n", AMFBENCH_DEFAULT_MIN_TIME);
+    printf("\nPlease report bugs to <%s>\n", PACKAGE_BUGREPORT);
+}
+
+static struct option long_options[] = {
+    { "min-time",           required_argument,  NULL, 't'},
+    { "only",               required_argument,  NULL, 'O'},
+    { "output",             required_argument,  NULL, 'o'},
+    { "help",               no_argument,        NULL, 'h'},
+    { 0, 0, 0, 0 }
+};
+
+int main(int argc, char ** argv) {
+    amfbench_shape shapes[4];
+    amfbench_state state;
+    const char * only = NULL;
+    const char * output_file = NULL;
+    double min_time = AMFBENCH_DEFAULT_MIN_TIME;
+    output_sink json_out;
+    json_emitter je;
+    FILE * json_file = NULL;
+    int option, s, o, res = OK;
+
+    while ((option = getopt_long(argc, argv, "t:o:h", long_options, NULL)) != EOF) {
+        switch (option) {
+            case 't': min_time = atof(optarg); break;
+            case 'O': only = optarg; break;
+            case 'o': output_file = optarg; break;
+            case 'h': help(argv[0]); return EXIT_SUCCESS;
+            default: usage(argv[0]); return EXIT_FAILURE;
+        }
+    }
+    if (min_time <= 0 || optind < argc) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    shapes[0].name = "keyframes";
+    shapes[0].data = amfbench_keyframes();
+    shapes[1].name = "deep";
+    shapes[1].data = amfbench_deep();
+    shapes[2].name = "many-keys";
+    shapes[2].data = amfbench_many_keys();
+    shapes[3].name = "long-strings";
+    shapes[3].data = amfbench_long_strings();
+    for (s = 0; s < 4; s++) {
+        shapes[s].size = amf_data_size(shapes[s].data);
+        shapes[s].buffer = (byte *) malloc(shapes[s].size);
+        if (shapes[s].data == NULL || shapes[s].buffer == NULL) {
+            fprintf(stderr, "%s: memory allocation error\n", argv[0]);
+            return ERROR_MEMORY;
+        }
+        amf_data_buffer_write(shapes[s].data, shapes[s].buffer, shapes[s].size);
+    }
+
+    if (output_file != NULL) {
+        json_file = fopen(output_file, "w");
+        if (json_file == NULL) {
+            fprintf(stderr, "%s: cannot open %s for writing\n", argv[0], output_file);
+            return ERROR_OPEN_WRITE;
+        }
+        sink_init_file(&json_out, json_file);
+        json_emit_init(&je, &json_out);
+        json_emit_object_start(&je);
+        json_emit_object_key_z(&je, "version");
+        json_emit_string_z(&je, flvmeta_version());
+        json_emit_object_key_z(&je, "allocations_counted");
+        json_emit_boolean(&je, (byte)memcount_enabled());
+        json_emit_object_key_z(&je, "results");
+        json_emit_array_start(&je);
+    }
+
+    printf("%-13s %-15s %10s %12s %14s %12s\n",
+        "shape", "function", "bytes", "iterations", "ns/op", "allocs/op");
+
+    for (s = 0; s < 4; s++) {
+        if (only != NULL && strcmp(only, shapes[s].name)) {
+            for (o = 0; operations[o].name != NULL && strcmp(only, operations[o].name); o++);
+            if (operations[o].name == NULL) {
+                continue;
+            }
+        }
+        state.shape = &shapes[s];
+        state.data = NULL;
+        state.buffer = (byte *) malloc(shapes[s].size);
+        if (state.buffer == NULL) {
+            res = ERROR_MEMORY;
+            break;
+        }
+
+        for (o = 0; operations[o].name != NULL; o++) {
+            const amfbench_op * op = &operations[o];
+            memcount_stats memory;
+            double elapsed = 0, start;
+            uint64 allocations = 0, iterations = 0, ops = 0;
+
+            if (only != NULL && strcmp(only, shapes[s].name) && strcmp(only, op->name)) {
+                continue;
+            }
+
+            while (elapsed < min_time || iterations < 3) {
+                if (op->setup != NULL) {
+                    op->setup(&state);
+                }
+                memcount_reset();
+                start = amfbench_now();
+                ops += op->run(&state);
+                elapsed += amfbench_now() - start;
+                memcount_get(&memory);
+                allocations += memory.allocations + memory.reallocations;
+                if (op->cleanup != NULL) {
+                    op->cleanup(&state);
+                }
+                iterations++;
+            }
+            if (ops == 0) {
+                ops = 1;
+            }
+
+            printf("%-13s %-15s %10lu %12" PRI_LL "u %14.1f ",
+                shapes[s].name, op->name, (unsigned long)shapes[s].size,
+                (unsigned long long)iterations, elapsed * 1e9 / ops);
+            if (memcount_enabled()) {
+                printf("%12.2f\n", (double)allocations / ops);
+            }
+            else {
+                printf("%12s\n", "-");
+            }
+
+            if (json_file != NULL) {
+                json_emit_object_start(&je);
+                json_emit_object_key_z(&je, "shape");
+                json_emit_string_z(&je, shapes[s].name);
+                json_emit_object_key_z(&je, "function");
+                json_emit_string_z(&je, op->name);
+                json_emit_object_key_z(&je, "bytes");
+                json_emit_file_offset(&je, (file_offset_t)shapes[s].size);
+                json_emit_object_key_z(&je, "iterations");
+                json_emit_file_offset(&je, (file_offset_t)iterations);
+                json_emit_object_key_z(&je, "ops");
+                json_emit_file_offset(&je, (file_offset_t)ops);
+                json_emit_object_key_z(&je, "ns_per_op");
+                json_emit_number(&je, elapsed * 1e9 / ops);
+                json_emit_object_key_z(&je, "allocs_per_op");
+                if (memcount_enabled()) {
+                    json_emit_number(&je, (double)allocations / ops);
+                }
+                else {
+                    json_emit_null(&je);
+                }
+                json_emit_object_end(&je);
+            }
+        }
+        free(state.buffer);
+    }
+
+    if (json_file != NULL) {
+        json_emit_array_end(&je);
+        json_emit_object_end(&je);
+        sink_write_char(&json_out, '\n');
+        if (sink_close(&json_out) != 0 && res == OK) {
+            res = ERROR_WRITE;
+        }
+        if (fclose(json_file) != 0 && res == OK) {
+            res = ERROR_WRITE;
+        }
+    }
+
+    for (s = 0; s < 4; s++) {
+        amf_data_free(shapes[s].data);
+        free(shapes[s].buffer);
+    }
+    return res;
+}
@@ -0,0 +1,556 @@
+/*
+    FLVMeta - FLV Metadata Editor
+
+    Copyright (C) 2007-2014 Marc Noirot <marc.noirot AT gmail.com>
+
+    This file is part of FLVMeta.
+
+    FLVMeta is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    FLVMeta is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FLVMeta; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "libflvmeta.h"
+#include "json.h"
+#include "memcount.h"
+
+/*
+    flvbench: throughput benchmarks of the flvmeta commands.
+    Corpora of various shapes are generated with flvgen, then each command
+    runs in a forked process, so that its peak memory usage can be measured
+    separately, and reports its time and allocation counts back through a pipe.
+*/
+
+/* default number of runs of each command, the fastest one being kept */
+#define FLVBENCH_DEFAULT_RUNS 3
+
+/* size of the corpus file paths, and of the flvgen command lines */
+#define FLVBENCH_PATH_SIZE 1024
+#define FLVBENCH_COMMAND_SIZE 2048
+
+/* corpus shapes, as flvgen options, durations being scaled */
+typedef struct __flvbench_corpus {
+    const char * name;
+    double duration;
+    const char * flvgen_options;
+    /* whether an onMetaData tag is computed before the benchmarks */
+    int update;
+} flvbench_corpus;
+
+static const flvbench_corpus corpora[] = {
+    { "av",         120, "--video-bitrate=2000 --audio-bitrate=128", 1 },
+    { "small-tags", 300, "--frame-rate=60 --video-bitrate=100 --audio-bitrate=32 -k 10", 1 },
+    { "audio-only", 600, "--video=none --audio=mp3", 1 },
+    { "keyframes",  600, "--frame-rate=30 -k 0 --video-bitrate=200 --audio=none", 1 },
+    { "metadata",   30,  "--metadata-size=8000000", 0 },
+    { NULL, 0, NULL, 0 }
+};
+
+/* benchmarked commands */
+#define FLVBENCH_UPDATE_NEW     0
+#define FLVBENCH_UPDATE_INPLACE 1
+
+typedef struct __flvbench_command {
+    const char * name;
+    int command;
+    int format;
+} flvbench_command;
+
+static const flvbench_command commands[] = {
+    { "check",          FLVMETA_CHECK_COMMAND,      FLVMETA_FORMAT_RAW },
+    { "dump",           FLVMETA_DUMP_COMMAND,       FLVMETA_FORMAT_XML },
+    { "dump",           FLVMETA_DUMP_COMMAND,       FLVMETA_FORMAT_JSON },
+    { "dump",           FLVMETA_DUMP_COMMAND,       FLVMETA_FORMAT_RAW },
+    { "dump",           FLVMETA_DUMP_COMMAND,       FLVMETA_FORMAT_YAML },
+    { "dump",           FLVMETA_DUMP_COMMAND,       FLVMETA_FORMAT_NDJSON },
+    { "dump",           FLVMETA_DUMP_COMMAND,       FLVMETA_FORMAT_CBOR },
+    { "dump",           FLVMETA_DUMP_COMMAND,       FLVMETA_FORMAT_CSV },
+    { "dump",           FLVMETA_DUMP_COMMAND,       FLVMETA_FORMAT_TSV },
+    { "full-dump",      FLVMETA_FULL_DUMP_COMMAND,  FLVMETA_FORMAT_XML },
+    { "full-dump",      FLVMETA_FULL_DUMP_COMMAND,  FLVMETA_FORMAT_JSON },
+    { "full-dump",      FLVMETA_FULL_DUMP_COMMAND,  FLVMETA_FORMAT_RAW },
+    { "full-dump",      FLVMETA_FULL_DUMP_COMMAND,  FLVMETA_FORMAT_YAML },
+    { "full-dump",      FLVMETA_FULL_DUMP_COMMAND,  FLVMETA_FORMAT_NDJSON },
+    { "full-dump",      FLVMETA_FULL_DUMP_COMMAND,  FLVMETA_FORMAT_CBOR },
+    { "full-dump",      FLVMETA_FULL_DUMP_COMMAND,  FLVMETA_FORMAT_CSV },
+    { "full-dump",      FLVMETA_FULL_DUMP_COMMAND,  FLVMETA_FORMAT_TSV },
+    { "update",         FLVMETA_UPDATE_COMMAND,     FLVBENCH_UPDATE_NEW },
+    { "update-inplace", FLVMETA_UPDATE_COMMAND,     FLVBENCH_UPDATE_INPLACE },
+    { NULL, 0, 0 }
+};
+
+static const char * format_names[] = {
+    "xml", "raw", "json", "yaml", "ndjson", "cbor", "csv", "tsv"
+};
+
+/* measures of a single run, sent by the child process */
+typedef struct __flvbench_measure {
+    int status;
+    double seconds;
+    memcount_stats memory;
+} flvbench_measure;
+
+typedef struct __flvbench_opts {
+    const char * flvgen;
+    const char * corpus_dir;
+    const char * output_file;
+    const char * only;
+    int runs;
+    double scale;
+} flvbench_opts;
+
+/*
+    Command-line options
+*/
+static struct option long_options[] = {
+    { "runs",               required_argument,  NULL, 'n'},
+    { "scale",              required_argument,  NULL, 's'},
+    { "only",               required_argument,  NULL, 'O'},
+    { "corpus-dir",         required_argument,  NULL, 'c'},
+    { "flvgen",             required_argument,  NULL, 'g'},
+    { "output",             required_argument,  NULL, 'o'},
+    { "help",               no_argument,        NULL, 'h'},
+    { 0, 0, 0, 0 }
+};
+
+/* discard the command output, only its production is measured */
+static size_t flvbench_discard(const void * data, size_t size, void * user_data) {
+    (void)data;
+    (void)user_data;
+    return size;
+}
+
+static double flvbench_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int flvbench_copy_file(const char * from, const char * to) {
+    FILE * in, * out;
+    char * buffer;
+    size_t n;
+    int res = OK;
+
+    buffer = (char *) malloc(1024 * 1024);
+    if (buffer == NULL) {
+        return ERROR_MEMORY;
+    }
+    in = fopen(from, "rb");
+    if (in == NULL) {
+        free(buffer);
+        return ERROR_OPEN_READ;
+    }
+    out = fopen(to, "wb");
+    if (out == NULL) {
+        fclose(in);
+        free(buffer);
+        return ERROR_OPEN_WRITE;
+    }
+    while ((n = fread(buffer, 1, 1024 * 1024, in)) > 0) {
+        if (fwrite(buffer, n, 1, out) != 1) {
+            res = ERROR_WRITE;
+            break;
+        }
+    }
+    fclose(in);
+    if (fclose(out) != 0) {
+        res = ERROR_WRITE;
+    }
+    free(buffer);
+    return res;
+}
+
+/* count the tags of a file */
+static uint32 flvbench_count_tags(const char * file) {
+    flv_stream * stream;
+    flv_header header;
+    flv_tag tag;
+    uint32 prev_tag_size, count = 0;
+
+    stream = flv_open(file);
+    if (stream == NULL) {
+        return 0;
+    }
+    if (flv_read_header(stream, &header) == FLV_OK) {
+        while (flv_read_prev_tag_size(stream, &prev_tag_size) == FLV_OK
+        && flv_read_tag(stream, &tag) == FLV_OK) {
+            count++;
+        }
+    }
+    flv_close(stream);
+    return count;
+}
+
+/*
+    generate a corpus with flvgen, then compute its metadata if needed
+*/
+static int flvbench_generate(const flvbench_opts * opts, const flvbench_corpus * corpus, char * file, char * raw_file) {
+    char command[FLVBENCH_COMMAND_SIZE];
+    flvmeta_context * ctx;
+    int retval;
+
+    if (snprintf(raw_file, FLVBENCH_PATH_SIZE, "%s/%s-raw.flv", opts->corpus_dir, corpus->name) >= FLVBENCH_PATH_SIZE
+    || snprintf(file, FLVBENCH_PATH_SIZE, "%s/%s.flv", opts->corpus_dir, corpus->name) >= FLVBENCH_PATH_SIZE
+    || snprintf(command, sizeof(command), "\"%s\" --duration=%g %s \"%s\"",
+        opts->flvgen, corpus->duration * opts->scale, corpus->flvgen_options,
+        corpus->update ? raw_file : file) >= (int)sizeof(command)) {
+        fprintf(stderr, "flvbench: path too long for %s\n", corpus->name);
+        return ERROR_OPEN_WRITE;
+    }
+    if (system(command) != 0) {
+        fprintf(stderr, "flvbench: cannot generate %s with %s\n", file, opts->flvgen);
+        return ERROR_OPEN_WRITE;
+    }
+
+    if (corpus->update) {
+        ctx = flvmeta_context_new();
+        if (ctx == NULL) {
+            return ERROR_MEMORY;
+        }
+        flvmeta_context_set_command(ctx, FLVMETA_UPDATE_COMMAND);
+        flvmeta_context_set_input_file(ctx, raw_file);
+        flvmeta_context_set_output_file(ctx, file);
+        retval = flvmeta_execute(ctx);
+        flvmeta_context_free(ctx);
+        if (retval != OK) {
+            fprintf(stderr, "flvbench: cannot update %s\n", file);
+            return ERROR_OPEN_WRITE;
+        }
+        remove(raw_file);
+    }
+    return OK;
+}
+
+/*
+    run a command in a child process, returning its measures
+*/
+static int flvbench_run(const flvbench_command * command, char * input_file, char * output_file, flvbench_measure * measure, long * peak_rss_kb) {
+    int fds[2], status;
+    struct rusage usage;
+    pid_t pid;
+    ssize_t n;
+
+    if (pipe(fds) != 0) {
+        return ERROR_WRITE;
+    }
+    fflush(stdout);
+    fflush(stderr);
+
+    pid = fork();
+    if (pid < 0) {
+        close(fds[0]);
+        close(fds[1]);
+        return ERROR_MEMORY;
+    }
+    if (pid == 0) {
+        flvmeta_context * ctx;
+        output_sink out;
+        flvbench_measure result;
+        double start;
+
+        close(fds[0]);
+        ctx = flvmeta_context_new();
+        if (ctx == NULL) {
+            _exit(EXIT_FAILURE);
+        }
+        flvmeta_context_set_command(ctx, command->command);
+        flvmeta_context_set_input_file(ctx, input_file);
+        flvmeta_context_set_output_file(ctx, output_file);
+        if (command->command != FLVMETA_UPDATE_COMMAND) {
+            flvmeta_context_set_format(ctx, command->format);
+        }
+        sink_init(&out, flvbench_discard, NULL, NULL, NULL, 0);
+        flvmeta_context_set_output(ctx, &out);
+
+        memcount_reset();
+        start = flvbench_now();
+        result.status = flvmeta_execute(ctx);
+        result.seconds = flvbench_now() - start;
+        memcount_get(&result.memory);
+        sink_close(&out);
+
+        n = write(fds[1], &result, sizeof(result));
+        close(fds[1]);
+        _exit(n == sizeof(result) ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
+
+    close(fds[1]);
+    n = read(fds[0], measure, sizeof(*measure));
+    close(fds[0]);
+    if (wait4(pid, &status, 0, &usage) != pid || n != sizeof(*measure)) {
+        return ERROR_EOF;
+    }
+#ifdef __APPLE__
+    /* bytes instead of kilobytes */
+    *peak_rss_kb = usage.ru_maxrss / 1024;
+#else
+    *peak_rss_kb = usage.ru_maxrss;
+#endif
+    return OK;
+}
+
+static void usage(const char * name) {
+    fprintf(stderr, "Usage: %s [OPTIONS]\n", name);
+    fprintf(stderr, "Try `%s --help' for more information.\n", name);
+}
+
+static void help(const char * name) {
+    printf("Usage: %s [OPTIONS]\n", name);
+    printf("\nMeasure the throughput, peak memory usage and allocations of the flvmeta\n"
+           "commands on generated FLV files.\n"
+           "\nOptions:\n"
+           "  -n, --runs=COUNT          run each command COUNT times, keeping the fastest\n"
+           "                            run (default %d)\n"
+           "  -s, --scale=FACTOR        multiply the duration of the corpora by FACTOR\n"
+           "      --only=NAME           only run the corpus or command named NAME\n"
+           "      --corpus-dir=DIR      generate the corpora into DIR (default bench-corpus)\n"
+           "      --flvgen=PATH         path of the flvgen program, by default next to\n"
+           "                            this program\n"
+           "  -o, --output=FILE         write the results to FILE as JSON\n"
+           "  -h, --help                display this information and exit\n", FLVBENCH_DEFAULT_RUNS);
+    printf("\nPlease report bugs to <%s>\n", PACKAGE_BUGREPORT);
+}
+
+int main(int argc, char ** argv) {
+    flvbench_opts opts;
+    char * flvgen = NULL;
+    char file[FLVBENCH_PATH_SIZE], raw_file[FLVBENCH_PATH_SIZE], output_file[FLVBENCH_PATH_SIZE];
+    output_sink json_out;
+    json_emitter je;
+    FILE * json_file = NULL;
+    int option, c, i, run, res = OK;
+
+    /* default options */
+    opts.flvgen = NULL;
+    opts.corpus_dir = "bench-corpus";
+    opts.output_file = NULL;
+    opts.only = NULL;
+    opts.runs = FLVBENCH_DEFAULT_RUNS;
+    opts.scale = 1;
+
+    while ((option = getopt_long(argc, argv, "n:s:o:h", long_options, NULL)) != EOF) {
+        switch (option) {
+            case 'n': opts.runs = atoi(optarg); break;
+            case 's': opts.scale = atof(optarg); break;
+            case 'O': opts.only = optarg; break;
+            case 'c': opts.corpus_dir = optarg; break;
+            case 'g': opts.flvgen = optarg; break;
+            case 'o': opts.output_file = optarg; break;
+            case 'h': help(argv[0]); return EXIT_SUCCESS;
+            default: usage(argv[0]); return EXIT_FAILURE;
+        }
+    }
+    if (opts.runs < 1 || opts.scale <= 0 || optind < argc) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    /* flvgen is built in the same directory */
+    if (opts.flvgen == NULL) {
+        const char * slash = strrchr(argv[0], '/');
+        size_t length = (slash != NULL) ? (size_t)(slash - argv[0] + 1) : 0;
+        flvgen = (char *) malloc(length + sizeof("flvgen"));
+        if (flvgen == NULL) {
+            return ERROR_MEMORY;
+        }
+        memcpy(flvgen, argv[0], length);
+        strcpy(flvgen + length, "flvgen");
+        opts.flvgen = flvgen;
+    }
+
+    if (strlen(opts.corpus_dir) > 512 || strlen(opts.flvgen) > 512) {
+        fprintf(stderr, "%s: path too long\n", argv[0]);
+        free(flvgen);
+        return EXIT_FAILURE;
+    }
+    mkdir(opts.corpus_dir, 0777);
+
+    if (opts.output_file != NULL) {
+        json_file = fopen(opts.output_file, "w");
+        if (json_file == NULL) {
+            fprintf(stderr, "%s: cannot open %s for writing\n", argv[0], opts.output_file);
+            free(flvgen);
+            return ERROR_OPEN_WRITE;
+        }
+        sink_init_file(&json_out, json_file);
+        json_emit_init(&je, &json_out);
+        json_emit_object_start(&je);
+        json_emit_object_key_z(&je, "version");
+        json_emit_string_z(&je, flvmeta_version());
+        json_emit_object_key_z(&je, "runs");
+        json_emit_integer(&je, opts.runs);
+        json_emit_object_key_z(&je, "scale");
+        json_emit_number(&je, opts.scale);
+        json_emit_object_key_z(&je, "allocations_counted");
+        json_emit_boolean(&je, (byte)memcount_enabled());
+        json_emit_object_key_z(&je, "results");
+        json_emit_array_start(&je);
+    }
+
+    printf("%-11s %-15s %-7s %9s %9s %11s %9s %11s %13s\n",
+        "corpus", "command", "format", "MB", "seconds", "MB/s", "tags/s", "peak RSS kB", "allocations");
+
+    for (c = 0; corpora[c].name != NULL && res == OK; c++) {
+        const flvbench_corpus * corpus = &corpora[c];
+        struct stat st;
+        uint32 tags;
+        int selected = (opts.only == NULL || !strcmp(opts.only, corpus->name));
+
+        /* skip the corpus if no command can be selected */
+        for (i = 0; !selected && commands[i].name != NULL; i++) {
+            selected = !strcmp(opts.only, commands[i].name);
+        }
+        if (!selected) {
+            continue;
+        }
+
+        res = flvbench_generate(&opts, corpus, file, raw_file);
+        if (res != OK || stat(file, &st) != 0) {
+            break;
+        }
+        tags = flvbench_count_tags(file);
+
+        for (i = 0; commands[i].name != NULL; i++) {
+            const flvbench_command * command = &commands[i];
+            flvbench_measure best, measure;
+            long peak_rss_kb = 0, rss_kb;
+            int inplace = (command->command == FLVMETA_UPDATE_COMMAND && command->format == FLVBENCH_UPDATE_INPLACE);
+            int update = (command->command == FLVMETA_UPDATE_COMMAND);
+            double mb = st.st_size / 1e6;
+
+            if (opts.only != NULL && strcmp(opts.only, corpus->name) && strcmp(opts.only, command->name)) {
+                continue;
+            }
+
+            if (snprintf(output_file, sizeof(output_file), "%s/%s-out.flv", opts.corpus_dir, corpus->name) >= (int)sizeof(output_file)) {
+                fprintf(stderr, "%s: path too long for %s\n", argv[0], corpus->name);
+                res = ERROR_OPEN_WRITE;
+                break;
+            }
+            memset(&best, 0, sizeof(best));
+            best.seconds = -1;
+            for (run = 0; run < opts.runs && res == OK; run++) {
+                char * input = file;
+                if (inplace) {
+                    /* update a fresh copy each time */
+                    res = flvbench_copy_file(file, output_file);
+                    input = output_file;
+                }
+                if (res == OK) {
+                    res = flvbench_run(command, input, update ? output_file : NULL, &measure, &rss_kb);
+                }
+                if (res == OK) {
+                    if (best.seconds < 0 || measure.seconds < best.seconds) {
+                        best = measure;
+                    }
+                    if (rss_kb > peak_rss_kb) {
+                        peak_rss_kb = rss_kb;
+                    }
+                }
+            }
+            if (update) {
+                remove(output_file);
+            }
+            if (res != OK) {
+                fprintf(stderr, "%s: cannot run %s on %s\n", argv[0], command->name, file);
+                break;
+            }
+            if (best.seconds <= 0) {
+                best.seconds = 1e-9;
+            }
+
+            printf("%-11s %-15s %-7s %9.2f %9.4f %11.1f %9.0f %11ld ",
+                corpus->name, command->name, update ? "-" : format_names[command->format],
+                mb, best.seconds, mb / best.seconds, tags / best.seconds, peak_rss_kb);
+            if (memcount_enabled()) {
+                printf("%13" PRI_LL "u\n", (unsigned long long)best.memory.allocations);
+            }
+            else {
+                printf("%13s\n", "-");
+            }
+
+            if (json_file != NULL) {
+                json_emit_object_start(&je);
+                json_emit_object_key_z(&je, "corpus");
+                json_emit_string_z(&je, corpus->name);
+                json_emit_object_key_z(&je, "command");
+                json_emit_string_z(&je, command->name);
+                json_emit_object_key_z(&je, "format");
+                if (update) {
+                    json_emit_null(&je);
+                }
+                else {
+                    json_emit_string_z(&je, format_names[command->format]);
+                }
+                json_emit_object_key_z(&je, "status");
+                json_emit_integer(&je, best.status);
+                json_emit_object_key_z(&je, "bytes");
+                json_emit_file_offset(&je, st.st_size);
+                json_emit_object_key_z(&je, "tags");
+                json_emit_file_offset(&je, tags);
+                json_emit_object_key_z(&je, "seconds");
+                json_emit_number(&je, best.seconds);
+                json_emit_object_key_z(&je, "mb_per_s");
+                json_emit_number(&je, mb / best.seconds);
+                json_emit_object_key_z(&je, "tags_per_s");
+                json_emit_number(&je, tags / best.seconds);
+                json_emit_object_key_z(&je, "peak_rss_kb");
+                json_emit_file_offset(&je, peak_rss_kb);
+                json_emit_object_key_z(&je, "allocations");
+                if (memcount_enabled()) {
+                    json_emit_file_offset(&je, (file_offset_t)best.memory.allocations);
+                    json_emit_object_key_z(&je, "reallocations");
+                    json_emit_file_offset(&je, (file_offset_t)best.memory.reallocations);
+                    json_emit_object_key_z(&je, "frees");
+                    json_emit_file_offset(&je, (file_offset_t)best.memory.frees);
+                    json_emit_object_key_z(&je, "allocated_bytes");
+                    json_emit_file_offset(&je, (file_offset_t)best.memory.allocated_bytes);
+                }
+                else {
+                    json_emit_null(&je);
+                }
+                json_emit_object_end(&je);
+            }
+        }
+    }
+
+    if (json_file != NULL) {
+        json_emit_array_end(&je);
+        json_emit_object_end(&je);
+        sink_write_char(&json_out, '\n');
+        if (sink_close(&json_out) != 0 && res == OK) {
+            res = ERROR_WRITE;
+        }
+        if (fclose(json_file) != 0 && res == OK) {
+            res = ERROR_WRITE;
+        }
+    }
+
+    free(flvgen);
+    return res;
+}
@@ -0,0 +1,1237 @@
+/*
+    FLVMeta - FLV Metadata Editor
+
+    Copyright (C) 2007-2014 Marc Noirot <marc.noirot AT gmail.com>
+
+    This file is part of FLVMeta.
+
+    FLVMeta is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    FLVMeta is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FLVMeta; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "libflvmeta.h"
+
+/*
+    flvgen: deterministic generator of synthetic FLV files, valid or
+    deliberately broken, used to exercise flvmeta without sample media.
+    Media payloads are pseudo-random bytes framed by real codec headers,
+    so that flvmeta can compute every metadata value from them.
+*/
+
+/* generated codecs */
+#define FLVGEN_VIDEO_NONE   0
+#define FLVGEN_VIDEO_AVC    1
+#define FLVGEN_VIDEO_H263   2
+#define FLVGEN_VIDEO_VP6    3
+
+#define FLVGEN_AUDIO_NONE   0
+#define FLVGEN_AUDIO_AAC    1
+#define FLVGEN_AUDIO_MP3    2
+
+/* corruption patterns */
+#define FLVGEN_CORRUPT_SIGNATURE    0x0001
+#define FLVGEN_CORRUPT_METADATA     0x0002
+#define FLVGEN_CORRUPT_TRUNCATE     0x0004
+#define FLVGEN_CORRUPT_PREV_SIZE    0x0008
+#define FLVGEN_CORRUPT_TAG_TYPE     0x0010
+#define FLVGEN_CORRUPT_BODY_LENGTH  0x0020
+#define FLVGEN_CORRUPT_TIMESTAMP    0x0040
+#define FLVGEN_CORRUPT_STREAM_ID    0x0080
+#define FLVGEN_CORRUPT_EMPTY        0x0100
+#define FLVGEN_CORRUPT_GARBAGE      0x0200
+#define FLVGEN_CORRUPT_CODEC        0x0400
+
+/* patterns applied to a single media tag */
+#define FLVGEN_TAG_CORRUPTIONS      0x07FC
+
+/* all generated audio is sampled at 44100 Hz */
+#define FLVGEN_SAMPLE_RATE          44100
+#define FLVGEN_AAC_FRAME_SAMPLES    1024
+#define FLVGEN_MP3_FRAME_SAMPLES    1152
+
+/* size of the random bytes inserted by the garbage pattern */
+#define FLVGEN_GARBAGE_SIZE         64
+
+/* biggest possible tag body */
+#define FLVGEN_MAX_BODY_LENGTH      0xFFFFFFu
+
+typedef struct __flvgen_opts {
+    const char * output_file;
+    double duration;
+    uint32 max_tags;
+    uint64 max_size;
+    int video_codec;
+    int audio_codec;
+    uint32 video_bitrate;
+    uint32 audio_bitrate;
+    double frame_rate;
+    uint32 width;
+    uint32 height;
+    double keyframe_interval;
+    uint32 metadata_size;
+    int no_metadata;
+    uint32 start_time;
+    int wrap_timestamps;
+    uint32 corruptions;
+    uint32 corrupt_at;
+    uint32 seed;
+    int verbose;
+} flvgen_opts;
+
+typedef struct __flvgen_state {
+    const flvgen_opts * opts;
+    FILE * out;
+    uint32 random;
+    byte * body;
+    size_t body_capacity;
+    uint32 tag_number;
+    uint64 written;
+    /* file offset of the onMetaData duration value, 0 without onMetaData */
+    uint64 duration_offset;
+    int corrupted;
+    int truncated;
+    uint32 mp3_bitrate;
+    uint32 mp3_bitrate_index;
+    uint32 mp3_remainder;
+} flvgen_state;
+
+/*
+    Long-only options
+*/
+enum {
+    SIZE_OPTION_ID = 256,
+    VIDEO_OPTION_ID,
+    AUDIO_OPTION_ID,
+    VIDEO_BITRATE_OPTION_ID,
+    AUDIO_BITRATE_OPTION_ID,
+    FRAME_RATE_OPTION_ID,
+    WIDTH_OPTION_ID,
+    HEIGHT_OPTION_ID,
+    METADATA_SIZE_OPTION_ID,
+    NO_METADATA_OPTION_ID,
+    START_TIME_OPTION_ID,
+    WRAP_TIMESTAMPS_OPTION_ID,
+    CORRUPT_OPTION_ID,
+    CORRUPT_AT_OPTION_ID
+};
+
+/*
+    Command-line options
+*/
+static struct option long_options[] = {
+    { "duration",           required_argument,  NULL, 'd'},
+    { "tags",               required_argument,  NULL, 'n'},
+    { "size",               required_argument,  NULL, SIZE_OPTION_ID},
+    { "video",              required_argument,  NULL, VIDEO_OPTION_ID},
+    { "audio",              required_argument,  NULL, AUDIO_OPTION_ID},
+    { "video-bitrate",      required_argument,  NULL, VIDEO_BITRATE_OPTION_ID},
+    { "audio-bitrate",      required_argument,  NULL, AUDIO_BITRATE_OPTION_ID},
+    { "frame-rate",         required_argument,  NULL, FRAME_RATE_OPTION_ID},
+    { "width",              required_argument,  NULL, WIDTH_OPTION_ID},
+    { "height",             required_argument,  NULL, HEIGHT_OPTION_ID},
+    { "keyframe-interval",  required_argument,  NULL, 'k'},
+    { "metadata-size",      required_argument,  NULL, METADATA_SIZE_OPTION_ID},
+    { "no-metadata",        no_argument,        NULL, NO_METADATA_OPTION_ID},
+    { "start-time",         required_argument,  NULL, START_TIME_OPTION_ID},
+    { "wrap-timestamps",    no_argument,        NULL, WRAP_TIMESTAMPS_OPTION_ID},
+    { "corrupt",            required_argument,  NULL, CORRUPT_OPTION_ID},
+    { "corrupt-at",         required_argument,  NULL, CORRUPT_AT_OPTION_ID},
+    { "seed",               required_argument,  NULL, 's'},
+    { "verbose",            no_argument,        NULL, 'v'},
+    { "version",            no_argument,        NULL, 'V'},
+    { "help",               no_argument,        NULL, 'h'},
+    { 0, 0, 0, 0 }
+};
+
+/* short options */
+#define DURATION_OPTION             "d:"
+#define TAGS_OPTION                 "n:"
+#define KEYFRAME_INTERVAL_OPTION    "k:"
+#define SEED_OPTION                 "s:"
+#define VERBOSE_OPTION              "v"
+#define VERSION_OPTION              "V"
+#define HELP_OPTION                 "h"
+
+/* names of the corruption patterns, in flag order */
+static const char * corruption_names[] = {
+    "signature",
+    "metadata",
+    "truncate",
+    "prev-size",
+    "tag-type",
+    "body-length",
+    "timestamp",
+    "stream-id",
+    "empty",
+    "garbage",
+    "codec",
+    NULL
+};
+
+/* MPEG-1 Layer III bitrates, in kbps, by bitrate index */
+static const uint32 mp3_bitrates[] = {
+    0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320
+};
+
+/*
+    pseudo-random numbers, xorshift32 so that output only depends on the seed
+*/
+static uint32 flvgen_random(flvgen_state * gen) {
+    uint32 x = gen->random;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    gen->random = x;
+    return x;
+}
+
+static void flvgen_fill(flvgen_state * gen, byte * buffer, size_t size) {
+    size_t i;
+    uint32 value = 0;
+
+    for (i = 0; i < size; i++) {
+        if ((i & 3) == 0) {
+            value = flvgen_random(gen);
+        }
+        buffer[i] = (byte)(value >> ((i & 3) << 3));
+    }
+}
+
+/* make sure the body buffer can hold size bytes */
+static byte * flvgen_reserve(flvgen_state * gen, size_t size) {
+    if (size > gen->body_capacity) {
+        byte * body = (byte *) realloc(gen->body, size);
+        if (body == NULL) {
+            return NULL;
+        }
+        gen->body = body;
+        gen->body_capacity = size;
+    }
+    return gen->body;
+}
+
+/* apply a +/- 12.5% jitter to a frame size */
+static uint32 flvgen_jitter(flvgen_state * gen, uint32 size) {
+    uint32 range = size / 4;
+    if (range > 0) {
+        size = size - size / 8 + flvgen_random(gen) % (range + 1);
+    }
+    return size;
+}
+
+/*
+    bit writer, for codec headers
+*/
+typedef struct __flvgen_bits {
+    byte * buffer;
+    size_t size;
+    size_t bits;
+} flvgen_bits;
+
+static void flvgen_bits_init(flvgen_bits * bw, byte * buffer, size_t size) {
+    bw->buffer = buffer;
+    bw->size = size;
+    bw->bits = 0;
+    memset(buffer, 0, size);
+}
+
+static void flvgen_put_bits(flvgen_bits * bw, uint32 value, int count) {
+    while (count-- > 0) {
+        if (bw->bits / 8 < bw->size) {
+            if ((value >> count) & 1) {
+                bw->buffer[bw->bits / 8] |= (byte)(0x80 >> (bw->bits % 8));
+            }
+            bw->bits++;
+        }
+    }
+}
+
+/* unsigned Exp-Golomb code */
+static void flvgen_put_ue(flvgen_bits * bw, uint32 value) {
+    int length = 0;
+    uint32 code = value + 1;
+
+    while ((code >> length) > 1) {
+        length++;
+    }
+    flvgen_put_bits(bw, 0, length);
+    flvgen_put_bits(bw, code, length + 1);
+}
+
+/* rbsp trailing bits, returning the number of bytes written */
+static size_t flvgen_put_trailing_bits(flvgen_bits * bw) {
+    flvgen_put_bits(bw, 1, 1);
+    while (bw->bits % 8 != 0) {
+        flvgen_put_bits(bw, 0, 1);
+    }
+    return bw->bits / 8;
+}
+
+/*
+    turn a raw byte sequence payload into a NAL unit, with its header
+    and emulation prevention bytes
+*/
+static size_t flvgen_nal_unit(byte header, const byte * rbsp, size_t size, byte * nal) {
+    size_t i, n = 0;
+    int zeros = 0;
+
+    nal[n++] = header;
+    for (i = 0; i < size; i++) {
+        if (zeros == 2 && rbsp[i] <= 3) {
+            nal[n++] = 3;
+            zeros = 0;
+        }
+        nal[n++] = rbsp[i];
+        zeros = (rbsp[i] == 0) ? zeros + 1 : 0;
+    }
+    return n;
+}
+
+/*
+    AVCDecoderConfigurationRecord holding a Baseline profile SPS with the
+    requested frame size, and a matching PPS
+*/
+static size_t flvgen_avc_configuration(const flvgen_opts * opts, byte * record) {
+    byte rbsp[32];
+    flvgen_bits bw;
+    uint32 width_in_mbs, height_in_mbs;
+    size_t size, sps_size, pps_size;
+
+    width_in_mbs = (opts->width + 15) / 16;
+    height_in_mbs = (opts->height + 15) / 16;
+
+    /* sequence parameter set */
+    flvgen_bits_init(&bw, rbsp, sizeof(rbsp));
+    flvgen_put_bits(&bw, 66, 8);    /* profile_idc: Baseline */
+    flvgen_put_bits(&bw, 0xC0, 8);  /* constraint_set0 and constraint_set1 */
+    flvgen_put_bits(&bw, 30, 8);    /* level_idc */
+    flvgen_put_ue(&bw, 0);          /* seq_parameter_set_id */
+    flvgen_put_ue(&bw, 0);          /* log2_max_frame_num_minus4 */
+    flvgen_put_ue(&bw, 2);          /* pic_order_cnt_type */
+    flvgen_put_ue(&bw, 1);          /* num_ref_frames */
+    flvgen_put_bits(&bw, 0, 1);     /* gaps_in_frame_num_value_allowed_flag */
+    flvgen_put_ue(&bw, width_in_mbs - 1);
+    flvgen_put_ue(&bw, height_in_mbs - 1);
+    flvgen_put_bits(&bw, 1, 1);     /* frame_mbs_only_flag */
+    flvgen_put_bits(&bw, 1, 1);     /* direct_8x8_inference_flag */
+    if (width_in_mbs * 16 != opts->width || height_in_mbs * 16 != opts->height) {
+        flvgen_put_bits(&bw, 1, 1); /* frame_cropping_flag */
+        flvgen_put_ue(&bw, 0);
+        flvgen_put_ue(&bw, (width_in_mbs * 16 - opts->width) / 2);
+        flvgen_put_ue(&bw, 0);
+        flvgen_put_ue(&bw, (height_in_mbs * 16 - opts->height) / 2);
+    }
+    else {
+        flvgen_put_bits(&bw, 0, 1);
+    }
+    flvgen_put_bits(&bw, 0, 1);     /* vui_parameters_present_flag */
+    size = flvgen_put_trailing_bits(&bw);
+    sps_size = flvgen_nal_unit(0x67, rbsp, size, record + 8);
+
+    record[0] = 1;          /* configurationVersion */
+    record[1] = record[9];  /* AVCProfileIndication */
+    record[2] = record[10]; /* profile_compatibility */
+    record[3] = record[11]; /* AVCLevelIndication */
+    record[4] = 0xFF;       /* 4 bytes NAL unit lengths */
+    record[5] = 0xE1;       /* one SPS */
+    record[6] = (byte)(sps_size >> 8);
+    record[7] = (byte)sps_size;
+
+    /* picture parameter set */
+    flvgen_bits_init(&bw, rbsp, sizeof(rbsp));
+    flvgen_put_ue(&bw, 0);          /* pic_parameter_set_id */
+    flvgen_put_ue(&bw, 0);          /* seq_parameter_set_id */
+    flvgen_put_bits(&bw, 0, 1);     /* entropy_coding_mode_flag */
+    flvgen_put_bits(&bw, 0, 1);     /* bottom_field_pic_order_in_frame_present_flag */
+    flvgen_put_ue(&bw, 0);          /* num_slice_groups_minus1 */
+    flvgen_put_ue(&bw, 0);          /* num_ref_idx_l0_default_active_minus1 */
+    flvgen_put_ue(&bw, 0);          /* num_ref_idx_l1_default_active_minus1 */
+    flvgen_put_bits(&bw, 0, 3);     /* weighted_pred_flag, weighted_bipred_idc */
+    flvgen_put_ue(&bw, 0);          /* pic_init_qp_minus26 */
+    flvgen_put_ue(&bw, 0);          /* pic_init_qs_minus26 */
+    flvgen_put_ue(&bw, 0);          /* chroma_qp_index_offset */
+    flvgen_put_bits(&bw, 1, 1);     /* deblocking_filter_control_present_flag */
+    flvgen_put_bits(&bw, 0, 2);     /* constrained_intra_pred, redundant_pic_cnt_present */
+    size = flvgen_put_trailing_bits(&bw);
+    pps_size = flvgen_nal_unit(0x68, rbsp, size, record + 8 + sps_size + 3);
+
+    record[8 + sps_size] = 1; /* one PPS */
+    record[8 + sps_size + 1] = (byte)(pps_size >> 8);
+    record[8 + sps_size + 2] = (byte)pps_size;
+
+    return 8 + sps_size + 3 + pps_size;
+}
+
+/*
+    size of the video frames, derived from the bitrate: keyframes are
+    three times as big as the average frame, interframes share the rest
+*/
+static uint32 flvgen_video_frame_size(flvgen_state * gen, int keyframe) {
+    const flvgen_opts * opts = gen->opts;
+    uint32 gop_frames, average, size;
+
+    gop_frames = (uint32)(opts->keyframe_interval * opts->frame_rate + 0.5);
+    if (gop_frames < 1) {
+        gop_frames = 1;
+    }
+    average = (uint32)(opts->video_bitrate * 125.0 / opts->frame_rate);
+
+    if (gop_frames == 1) {
+        size = average;
+    }
+    else if (keyframe) {
+        size = average * 3;
+    }
+    else {
+        size = (average * gop_frames - average * 3) / (gop_frames - 1);
+    }
+    size = flvgen_jitter(gen, size);
+    if (size < 16) {
+        size = 16;
+    }
+    if (size > FLVGEN_MAX_BODY_LENGTH - 16) {
+        size = FLVGEN_MAX_BODY_LENGTH - 16;
+    }
+    return size;
+}
+
+/*
+    build a video tag body, returning its length
+*/
+static uint32 flvgen_video_frame(flvgen_state * gen, uint32 frame, int keyframe, int * error) {
+    const flvgen_opts * opts = gen->opts;
+    uint32 size, length;
+    byte * body;
+    flvgen_bits bw;
+
+    size = flvgen_video_frame_size(gen, keyframe);
+    body = flvgen_reserve(gen, size + 16);
+    if (body == NULL) {
+        *error = ERROR_MEMORY;
+        return 0;
+    }
+    body[0] = (byte)((keyframe ? FLV_VIDEO_TAG_FRAME_TYPE_KEYFRAME : FLV_VIDEO_TAG_FRAME_TYPE_INTERFRAME) << 4);
+
+    switch (opts->video_codec) {
+        case FLVGEN_VIDEO_AVC:
+            body[0] |= FLV_VIDEO_TAG_CODEC_AVC;
+            body[1] = FLV_AVC_PACKET_TYPE_NALU;
+            body[2] = body[3] = body[4] = 0; /* composition time */
+            body[5] = (byte)(size >> 24);
+            body[6] = (byte)(size >> 16);
+            body[7] = (byte)(size >> 8);
+            body[8] = (byte)size;
+            body[9] = keyframe ? 0x65 : 0x41; /* IDR or non-IDR slice */
+            flvgen_fill(gen, body + 10, size - 1);
+            length = 9 + size;
+            break;
+        case FLVGEN_VIDEO_H263:
+            /* Sorenson H.263 picture header */
+            body[0] |= FLV_VIDEO_TAG_CODEC_SORENSEN_H263;
+            flvgen_bits_init(&bw, body + 1, 10);
+            flvgen_put_bits(&bw, 1, 17);                /* picture start code */
+            flvgen_put_bits(&bw, 0, 5);                 /* version */
+            flvgen_put_bits(&bw, frame & 0xFF, 8);      /* temporal reference */
+            if (opts->width < 256 && opts->height < 256) {
+                flvgen_put_bits(&bw, 0, 3);
+                flvgen_put_bits(&bw, opts->width, 8);
+                flvgen_put_bits(&bw, opts->height, 8);
+            }
+            else {
+                flvgen_put_bits(&bw, 1, 3);
+                flvgen_put_bits(&bw, opts->width, 16);
+                flvgen_put_bits(&bw, opts->height, 16);
+            }
+            flvgen_put_bits(&bw, keyframe ? 0 : 1, 2);  /* picture type */
+            flvgen_put_bits(&bw, 0, 1);                 /* deblocking */
+            flvgen_put_bits(&bw, 8, 5);                 /* quantizer */
+            flvgen_put_bits(&bw, 0, 1);                 /* no extra information */
+            flvgen_fill(gen, body + 11, size);
+            length = 11 + size;
+            break;
+        case FLVGEN_VIDEO_VP6:
+        default:
+            /* VP6 frame, with the FLV size adjustment byte */
+            body[0] |= FLV_VIDEO_TAG_CODEC_ON2_VP6;
+            body[1] = (byte)(((opts->width + 15) / 16) * 16 - opts->width) << 4;
+            body[1] |= (byte)(((opts->height + 15) / 16) * 16 - opts->height);
+            if (keyframe) {
+                body[2] = 0x10;                             /* keyframe, quantizer */
+                body[3] = 0x36;                             /* version 6, advanced profile */
+                body[4] = (byte)((opts->height + 15) / 16); /* macroblock rows */
+                body[5] = (byte)((opts->width + 15) / 16);  /* macroblock columns */
+                body[6] = body[4];                          /* displayed rows */
+                body[7] = body[5];                          /* displayed columns */
+                flvgen_fill(gen, body + 8, size);
+                length = 8 + size;
+            }
+            else {
+                body[2] = 0x90;                             /* interframe, quantizer */
+                flvgen_fill(gen, body + 3, size);
+                length = 3 + size;
+            }
+            break;
+    }
+    return length;
+}
+
+/*
+    build an audio tag body, returning its length
+*/
+static uint32 flvgen_audio_frame(flvgen_state * gen, int * error) {
+    const flvgen_opts * opts = gen->opts;
+    uint32 size;
+    byte * body;
+
+    if (opts->audio_codec == FLVGEN_AUDIO_AAC) {
+        size = (uint32)(opts->audio_bitrate * 125.0 * FLVGEN_AAC_FRAME_SAMPLES / FLVGEN_SAMPLE_RATE);
+        size = flvgen_jitter(gen, size);
+        if (size < 8) {
+            size = 8;
+        }
+        body = flvgen_reserve(gen, size + 2);
+        if (body == NULL) {
+            *error = ERROR_MEMORY;
+            return 0;
+        }
+        body[0] = 0xAF; /* AAC, 44 kHz, 16 bits, stereo */
+        body[1] = FLV_AAC_PACKET_TYPE_RAW;
+        flvgen_fill(gen, body + 2, size);
+        return size + 2;
+    }
+    else {
+        /* constant bitrate frames, padded to keep the exact bitrate */
+        uint32 padding = 0;
+        gen->mp3_remainder += (144000 * gen->mp3_bitrate) % FLVGEN_SAMPLE_RATE;
+        if (gen->mp3_remainder >= FLVGEN_SAMPLE_RATE) {
+            gen->mp3_remainder -= FLVGEN_SAMPLE_RATE;
+            padding = 1;
+        }
+        size = 144000 * gen->mp3_bitrate / FLVGEN_SAMPLE_RATE + padding;
+        body = flvgen_reserve(gen, size + 1);
+        if (body == NULL) {
+            *error = ERROR_MEMORY;
+            return 0;
+        }
+        body[0] = 0x2F; /* MP3, 44 kHz, 16 bits, stereo */
+        body[1] = 0xFF; /* MPEG-1 Layer III, no CRC */
+        body[2] = 0xFB;
+        body[3] = (byte)((gen->mp3_bitrate_index << 4) | (padding << 1));
+        body[4] = 0x00; /* stereo */
+        flvgen_fill(gen, body + 5, size - 4);
+        return size + 1;
+    }
+}
+
+/*
+    write raw bytes to the output file
+*/
+static int flvgen_write(flvgen_state * gen, const void * data, size_t size) {
+    if (size > 0 && fwrite(data, size, 1, gen->out) != 1) {
+        return ERROR_WRITE;
+    }
+    gen->written += size;
+    return OK;
+}
+
+/*
+    write a tag and its previous tag size, applying the requested tag
+    corruptions to the first media tag at or after the corruption index
+*/
+static int flvgen_write_tag(flvgen_state * gen, uint8 type, uint32 timestamp, byte * body, uint32 length) {
+    const flvgen_opts * opts = gen->opts;
+    flv_tag tag;
+    uint32 corruptions, declared_length;
+    uint32_be prev_tag_size;
+    int res;
+
+    corruptions = 0;
+    if (!gen->corrupted
+    && (opts->corruptions & FLVGEN_TAG_CORRUPTIONS)
+    && type != FLV_TAG_TYPE_META
+    && gen->tag_number >= opts->corrupt_at) {
+        corruptions = opts->corruptions;
+        gen->corrupted = 1;
+    }
+
+    if (corruptions & FLVGEN_CORRUPT_GARBAGE) {
+        byte garbage[FLVGEN_GARBAGE_SIZE];
+        flvgen_fill(gen, garbage, sizeof(garbage));
+        res = flvgen_write(gen, garbage, sizeof(garbage));
+        if (res != OK) {
+            return res;
+        }
+    }
+    if (corruptions & FLVGEN_CORRUPT_EMPTY) {
+        length = 0;
+    }
+    if ((corruptions & FLVGEN_CORRUPT_CODEC) && length > 0) {
+        if (type == FLV_TAG_TYPE_VIDEO) {
+            /* switch between AVC and Sorenson H.263 */
+            body[0] = (byte)((body[0] & 0xF0) | (flv_video_tag_codec_id(body[0]) == FLV_VIDEO_TAG_CODEC_AVC ?
+                FLV_VIDEO_TAG_CODEC_SORENSEN_H263 : FLV_VIDEO_TAG_CODEC_AVC));
+        }
+        else {
+            /* switch between AAC and MP3 */
+            body[0] = (byte)((body[0] & 0x0F) | ((flv_audio_tag_sound_format(body[0]) == FLV_AUDIO_TAG_SOUND_FORMAT_AAC ?
+                FLV_AUDIO_TAG_SOUND_FORMAT_MP3 : FLV_AUDIO_TAG_SOUND_FORMAT_AAC) << 4));
+        }
+    }
+    if (corruptions & FLVGEN_CORRUPT_TIMESTAMP) {
+        /* jump ten seconds backwards, or one hour forward at the start */
+        timestamp = (timestamp - opts->start_time >= 10000) ? timestamp - 10000 : timestamp + 3600000;
+    }
+
+    declared_length = length;
+    if (corruptions & FLVGEN_CORRUPT_BODY_LENGTH) {
+        declared_length = length + 64;
+    }
+
+    tag.type = (corruptions & FLVGEN_CORRUPT_TAG_TYPE) ? 0x0F : type;
+    tag.body_length = uint32_to_uint24_be(declared_length);
+    flv_tag_set_timestamp(&tag, timestamp);
+    if (opts->wrap_timestamps) {
+        /* mimic muxers ignoring the timestamp extension */
+        tag.timestamp_extended = 0;
+    }
+    tag.stream_id = uint32_to_uint24_be((corruptions & FLVGEN_CORRUPT_STREAM_ID) ? 1 : 0);
+
+    if (flv_write_tag(gen->out, &tag) != 1) {
+        return ERROR_WRITE;
+    }
+    gen->written += FLV_TAG_SIZE;
+    gen->tag_number++;
+
+    if (corruptions & FLVGEN_CORRUPT_TRUNCATE) {
+        /* the file ends in the middle of the tag body */
+        gen->truncated = 1;
+        return flvgen_write(gen, body, length / 2);
+    }
+
+    res = flvgen_write(gen, body, length);
+    if (res != OK) {
+        return res;
+    }
+
+    if (corruptions & FLVGEN_CORRUPT_PREV_SIZE) {
+        prev_tag_size = swap_uint32(FLV_TAG_SIZE + length + 1024);
+    }
+    else {
+        prev_tag_size = swap_uint32(FLV_TAG_SIZE + length);
+    }
+    return flvgen_write(gen, &prev_tag_size, sizeof(uint32_be));
+}
+
+/*
+    write the onMetaData tag describing the configured streams,
+    padded with random strings up to the requested size
+*/
+static int flvgen_write_metadata(flvgen_state * gen) {
+    const flvgen_opts * opts = gen->opts;
+    amf_data * name, * data;
+    size_t name_size, size;
+    uint32 padding;
+    byte * body;
+    int res;
+
+    name = amf_str("onMetaData");
+    data = amf_associative_array_new();
+    if (name == NULL || data == NULL) {
+        amf_data_free(name);
+        amf_data_free(data);
+        return ERROR_MEMORY;
+    }
+
+    amf_associative_array_add(data, "duration", amf_number_new(opts->duration));
+    if (opts->video_codec != FLVGEN_VIDEO_NONE) {
+        static const number64 codec_ids[] = {
+            0, FLV_VIDEO_TAG_CODEC_AVC, FLV_VIDEO_TAG_CODEC_SORENSEN_H263, FLV_VIDEO_TAG_CODEC_ON2_VP6
+        };
+        amf_associative_array_add(data, "width", amf_number_new(opts->width));
+        amf_associative_array_add(data, "height", amf_number_new(opts->height));
+        amf_associative_array_add(data, "framerate", amf_number_new(opts->frame_rate));
+        amf_associative_array_add(data, "videocodecid", amf_number_new(codec_ids[opts->video_codec]));
+    }
+    if (opts->audio_codec != FLVGEN_AUDIO_NONE) {
+        amf_associative_array_add(data, "audiosamplerate", amf_number_new(FLVGEN_SAMPLE_RATE));
+        amf_associative_array_add(data, "audiosamplesize", amf_number_new(16));
+        amf_associative_array_add(data, "stereo", amf_boolean_new(1));
+        amf_associative_array_add(data, "audiocodecid", amf_number_new(
+            (opts->audio_codec == FLVGEN_AUDIO_MP3) ? FLV_AUDIO_TAG_SOUND_FORMAT_MP3 : FLV_AUDIO_TAG_SOUND_FORMAT_AAC));
+    }
+    amf_associative_array_add(data, "metadatacreator", amf_str("flvgen " PACKAGE_VERSION));
+
+    /* pad with strings of at most 64 KiB, each costing 16 bytes of overhead */
+    name_size = amf_data_size(name);
+    padding = 0;
+    while (name_size + amf_data_size(data) + 16 < opts->metadata_size) {
+        char key[16];
+        byte * str;
+        size_t remaining = opts->metadata_size - name_size - amf_data_size(data) - 16;
+        uint16 length = (uint16)((remaining > 0xFFFF) ? 0xFFFF : remaining);
+        size_t i;
+
+        str = flvgen_reserve(gen, length);
+        if (str == NULL) {
+            amf_data_free(name);
+            amf_data_free(data);
+            return ERROR_MEMORY;
+        }
+        for (i = 0; i < length; i++) {
+            str[i] = (byte)('a' + flvgen_random(gen) % 26);
+        }
+        sprintf(key, "padding%05u", (unsigned int)padding++);
+        amf_associative_array_add(data, key, amf_string_new(str, length));
+    }
+
+    size = name_size + amf_data_size(data);
+    body = flvgen_reserve(gen, size);
+    if (body == NULL) {
+        amf_data_free(name);
+        amf_data_free(data);
+        return ERROR_MEMORY;
+    }
+    amf_data_buffer_write(name, body, name_size);
+    amf_data_buffer_write(data, body + name_size, size - name_size);
+    amf_data_free(name);
+    amf_data_free(data);
+
+    if (opts->corruptions & FLVGEN_CORRUPT_METADATA) {
+        /* first key of the array running past the end of the tag */
+        body[name_size + 5] = 0xFF;
+        body[name_size + 6] = 0xFF;
+    }
+
+    /* duration is the first member: array marker and count, key, number marker */
+    gen->duration_offset = gen->written + FLV_TAG_SIZE + name_size + 5 + 2 + 8 + 1;
+
+    res = flvgen_write_tag(gen, FLV_TAG_TYPE_META, opts->start_time, body, (uint32)size);
+    return res;
+}
+
+/*
+    replace the duration declared by onMetaData with the one actually
+    generated, once generation was stopped by a tag or size limit
+*/
+static int flvgen_fix_duration(flvgen_state * gen, double duration) {
+    number64_be value;
+
+    if (gen->duration_offset == 0) {
+        return OK;
+    }
+    value = swap_number64(duration / 1000.0);
+    if (lfs_fseek(gen->out, (file_offset_t)gen->duration_offset, SEEK_SET) != 0
+    || fwrite(&value, sizeof(number64_be), 1, gen->out) != 1
+    || lfs_fseek(gen->out, 0, SEEK_END) != 0) {
+        return ERROR_WRITE;
+    }
+    return OK;
+}
+
+/*
+    generate the whole file
+*/
+static int flvgen_generate(const flvgen_opts * opts) {
+    flvgen_state gen;
+    flv_header header;
+    uint32_be prev_tag_size;
+    uint32 video_frame, audio_frame, gop_frames, length;
+    double duration, generated, video_time, audio_time, audio_frame_duration;
+    int res;
+
+    memset(&gen, 0, sizeof(gen));
+    gen.opts = opts;
+    gen.random = (opts->seed != 0) ? opts->seed : 0x9E3779B9;
+
+    /* closest valid MP3 bitrate */
+    gen.mp3_bitrate_index = 1;
+    for (length = 1; length < sizeof(mp3_bitrates) / sizeof(mp3_bitrates[0]); length++) {
+        if (abs((int)mp3_bitrates[length] - (int)opts->audio_bitrate)
+        < abs((int)mp3_bitrates[gen.mp3_bitrate_index] - (int)opts->audio_bitrate)) {
+            gen.mp3_bitrate_index = length;
+        }
+    }
+    gen.mp3_bitrate = mp3_bitrates[gen.mp3_bitrate_index];
+
+    gen.out = fopen(opts->output_file, "wb");
+    if (gen.out == NULL) {
+        return ERROR_OPEN_WRITE;
+    }
+    setvbuf(gen.out, NULL, _IOFBF, 1 << 20);
+
+    if (opts->verbose) {
+        fprintf(stdout, "Writing %s...\n", opts->output_file);
+    }
+
+    /* header */
+    header.signature[0] = 'F';
+    header.signature[1] = 'L';
+    header.signature[2] = (opts->corruptions & FLVGEN_CORRUPT_SIGNATURE) ? 'X' : 'V';
+    header.version = FLV_VERSION;
+    header.flags = 0;
+    if (opts->video_codec != FLVGEN_VIDEO_NONE) {
+        header.flags |= FLV_FLAG_VIDEO;
+    }
+    if (opts->audio_codec != FLVGEN_AUDIO_NONE) {
+        header.flags |= FLV_FLAG_AUDIO;
+    }
+    header.offset = swap_uint32(FLV_HEADER_SIZE);
+    prev_tag_size = 0;
+    if (flv_write_header(gen.out, &header) != 1) {
+        res = ERROR_WRITE;
+        goto end;
+    }
+    gen.written = FLV_HEADER_SIZE;
+    res = flvgen_write(&gen, &prev_tag_size, sizeof(uint32_be));
+
+    /* onMetaData */
+    if (res == OK && !opts->no_metadata) {
+        res = flvgen_write_metadata(&gen);
+    }
+
+    /* sequence headers */
+    if (res == OK && opts->video_codec == FLVGEN_VIDEO_AVC) {
+        byte * body = flvgen_reserve(&gen, 128);
+        if (body == NULL) {
+            res = ERROR_MEMORY;
+            goto end;
+        }
+        body[0] = (FLV_VIDEO_TAG_FRAME_TYPE_KEYFRAME << 4) | FLV_VIDEO_TAG_CODEC_AVC;
+        body[1] = FLV_AVC_PACKET_TYPE_SEQUENCE_HEADER;
+        body[2] = body[3] = body[4] = 0;
+        length = 5 + (uint32)flvgen_avc_configuration(opts, body + 5);
+        res = flvgen_write_tag(&gen, FLV_TAG_TYPE_VIDEO, opts->start_time, body, length);
+    }
+    if (res == OK && !gen.truncated && opts->audio_codec == FLVGEN_AUDIO_AAC) {
+        /* AudioSpecificConfig: AAC LC, 44100 Hz, stereo */
+        byte body[4];
+        body[0] = 0xAF;
+        body[1] = FLV_AAC_PACKET_TYPE_SEQUENCE_HEADER;
+        body[2] = 0x12;
+        body[3] = 0x10;
+        res = flvgen_write_tag(&gen, FLV_TAG_TYPE_AUDIO, opts->start_time, body, sizeof(body));
+    }
+
+    /* interleaved frames, in timestamp order */
+    gop_frames = (uint32)(opts->keyframe_interval * opts->frame_rate + 0.5);
+    if (gop_frames < 1) {
+        gop_frames = 1;
+    }
+    audio_frame_duration = 1000.0 * ((opts->audio_codec == FLVGEN_AUDIO_MP3) ?
+        FLVGEN_MP3_FRAME_SAMPLES : FLVGEN_AAC_FRAME_SAMPLES) / FLVGEN_SAMPLE_RATE;
+    duration = opts->duration * 1000.0;
+    video_frame = audio_frame = 0;
+
+    while (res == OK && !gen.truncated) {
+        int error = OK;
+
+        video_time = (opts->video_codec != FLVGEN_VIDEO_NONE) ? video_frame * 1000.0 / opts->frame_rate : duration;
+        audio_time = (opts->audio_codec != FLVGEN_AUDIO_NONE) ? audio_frame * audio_frame_duration : duration;
+
+        if (video_time >= duration && audio_time >= duration) {
+            break;
+        }
+
+        if ((opts->max_tags > 0 && gen.tag_number >= opts->max_tags)
+        || (opts->max_size > 0 && gen.written >= opts->max_size)) {
+            /* the streams end with their last written frame */
+            generated = 0;
+            if (opts->video_codec != FLVGEN_VIDEO_NONE) {
+                generated = video_time;
+            }
+            if (opts->audio_codec != FLVGEN_AUDIO_NONE && audio_time > generated) {
+                generated = audio_time;
+            }
+            res = flvgen_fix_duration(&gen, generated);
+            break;
+        }
+
+        if (video_time <= audio_time) {
+            length = flvgen_video_frame(&gen, video_frame, (video_frame % gop_frames) == 0, &error);
+            if (error == OK) {
+                res = flvgen_write_tag(&gen, FLV_TAG_TYPE_VIDEO, opts->start_time + (uint32)video_time, gen.body, length);
+            }
+            video_frame++;
+        }
+        else {
+            length = flvgen_audio_frame(&gen, &error);
+            if (error == OK) {
+                res = flvgen_write_tag(&gen, FLV_TAG_TYPE_AUDIO, opts->start_time + (uint32)audio_time, gen.body, length);
+            }
+            audio_frame++;
+        }
+        if (error != OK) {
+            res = error;
+        }
+    }
+
+end:
+    if (fclose(gen.out) != 0 && res == OK) {
+        res = ERROR_WRITE;
+    }
+    free(gen.body);
+
+    if (res == OK && opts->verbose) {
+        fprintf(stdout, "%s successfully written (%u tags, %" PRI_LL "u bytes)\n",
+            opts->output_file, (unsigned int)gen.tag_number, (unsigned long long)gen.written);
+    }
+    return res;
+}
+
+static void version(void) {
+    printf("flvgen %s\n\n", PACKAGE_VERSION);
+    printf("%s\n", COPYRIGHT_STR);
+    printf("This is free software; see the source for copying conditions. There is NO\n"
+           "warranty; not even for MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.\n\n");
+}
+
+static void usage(const char * name) {
+    fprintf(stderr, "Usage: %s [OPTIONS] OUTPUT_FILE\n", name);
+    fprintf(stderr, "Try `%s --help' for more information.\n", name);
+}
+
+static void help(const char * name) {
+    int i;
+
+    printf("Usage: %s [OPTIONS] OUTPUT_FILE\n", name);
+    printf("\nGenerate a synthetic FLV file, always identical for identical options.\n"
+           "\nStream options:\n"
+           "  -d, --duration=SECONDS    duration of the streams (default 10)\n"
+           "  -n, --tags=COUNT          stop after COUNT tags\n"
+           "      --size=BYTES          stop once the file reaches BYTES, which may be\n"
+           "                            followed by k, M or G (binary multiples)\n"
+           "      --video=CODEC         CODEC is 'avc' (default), 'h263', 'vp6' or 'none'\n"
+           "      --audio=CODEC         CODEC is 'aac' (default), 'mp3' or 'none'\n"
+           "      --video-bitrate=KBPS  average video bitrate (default 500)\n"
+           "      --audio-bitrate=KBPS  audio bitrate (default 128)\n"
+           "      --frame-rate=FPS      video frame rate (default 25)\n"
+           "      --width=PIXELS        video width (default 320)\n"
+           "      --height=PIXELS       video height (default 240)\n"
+           "  -k, --keyframe-interval=SECONDS\n"
+           "                            time between keyframes (default 2)\n"
+           "      --metadata-size=BYTES pad onMetaData to about BYTES\n"
+           "      --no-metadata         do not write an onMetaData tag\n"
+           "      --start-time=MS       timestamp of the first tag, 16777216 or more\n"
+           "                            requiring extended timestamps\n"
+           "      --wrap-timestamps     do not write the timestamp extension, so that\n"
+           "                            timestamps wrap around after 16777215 ms\n"
+           "  -s, --seed=NUMBER         seed of the pseudo-random payloads (default 1)\n"
+           "\nCorruption options:\n"
+           "      --corrupt=PATTERN     damage the file, this option can be repeated;\n"
+           "                            PATTERN is one of:");
+    for (i = 0; corruption_names[i] != NULL; i++) {
+        printf("%s%s", (i % 5 == 0) ? "\n                             " : " ", corruption_names[i]);
+    }
+    printf("\n"
+           "      --corrupt-at=TAG      damage the first media tag from the TAG-th one,\n"
+           "                            counting from 0 (default 10)\n"
+           "\nCommon options:\n"
+           "  -v, --verbose             display informative messages\n"
+           "\nMiscellaneous:\n"
+           "  -V, --version             print version information and exit\n"
+           "  -h, --help                display this information and exit\n");
+    printf("\nPlease report bugs to <%s>\n", PACKAGE_BUGREPORT);
+}
+
+/* parse a positive number */
+static int parse_double(const char * arg, double min, double max, double * value) {
+    char * end;
+    double result = strtod(arg, &end);
+    if (*arg == 0 || *end != 0 || result != result || result < min || result > max) {
+        return 0;
+    }
+    *value = result;
+    return 1;
+}
+
+static int parse_uint32(const char * arg, uint32 min, uint32 max, uint32 * value) {
+    char * end;
+    double result = strtod(arg, &end);
+    if (*arg == 0 || *end != 0 || !(result >= min && result <= max) || result != (double)(uint32)result) {
+        return 0;
+    }
+    *value = (uint32)result;
+    return 1;
+}
+
+/* parse a size with an optional binary multiple suffix */
+static int parse_size(const char * arg, uint64 * value) {
+    char * end;
+    double result = strtod(arg, &end);
+    if (*arg == 0 || result != result || result < 0) {
+        return 0;
+    }
+    switch (*end) {
+        case 'k': case 'K': result *= 1024.0; end++; break;
+        case 'm': case 'M': result *= 1024.0 * 1024.0; end++; break;
+        case 'g': case 'G': result *= 1024.0 * 1024.0 * 1024.0; end++; break;
+        default: break;
+    }
+    if (*end != 0 || result > 1.8e19) {
+        return 0;
+    }
+    *value = (uint64)result;
+    return 1;
+}
+
+static int parse_command_line(int argc, char ** argv, flvgen_opts * options) {
+    int option, option_index;
+
+    option_index = 0;
+    do {
+        option = getopt_long(argc, argv,
+            DURATION_OPTION
+            TAGS_OPTION
+            KEYFRAME_INTERVAL_OPTION
+            SEED_OPTION
+            VERBOSE_OPTION
+            VERSION_OPTION
+            HELP_OPTION,
+            long_options, &option_index);
+        switch (option) {
+            /*
+                stream options
+            */
+            case 'd':
+                if (!parse_double(optarg, 0, 4294967.295, &options->duration)) {
+                    fprintf(stderr, "%s: invalid duration -- %s\n", argv[0], optarg);
+                    usage(argv[0]);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'n':
+                if (!parse_uint32(optarg, 1, 0xFFFFFFFFu, &options->max_tags)) {
+                    fprintf(stderr, "%s: invalid number of tags -- %s\n", argv[0], optarg);
+                    usage(argv[0]);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case SIZE_OPTION_ID:
+                if (!parse_size(optarg, &options->max_size)) {
+                    fprintf(stderr, "%s: invalid size -- %s\n", argv[0], optarg);
+                    usage(argv[0]);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case VIDEO_OPTION_ID:
+                if (!strcmp(optarg, "avc")) {
+                    options->video_codec = FLVGEN_VIDEO_AVC;
+                }
+                else if (!strcmp(optarg, "h263")) {
+                    options->video_codec = FLVGEN_VIDEO_H263;
+                }
+                else if (!strcmp(optarg, "vp6")) {
+                    options->video_codec = FLVGEN_VIDEO_VP6;
+                }
+                else if (!strcmp(optarg, "none")) {
+                    options->video_codec = FLVGEN_VIDEO_NONE;
+                }
+                else {
+                    fprintf(stderr, "%s: invalid video codec -- %s\n", argv[0], optarg);
+                    usage(argv[0]);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case AUDIO_OPTION_ID:
+                if (!strcmp(optarg, "aac")) {
+                    options->audio_codec = FLVGEN_AUDIO_AAC;
+                }
+                else if (!strcmp(optarg, "mp3")) {
+                    options->audio_codec = FLVGEN_AUDIO_MP3;
+                }
+                else if (!strcmp(optarg, "none")) {
+                    options->audio_codec = FLVGEN_AUDIO_NONE;
+                }
+                else {
+                    fprintf(stderr, "%s: invalid audio codec -- %s\n", argv[0], optarg);
+                    usage(argv[0]);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case VIDEO_BITRATE_OPTION_ID:
+                if (!parse_uint32(optarg, 1, 1000000, &options->video_bitrate)) {
+                    fprintf(stderr, "%s: invalid video bitrate -- %s\n", argv[0], optarg);
+                    usage(argv[0]);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case AUDIO_BITRATE_OPTION_ID:
+                if (!parse_uint32(optarg, 8, 10000, &options->audio_bitrate)) {
+                    fprintf(stderr, "%s: invalid audio bitrate -- %s\n", argv[0], optarg);
+                    usage(argv[0]);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case FRAME_RATE_OPTION_ID:
+                if (!parse_double(optarg, 0.01, 1000, &options->frame_rate)) {
+                    fprintf(stderr, "%s: invalid frame rate -- %s\n", argv[0], optarg);
+                    usage(argv[0]);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case WIDTH_OPTION_ID:
+                if (!parse_uint32(optarg, 2, 4080, &options->width) || (options->width & 1)) {
+                    fprintf(stderr, "%s: invalid width -- %s\n", argv[0], optarg);
+                    usage(argv[0]);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case HEIGHT_OPTION_ID:
+                if (!parse_uint32(optarg, 2, 4080, &options->height) || (options->height & 1)) {
+                    fprintf(stderr, "%s: invalid height -- %s\n", argv[0], optarg);
+                    usage(argv[0]);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'k':
+                if (!parse_double(optarg, 0, 3600, &options->keyframe_interval)) {
+                    fprintf(stderr, "%s: invalid keyframe interval -- %s\n", argv[0], optarg);
+                    usage(argv[0]);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case METADATA_SIZE_OPTION_ID:
+                if (!parse_uint32(optarg, 0, FLVGEN_MAX_BODY_LENGTH, &options->metadata_size)) {
+                    fprintf(stderr, "%s: invalid metadata size -- %s\n", argv[0], optarg);
+                    usage(argv[0]);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case NO_METADATA_OPTION_ID: options->no_metadata = 1; break;
+            case START_TIME_OPTION_ID:
+                if (!parse_uint32(optarg, 0, 0xFFFFFFFFu, &options->start_time)) {
+                    fprintf(stderr, "%s: invalid start time -- %s\n", argv[0], optarg);
+                    usage(argv[0]);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case WRAP_TIMESTAMPS_OPTION_ID: options->wrap_timestamps = 1; break;
+            case 's':
+                if (!parse_uint32(optarg, 0, 0xFFFFFFFFu, &options->seed)) {
+                    fprintf(stderr, "%s: invalid seed -- %s\n", argv[0], optarg);
+                    usage(argv[0]);
+                    return EXIT_FAILURE;
+                }
+                break;
+            /*
+                corruption options
+            */
+            case CORRUPT_OPTION_ID:
+                {
+                    int i;
+                    for (i = 0; corruption_names[i] != NULL; i++) {
+                        if (!strcmp(optarg, corruption_names[i])) {
+                            options->corruptions |= 1u << i;
+                            break;
+                        }
+                    }
+                    if (corruption_names[i] == NULL) {
+                        fprintf(stderr, "%s: invalid corruption pattern -- %s\n", argv[0], optarg);
+                        usage(argv[0]);
+                        return EXIT_FAILURE;
+                    }
+                } break;
+            case CORRUPT_AT_OPTION_ID:
+                if (!parse_uint32(optarg, 0, 0xFFFFFFFFu, &options->corrupt_at)) {
+                    fprintf(stderr, "%s: invalid tag number -- %s\n", argv[0], optarg);
+                    usage(argv[0]);
+                    return EXIT_FAILURE;
+                }
+                break;
+            /*
+                common options
+            */
+            case 'v': options->verbose = 1; break;
+            /*
+                Miscellaneous
+            */
+            case 'V':
+                version();
+                exit(EXIT_SUCCESS);
+                break;
+            case 'h':
+                help(argv[0]);
+                exit(EXIT_SUCCESS);
+                break;
+            /* last option */
+            case EOF: break;
+            /*
+                error cases
+            */
+            /* unknown option */
+            case '?':
+            /* missing argument */
+            case ':':
+            /* we should not be here */
+            default:
+                usage(argv[0]);
+                return EXIT_FAILURE;
+        }
+    } while (option != EOF);
+
+    /* output filename */
+    if (optind > 0 && optind < argc) {
+        options->output_file = argv[optind];
+    }
+    else {
+        fprintf(stderr, "%s: no output file\n", argv[0]);
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    return OK;
+}
+
+int main(int argc, char ** argv) {
+    int errcode;
+    flvgen_opts options;
+
+    /* default options */
+    memset(&options, 0, sizeof(options));
+    options.duration = 10;
+    options.video_codec = FLVGEN_VIDEO_AVC;
+    options.audio_codec = FLVGEN_AUDIO_AAC;
+    options.video_bitrate = 500;
+    options.audio_bitrate = 128;
+    options.frame_rate = 25;
+    options.width = 320;
+    options.height = 240;
+    options.keyframe_interval = 2;
+    options.corrupt_at = 10;
+    options.seed = 1;
+
+    errcode = parse_command_line(argc, argv, &options);
+
+    if (errcode == OK) {
+        errcode = flvgen_generate(&options);
+
+        /* error report */
+        switch (errcode) {
+            case ERROR_MEMORY: fprintf(stderr, "%s: memory allocation error\n", argv[0]); break;
+            case ERROR_OPEN_WRITE: fprintf(stderr, "%s: cannot open %s for writing\n", argv[0], options.output_file); break;
+            case ERROR_WRITE: fprintf(stderr, "%s: unable to write to %s\n", argv[0], options.output_file); break;
+            default: break;
+        }
+    }
+
+    return errcode;
+}
@@ -0,0 +1,90 @@
+/*
+    FLVMeta - FLV Metadata Editor
+
+    Copyright (C) 2007-2014 Marc Noirot <marc.noirot AT gmail.com>
+
+    This file is part of FLVMeta.
+
+    FLVMeta is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    FLVMeta is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FLVMeta; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+#include <stdlib.h>
+
+#include "memcount.h"
+
+static memcount_stats counters;
+
+#ifdef MEMCOUNT_WRAP
+
+/*
+    the linker redirects every call to the allocator functions to the
+    __wrap_ ones, the original functions being available as __real_ ones
+*/
+void * __real_malloc(size_t size);
+void * __real_calloc(size_t count, size_t size);
+void * __real_realloc(void * ptr, size_t size);
+void __real_free(void * ptr);
+
+void * __wrap_malloc(size_t size) {
+    counters.allocations++;
+    counters.allocated_bytes += size;
+    return __real_malloc(size);
+}
+
+void * __wrap_calloc(size_t count, size_t size) {
+    counters.allocations++;
+    counters.allocated_bytes += count * size;
+    return __real_calloc(count, size);
+}
+
+void * __wrap_realloc(void * ptr, size_t size) {
+    if (ptr == NULL) {
+        counters.allocations++;
+    }
+    else {
+        counters.reallocations++;
+    }
+    counters.allocated_bytes += size;
+    return __real_realloc(ptr, size);
+}
+
+void __wrap_free(void * ptr) {
+    if (ptr != NULL) {
+        counters.frees++;
+    }
+    __real_free(ptr);
+}
+
+int memcount_enabled(void) {
+    return 1;
+}
+
+#else /* MEMCOUNT_WRAP */
+
+int memcount_enabled(void) {
+    return 0;
+}
+
+#endif /* MEMCOUNT_WRAP */
+
+void memcount_reset(void) {
+    counters.allocations = 0;
+    counters.reallocations = 0;
+    counters.frees = 0;
+    counters.allocated_bytes = 0;
+}
+
+void memcount_get(memcount_stats * stats) {
+    *stats = counters;
+}
@@ -0,0 +1,55 @@
+/*
+    FLVMeta - FLV Metadata Editor
+
+    Copyright (C) 2007-2014 Marc Noirot <marc.noirot AT gmail.com>
+
+    This file is part of FLVMeta.
+
+    FLVMeta is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    FLVMeta is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FLVMeta; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+#ifndef __MEMCOUNT_H__
+#define __MEMCOUNT_H__
+
+#include "types.h"
+
+/**
+    Allocation counters for the benchmarks.
+    They are maintained when the build wraps the C allocator functions
+    with the linker (MEMCOUNT_WRAP), and stay at zero otherwise.
+*/
+
+typedef struct __memcount_stats {
+    uint64 allocations;
+    uint64 reallocations;
+    uint64 frees;
+    uint64 allocated_bytes;
+} memcount_stats;
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/* whether allocations are actually counted */
+int memcount_enabled(void);
+
+void memcount_reset(void);
+
+void memcount_get(memcount_stats * stats);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __MEMCOUNT_H__ */